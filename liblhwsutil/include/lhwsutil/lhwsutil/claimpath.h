@@ -0,0 +1,37 @@
+#ifndef __LHWSUTIL_CLAIMPATH_H__
+#define __LHWSUTIL_CLAIMPATH_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace LHWSUtilNS
+{
+    // a nested claim, split and unescaped once so it can be resolved directly on the parsed claims
+    //
+    // a path starting with '/' is a json pointer ( rfc 6901, ~1 => '/', ~0 => '~' ), needed when a
+    // member name contains '.', e.g. /resource_access/my.client/roles
+    // anything else is '.' separated, e.g. realm_access.roles
+    // a numeric token indexes into an array, e.g. /aud/0
+    // the empty path is the claims object itself
+    class ClaimPath
+    {
+        public:
+            ClaimPath();
+            // throws std::runtime_error if path has an empty or invalid token
+            explicit ClaimPath( const std::string& _path );
+
+            const std::string& GetPath() const;
+            size_t NumTokens() const;
+            const std::string& GetToken( size_t i ) const;
+            // token i as an array index, -1 if it is not one
+            long GetIndex( size_t i ) const;
+
+        private:
+            std::string path;
+            std::vector< std::string > tokens;
+            std::vector< long > indices;
+    };
+}
+
+#endif
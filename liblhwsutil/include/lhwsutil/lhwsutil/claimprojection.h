@@ -0,0 +1,154 @@
+#ifndef __LHWSUTIL_CLAIMPROJECTION_H__
+#define __LHWSUTIL_CLAIMPROJECTION_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace LHWSUtilNS
+{
+    enum class ClaimType
+    {
+        String = 0,
+        Bool,
+        Int,
+        // a json array of strings or a space separated string ( e.g. scope )
+        StringList
+    };
+
+    const size_t maxProjectedClaims = 64;
+
+    // the type erased half of ClaimProjection< T >, filled in by the validator
+    class ClaimProjectionBase
+    {
+        public:
+            ClaimProjectionBase();
+            virtual ~ClaimProjectionBase();
+
+            ClaimProjectionBase( const ClaimProjectionBase& other ) = delete;
+            ClaimProjectionBase& operator=( const ClaimProjectionBase& other ) = delete;
+
+            // index of the top level claim, -1 if it is not projected
+            int FindClaim( const char* claim, size_t claimSize ) const;
+
+            size_t NumClaims() const;
+            const std::string& GetClaimName( size_t index ) const;
+            ClaimType GetClaimType( size_t index ) const;
+            bool ClaimIsRequired( size_t index ) const;
+
+            // write the value of claim index into target, a T* for ClaimProjection< T >
+            virtual void SetString( void* target, size_t index, const char* str, size_t strSize ) const = 0;
+            virtual void SetBool( void* target, size_t index, bool value ) const = 0;
+            virtual void SetInt( void* target, size_t index, long value ) const = 0;
+            virtual void ClearList( void* target, size_t index ) const = 0;
+            virtual void AppendToList( void* target, size_t index, const char* str, size_t strSize ) const = 0;
+
+        protected:
+            // return the claim's index
+            // throws std::runtime_error if the claim is already mapped or maxProjectedClaims are mapped
+            size_t addClaim( const std::string& claim, ClaimType type, bool required );
+
+        private:
+            struct ProjectedClaim
+            {
+                std::string name;
+                ClaimType type;
+                bool required;
+            };
+
+            std::vector< ProjectedClaim > claims;
+    };
+
+    // maps top level claims onto fields of T, declared once and shared between threads, e.g.
+    //
+    //   ClaimProjection< MyClaims > projection;
+    //   projection.MapString( "sub", &MyClaims::sub )
+    //             .MapStringList( "scope", &MyClaims::scopes )
+    //             .MapInt( "exp", &MyClaims::exp, false );
+    //
+    // fields of optional claims absent from a token are left untouched
+    template< typename T >
+    class ClaimProjection : public ClaimProjectionBase
+    {
+        public:
+            ClaimProjection()
+                : ClaimProjectionBase()
+                , stringFields()
+                , boolFields()
+                , intFields()
+                , listFields()
+            {
+            }
+
+            ClaimProjection& MapString( const std::string& claim, std::string T::* field, bool required = true )
+            {
+                size_t index = addClaim( claim, ClaimType::String, required );
+                fieldsFor( stringFields, index ) = field;
+                return *this;
+            }
+
+            ClaimProjection& MapBool( const std::string& claim, bool T::* field, bool required = true )
+            {
+                size_t index = addClaim( claim, ClaimType::Bool, required );
+                fieldsFor( boolFields, index ) = field;
+                return *this;
+            }
+
+            ClaimProjection& MapInt( const std::string& claim, long T::* field, bool required = true )
+            {
+                size_t index = addClaim( claim, ClaimType::Int, required );
+                fieldsFor( intFields, index ) = field;
+                return *this;
+            }
+
+            ClaimProjection& MapStringList( const std::string& claim,
+                                            std::vector< std::string > T::* field,
+                                            bool required = true )
+            {
+                size_t index = addClaim( claim, ClaimType::StringList, required );
+                fieldsFor( listFields, index ) = field;
+                return *this;
+            }
+
+            void SetString( void* target, size_t index, const char* str, size_t strSize ) const
+            {
+                ( static_cast< T* >( target )->*stringFields[ index ] ).assign( str, strSize );
+            }
+
+            void SetBool( void* target, size_t index, bool value ) const
+            {
+                static_cast< T* >( target )->*boolFields[ index ] = value;
+            }
+
+            void SetInt( void* target, size_t index, long value ) const
+            {
+                static_cast< T* >( target )->*intFields[ index ] = value;
+            }
+
+            void ClearList( void* target, size_t index ) const
+            {
+                ( static_cast< T* >( target )->*listFields[ index ] ).clear();
+            }
+
+            void AppendToList( void* target, size_t index, const char* str, size_t strSize ) const
+            {
+                ( static_cast< T* >( target )->*listFields[ index ] ).emplace_back( str, strSize );
+            }
+
+        private:
+            // indexed by claim index, null for claims of another type
+            std::vector< std::string T::* > stringFields;
+            std::vector< bool T::* > boolFields;
+            std::vector< long T::* > intFields;
+            std::vector< std::vector< std::string > T::* > listFields;
+
+            template< typename F >
+            static F& fieldsFor( std::vector< F >& fields, size_t index )
+            {
+                fields.resize( index + 1, nullptr );
+                return fields[ index ];
+            }
+    };
+}
+
+#endif
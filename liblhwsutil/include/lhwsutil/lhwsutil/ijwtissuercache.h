@@ -1,12 +1,29 @@
 #ifndef __LHWSUTIL_IJWTISSUERCACHE_H__
 #define __LHWSUTIL_IJWTISSUERCACHE_H__
 
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace LHWSUtilNS
 {
+    // a string held by an issuer, null terminated and valid for as long as the issuer is
+    struct JwtIssuerStr
+    {
+        JwtIssuerStr();
+        JwtIssuerStr( const char* _data, size_t _size );
+
+        bool empty() const;
+        std::string str() const;
+        const char* c_str() const;
+
+        const char* data;
+        size_t size;
+    };
+
     class IJwtIssuer
     {
         public:
@@ -15,9 +32,22 @@ namespace LHWSUtilNS
 
             virtual const std::string& GetUrl() const = 0;
             virtual bool AlgIsSupported( const std::string& alg ) const = 0;
+            // throws if alg is unsupported
             virtual const std::string& GetKeyPemForAlg( const std::string& alg ) const = 0;
             virtual const std::string& GetClientAuthzBearerToken() const = 0;
+            // the raw openid-configuration, only retained if debug logging was enabled when loaded
             virtual const std::string& GetOpenIdConfiguration() const = 0;
+            // from the openid-configuration, empty unless it was pulled down, empty by default
+            virtual JwtIssuerStr GetIntrospectionEndpoint() const;
+            virtual JwtIssuerStr GetJwksUri() const;
+
+            // the getters above without a std::string, what the validator uses
+            // by default views of the std::string getters, a JwtIssuer's point into its record
+            virtual JwtIssuerStr GetUrlView() const;
+            // throws if alg is unsupported
+            virtual JwtIssuerStr GetKeyPemForAlgView( const std::string& alg ) const;
+            virtual JwtIssuerStr GetClientAuthzBearerTokenView() const;
+            virtual JwtIssuerStr GetOpenIdConfigurationView() const;
     };
 
     struct JwtIssuerCacheParams
@@ -31,6 +61,15 @@ namespace LHWSUtilNS
         // pulldownOpenIdConfiguration && algToKeyPem[ alg ].empty => fetch jwk url and generate pem dynamically at load
     };
 
+    struct JwtIssuerMemoryUsage
+    {
+        JwtIssuerMemoryUsage();
+
+        std::string iss;
+        // approximate heap bytes held for the issuer by the cache
+        size_t bytes;
+    };
+
     class IJwtIssuerCache
     {
         public:
@@ -40,10 +79,50 @@ namespace LHWSUtilNS
             virtual void LoadIssuer( const JwtIssuerCacheParams& cacheParams ) = 0;
             virtual bool IssuerIsLoaded( const std::string& iss ) const = 0;
             virtual std::shared_ptr< IJwtIssuer > GetIssuer( const std::string& iss ) = 0;
+
+            // for a fixed set of issuers, builds a read-only perfect hash table of the loaded issuers
+            // which GetIssuer and IssuerIsLoaded use, without the cache's lock, until Unfreeze
+            // LoadIssuer throws while the cache is frozen
+            // return 0 if frozen
+            // return !=0 and stay unfrozen if an issuer is still pending its load or the table cannot be built
+            // by default the cache cannot be frozen, Freeze returns 2
+            virtual int Freeze();
+            virtual void Unfreeze();
+            virtual bool IsFrozen() const;
+
+            // appends the usage of each loaded issuer to usageOut, return the total
+            // by default nothing is appended and 0 returned
+            virtual size_t GetMemoryUsage( std::vector< JwtIssuerMemoryUsage >& usageOut ) const;
     };
 
     std::shared_ptr< IJwtIssuerCache > GetStandardJwtIssuerCache();
 
+    // return true and fill cacheParams, its iss already set, if iss may be loaded
+    typedef std::function< bool( const std::string& iss, JwtIssuerCacheParams& cacheParams ) > JwtIssuerResolver;
+
+    // for a cache which loads an issuer on its first use rather than up front, e.g. an issuer per tenant
+    struct LazyJwtIssuerCacheParams
+    {
+        LazyJwtIssuerCacheParams();
+
+        // an iss matching one of these is loaded with issuerParams, a '*' matches one or more
+        // characters other than '/', '?' and '#', e.g. "https://idp.example.com/realms/*"
+        std::vector< std::string > allowedIssPatterns;
+        // the params of an iss matching allowedIssPatterns, with its iss set
+        JwtIssuerCacheParams issuerParams;
+        // consulted for an iss which matches no pattern, may be empty
+        JwtIssuerResolver resolver;
+        // the least recently used issuers are evicted once the cache holds more, 0 => no limit
+        size_t maxMemoryBytes;
+        // an iss which failed to load is not loaded again for this long
+        long failedLoadRetrySeconds;
+    };
+
+    // issuers are loaded by GetIssuer, outside the cache's lock, the first time they are used and
+    // again once evicted, those given to LoadIssuer are loaded up front and reloaded the same way
+    // the cache cannot be frozen
+    std::shared_ptr< IJwtIssuerCache > GetStandardJwtIssuerCache( const LazyJwtIssuerCacheParams& params );
+
 
     int AuthzBearerTokenForClientIdSecret( const std::string& clientId,
                                            const std::string& clientSecret,
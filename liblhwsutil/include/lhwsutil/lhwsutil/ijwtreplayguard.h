@@ -0,0 +1,63 @@
+#ifndef __LHWSUTIL_IJWTREPLAYGUARD_H__
+#define __LHWSUTIL_IJWTREPLAYGUARD_H__
+
+#include <cstddef>
+#include <memory>
+
+namespace LHWSUtilNS
+{
+    // what a validator does with a token the guard could not record
+    enum class JwtReplayFailMode
+    {
+        // accept it, it may be replayed
+        Open = 0,
+        // reject it with JwtValidationResult::Error
+        Closed
+    };
+
+    enum class JwtReplayCheck
+    {
+        // not seen before, recorded until its exp
+        First = 0,
+        // recorded by an earlier check and its exp has not passed
+        Replayed,
+        // could not be recorded, the guard is full or exp is beyond maxLifetimeSeconds
+        Unrecorded
+    };
+
+    struct JwtReplayGuardParams
+    {
+        JwtReplayGuardParams();
+
+        // the guard's memory is allocated up front for this many jtis
+        size_t maxEntries;
+        // tokens living longer are not recorded, one-time tokens are short lived
+        long maxLifetimeSeconds;
+        JwtReplayFailMode failMode;
+    };
+
+    // the jtis of one-time tokens ( e.g. webhooks, DPoP proofs ) seen until their exp, so that a
+    // validator created with one in JwtValidatorParams rejects a second use of a token as
+    // JwtValidationResult::Replayed
+    // a jti is only unique within its issuer, so it is recorded together with the token's iss
+    // only tokens which passed every other check are recorded, a token without jti or exp is Invalid
+    class IJwtReplayGuard
+    {
+        public:
+            IJwtReplayGuard();
+            virtual ~IJwtReplayGuard();
+
+            // records iss and jti until exp unless already recorded, exp and now are seconds since the epoch
+            virtual JwtReplayCheck CheckAndRecord( const char* iss, size_t issSize,
+                                                   const char* jti, size_t jtiSize,
+                                                   long exp, long now ) = 0;
+            virtual JwtReplayFailMode GetFailMode() const = 0;
+            virtual size_t NumEntries() const = 0;
+    };
+
+    // iss and jti are held as 64 bit hashes, two distinct tokens are mistaken for a replay with a
+    // probability of about NumEntries() / 2^64
+    std::shared_ptr< IJwtReplayGuard > GetStandardJwtReplayGuard( const JwtReplayGuardParams& params );
+}
+
+#endif
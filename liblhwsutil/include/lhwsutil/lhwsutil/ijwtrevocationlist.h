@@ -0,0 +1,124 @@
+#ifndef __LHWSUTIL_IJWTREVOCATIONLIST_H__
+#define __LHWSUTIL_IJWTREVOCATIONLIST_H__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LHWSUtilNS
+{
+    // the claim a revocation matches
+    enum class JwtRevocationClaim
+    {
+        Jti = 0,
+        Sid
+    };
+
+    struct JwtRevocation
+    {
+        JwtRevocation();
+        JwtRevocation( JwtRevocationClaim _claim, const std::string& _value, long _exp );
+
+        JwtRevocationClaim claim;
+        std::string value;
+        // seconds since the epoch, the revocation is dropped once it passes as the tokens it
+        // revokes have expired by then
+        long exp;
+    };
+
+    // revoked jti and sid values checked by IJwtValidator before a token's key is looked up,
+    // a revoked token is rejected with JwtValidationResult::Revoked
+    // set it as the IJwtRevocationList singleton for validators to consult it
+    class IJwtRevocationList
+    {
+        public:
+            IJwtRevocationList();
+            virtual ~IJwtRevocationList();
+
+            virtual void Revoke( const JwtRevocation& revocation ) = 0;
+            // replaces every revocation at once, lookups see either the old or the new set
+            virtual void Reload( const std::vector< JwtRevocation >& revocations ) = 0;
+            // drops the revocations whose exp is not after now, return the number dropped
+            virtual size_t Expire( long now ) = 0;
+            virtual size_t NumRevocations() const = 0;
+
+            // whether value is revoked for claim and its revocation's exp is after now
+            virtual bool IsRevoked( JwtRevocationClaim claim,
+                                    const char* value,
+                                    size_t valueSize,
+                                    long now ) const = 0;
+    };
+
+    // expectedRevocations sizes the filter in front of the set, it is rebuilt larger if exceeded
+    std::shared_ptr< IJwtRevocationList > GetStandardJwtRevocationList( size_t expectedRevocations );
+
+    // return 0 and fill revocation from a line of the revocation stream
+    //   jti <value> <exp>
+    //   sid <value> <exp>
+    // return 1 for a blank or # comment line, !=0 otherwise if the line is invalid
+    int ParseJwtRevocation( const char* line, size_t lineSize, JwtRevocation& revocation );
+
+    // feeds an IJwtRevocationList from a local file being appended to or a unix socket, one
+    // ParseJwtRevocation line at a time
+    // a "begin" line starts a bulk reload, the lines up to the following "end" replace every
+    // revocation at once through IJwtRevocationList::Reload
+    // a file which is replaced ( e.g. renamed over ) or truncated is read again from its start as a
+    // bulk reload
+    // Poll does the io on the calling thread, e.g. from a dedicated thread or an event loop
+    class JwtRevocationFeed
+    {
+        public:
+            JwtRevocationFeed( const std::shared_ptr< IJwtRevocationList >& _revocationList );
+            ~JwtRevocationFeed();
+
+            JwtRevocationFeed( const JwtRevocationFeed& other ) = delete;
+            JwtRevocationFeed& operator=( const JwtRevocationFeed& other ) = delete;
+
+            // return 0 if the feed will follow the file at path, read as a bulk reload on the next Poll
+            int TailFile( const std::string& path );
+            // return 0 if connected to the stream socket listening at path
+            int ConnectUnixSocket( const std::string& path );
+
+            // applies what has arrived, waiting up to timeoutMs when nothing has, and expires the
+            // list's passed revocations about once a minute
+            // a source which could not be opened or was dropped is retried on the next Poll
+            // return 0 if the source was read, !=0 if it is unavailable
+            int Poll( int timeoutMs );
+
+            // lines which failed to parse, skipped
+            size_t NumInvalidLines() const;
+
+        private:
+            std::shared_ptr< IJwtRevocationList > revocationList;
+            std::string path;
+            bool isSocket;
+            int fd;
+            // identity and read offset of the tailed file
+            unsigned long long fileDev;
+            unsigned long long fileIno;
+            long long fileOffset;
+            std::string pendingLine;
+            bool inBulkReload;
+            // the file is being read from its start, its revocations replace the list at its end
+            bool fileReloadPending;
+            std::vector< JwtRevocation > bulkRevocations;
+            size_t numInvalidLines;
+            long lastExpiredAt;
+
+            void closeSource();
+            int openFile();
+            int connectSocket();
+            void consume( const char* data, size_t dataSize );
+            void applyLine( const char* line, size_t lineSize );
+    };
+}
+
+#include <lhmiscutil/singleton.h>
+
+namespace LHMiscUtilNS
+{
+    EnableClassAsSingleton( LHWSUtilNS::IJwtRevocationList, SingletonCanBeSet::WhenEmpty );
+}
+
+#endif
@@ -1,9 +1,19 @@
 #ifndef __LHWSUTIL_IJWTVALIDATOR_H__
 #define __LHWSUTIL_IJWTVALIDATOR_H__
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_set>
+#include <vector>
+
+#include <lhwsutil/claimpath.h>
+#include <lhwsutil/claimprojection.h>
+#include <lhwsutil/ijwtreplayguard.h>
+#include <lhwsutil/jwtpolicy.h>
+#include <lhwsutil/metrics.h>
+#include <lhwsutil/validatedjwt.h>
 
 namespace LHWSUtilNS
 {
@@ -22,6 +32,76 @@ namespace LHWSUtilNS
             virtual int GetGrantStrValue( const std::string& grant,
                                           std::string& valueOut ) const = 0;
             virtual void ToString( std::string& out, bool prettyPrint ) const = 0;
+
+            // nested claims, see ClaimPath
+            // by default the top level claim is serialized through GetGrantJsonValue and parsed,
+            // ValidJwt and ValidJwtJson resolve path directly on their parsed claims
+            // return 0 and set valueOut if the claim at path exists and has the type
+            virtual int GetClaimStrValue( const ClaimPath& path,
+                                          std::string& valueOut ) const;
+            virtual int GetClaimBoolValue( const ClaimPath& path,
+                                           bool& valueOut ) const;
+            virtual int GetClaimIntValue( const ClaimPath& path,
+                                          long& valueOut ) const;
+            // return 0 if the claim at path is an array, setting containsOut if one of its elements
+            // is the string value
+            virtual int ClaimArrayContains( const ClaimPath& path,
+                                            const std::string& value,
+                                            bool& containsOut ) const;
+            // return 0 if the claim at path is an array, calling visitor with each of its string
+            // elements until visitor returns false
+            virtual int ForEachClaimStr( const ClaimPath& path,
+                                         const std::function< bool( const char* str, size_t strSize ) >& visitor ) const;
+    };
+
+    struct JwtIntrospectionParams
+    {
+        JwtIntrospectionParams();
+
+        // the call fails once the deadline passes, time_point::max() => no deadline
+        std::chrono::steady_clock::time_point deadline;
+        // 0 => no limit
+        long connectTimeoutMs;
+        // send a second introspection request once the first has taken longer than the
+        // hedgePercentile of previously observed introspection latencies
+        bool hedge;
+        double hedgePercentile;
+        // hedging stays off until this many latencies have been observed
+        unsigned long hedgeMinSamples;
+    };
+
+    // checks made on the decoded token before its key is looked up and its signature verified, or
+    // before it is introspected, so that expired or foreign tokens cost a decode and nothing more
+    // a token failing one is Invalid
+    struct JwtValidationChecks
+    {
+        JwtValidationChecks();
+
+        // longer tokens are rejected before they are decoded, 0 => no limit
+        size_t maxTokenSize;
+        // exp and nbf are enforced when present, allowing this much drift between clocks
+        long clockSkewSeconds;
+        // reject tokens without exp
+        bool requireExp;
+        // reject tokens without a kid header
+        bool requireKid;
+        // the header algs accepted, empty => any the issuer supports
+        std::vector< std::string > algs;
+        // the iss values accepted, empty => any the issuer cache knows
+        std::vector< std::string > issuers;
+        // aud, a string or an array of strings, must hold one of these, empty => aud is not checked
+        std::vector< std::string > audiences;
+    };
+
+    // settings fixed for the life of a validator, given to IJwtValidatorFactory::CreateJwtValidator
+    // so that no validation races with a change to them
+    struct JwtValidatorParams
+    {
+        JwtValidatorParams();
+
+        // makes every token validated by the validator one-time, see IJwtReplayGuard, null => off
+        std::shared_ptr< IJwtReplayGuard > replayGuard;
+        JwtValidationChecks checks;
     };
 
     class IJwtValidator
@@ -35,6 +115,56 @@ namespace LHWSUtilNS
             virtual std::unique_ptr< IValidJwt > ValidateIntoJwt( const std::string& b64UrlEncodedJwt ) const = 0;
 
             virtual std::unique_ptr< LHWSUtilNS::IValidJwt > IntrospectJwt( const std::string& b64UrlEncodedJwt ) const = 0;
+            // by default params are ignored and the overload above is called
+            virtual std::unique_ptr< LHWSUtilNS::IValidJwt > IntrospectJwt( const std::string& b64UrlEncodedJwt,
+                                                                          const JwtIntrospectionParams& params ) const;
+
+            // as above, also evaluating policy against the token's claims
+            // return the jwt and set decision to Allow if it is valid and the policy allows it
+            // return nullptr and set decision to Deny otherwise
+            // the policy is evaluated before the signature is verified or the token introspected
+            // so denied tokens cost neither
+            // by default every token is denied, a validator which cannot evaluate policies allows none
+            virtual std::unique_ptr< IValidJwt > ValidateIntoJwt( const std::string& b64UrlEncodedJwt,
+                                                                const JwtPolicy& policy,
+                                                                JwtPolicyDecision& decision ) const;
+            virtual std::unique_ptr< IValidJwt > IntrospectJwt( const std::string& b64UrlEncodedJwt,
+                                                              const JwtIntrospectionParams& params,
+                                                              const JwtPolicy& policy,
+                                                              JwtPolicyDecision& decision ) const;
+
+            // as above, filling validatedJwt with the result and the common claims rather than
+            // allocating an IValidJwt, validatedJwt can be reused across calls
+            // return the result, only Valid leaves claims in validatedJwt
+            // by default the claims are projected from the IValidJwt of the overloads above, and a
+            // token which is not Valid is reported Invalid
+            virtual JwtValidationResult ValidateIntoJwt( const std::string& b64UrlEncodedJwt,
+                                                       ValidatedJwt& validatedJwt ) const;
+            virtual JwtValidationResult IntrospectJwt( const std::string& b64UrlEncodedJwt,
+                                                     const JwtIntrospectionParams& params,
+                                                     ValidatedJwt& validatedJwt ) const;
+
+            // validates as ValidateIntoJwt and fills claims from the payload in a single pass,
+            // without building an IValidJwt
+            // return 0 if the token is valid and carries every required claim of projection
+            // return 1 if the token is invalid
+            // return 2 if a projected claim is missing or has the wrong type
+            // claims may have been partially filled when !=0
+            template< typename T >
+            int ValidateIntoClaims( const std::string& b64UrlEncodedJwt,
+                                    const ClaimProjection< T >& projection,
+                                    T& claims ) const
+            {
+                return validateIntoClaims( b64UrlEncodedJwt, projection, &claims );
+            }
+
+        protected:
+            // claims is a T* for a ClaimProjection< T >
+            // by default the token is validated by ValidateIntoJwt( b64UrlEncodedJwt ) and each
+            // projected claim read through the jwt's GetGrantJsonValue
+            virtual int validateIntoClaims( const std::string& b64UrlEncodedJwt,
+                                            const ClaimProjectionBase& projection,
+                                            void* claims ) const;
     };
 
     class IJwtValidatorFactory
@@ -44,6 +174,8 @@ namespace LHWSUtilNS
             virtual ~IJwtValidatorFactory();
 
             virtual std::unique_ptr< IJwtValidator > CreateJwtValidator() const = 0;
+            // by default nullptr, a validator which ignored params would e.g. accept replays
+            virtual std::unique_ptr< IJwtValidator > CreateJwtValidator( const JwtValidatorParams& params ) const;
     };
 
     std::shared_ptr< IJwtValidatorFactory > GetStandardJwtValidatorFactory();
@@ -60,6 +192,10 @@ namespace LHWSUtilNS
 
     int GetIdentifiers( const IValidJwt& jwt, UserIdentifiers& userIdentifiers );
 
+    // the claims of GetIdentifiers, for IJwtValidator::ValidateIntoClaims
+    const ClaimProjection< UserIdentifiers >& GetUserIdentifiersProjection();
+
+    // see also GetScopes( jwt, ScopeRegistry, ScopeSet ) in lhwsutil/scoperegistry.h
     int GetScopes( const IValidJwt& jwt, std::unordered_set< std::string >& scopes );
 }
 
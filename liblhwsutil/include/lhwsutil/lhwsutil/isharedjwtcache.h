@@ -0,0 +1,81 @@
+#ifndef __LHWSUTIL_ISHAREDJWTCACHE_H__
+#define __LHWSUTIL_ISHAREDJWTCACHE_H__
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <lhwsutil/ijwtissuercache.h>
+
+namespace LHWSUtilNS
+{
+    enum class SharedJwtCacheRole
+    {
+        // creates the segment, replacing any left by an earlier writer, and loads and publishes issuers
+        Writer = 0,
+        // opens the segment a writer created
+        Reader
+    };
+
+    // an introspection result recorded in the segment
+    enum class SharedJwtResult
+    {
+        // none recorded for the token, or it expired
+        Unknown = 0,
+        Active,
+        Inactive
+    };
+
+    struct SharedJwtCacheParams
+    {
+        SharedJwtCacheParams();
+
+        // the posix shared memory object, a '/' followed by characters other than '/'
+        std::string name;
+        SharedJwtCacheRole role;
+        // the layout of the segment, fixed by the writer, a reader takes them from the segment
+        size_t maxIssuers;
+        // an issuer whose url, bearer token, endpoints and key pems take more fails to publish
+        size_t maxIssuerBytes;
+        // the introspection results held, 0 => results are not shared
+        size_t maxResults;
+        // a result is held until the token's exp or for this long, whichever is sooner
+        long resultLifetimeSeconds;
+    };
+
+    // a host wide cache in a posix shared memory segment for pre-forked worker processes, so that
+    // an issuer's keys are fetched and a token introspected once per host rather than per worker
+    // e.g. the parent creates the Writer and loads its issuers before forking, each worker opens
+    // a Reader once forked and sets it as its IJwtIssuerCache and ISharedJwtCache singletons
+    // readers never lock the segment, a record being written is read again or treated as missing
+    class ISharedJwtCache : public IJwtIssuerCache
+    {
+        public:
+            ISharedJwtCache();
+            virtual ~ISharedJwtCache();
+
+            // writer only, loads and publishes every issuer given to LoadIssuer again, an issuer
+            // which fails to load keeps its published record
+            // does the io on the calling thread, e.g. from a timer in the writer process
+            // return the number of issuers which failed to load or publish
+            virtual size_t Refresh() = 0;
+
+            // the introspection result recorded for b64UrlEncodedJwt, now is seconds since the epoch
+            virtual SharedJwtResult FindResult( const std::string& b64UrlEncodedJwt, long now ) const = 0;
+            // records active for b64UrlEncodedJwt until exp, 0 => no exp, or resultLifetimeSeconds
+            // from now, dropped if another process is recording into the same slot
+            virtual void RecordResult( const std::string& b64UrlEncodedJwt, bool active, long exp, long now ) = 0;
+    };
+
+    // throws if the segment cannot be created or opened, or a reader finds no writer's segment
+    std::shared_ptr< ISharedJwtCache > GetSharedJwtCache( const SharedJwtCacheParams& params );
+}
+
+#include <lhmiscutil/singleton.h>
+
+namespace LHMiscUtilNS
+{
+    EnableClassAsSingleton( LHWSUtilNS::ISharedJwtCache, SingletonCanBeSet::WhenEmpty );
+}
+
+#endif
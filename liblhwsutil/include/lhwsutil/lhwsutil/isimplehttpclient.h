@@ -12,6 +12,27 @@ namespace LHWSUtilNS
         HttpRequestParams();
 
         bool verbose;
+        // 0 => no limit
+        long connectTimeoutMs;
+        long timeoutMs;
+        // 0 => disabled, otherwise a second identical request is sent if the first has not
+        // completed after hedgeAfterMs and the response of whichever succeeds first is used
+        long hedgeAfterMs;
+    };
+
+    // receives a response body incrementally as it is read off the wire
+    class IHttpResponseSink
+    {
+        public:
+            IHttpResponseSink();
+            virtual ~IHttpResponseSink();
+
+            // called at most once, before any data, when the size of the body is known
+            virtual void ExpectSize( size_t numBytes ) = 0;
+            // return 0 to continue, !=0 to abort the transfer
+            virtual int Consume( const char* data, size_t numBytes ) = 0;
+            // called once after the whole body was consumed, return !=0 to fail the request
+            virtual int Finish() = 0;
     };
 
     class ISimpleHttpClient
@@ -24,6 +45,11 @@ namespace LHWSUtilNS
             virtual int Get( const std::string& url,
                              const HttpRequestParams& params,
                              std::string& responseBody ) = 0;
+            // the default reads the whole body through the overload above and then hands it to
+            // responseSink, return its error, else that of the sink's Consume or Finish
+            virtual int Get( const std::string& url,
+                             const HttpRequestParams& params,
+                             IHttpResponseSink& responseSink );
 
             virtual int Post( const std::string& url,
                               const std::string& data,
@@ -34,6 +60,12 @@ namespace LHWSUtilNS
                               const std::unordered_map< std::string, std::string >& headers,
                               const HttpRequestParams& params,
                               std::string& responseBody ) = 0;
+            // the default reads the whole body as Get does
+            virtual int Post( const std::string& url,
+                              const std::string& data,
+                              const std::unordered_map< std::string, std::string >& headers,
+                              const HttpRequestParams& params,
+                              IHttpResponseSink& responseSink );
 
             virtual std::string UrlEscape( const std::string& data ) = 0;
     };
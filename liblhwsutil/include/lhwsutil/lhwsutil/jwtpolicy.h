@@ -0,0 +1,92 @@
+#ifndef __LHWSUTIL_JWTPOLICY_H__
+#define __LHWSUTIL_JWTPOLICY_H__
+
+#include <string>
+#include <vector>
+
+#include <lhwsutil/claimpath.h>
+
+namespace LHWSUtilNS
+{
+    class IValidJwt;
+
+    enum class JwtPolicyDecision
+    {
+        Allow = 0,
+        Deny
+    };
+
+    enum class JwtPolicyOp
+    {
+        // the claim is present
+        Exists = 0,
+        // a string, bool or integer claim equals value, an array claim has a string element equal to it
+        Equals,
+        // an array claim has a string element equal to value, a string claim has value as one of its
+        // space separated tokens ( e.g. scope )
+        Contains
+    };
+
+    struct JwtPolicyCondition
+    {
+        JwtPolicyCondition();
+
+        std::string path;
+        ClaimPath claimPath;
+        JwtPolicyOp op;
+        // a policy interns its claim names and values, conditions on the same top level claim share
+        // an index into JwtPolicy::GetClaimNames(), conditions with the same value one into GetValues()
+        size_t claimIndex;
+        size_t valueIndex;
+        // value parsed as a bool or integer literal, for matching bool and number claims
+        bool valueIsBool;
+        bool boolValue;
+        bool valueIsInt;
+        long intValue;
+    };
+
+    // conditions on a token's claims which must all hold for it to be allowed, compiled once and
+    // evaluated by IJwtValidator during validation
+    // conditions on top level claims are evaluated before nested ones, evaluation stops at the
+    // first that fails
+    class JwtPolicy
+    {
+        public:
+            JwtPolicy();
+
+            // expression := condition ( AND condition )*
+            // condition  := path exists | path == value | path contains value
+            // path is a ClaimPath, value a bare word or a "quoted string"
+            // e.g. scope contains orders:write AND realm_access.roles contains admin AND aud == api
+            // return 0 if compiled, conditions are added to those already in the policy
+            // return !=0 and set errorStr if the expression is invalid
+            int Compile( const std::string& expression, std::string& errorStr );
+
+            // throw std::runtime_error if path is empty or not a valid ClaimPath, the policy is left as it was
+            void RequireClaim( const std::string& path );
+            void RequireClaimEquals( const std::string& path, const std::string& value );
+            void RequireClaimContains( const std::string& path, const std::string& value );
+
+            const std::vector< JwtPolicyCondition >& GetConditions() const;
+            const std::vector< std::string >& GetClaimNames() const;
+            const std::vector< std::string >& GetValues() const;
+
+            // evaluates the policy against an already validated jwt, each top level claim named by
+            // the policy is fetched once through GetGrantJsonValue and the policy evaluated on them
+            // as IJwtValidator evaluates it on a parsed payload
+            JwtPolicyDecision Evaluate( const IValidJwt& jwt ) const;
+
+        private:
+            std::vector< JwtPolicyCondition > conditions;
+            std::vector< std::string > claimNames;
+            std::vector< std::string > values;
+
+            void addCondition( const std::string& path,
+                               JwtPolicyOp op,
+                               const std::string& value,
+                               bool parseLiterals );
+            void insertCondition( JwtPolicyCondition&& condition, const std::string& value );
+    };
+}
+
+#endif
@@ -6,48 +6,122 @@
 #include <boost/log/sources/global_logger_storage.hpp>
 #include <boost/log/sources/severity_channel_logger.hpp>
 #include <boost/log/trivial.hpp>
+#include <boost/log/utility/manipulators/add_value.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include <lhwsutil/tracing.h>
 
 #define LHWSUTIL_LOGGER_CHANNEL_NAME_GENERIC    "LHWSUtil"
 
-#define LHWSUTIL_LOGGER_RECORD_ATTR_NAME_SCOPE  "Scope"
+// boost::string_view attribute holding the innermost wsUtilLogSetScope name, set on every record
+// written, it views a string literal so the record allocates nothing for it
+#define LHWSUTIL_LOGGER_RECORD_ATTR_NAME_TRACE_SCOPE  "TraceScope"
 
-#define LHWSUTIL_VERBOSE_LOGGING
+// wsUtilLog* calls below this severity are compiled out, 0 = trace ... 5 = fatal, 6 = none
+#ifndef LHWSUTIL_MIN_LOG_SEVERITY
+#define LHWSUTIL_MIN_LOG_SEVERITY 0
+#endif
+
+// payloads ( bodies, keys, tokens ) wrapped in LogPayload are truncated to this many bytes
+#ifndef LHWSUTIL_LOG_PAYLOAD_MAX_BYTES
+#define LHWSUTIL_LOG_PAYLOAD_MAX_BYTES 256
+#endif
 
 namespace LHWSUtilNS
 {
     typedef boost::log::trivial::severity_level SeverityLevel;
     typedef boost::log::sources::severity_channel_logger_mt< SeverityLevel, std::string > LoggerType;
+
+    // records below the threshold are dropped before boost log is consulted and before
+    // any argument is evaluated, trace by default, wsUtilLog is not subject to it
+    extern std::atomic< int > logSeverityThreshold;
+
+    void SetLogSeverityThreshold( SeverityLevel severity );
+
+    // the runtime threshold only, LHWSUTIL_MIN_LOG_SEVERITY is tested by the macros below so this
+    // reads the same in every translation unit whatever each was compiled with
+    inline bool LogSeverityEnabled( SeverityLevel severity )
+    {
+        return static_cast< int >( severity ) >= logSeverityThreshold.load( std::memory_order_relaxed );
+    }
+
+    // streams at most maxBytes of data followed by the full size if anything was cut
+    struct LogPayload
+    {
+        LogPayload( const std::string& _data, size_t _maxBytes = LHWSUTIL_LOG_PAYLOAD_MAX_BYTES );
+        LogPayload( const char* _data, size_t _size, size_t _maxBytes = LHWSUTIL_LOG_PAYLOAD_MAX_BYTES );
+
+        const char* data;
+        size_t size;
+        size_t maxBytes;
+    };
+
+    std::ostream& operator<<( std::ostream& os, const LogPayload& payload );
+
+    // adds a sink for the LHWSUtil channel whose records are queued to a dedicated thread which
+    // writes them to stream, records are dropped rather than blocking the caller when the queue
+    // of asyncLogSinkCapacity records is full
+    const size_t asyncLogSinkCapacity = 8192;
+
+    void EnableAsyncLogSink( const std::shared_ptr< std::ostream >& stream, SeverityLevel minSeverity );
+    // flushes the queued records and removes the sink
+    void DisableAsyncLogSink();
 }
 
 // Singleton logger
 BOOST_LOG_GLOBAL_LOGGER( LHWSUtilLoggerGeneric, LHWSUtilNS::LoggerType )
 
-// call at top of every function
+// call at top of every function, see LHWSUtilNS::TraceScope
 #define wsUtilLogSetScope( scopeName ) \
-    BOOST_LOG_NAMED_SCOPE( scopeName )
+    wsUtilTraceSpan( scopeName )
 
 #define wsUtilLogSetTag( tag ) \
     BOOST_LOG_SCOPED_THREAD_TAG( "Tag", tag )
 
+// true when severity is both compiled in and above the runtime threshold
+#define wsUtilLogSeverityEnabled( severity ) \
+    ( ( static_cast< int >( severity ) >= LHWSUTIL_MIN_LOG_SEVERITY ) && \
+      LHWSUtilNS::LogSeverityEnabled( severity ) )
+
+// msg is only evaluated when the severity is enabled
+#define wsUtilLogWithSeverity( severity, msg ) \
+    do \
+    { \
+        if ( wsUtilLogSeverityEnabled( severity ) ) \
+        { \
+            BOOST_LOG_SEV( LHWSUtilLoggerGeneric::get(), severity ) \
+                << boost::log::add_value( LHWSUTIL_LOGGER_RECORD_ATTR_NAME_TRACE_SCOPE, \
+                                          boost::string_view( LHWSUtilNS::CurrentTraceScopeName() ) ) \
+                << msg; \
+        } \
+    } while ( 0 )
+
+// at the logger's default severity, as ever, so neither compiled out nor dropped by the threshold
 #define wsUtilLog( msg ) \
-    BOOST_LOG( LHWSUtilLoggerGeneric::get() ) << msg
+    BOOST_LOG( LHWSUtilLoggerGeneric::get() ) \
+        << boost::log::add_value( LHWSUTIL_LOGGER_RECORD_ATTR_NAME_TRACE_SCOPE, \
+                                  boost::string_view( LHWSUtilNS::CurrentTraceScopeName() ) ) \
+        << msg
 
 #define wsUtilLogTrace( msg ) \
-    BOOST_LOG_SEV( LHWSUtilLoggerGeneric::get(), LHWSUtilNS::SeverityLevel::trace ) << msg
+    wsUtilLogWithSeverity( LHWSUtilNS::SeverityLevel::trace, msg )
 
 #define wsUtilLogDebug( msg ) \
-    BOOST_LOG_SEV( LHWSUtilLoggerGeneric::get(), LHWSUtilNS::SeverityLevel::debug ) << msg
+    wsUtilLogWithSeverity( LHWSUtilNS::SeverityLevel::debug, msg )
 
 #define wsUtilLogInfo( msg ) \
-    BOOST_LOG_SEV( LHWSUtilLoggerGeneric::get(), LHWSUtilNS::SeverityLevel::info ) << msg
+    wsUtilLogWithSeverity( LHWSUtilNS::SeverityLevel::info, msg )
 
 #define wsUtilLogError( msg ) \
-    BOOST_LOG_SEV( LHWSUtilLoggerGeneric::get(), LHWSUtilNS::SeverityLevel::error ) << msg
+    wsUtilLogWithSeverity( LHWSUtilNS::SeverityLevel::error, msg )
 
 #define wsUtilLogFatal( msg ) \
-    BOOST_LOG_SEV( LHWSUtilLoggerGeneric::get(), LHWSUtilNS::SeverityLevel::fatal ) << msg
-
-#define wsUtilLogWithSeverity( severity, msg ) \
-    BOOST_LOG_SEV( LHWSUtilLoggerGeneric::get(), severity ) << msg
+    wsUtilLogWithSeverity( LHWSUtilNS::SeverityLevel::fatal, msg )
 
 #endif
@@ -0,0 +1,122 @@
+#ifndef __LHWSUTIL_METRICS_H__
+#define __LHWSUTIL_METRICS_H__
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace LHWSUtilNS
+{
+    enum class JwtValidationMethod
+    {
+        ValidateIntoJwt = 0,
+        IntrospectJwt,
+        NumMethods
+    };
+
+    enum class JwtValidationResult
+    {
+        Valid = 0,
+        // the token itself was rejected
+        Invalid,
+        // introspection answered active=false
+        Inactive,
+        // the token could not be judged, e.g. the issuer cache or the IdP failed
+        Error,
+        // the token was rejected by a JwtPolicy
+        Denied,
+        // the token's jti or sid is in the IJwtRevocationList
+        Revoked,
+        // the token's jti was already seen by the validator's IJwtReplayGuard
+        Replayed,
+        NumResults
+    };
+
+    // the last stage a validation reached
+    enum class JwtValidationStage
+    {
+        Decode = 0,
+        KeyLookup,
+        Verify,
+        Introspect,
+        NumStages
+    };
+
+    enum class HttpRequestOutcome
+    {
+        Ok = 0,
+        TimedOut,
+        Failed,
+        NumOutcomes
+    };
+
+    // CURLINFO_*_TIME of the attempt that answered, each measured from the start of the request
+    enum class HttpTiming
+    {
+        NameLookup = 0,
+        Connect,
+        AppConnect,
+        PreTransfer,
+        StartTransfer,
+        Total,
+        NumTimings
+    };
+
+    const size_t numJwtValidationMethods = static_cast< size_t >( JwtValidationMethod::NumMethods );
+    const size_t numJwtValidationResults = static_cast< size_t >( JwtValidationResult::NumResults );
+    const size_t numJwtValidationStages = static_cast< size_t >( JwtValidationStage::NumStages );
+    const size_t numHttpRequestOutcomes = static_cast< size_t >( HttpRequestOutcome::NumOutcomes );
+    const size_t numHttpTimings = static_cast< size_t >( HttpTiming::NumTimings );
+
+    typedef std::array< uint64_t, numJwtValidationResults > JwtValidationCounts;
+
+    struct HistogramSnapshot
+    {
+        HistogramSnapshot();
+
+        uint64_t count;
+        uint64_t sumMicros;
+        // bucketCounts[ i ] counts samples below bucketUpperBoundsMicros[ i ] not counted by bucket i - 1
+        std::vector< uint64_t > bucketUpperBoundsMicros;
+        std::vector< uint64_t > bucketCounts;
+    };
+
+    // totals over every thread since the process started
+    struct MetricsSnapshot
+    {
+        MetricsSnapshot();
+
+        JwtValidationCounts validationsByMethod[ numJwtValidationMethods ];
+        JwtValidationCounts validationsByStage[ numJwtValidationStages ];
+        // only issuers loaded into an issuer cache get their own entry, the rest are counted under "other"
+        std::map< std::string, JwtValidationCounts > validationsByIssuer;
+        std::map< std::string, JwtValidationCounts > validationsByAlg;
+        HistogramSnapshot validationLatency[ numJwtValidationMethods ];
+
+        uint64_t issuerCacheHits;
+        uint64_t issuerCacheMisses;
+        uint64_t issuerReloads;
+        uint64_t issuerReloadFailures;
+        int64_t pendingIssuers;
+
+        uint64_t httpRequests[ numHttpRequestOutcomes ];
+        uint64_t httpHedgedRequests;
+        HistogramSnapshot httpTimings[ numHttpTimings ];
+    };
+
+    void GetMetricsSnapshot( MetricsSnapshot& snapshotOut );
+
+    // prometheus text exposition format 0.0.4, every metric is prefixed with lhwsutil_
+    void FormatMetricsPrometheus( const MetricsSnapshot& snapshot, std::string& out );
+
+    const char* JwtValidationMethodName( JwtValidationMethod method );
+    const char* JwtValidationResultName( JwtValidationResult result );
+    const char* JwtValidationStageName( JwtValidationStage stage );
+    const char* HttpRequestOutcomeName( HttpRequestOutcome outcome );
+    const char* HttpTimingName( HttpTiming timing );
+}
+
+#endif
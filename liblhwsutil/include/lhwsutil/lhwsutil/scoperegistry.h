@@ -0,0 +1,70 @@
+#ifndef __LHWSUTIL_SCOPEREGISTRY_H__
+#define __LHWSUTIL_SCOPEREGISTRY_H__
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace LHWSUtilNS
+{
+    class IValidJwt;
+
+    const size_t maxRegisteredScopes = 128;
+
+    // bit n is set when the n-th registered scope is present
+    typedef std::bitset< maxRegisteredScopes > ScopeSet;
+
+    inline bool HasAllScopes( const ScopeSet& scopes, const ScopeSet& required )
+    {
+        return ( scopes & required ) == required;
+    }
+
+    inline bool HasAnyScope( const ScopeSet& scopes, const ScopeSet& anyOf )
+    {
+        return ( scopes & anyOf ).any();
+    }
+
+    // the scopes an application checks for, registered up front so that a token's scope claim can
+    // be matched into a ScopeSet without allocating
+    // register every scope before sharing the registry between threads, the const members are
+    // then safe to call concurrently
+    class ScopeRegistry
+    {
+        public:
+            ScopeRegistry();
+
+            ScopeRegistry( const ScopeRegistry& other ) = delete;
+            ScopeRegistry& operator=( const ScopeRegistry& other ) = delete;
+
+            // returns the scope's bit, registering the scope if it is new
+            // throws std::runtime_error for an empty scope or once maxRegisteredScopes are registered
+            size_t RegisterScope( const std::string& scope );
+            // registers every scope and returns the set of them, for use as HasAllScopes' required
+            ScopeSet RegisterScopes( const std::vector< std::string >& scopes );
+
+            // return 0 and set bit if scope is registered
+            int FindScope( const char* scope, size_t scopeSize, size_t& bit ) const;
+
+            // sets the bits of the registered scopes in the space separated scopesStr,
+            // unregistered scopes are ignored
+            void ParseScopes( const char* scopesStr, size_t scopesStrSize, ScopeSet& scopes ) const;
+
+            size_t NumScopes() const;
+            const std::string& ScopeName( size_t bit ) const;
+
+        private:
+            // open addressing over twice maxRegisteredScopes, slots hold bit + 1, 0 => empty
+            static const size_t numSlots = 2 * maxRegisteredScopes;
+
+            std::vector< std::string > names;
+            std::vector< uint8_t > slots;
+    };
+
+    // return 0 and add the jwt's scope claim to scopes, see ScopeRegistry::ParseScopes
+    // return 1 if the jwt is missing scope
+    int GetScopes( const IValidJwt& jwt, const ScopeRegistry& registry, ScopeSet& scopes );
+}
+
+#endif
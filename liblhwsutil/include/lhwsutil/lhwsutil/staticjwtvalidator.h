@@ -0,0 +1,157 @@
+#ifndef __LHWSUTIL_STATICJWTVALIDATOR_H__
+#define __LHWSUTIL_STATICJWTVALIDATOR_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <lhwsutil/metrics.h>
+#include <lhwsutil/validatedjwt.h>
+
+namespace LHWSUtilNS
+{
+    enum class JwtAlg
+    {
+        HS256 = 0,
+        HS384,
+        HS512,
+        RS256,
+        RS384,
+        RS512,
+        ES256,
+        ES384,
+        ES512
+    };
+
+    const char* JwtAlgName( JwtAlg alg );
+    // return true and set algOut if name is that of a JwtAlg
+    bool JwtAlgForName( const char* name, size_t nameSize, JwtAlg& algOut );
+
+    // claims a StaticJwtValidator can require, those held by ValidatedJwt
+    template< JwtStrClaim Claim >
+    struct RequiredStrClaim
+    {
+        static constexpr uint32_t strClaimMask = static_cast< uint32_t >( 1 ) << static_cast< size_t >( Claim );
+        static constexpr uint32_t intClaimMask = 0;
+    };
+
+    // the masks are bound to references by gtest and the like, which needs a definition
+    template< JwtStrClaim Claim >
+    constexpr uint32_t RequiredStrClaim< Claim >::strClaimMask;
+    template< JwtStrClaim Claim >
+    constexpr uint32_t RequiredStrClaim< Claim >::intClaimMask;
+
+    template< JwtIntClaim Claim >
+    struct RequiredIntClaim
+    {
+        static constexpr uint32_t strClaimMask = 0;
+        static constexpr uint32_t intClaimMask = static_cast< uint32_t >( 1 ) << static_cast< size_t >( Claim );
+    };
+
+    template< JwtIntClaim Claim >
+    constexpr uint32_t RequiredIntClaim< Claim >::strClaimMask;
+    template< JwtIntClaim Claim >
+    constexpr uint32_t RequiredIntClaim< Claim >::intClaimMask;
+
+    typedef RequiredStrClaim< JwtStrClaim::Iss > ClaimIss;
+    typedef RequiredStrClaim< JwtStrClaim::Sub > ClaimSub;
+    typedef RequiredStrClaim< JwtStrClaim::Azp > ClaimAzp;
+    typedef RequiredStrClaim< JwtStrClaim::Jti > ClaimJti;
+    typedef RequiredStrClaim< JwtStrClaim::Sid > ClaimSid;
+    typedef RequiredStrClaim< JwtStrClaim::Aud > ClaimAud;
+    typedef RequiredStrClaim< JwtStrClaim::Scope > ClaimScope;
+    typedef RequiredIntClaim< JwtIntClaim::Exp > ClaimExp;
+    typedef RequiredIntClaim< JwtIntClaim::Iat > ClaimIat;
+    typedef RequiredIntClaim< JwtIntClaim::Nbf > ClaimNbf;
+
+    // the claims folded into a pair of masks checked against ValidatedJwt in one comparison
+    template< typename... Claims >
+    struct RequiredClaims;
+
+    // not a template, its masks are defined once in the library
+    template<>
+    struct RequiredClaims<>
+    {
+        static constexpr uint32_t strClaimMask = 0;
+        static constexpr uint32_t intClaimMask = 0;
+    };
+
+    template< typename Claim, typename... Claims >
+    struct RequiredClaims< Claim, Claims... >
+    {
+        static constexpr uint32_t strClaimMask = Claim::strClaimMask | RequiredClaims< Claims... >::strClaimMask;
+        static constexpr uint32_t intClaimMask = Claim::intClaimMask | RequiredClaims< Claims... >::intClaimMask;
+    };
+
+    template< typename Claim, typename... Claims >
+    constexpr uint32_t RequiredClaims< Claim, Claims... >::strClaimMask;
+    template< typename Claim, typename... Claims >
+    constexpr uint32_t RequiredClaims< Claim, Claims... >::intClaimMask;
+
+    // declares a type naming an issuer for AllowedIssuers, e.g.
+    //   LHWSUTIL_JWT_ISSUER( CorpIdp, "https://idp.corp/realms/main" );
+    #define LHWSUTIL_JWT_ISSUER( IssuerType, issuerUrl ) \
+        struct IssuerType \
+        { \
+            static const char* Url() { return issuerUrl; } \
+        }
+
+    // the issuers whose tokens are accepted, no issuers => any issuer loaded in the issuer cache
+    template< typename... Issuers >
+    struct AllowedIssuers
+    {
+        static constexpr size_t numIssuers = sizeof...( Issuers );
+
+        static const char* const* Urls()
+        {
+            static const char* const urls[ sizeof...( Issuers ) + 1 ] = { Issuers::Url()..., nullptr };
+            return urls;
+        }
+    };
+
+    template< typename... Issuers >
+    constexpr size_t AllowedIssuers< Issuers... >::numIssuers;
+
+    typedef AllowedIssuers<> AnyIssuer;
+
+    // validates as IJwtValidator::ValidateIntoJwt( token, validatedJwt ) with the parameters fixed at
+    // compile time, explicitly instantiated in the library for every JwtAlg
+    // the key is looked up in the same IJwtIssuerCache singleton as IJwtValidator's
+    // return Invalid if the token's alg is not Alg, its issuer is not allowed or it lacks a claim
+    // of requiredStrClaims/requiredIntClaims ( RequiredClaims masks )
+    template< JwtAlg Alg >
+    JwtValidationResult ValidateStaticJwt( const std::string& b64UrlEncodedJwt,
+                                           uint32_t requiredStrClaims,
+                                           uint32_t requiredIntClaims,
+                                           const char* const* allowedIssuers,
+                                           size_t numAllowedIssuers,
+                                           ValidatedJwt& validatedJwt );
+
+    // a validator for services which know their algorithm, issuers and required claims at build
+    // time, alongside the runtime IJwtValidator, e.g.
+    //
+    //   LHWSUTIL_JWT_ISSUER( CorpIdp, "https://idp.corp/realms/main" );
+    //   typedef StaticJwtValidator< JwtAlg::RS256,
+    //                               RequiredClaims< ClaimSub, ClaimExp >,
+    //                               AllowedIssuers< CorpIdp > > CorpValidator;
+    //
+    // the alg is dispatched without comparing alg strings, the claim checks reduce to two mask
+    // comparisons and nothing is allocated once validatedJwt is warm
+    template< JwtAlg Alg, typename Required = RequiredClaims<>, typename Issuers = AnyIssuer >
+    class StaticJwtValidator
+    {
+        public:
+            JwtValidationResult ValidateIntoJwt( const std::string& b64UrlEncodedJwt,
+                                                 ValidatedJwt& validatedJwt ) const
+            {
+                return ValidateStaticJwt< Alg >( b64UrlEncodedJwt,
+                                                 Required::strClaimMask,
+                                                 Required::intClaimMask,
+                                                 Issuers::Urls(),
+                                                 Issuers::numIssuers,
+                                                 validatedJwt );
+            }
+    };
+}
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef __LHWSUTIL_TRACING_H__
+#define __LHWSUTIL_TRACING_H__
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace LHWSUtilNS
+{
+    struct TracingParams
+    {
+        TracingParams();
+
+        // 1 in sampleEvery outermost scopes on a thread is recorded along with everything nested in it
+        size_t sampleEvery;
+        // oldest spans are dropped beyond this
+        size_t maxSpans;
+        // spans recorded per sampled outermost scope, the rest are dropped
+        size_t maxSpansPerTrace;
+    };
+
+    void EnableTracing( const TracingParams& params );
+    // spans already recorded are kept
+    void DisableTracing();
+    void ClearTraceSpans();
+
+    // chrome trace event format, load into chrome://tracing or perfetto
+    void GetChromeTraceJson( std::string& out );
+
+    // the innermost scope on this thread, "" outside of any
+    const char* CurrentTraceScopeName();
+
+    // names the current scope for logging and, when the outermost scope on this thread was
+    // sampled, records a span for it
+    // name must outlive the process' spans, in practice a string literal
+    class TraceScope
+    {
+        public:
+            TraceScope( const char* _name );
+            ~TraceScope();
+
+            TraceScope( const TraceScope& other ) = delete;
+            TraceScope& operator=( const TraceScope& other ) = delete;
+
+            // ends the scope before it goes out of scope, scopes must still end innermost first
+            void End();
+
+        private:
+            const char* name;
+            const char* parentName;
+            bool ended;
+            bool recording;
+            std::chrono::steady_clock::time_point start;
+    };
+}
+
+#define LHWSUTIL_TRACE_CONCAT_INNER( a, b ) a ## b
+#define LHWSUTIL_TRACE_CONCAT( a, b ) LHWSUTIL_TRACE_CONCAT_INNER( a, b )
+
+// a span over the rest of the enclosing block
+#define wsUtilTraceSpan( spanName ) \
+    LHWSUtilNS::TraceScope LHWSUTIL_TRACE_CONCAT( lhwsutilTraceScope, __LINE__ )( spanName )
+
+#endif
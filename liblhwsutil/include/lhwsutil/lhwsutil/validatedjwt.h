@@ -0,0 +1,116 @@
+#ifndef __LHWSUTIL_VALIDATEDJWT_H__
+#define __LHWSUTIL_VALIDATEDJWT_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <lhwsutil/metrics.h>
+
+namespace LHWSUtilImplNS
+{
+    class JwtValidator;
+}
+
+namespace LHWSUtilNS
+{
+    class ClaimProjectionBase;
+    class IJwtValidator;
+    enum class JwtAlg;
+
+    enum class JwtStrClaim
+    {
+        Iss = 0,
+        Sub,
+        Azp,
+        Jti,
+        Sid,
+        // lists, held space separated
+        Aud,
+        Scope,
+        NumClaims
+    };
+
+    enum class JwtIntClaim
+    {
+        Exp = 0,
+        Iat,
+        Nbf,
+        NumClaims
+    };
+
+    const size_t numJwtStrClaims = static_cast< size_t >( JwtStrClaim::NumClaims );
+    const size_t numJwtIntClaims = static_cast< size_t >( JwtIntClaim::NumClaims );
+    // string claims beyond this spill onto the heap
+    const size_t validatedJwtInlineBytes = 384;
+
+    // the outcome of a validation and the common claims of the token, filled by
+    // IJwtValidator::ValidateIntoJwt/IntrospectJwt
+    // a plain value without virtual calls, meant to live on the stack or be reused across requests
+    // so that once warm a validation does not allocate for it
+    class ValidatedJwt
+    {
+        public:
+            ValidatedJwt();
+            ~ValidatedJwt();
+
+            ValidatedJwt( const ValidatedJwt& other ) = delete;
+            ValidatedJwt& operator=( const ValidatedJwt& other ) = delete;
+            ValidatedJwt( ValidatedJwt&& other );
+            ValidatedJwt& operator=( ValidatedJwt&& other );
+
+            // Error until filled by a validator
+            JwtValidationResult GetResult() const;
+            bool IsValid() const;
+
+            // return 0 and point strOut at the claim, valid until this is reset or moved from
+            // return 1 if the claim is absent
+            int GetStrClaim( JwtStrClaim claim, const char*& strOut, size_t& strSizeOut ) const;
+            // return 0 and set valueOut, 1 if the claim is absent
+            int GetIntClaim( JwtIntClaim claim, long& valueOut ) const;
+            // whether every claim of the masks, bit n for claim n, is present
+            bool HasClaims( uint32_t strClaimMask, uint32_t intClaimMask ) const;
+            // whether value is one of the space separated tokens of the claim, e.g. Aud or Scope
+            bool StrClaimHasToken( JwtStrClaim claim, const char* value, size_t valueSize ) const;
+
+            // empty and Error, keeps any heap capacity for the next validation
+            void Reset();
+
+            // fills a ValidatedJwt* target with the claims above
+            static const ClaimProjectionBase& GetClaimProjection();
+
+        private:
+            class Projection;
+
+            // only a validator sets the result, once it has filled the claims
+            friend class IJwtValidator;
+            friend class LHWSUtilImplNS::JwtValidator;
+            template< JwtAlg Alg >
+            friend JwtValidationResult ValidateStaticJwt( const std::string& b64UrlEncodedJwt,
+                                                          uint32_t requiredStrClaims,
+                                                          uint32_t requiredIntClaims,
+                                                          const char* const* allowedIssuers,
+                                                          size_t numAllowedIssuers,
+                                                          ValidatedJwt& validatedJwt );
+
+            JwtValidationResult result;
+            uint32_t strClaimsPresent;
+            uint32_t intClaimsPresent;
+            size_t strOffsets[ numJwtStrClaims ];
+            size_t strSizes[ numJwtStrClaims ];
+            long intClaims[ numJwtIntClaims ];
+            size_t strsUsed;
+            bool strsSpilled;
+            char inlineStrs[ validatedJwtInlineBytes ];
+            std::string spilledStrs;
+
+            void setResult( JwtValidationResult _result );
+            const char* strs() const;
+            // start claim's value at the end of the strings, dropping any value it had
+            void startStr( size_t claim );
+            // append to claim's value, which must be the last one started
+            void appendStr( size_t claim, const char* str, size_t strSize );
+    };
+}
+
+#endif
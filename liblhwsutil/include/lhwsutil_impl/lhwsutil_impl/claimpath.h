@@ -0,0 +1,27 @@
+#ifndef __LHWSUTIL_IMPL_CLAIMPATH_H__
+#define __LHWSUTIL_IMPL_CLAIMPATH_H__
+
+#include <functional>
+#include <string>
+
+#include <rapidjson/document.h>
+
+#include <lhwsutil/claimpath.h>
+
+namespace LHWSUtilImplNS
+{
+    // the value at path's tokens [ fromToken.. ] below root, nullptr if there is none
+    const rapidjson::Value* ResolveClaimPath( const rapidjson::Value& root,
+                                              const LHWSUtilNS::ClaimPath& path,
+                                              size_t fromToken = 0 );
+
+    // the IValidJwt::GetClaim* family over an already resolved claim, which may be null
+    int GetClaimStrValue( const rapidjson::Value* claim, std::string& valueOut );
+    int GetClaimBoolValue( const rapidjson::Value* claim, bool& valueOut );
+    int GetClaimIntValue( const rapidjson::Value* claim, long& valueOut );
+    int ClaimArrayContains( const rapidjson::Value* claim, const std::string& value, bool& containsOut );
+    int ForEachClaimStr( const rapidjson::Value* claim,
+                         const std::function< bool( const char* str, size_t strSize ) >& visitor );
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef __LHWSUTIL_IMPL_CLAIMPROJECTION_H__
+#define __LHWSUTIL_IMPL_CLAIMPROJECTION_H__
+
+#include <rapidjson/document.h>
+
+#include <string>
+
+#include <lhwsutil/claimprojection.h>
+
+namespace LHWSUtilImplNS
+{
+    // fills target from payloadJson in a single SAX pass, no document is built
+    // return 0 if every required claim of projection was set
+    // return 1 if payloadJson is not a json object or a projected claim has the wrong type
+    // return 2 if a required claim is missing
+    int ProjectClaims( const std::string& payloadJson,
+                       const LHWSUtilNS::ClaimProjectionBase& projection,
+                       void* target );
+
+    // as above, from an already parsed payload
+    int ProjectClaims( const rapidjson::Value& payload,
+                       const LHWSUtilNS::ClaimProjectionBase& projection,
+                       void* target );
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef __LHWSUTIL_IMPL_FROZENISSUERTABLE_H__
+#define __LHWSUTIL_IMPL_FROZENISSUERTABLE_H__
+
+#include <lhwsutil/ijwtissuercache.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace LHWSUtilImplNS
+{
+    // a read-only minimal perfect hash table of a fixed set of issuers, keyed on their urls
+    // hash and displace: the hash of an iss picks a bucket, and the bucket's displacement, chosen
+    // when the table is built, sends each of its issuers to a slot of its own, so a lookup hashes iss
+    // once and compares it to a single issuer's url
+    // immutable once built, safe to read from any number of threads
+    class FrozenIssuerTable
+    {
+        public:
+            // throws if issuers cannot be placed, e.g. two of them have the same url
+            FrozenIssuerTable( const std::vector< std::shared_ptr< LHWSUtilNS::IJwtIssuer > >& issuers );
+
+            FrozenIssuerTable( const FrozenIssuerTable& other ) = delete;
+            FrozenIssuerTable& operator=( const FrozenIssuerTable& other ) = delete;
+
+            // return the issuer whose url is iss, null if there is none
+            const std::shared_ptr< LHWSUtilNS::IJwtIssuer >* Find( const std::string& iss ) const;
+
+            size_t NumIssuers() const;
+
+        private:
+            struct Slot
+            {
+                // the issuer's url, compared without going through the issuer
+                std::string iss;
+                std::shared_ptr< LHWSUtilNS::IJwtIssuer > issuer;
+            };
+
+            std::vector< uint32_t > displacements;
+            std::vector< Slot > slots;
+
+            size_t bucketFor( uint64_t hash ) const;
+            size_t slotFor( uint64_t hash, uint32_t displacement ) const;
+    };
+}
+
+#endif
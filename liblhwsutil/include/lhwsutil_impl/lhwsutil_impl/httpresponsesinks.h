@@ -0,0 +1,60 @@
+#ifndef __LHWSUTIL_IMPL_HTTPRESPONSESINKS_H__
+#define __LHWSUTIL_IMPL_HTTPRESPONSESINKS_H__
+
+#include <rapidjson/document.h>
+
+#include <string>
+
+#include <lhwsutil/isimplehttpclient.h>
+
+namespace LHWSUtilImplNS
+{
+    // appends the body to a caller owned string, reserving up front when the size is known
+    class StringResponseSink : public LHWSUtilNS::IHttpResponseSink
+    {
+        public:
+            StringResponseSink( std::string& _bodyOut );
+            ~StringResponseSink();
+
+            StringResponseSink( const StringResponseSink& other ) = delete;
+            StringResponseSink& operator=( const StringResponseSink& other ) = delete;
+            StringResponseSink() = delete;
+
+            void ExpectSize( size_t numBytes );
+            int Consume( const char* data, size_t numBytes );
+            int Finish();
+
+        private:
+            std::string& bodyOut;
+    };
+
+    // collects the body into a single buffer and parses it in place once the transfer is
+    // complete, the document strings point into the buffer so nothing is copied a second time
+    class JsonDocumentResponseSink : public LHWSUtilNS::IHttpResponseSink
+    {
+        public:
+            JsonDocumentResponseSink();
+            ~JsonDocumentResponseSink();
+
+            JsonDocumentResponseSink( const JsonDocumentResponseSink& other ) = delete;
+            JsonDocumentResponseSink& operator=( const JsonDocumentResponseSink& other ) = delete;
+
+            void ExpectSize( size_t numBytes );
+            int Consume( const char* data, size_t numBytes );
+            int Finish();
+
+            // valid once Finish returned 0
+            const rapidjson::Document& GetDocument() const;
+            size_t GetBodySize() const;
+
+        private:
+            std::string buffer;
+            size_t bodySize;
+            rapidjson::Document document;
+    };
+
+    // upper bound on how much a sink will reserve on the word of a Content-Length header
+    const size_t maxResponseSizeToReserve = 8 * 1024 * 1024;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef __LHWSUTIL_IMPL_JWSVERIFIER_H__
+#define __LHWSUTIL_IMPL_JWSVERIFIER_H__
+
+#include <lhwsutil/staticjwtvalidator.h>
+
+#include <openssl/evp.h>
+
+#include <cstddef>
+#include <string>
+
+namespace LHWSUtilImplNS
+{
+    // alg's digest, on OpenSSL 3 fetched from the default provider once per process
+    const EVP_MD* GetJwsDigest( LHWSUtilNS::JwtAlg alg );
+
+    // verifies the JWS signatures of one alg and key with OpenSSL directly
+    // the verifier's context is initialised once, which is when OpenSSL 3 fetches the signature
+    // implementation, and each Verify copies it into an EVP_MD_CTX kept per thread rather than
+    // fetching again and creating and initialising a context of its own
+    // immutable once built, safe to use from any number of threads
+    class JwsVerifier
+    {
+        public:
+            // key is a public key pem for RS and ES algs, the secret for HS algs
+            // throws if key cannot be read or is not one for alg
+            JwsVerifier( LHWSUtilNS::JwtAlg _alg, const char* key, size_t keySize );
+            // takes a reference to key, e.g. that of an RSAPublicKey
+            JwsVerifier( LHWSUtilNS::JwtAlg _alg, EVP_PKEY* key );
+            ~JwsVerifier();
+
+            JwsVerifier( const JwsVerifier& other ) = delete;
+            JwsVerifier& operator=( const JwsVerifier& other ) = delete;
+
+            // signingInput is the b64url encoded header and payload joined by '.', signature is decoded
+            // ES signatures are the JWS r || s rather than DER
+            // return 0 if signature is valid, 1 if it is not, 2 on an error
+            int Verify( const char* signingInput,
+                        size_t signingInputSize,
+                        const unsigned char* signature,
+                        size_t signatureSize ) const;
+
+            // verifies the signature of a compact serialised jws, its header's alg is not looked at
+            // return 0 if the signature is valid, 1 if it is not, 2 if jwsStr is malformed or on an error
+            int VerifyCompact( const std::string& jwsStr ) const;
+
+            LHWSUtilNS::JwtAlg GetAlg() const;
+
+        private:
+            LHWSUtilNS::JwtAlg alg;
+            EVP_PKEY* pkey;
+            // initialised for alg and pkey, copied by every Verify
+            EVP_MD_CTX* templateCtx;
+
+            // return 0 if templateCtx is ready, !=0 if pkey is not a key for alg or on an error
+            int initTemplateCtx();
+    };
+}
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef __LHWSUTIL_IMPL_JWTCHECKS_H__
+#define __LHWSUTIL_IMPL_JWTCHECKS_H__
+
+#include <rapidjson/document.h>
+
+#include <cstddef>
+#include <string>
+
+#include <lhwsutil/ijwtvalidator.h>
+
+namespace LHWSUtilImplNS
+{
+    // a NumericDate claim, exp or nbf
+    struct JwtTimeClaim
+    {
+        JwtTimeClaim();
+
+        bool present;
+        // present and an integer
+        bool valid;
+        long value;
+    };
+
+    // what JwtValidationChecks looks at, gathered from either libjwt's or rapidjson's parse of the
+    // token, the strings are null when missing and point into the parse
+    struct JwtCheckedFields
+    {
+        JwtCheckedFields();
+
+        const char* alg;
+        const char* kid;
+        const char* iss;
+        size_t issSize;
+        JwtTimeClaim exp;
+        JwtTimeClaim nbf;
+        // a string or an array, null when missing, only read if checks.audiences is not empty
+        const rapidjson::Value* aud;
+    };
+
+    // return 0 if jwtStr is no longer than checks.maxTokenSize and made of three base64url segments,
+    // the header and payload not empty, without decoding it
+    // return 1 if it is too long, 2 if it does not have three segments, 3 if a segment is not base64url
+    int CheckJwtShape( const std::string& jwtStr, const LHWSUtilNS::JwtValidationChecks& checks );
+
+    // return 0 if fields pass checks at now, seconds since the epoch
+    // return 1 if alg is not accepted, 2 if kid is missing, 3 if iss is missing or not accepted,
+    // 4 if exp is missing or not an integer, 5 if expired, 6 if nbf is not an integer or not yet
+    // reached, 7 if aud is not accepted
+    int CheckJwtFields( const JwtCheckedFields& fields, const LHWSUtilNS::JwtValidationChecks& checks, long now );
+
+    // fills fields from a parsed header and payload, which must outlive fields
+    void GetJwtCheckedFields( const rapidjson::Value& headerJson,
+        const rapidjson::Value& payloadJson,
+        JwtCheckedFields& fields );
+}
+
+#endif
@@ -2,35 +2,117 @@
 #define __LHWSUTIL_IMPL_JWTISSUERCACHE_H__
 
 #include <lhwsutil/ijwtissuercache.h>
+#include <lhwsutil/staticjwtvalidator.h>
 
+#include <lhwsutil_impl/frozenissuertable.h>
+#include <lhwsutil_impl/timedmutex.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 namespace LHWSUtilImplNS
 {
+    // what a JwtIssuer is built from, discarded once it is
+    struct JwtIssuerFields
+    {
+        JwtIssuerFields();
+
+        std::string url;
+        std::string clientAuthzBearerToken;
+        std::string introspectionEndpoint;
+        std::string jwksUri;
+        // left empty unless debug logging is enabled
+        std::string openIdConfiguration;
+        std::vector< std::pair< LHWSUtilNS::JwtAlg, std::string > > algKeyPems;
+        // the keys of algs which are not a JwtAlg, e.g. PS256 or EdDSA, found by name
+        std::vector< std::pair< std::string, std::string > > namedAlgKeyPems;
+    };
+
+    // an immutable record of an issuer: its key table and strings are packed into one block
+    // allocated when it is built, and its algs are held as JwtAlg rather than strings unless they
+    // are not one
+    // the std::string getters copy the record's strings out on the first call to one of them, the
+    // View getters point into the record
     class JwtIssuer : public LHWSUtilNS::IJwtIssuer
     {
         public:
-            JwtIssuer( const std::string& url );
+            JwtIssuer( const JwtIssuerFields& fields );
             ~JwtIssuer();
 
+            JwtIssuer( const JwtIssuer& other ) = delete;
+            JwtIssuer& operator=( const JwtIssuer& other ) = delete;
+
             const std::string& GetUrl() const;
             bool AlgIsSupported( const std::string& alg ) const;
             const std::string& GetKeyPemForAlg( const std::string& alg ) const;
             const std::string& GetClientAuthzBearerToken() const;
             const std::string& GetOpenIdConfiguration() const;
+            LHWSUtilNS::JwtIssuerStr GetIntrospectionEndpoint() const;
+            LHWSUtilNS::JwtIssuerStr GetJwksUri() const;
+
+            LHWSUtilNS::JwtIssuerStr GetUrlView() const;
+            LHWSUtilNS::JwtIssuerStr GetKeyPemForAlgView( const std::string& alg ) const;
+            LHWSUtilNS::JwtIssuerStr GetClientAuthzBearerTokenView() const;
+            LHWSUtilNS::JwtIssuerStr GetOpenIdConfigurationView() const;
 
-            void SetKeyPemForAlg( const std::string& alg, const std::string& keyPem );
-            void SetClientAuthzBearerToken( const std::string& _clientAuthzBearerToken );
-            void SetOpenIdConfiguration( const std::string _openIdConfiguration );
+            // heap bytes held by the issuer
+            size_t GetMemoryUsage() const;
+            // appends the first key of each alg, as in JwtIssuerFields
+            void GetKeys( std::vector< std::pair< LHWSUtilNS::JwtAlg, std::string > >& algKeyPemsOut,
+                          std::vector< std::pair< std::string, std::string > >& namedAlgKeyPemsOut ) const;
 
         private:
-            std::string url;
-            std::unordered_map< std::string, std::string > algToKeyPem;
-            std::string clientAuthzBearerToken;
-            std::string openIdConfiguration;
+            // within block
+            struct StrRef
+            {
+                uint32_t offset;
+                uint32_t size;
+            };
+
+            struct Key
+            {
+                LHWSUtilNS::JwtAlg alg;
+                // empty unless the alg is not a JwtAlg, when alg is meaningless
+                StrRef name;
+                StrRef pem;
+            };
+
+            // numKeys Keys followed by the null terminated strings
+            std::unique_ptr< char[] > block;
+            size_t blockSize;
+            size_t numKeys;
+            StrRef url;
+            StrRef clientAuthzBearerToken;
+            StrRef introspectionEndpoint;
+            StrRef jwksUri;
+            StrRef openIdConfiguration;
+
+            // copies for the std::string getters
+            struct Strings
+            {
+                std::string url;
+                std::string clientAuthzBearerToken;
+                std::string openIdConfiguration;
+                // by key
+                std::vector< std::string > keyPems;
+            };
+            mutable std::once_flag stringsOnce;
+            mutable std::unique_ptr< Strings > strings;
+            mutable std::atomic< size_t > stringsBytes;
+
+            LHWSUtilNS::JwtIssuerStr str( const StrRef& ref ) const;
+            const Key* keys() const;
+            const Key* findKey( const std::string& alg ) const;
+            // throws if alg is unsupported
+            const Key& getKey( const std::string& alg ) const;
+            const Strings& getStrings() const;
     };
 
     class JwtIssuerCache : public LHWSUtilNS::IJwtIssuerCache
@@ -43,16 +125,59 @@ namespace LHWSUtilImplNS
             bool IssuerIsLoaded( const std::string& iss ) const;
             std::shared_ptr< LHWSUtilNS::IJwtIssuer > GetIssuer( const std::string& iss );
 
+            int Freeze();
+            void Unfreeze();
+            bool IsFrozen() const;
+
+            size_t GetMemoryUsage( std::vector< LHWSUtilNS::JwtIssuerMemoryUsage >& usageOut ) const;
+
+            void GetLockWaitStats( LockWaitStats& statsOut ) const;
+            void ResetLockWaitStats();
+
         private:
-            mutable std::mutex cacheMutex;
+            mutable TimedMutex cacheMutex;
             std::unordered_map< std::string, std::shared_ptr< JwtIssuer > > issToJwtIssuer;
             std::unordered_map< std::string, LHWSUtilNS::JwtIssuerCacheParams > pendingIssToCacheParams;
+            // read without cacheMutex, null unless frozen
+            std::atomic< const FrozenIssuerTable* > frozenIssuers;
+            // owns the table frozenIssuers points at, under cacheMutex
+            std::unique_ptr< FrozenIssuerTable > frozenTable;
+            // a reader of frozenIssuers counts itself in frozenReaders[ frozenReadEpoch & 1 ] until it is
+            // done with the table, so that a table which is replaced is freed once no reader holds it
+            std::atomic< unsigned > frozenReadEpoch;
+            mutable std::atomic< size_t > frozenReaders[ 2 ];
+
+            // counts the calling thread as a reader of the frozen table it points at, if any
+            class FrozenIssuersReader
+            {
+                public:
+                    FrozenIssuersReader( const JwtIssuerCache& jwtIssuerCache );
+                    ~FrozenIssuersReader();
+
+                    FrozenIssuersReader( const FrozenIssuersReader& other ) = delete;
+                    FrozenIssuersReader& operator=( const FrozenIssuersReader& other ) = delete;
+
+                    // null unless the cache is frozen
+                    const FrozenIssuerTable* table;
+
+                private:
+                    std::atomic< size_t >* readers;
+            };
 
             int reloadIssuer( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams );
+            // points frozenIssuers at table, then frees the table it pointed at once no reader holds it
+            // assume lock held
+            void replaceFrozenIssuers( std::unique_ptr< FrozenIssuerTable >&& table );
     };
 
+    // builds a JwtIssuer from cacheParams, fetching the keys it lacks if pulldownOpenIdConfiguration
+    // return 0 and set jwtIssuerOut if loaded
+    int LoadJwtIssuer( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams,
+                       std::shared_ptr< JwtIssuer >& jwtIssuerOut );
+
+    // fills the endpoints and the keys of algsToFetch from the openid-configuration of fields.url
     int FillJwtIssuerFromEndpoints( const std::unordered_set< std::string >& algsToFetch,
-                                     JwtIssuer& jwtIssuer );
+                                     JwtIssuerFields& fields );
 }
 
 #endif
@@ -0,0 +1,16 @@
+#ifndef __LHWSUTIL_IMPL_JWTPOLICY_H__
+#define __LHWSUTIL_IMPL_JWTPOLICY_H__
+
+#include <rapidjson/document.h>
+
+#include <lhwsutil/jwtpolicy.h>
+
+namespace LHWSUtilImplNS
+{
+    // evaluates the policy directly against a parsed payload or introspection response, the one
+    // evaluator behind IJwtValidator and JwtPolicy::Evaluate
+    LHWSUtilNS::JwtPolicyDecision EvaluateJwtPolicy( const LHWSUtilNS::JwtPolicy& policy,
+                                                     const rapidjson::Value& claims );
+}
+
+#endif
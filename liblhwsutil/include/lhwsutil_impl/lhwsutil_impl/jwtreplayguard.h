@@ -0,0 +1,102 @@
+#ifndef __LHWSUTIL_IMPL_JWTREPLAYGUARD_H__
+#define __LHWSUTIL_IMPL_JWTREPLAYGUARD_H__
+
+#include <lhwsutil/ijwtreplayguard.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+namespace LHWSUtilImplNS
+{
+    // a fixed size set of jti hashes whose entries are dropped at their exp by a hierarchical
+    // timing wheel of 1 second ticks
+    // level 0 has a slot per second of the next 256, levels 1 to 3 a slot per 2^8, 2^14 and 2^20
+    // seconds, an entry moves down a level each time its slot comes round until it expires from
+    // level 0, so expiring costs a constant per tick and entry
+    // not thread safe, JwtReplayGuard shards over these
+    class ReplayTimingWheel
+    {
+        public:
+            ReplayTimingWheel( size_t _capacity, long now );
+
+            ReplayTimingWheel( const ReplayTimingWheel& other ) = delete;
+            ReplayTimingWheel& operator=( const ReplayTimingWheel& other ) = delete;
+
+            // expires every entry whose exp is not after now
+            void Advance( long now );
+
+            // return First if hash was inserted, Replayed if it is present, Unrecorded if the wheel
+            // is full or exp is too far ahead, exp must be after the wheel's time
+            LHWSUtilNS::JwtReplayCheck Insert( uint64_t hash, long exp );
+
+            size_t NumEntries() const;
+
+        private:
+            static const uint32_t noEntry = 0xffffffff;
+            static const size_t numLevels = 4;
+            static const size_t level0Slots = 256;
+            static const size_t levelSlots = 64;
+            static const size_t numSlots = level0Slots + ( ( numLevels - 1 ) * levelSlots );
+
+            struct Entry
+            {
+                uint64_t hash;
+                long exp;
+                // the next entry of the same bucket, or of the free list
+                uint32_t nextInBucket;
+                uint32_t nextInSlot;
+            };
+
+            size_t capacity;
+            size_t bucketMask;
+            long time;
+            size_t numEntries;
+            uint32_t freeEntries;
+            std::unique_ptr< Entry[] > entries;
+            std::unique_ptr< uint32_t[] > buckets;
+            uint32_t slots[ numSlots ];
+
+            void tick();
+            // moves every entry of slot to a lower level, or expires it
+            void cascade( size_t slot );
+            // return false if exp is too far ahead of time
+            bool schedule( uint32_t entry );
+            void remove( uint32_t entry );
+    };
+
+    // ReplayTimingWheels sharded on the jti's hash, each behind its own mutex, about 28 bytes per
+    // entry allocated up front
+    class JwtReplayGuard : public LHWSUtilNS::IJwtReplayGuard
+    {
+        public:
+            JwtReplayGuard( const LHWSUtilNS::JwtReplayGuardParams& _params );
+            ~JwtReplayGuard();
+
+            JwtReplayGuard( const JwtReplayGuard& other ) = delete;
+            JwtReplayGuard& operator=( const JwtReplayGuard& other ) = delete;
+
+            LHWSUtilNS::JwtReplayCheck CheckAndRecord( const char* iss, size_t issSize,
+                                                       const char* jti, size_t jtiSize,
+                                                       long exp, long now );
+            LHWSUtilNS::JwtReplayFailMode GetFailMode() const;
+            size_t NumEntries() const;
+
+        private:
+            static const size_t numShards = 64;
+
+            struct Shard
+            {
+                Shard( size_t capacity, long now );
+
+                std::mutex mutex;
+                ReplayTimingWheel wheel;
+            };
+
+            LHWSUtilNS::JwtReplayGuardParams params;
+            std::unique_ptr< std::unique_ptr< Shard >[] > shards;
+    };
+}
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef __LHWSUTIL_IMPL_JWTREVOCATIONLIST_H__
+#define __LHWSUTIL_IMPL_JWTREVOCATIONLIST_H__
+
+#include <lhwsutil/ijwtrevocationlist.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace LHWSUtilImplNS
+{
+    // a blocked bloom filter, a key sets one bit in each word of a single 64 byte block so that a
+    // lookup touches one cache line
+    // Add and MayContain may run concurrently, a key is only reported once its Add completed
+    class RevocationBloomFilter
+    {
+        public:
+            RevocationBloomFilter( size_t _capacity );
+
+            RevocationBloomFilter( const RevocationBloomFilter& other ) = delete;
+            RevocationBloomFilter& operator=( const RevocationBloomFilter& other ) = delete;
+
+            void Add( uint64_t hash );
+            bool MayContain( uint64_t hash ) const;
+            // the number of keys the filter is sized for
+            size_t GetCapacity() const;
+
+        private:
+            static const size_t wordsPerBlock = 8;
+            // ~0.5% false positives at capacity
+            static const size_t bitsPerKey = 16;
+
+            size_t capacity;
+            size_t numBlocks;
+            std::unique_ptr< std::atomic< uint64_t >[] > words;
+    };
+
+    // the hash of a revocation key, shared by the filter and the shard choice
+    uint64_t HashRevocation( LHWSUtilNS::JwtRevocationClaim claim, const char* value, size_t valueSize );
+
+    // revocations in a RevocationBloomFilter in front of a sharded exact set, so that lookups of
+    // tokens which are not revoked, nearly all of them, take no lock
+    // Reload and the rebuilds which grow the filter or drop expired revocations build a new set
+    // and swap it in, lookups pick the new set up through a per thread cache of the current one
+    class JwtRevocationList : public LHWSUtilNS::IJwtRevocationList
+    {
+        public:
+            JwtRevocationList( size_t _expectedRevocations );
+            ~JwtRevocationList();
+
+            JwtRevocationList( const JwtRevocationList& other ) = delete;
+            JwtRevocationList& operator=( const JwtRevocationList& other ) = delete;
+
+            void Revoke( const LHWSUtilNS::JwtRevocation& revocation );
+            void Reload( const std::vector< LHWSUtilNS::JwtRevocation >& revocations );
+            size_t Expire( long now );
+            size_t NumRevocations() const;
+
+            bool IsRevoked( LHWSUtilNS::JwtRevocationClaim claim,
+                            const char* value,
+                            size_t valueSize,
+                            long now ) const;
+
+        private:
+            static const size_t numShards = 64;
+
+            struct Shard
+            {
+                std::mutex mutex;
+                // claim byte + value -> exp
+                std::unordered_map< std::string, long > revocations;
+            };
+
+            struct RevocationSet
+            {
+                RevocationSet( size_t capacity );
+
+                RevocationBloomFilter filter;
+                Shard shards[ numShards ];
+                size_t numRevocations;
+                // revocations dropped since the filter was built, whose bits are still set
+                size_t numStaleInFilter;
+            };
+
+            size_t expectedRevocations;
+            // serializes Revoke, Reload and Expire
+            mutable std::mutex writeMutex;
+            // guards currentSet, taken by lookups only when generation moved
+            mutable std::mutex currentSetMutex;
+            std::shared_ptr< RevocationSet > currentSet;
+            // unique across every list, changes whenever currentSet is replaced
+            std::atomic< uint64_t > generation;
+
+            // the current set, kept alive by the calling thread until it next sees a new generation
+            RevocationSet& acquireSet() const;
+            void replaceSet( const std::shared_ptr< RevocationSet >& revocationSet );
+            // return true if the revocation was not already in revocationSet
+            static bool insert( RevocationSet& revocationSet, const LHWSUtilNS::JwtRevocation& revocation );
+            // a set sized for at least capacity holding the revocations of revocationSet whose exp
+            // is after now
+            static std::shared_ptr< RevocationSet > rebuild( RevocationSet& revocationSet,
+                                                             size_t capacity,
+                                                             long now );
+    };
+}
+
+#endif
@@ -4,19 +4,35 @@
 #include <jwt.h> // C include, contains extern "C"
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_set>
 
 #include <rapidjson/document.h>
 
 #include <lhwsutil/ijwtvalidator.h>
+#include <lhwsutil/isimplehttpclient.h>
+
+#include <lhwsutil_impl/latencyhistogram.h>
 
 namespace LHWSUtilImplNS
 {
+    // the latencies of every introspection request, failed and timed out ones included, shared by
+    // every validator so hedging learns from all introspection traffic
+    LatencyHistogram& IntrospectionLatencies();
+
+    // sets the timeouts of an introspection request from params' deadline and its hedge delay
+    // from the hedgePercentile of IntrospectionLatencies
+    // return !=0 if the deadline has already passed
+    int FillIntrospectionRequestParams( const LHWSUtilNS::JwtIntrospectionParams& params,
+                                        LHWSUtilNS::HttpRequestParams& httpRequestParams );
+
     class ValidJwt : public LHWSUtilNS::IValidJwt
     {
         public:
             ValidJwt( jwt_t** lpJwt );
+            // takes the claims the validator already parsed from the token's payload, if any
+            ValidJwt( jwt_t** lpJwt, std::unique_ptr< rapidjson::Document >&& _claims );
             ValidJwt( jwt_t* lpJwt, bool copyJwt );
             ~ValidJwt();
 
@@ -35,18 +51,40 @@ namespace LHWSUtilImplNS
                                   std::string& valueOut ) const;
             void ToString( std::string& out, bool prettyPrint ) const;
 
+            int GetClaimStrValue( const LHWSUtilNS::ClaimPath& path,
+                                  std::string& valueOut ) const;
+            int GetClaimBoolValue( const LHWSUtilNS::ClaimPath& path,
+                                   bool& valueOut ) const;
+            int GetClaimIntValue( const LHWSUtilNS::ClaimPath& path,
+                                  long& valueOut ) const;
+            int ClaimArrayContains( const LHWSUtilNS::ClaimPath& path,
+                                    const std::string& value,
+                                    bool& containsOut ) const;
+            int ForEachClaimStr( const LHWSUtilNS::ClaimPath& path,
+                                 const std::function< bool( const char* str, size_t strSize ) >& visitor ) const;
+
         private:
             jwt_t* jwt;
             bool owning;
             int _errno;
+            // libjwt only hands out nested claims serialized, so unless the validator parsed the
+            // payload already the grants are serialized and parsed once, on the first nested claim access
+            const bool claimsGiven;
+            mutable std::once_flag claimsParsed;
+            mutable std::unique_ptr< rapidjson::Document > claims;
 
             int getJwtErrno() const;
+            const rapidjson::Value* resolveClaim( const LHWSUtilNS::ClaimPath& path ) const;
     };
 
     class ValidJwtJson : public LHWSUtilNS::IValidJwt
     {
         public:
+            // copies _jsonValue
             ValidJwtJson( const rapidjson::Value& _jsonValue );
+            // takes _jsonValue, its allocator and the buffer it was parsed in situ from, if any
+            // throws std::runtime_error if _jsonValue is not an object
+            ValidJwtJson( rapidjson::Document&& _jsonValue, std::unique_ptr< std::string >&& _insituBuffer );
             ~ValidJwtJson();
 
             ValidJwtJson( const ValidJwtJson& other ) = delete;
@@ -64,7 +102,21 @@ namespace LHWSUtilImplNS
                                   std::string& valueOut ) const;
             void ToString( std::string& out, bool prettyPrint ) const;
 
+            int GetClaimStrValue( const LHWSUtilNS::ClaimPath& path,
+                                  std::string& valueOut ) const;
+            int GetClaimBoolValue( const LHWSUtilNS::ClaimPath& path,
+                                   bool& valueOut ) const;
+            int GetClaimIntValue( const LHWSUtilNS::ClaimPath& path,
+                                  long& valueOut ) const;
+            int ClaimArrayContains( const LHWSUtilNS::ClaimPath& path,
+                                    const std::string& value,
+                                    bool& containsOut ) const;
+            int ForEachClaimStr( const LHWSUtilNS::ClaimPath& path,
+                                 const std::function< bool( const char* str, size_t strSize ) >& visitor ) const;
+
         private:
+            // before jsonValue, whose strings may point into it
+            std::unique_ptr< std::string > insituBuffer;
             rapidjson::Document jsonValue;
     };
 
@@ -73,6 +125,7 @@ namespace LHWSUtilImplNS
     {
         public:
             JwtValidator();
+            JwtValidator( const LHWSUtilNS::JwtValidatorParams& params );
 
             // 1) decode b64EncodedJwt -> jwt
             // 2) getUrl jwt.iss -> issuer
@@ -84,6 +137,54 @@ namespace LHWSUtilImplNS
             std::unique_ptr< LHWSUtilNS::IValidJwt > ValidateIntoJwt( const std::string& b64UrlEncodedJwt ) const;
 
             std::unique_ptr< LHWSUtilNS::IValidJwt > IntrospectJwt( const std::string& b64UrlEncodedJwt ) const;
+            std::unique_ptr< LHWSUtilNS::IValidJwt > IntrospectJwt( const std::string& b64UrlEncodedJwt,
+                                                                  const LHWSUtilNS::JwtIntrospectionParams& params ) const;
+
+            std::unique_ptr< LHWSUtilNS::IValidJwt > ValidateIntoJwt( const std::string& b64UrlEncodedJwt,
+                                                                    const LHWSUtilNS::JwtPolicy& policy,
+                                                                    LHWSUtilNS::JwtPolicyDecision& decision ) const;
+            std::unique_ptr< LHWSUtilNS::IValidJwt > IntrospectJwt( const std::string& b64UrlEncodedJwt,
+                                                                  const LHWSUtilNS::JwtIntrospectionParams& params,
+                                                                  const LHWSUtilNS::JwtPolicy& policy,
+                                                                  LHWSUtilNS::JwtPolicyDecision& decision ) const;
+
+            LHWSUtilNS::JwtValidationResult ValidateIntoJwt( const std::string& b64UrlEncodedJwt,
+                                                             LHWSUtilNS::ValidatedJwt& validatedJwt ) const;
+            LHWSUtilNS::JwtValidationResult IntrospectJwt( const std::string& b64UrlEncodedJwt,
+                                                           const LHWSUtilNS::JwtIntrospectionParams& params,
+                                                           LHWSUtilNS::ValidatedJwt& validatedJwt ) const;
+
+
+        protected:
+            int validateIntoClaims( const std::string& b64UrlEncodedJwt,
+                                    const LHWSUtilNS::ClaimProjectionBase& projection,
+                                    void* claims ) const;
+
+        private:
+            const std::shared_ptr< LHWSUtilNS::IJwtReplayGuard > replayGuard;
+            const LHWSUtilNS::JwtValidationChecks checks;
+
+            // policy may be null
+            std::unique_ptr< LHWSUtilNS::IValidJwt > validateIntoJwt( const std::string& b64UrlEncodedJwt,
+                                                                    const LHWSUtilNS::JwtPolicy* policy,
+                                                                    LHWSUtilNS::JwtPolicyDecision& decision ) const;
+            std::unique_ptr< LHWSUtilNS::IValidJwt > introspectJwt( const std::string& b64UrlEncodedJwt,
+                                                                  const LHWSUtilNS::JwtIntrospectionParams& params,
+                                                                  const LHWSUtilNS::JwtPolicy* policy,
+                                                                  LHWSUtilNS::JwtPolicyDecision& decision ) const;
+            // decodes the payload into payloadBuffer and parses it in situ into payloadJson, which
+            // hold the claims once the result is Valid
+            // projection may be null, otherwise claims are projected from the payload before the
+            // result is recorded
+            template< typename PayloadDocument >
+            LHWSUtilNS::JwtValidationResult introspectIntoJson( const std::string& b64UrlEncodedJwt,
+                                                                const LHWSUtilNS::JwtIntrospectionParams& params,
+                                                                const LHWSUtilNS::JwtPolicy* policy,
+                                                                LHWSUtilNS::JwtPolicyDecision& decision,
+                                                                std::string& payloadBuffer,
+                                                                PayloadDocument& payloadJson,
+                                                                const LHWSUtilNS::ClaimProjectionBase* projection,
+                                                                void* claims ) const;
     };
 
     class JwtValidatorFactory : public LHWSUtilNS::IJwtValidatorFactory
@@ -93,6 +194,7 @@ namespace LHWSUtilImplNS
             ~JwtValidatorFactory();
 
             std::unique_ptr< LHWSUtilNS::IJwtValidator > CreateJwtValidator() const;
+            std::unique_ptr< LHWSUtilNS::IJwtValidator > CreateJwtValidator( const LHWSUtilNS::JwtValidatorParams& params ) const;
     };
 }
 
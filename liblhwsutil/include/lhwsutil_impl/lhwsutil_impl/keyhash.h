@@ -0,0 +1,36 @@
+#ifndef __LHWSUTIL_IMPL_KEYHASH_H__
+#define __LHWSUTIL_IMPL_KEYHASH_H__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace LHWSUtilImplNS
+{
+    const uint64_t keyHashSeed = 0xcbf29ce484222325ULL;
+
+    // fnv-1a over key continuing from hash, e.g. ExtendKeyHash( keyHashSeed, key, keySize )
+    inline uint64_t ExtendKeyHash( uint64_t hash, const char* key, size_t keySize )
+    {
+        for ( size_t i = 0; i < keySize; ++i )
+        {
+            hash = ( hash ^ static_cast< unsigned char >( key[ i ] ) ) * 0x100000001b3ULL;
+        }
+
+        return hash;
+    }
+
+    // mixes every bit of hash into every other, fnv-1a alone leaves the high bits weak and the
+    // filters and tables index with them
+    inline uint64_t FinishKeyHash( uint64_t hash )
+    {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdULL;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ULL;
+        hash ^= hash >> 33;
+
+        return hash;
+    }
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef __LHWSUTIL_IMPL_LATENCYHISTOGRAM_H__
+#define __LHWSUTIL_IMPL_LATENCYHISTOGRAM_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace LHWSUtilImplNS
+{
+    // log-linear buckets, 4 per power of two, over microseconds
+    // bucket i < 4 holds exactly i, every other bucket is at most 25% wide
+    const size_t numLatencyBuckets = 128;
+
+    size_t LatencyBucketForMicros( uint64_t micros );
+    // exclusive upper bound of the bucket
+    uint64_t LatencyBucketUpperBoundMicros( size_t bucket );
+
+    // lock free, safe to record from many threads at once
+    class LatencyHistogram
+    {
+        public:
+            LatencyHistogram();
+            ~LatencyHistogram();
+
+            LatencyHistogram( const LatencyHistogram& other ) = delete;
+            LatencyHistogram& operator=( const LatencyHistogram& other ) = delete;
+
+            void Record( uint64_t micros );
+            // adds the counts recorded by other
+            void Merge( const LatencyHistogram& other );
+
+            uint64_t GetCount() const;
+            // upper bound of the bucket containing the percentile ( 0 < percentile <= 1 ), 0 if empty
+            uint64_t GetPercentileMicros( double percentile ) const;
+
+        private:
+            std::atomic< uint64_t > count;
+            std::atomic< uint64_t > buckets[ numLatencyBuckets ];
+    };
+}
+
+#endif
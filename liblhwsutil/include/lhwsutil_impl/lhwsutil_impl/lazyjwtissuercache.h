@@ -0,0 +1,88 @@
+#ifndef __LHWSUTIL_IMPL_LAZYJWTISSUERCACHE_H__
+#define __LHWSUTIL_IMPL_LAZYJWTISSUERCACHE_H__
+
+#include <lhwsutil/ijwtissuercache.h>
+
+#include <lhwsutil_impl/jwtissuercache.h>
+#include <lhwsutil_impl/timedmutex.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace LHWSUtilImplNS
+{
+    // whether iss matches pattern, see LazyJwtIssuerCacheParams::allowedIssPatterns
+    bool IssMatchesPattern( const std::string& iss, const std::string& pattern );
+
+    // loads issuers on first use and evicts the least recently used ones beyond maxMemoryBytes
+    // a load is made without cacheMutex held, concurrent GetIssuers of the same iss wait for it
+    // rather than loading it again
+    class LazyJwtIssuerCache : public LHWSUtilNS::IJwtIssuerCache
+    {
+        public:
+            LazyJwtIssuerCache( const LHWSUtilNS::LazyJwtIssuerCacheParams& _params );
+            ~LazyJwtIssuerCache();
+
+            LazyJwtIssuerCache( const LazyJwtIssuerCache& other ) = delete;
+            LazyJwtIssuerCache& operator=( const LazyJwtIssuerCache& other ) = delete;
+
+            void LoadIssuer( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams );
+            bool IssuerIsLoaded( const std::string& iss ) const;
+            std::shared_ptr< LHWSUtilNS::IJwtIssuer > GetIssuer( const std::string& iss );
+
+            int Freeze();
+            void Unfreeze();
+            bool IsFrozen() const;
+
+            size_t GetMemoryUsage( std::vector< LHWSUtilNS::JwtIssuerMemoryUsage >& usageOut ) const;
+
+            void GetLockWaitStats( LockWaitStats& statsOut ) const;
+            void ResetLockWaitStats();
+
+        private:
+            enum class EntryState
+            {
+                Loading = 0,
+                Loaded,
+                // not loaded again until retryAt
+                Failed
+            };
+
+            struct Entry
+            {
+                Entry();
+
+                EntryState state;
+                std::shared_ptr< JwtIssuer > jwtIssuer;
+                // counted against maxMemoryBytes, Loaded and Failed only
+                size_t bytes;
+                std::chrono::steady_clock::time_point retryAt;
+                // Loaded and Failed only
+                std::list< const std::string* >::iterator lruPosition;
+            };
+
+            LHWSUtilNS::LazyJwtIssuerCacheParams params;
+            mutable TimedMutex cacheMutex;
+            std::condition_variable_any loadedCondition;
+            std::unordered_map< std::string, Entry > issToEntry;
+            // the keys of issToEntry, most recently used first
+            std::list< const std::string* > lru;
+            size_t memoryBytes;
+            // the params given to LoadIssuer, an evicted issuer is loaded again with them
+            std::unordered_map< std::string, LHWSUtilNS::JwtIssuerCacheParams > issToLoadedParams;
+
+            // return true and fill cacheParams if iss matches a pattern or the resolver accepts it
+            bool resolve( const std::string& iss, LHWSUtilNS::JwtIssuerCacheParams& cacheParams ) const;
+            // assume lock held, records the load of the Loading entry of iss
+            void completeLoad( const std::string& iss, const std::shared_ptr< JwtIssuer >& jwtIssuer );
+            // assume lock held
+            void evict();
+    };
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef __LHWSUTIL_IMPL_METRICSREGISTRY_H__
+#define __LHWSUTIL_IMPL_METRICSREGISTRY_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <lhwsutil/metrics.h>
+
+#include <lhwsutil_impl/latencyhistogram.h>
+
+namespace LHWSUtilImplNS
+{
+    // issuers beyond this share the "other" label
+    const size_t maxMetricsIssuers = 64;
+    const size_t otherMetricsIssuer = maxMetricsIssuers;
+    const size_t numMetricsIssuers = maxMetricsIssuers + 1;
+
+    extern const char* const metricsAlgNames[];
+    const size_t numMetricsAlgs = 15;
+    const size_t otherMetricsAlg = numMetricsAlgs - 1;
+
+    // written by a single thread, read by any, so increments need no locked instruction
+    class ShardCounter
+    {
+        public:
+            ShardCounter();
+
+            ShardCounter( const ShardCounter& other ) = delete;
+            ShardCounter& operator=( const ShardCounter& other ) = delete;
+
+            void Add( uint64_t n )
+            {
+                value.store( value.load( std::memory_order_relaxed ) + n, std::memory_order_relaxed );
+            }
+
+            uint64_t Get() const
+            {
+                return value.load( std::memory_order_relaxed );
+            }
+
+        private:
+            std::atomic< uint64_t > value;
+    };
+
+    // single writer counterpart of LatencyHistogram, same buckets
+    struct ShardHistogram
+    {
+        void Record( uint64_t micros )
+        {
+            buckets[ LatencyBucketForMicros( micros ) ].Add( 1 );
+            count.Add( 1 );
+            sumMicros.Add( micros );
+        }
+
+        ShardCounter count;
+        ShardCounter sumMicros;
+        ShardCounter buckets[ numLatencyBuckets ];
+    };
+
+    struct MetricsShard
+    {
+        ShardCounter validationsByMethod[ LHWSUtilNS::numJwtValidationMethods ][ LHWSUtilNS::numJwtValidationResults ];
+        ShardCounter validationsByStage[ LHWSUtilNS::numJwtValidationStages ][ LHWSUtilNS::numJwtValidationResults ];
+        ShardCounter validationsByIssuer[ numMetricsIssuers ][ LHWSUtilNS::numJwtValidationResults ];
+        ShardCounter validationsByAlg[ numMetricsAlgs ][ LHWSUtilNS::numJwtValidationResults ];
+        ShardHistogram validationLatency[ LHWSUtilNS::numJwtValidationMethods ];
+
+        ShardCounter issuerCacheHits;
+        ShardCounter issuerCacheMisses;
+        ShardCounter issuerReloads;
+        ShardCounter issuerReloadFailures;
+
+        ShardCounter httpRequests[ LHWSUtilNS::numHttpRequestOutcomes ];
+        ShardCounter httpHedgedRequests;
+        ShardHistogram httpTimings[ LHWSUtilNS::numHttpTimings ];
+    };
+
+    // every thread records into its own shard, snapshots sum the shards of live threads and
+    // the totals of the threads that have exited
+    //
+    // issuers are given a label index when they are loaded into a cache, lookups of the index
+    // are lock free, an iss taken from an unverified token can never create a label
+    class MetricsRegistry
+    {
+        public:
+            MetricsRegistry();
+            ~MetricsRegistry();
+
+            MetricsRegistry( const MetricsRegistry& other ) = delete;
+            MetricsRegistry& operator=( const MetricsRegistry& other ) = delete;
+
+            // the calling thread's shard, created on first use
+            static MetricsShard& LocalShard();
+
+            void RegisterIssuer( const std::string& iss );
+            // otherMetricsIssuer if iss was never registered
+            size_t IssuerIndex( const std::string& iss ) const;
+
+            void AddPendingIssuers( int64_t delta );
+
+            void GetSnapshot( LHWSUtilNS::MetricsSnapshot& snapshotOut ) const;
+
+            void AttachShard( MetricsShard* shard );
+            // folds the shard's counts into the retired totals
+            void DetachShard( MetricsShard* shard );
+
+        private:
+            struct IssuerSlot
+            {
+                IssuerSlot();
+
+                std::atomic< bool > used;
+                size_t hash;
+                size_t index;
+                std::string iss;
+            };
+
+            // twice maxMetricsIssuers keeps probe sequences short
+            static const size_t numIssuerSlots = 2 * maxMetricsIssuers;
+
+            mutable std::mutex registryMutex;
+            std::vector< MetricsShard* > shards;
+            MetricsShard retired;
+            IssuerSlot issuerSlots[ numIssuerSlots ];
+            std::string issuerLabels[ maxMetricsIssuers ];
+            std::atomic< size_t > numIssuers;
+            std::atomic< int64_t > pendingIssuers;
+    };
+
+    // never destroyed so threads exiting during shutdown can still detach
+    MetricsRegistry& GetMetricsRegistry();
+
+    // the index into metricsAlgNames, otherMetricsAlg if unknown
+    size_t MetricsAlgIndex( const char* alg );
+
+    void RecordJwtValidation( LHWSUtilNS::JwtValidationMethod method,
+                              LHWSUtilNS::JwtValidationResult result,
+                              LHWSUtilNS::JwtValidationStage stage,
+                              size_t issuerIndex,
+                              size_t algIndex,
+                              uint64_t micros );
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef __LHWSUTIL_IMPL_PROBES_H__
+#define __LHWSUTIL_IMPL_PROBES_H__
+
+// USDT probes under the lhwsutil provider, see scripts/bpftrace
+// with LHWSUTIL_ENABLE_USDT each probe is a nop until a tracer attaches, without it the probes
+// and their arguments are compiled out
+//
+//   validate_entry( int method, size_t tokenSize )
+//   validate_exit( int method, int result, int stage, uint64_t micros )
+//   issuer_cache_hit( const char* iss )
+//   issuer_cache_miss( const char* iss )
+//   issuer_reload_entry( const char* iss )
+//   issuer_reload_exit( const char* iss, int rc )
+//   http_perform_entry( const char* url )
+//   http_perform_exit( const char* url, int curlCode, long hedgeAfterMs )
+//
+// method, result and stage are LHWSUtilNS::JwtValidationMethod, JwtValidationResult and
+// JwtValidationStage, every ValidateIntoJwt overload, ValidateIntoClaims and
+// StaticJwtValidator report ValidateIntoJwt, every IntrospectJwt overload IntrospectJwt
+
+#ifdef LHWSUTIL_ENABLE_USDT
+
+#include <sys/sdt.h>
+
+#define LHWSUTIL_PROBE1( name, a1 ) \
+    DTRACE_PROBE1( lhwsutil, name, a1 )
+#define LHWSUTIL_PROBE2( name, a1, a2 ) \
+    DTRACE_PROBE2( lhwsutil, name, a1, a2 )
+#define LHWSUTIL_PROBE3( name, a1, a2, a3 ) \
+    DTRACE_PROBE3( lhwsutil, name, a1, a2, a3 )
+#define LHWSUTIL_PROBE4( name, a1, a2, a3, a4 ) \
+    DTRACE_PROBE4( lhwsutil, name, a1, a2, a3, a4 )
+
+#else
+
+#define LHWSUTIL_PROBE1( name, a1 ) \
+    do {} while ( 0 )
+#define LHWSUTIL_PROBE2( name, a1, a2 ) \
+    do {} while ( 0 )
+#define LHWSUTIL_PROBE3( name, a1, a2, a3 ) \
+    do {} while ( 0 )
+#define LHWSUTIL_PROBE4( name, a1, a2, a3, a4 ) \
+    do {} while ( 0 )
+
+#endif
+
+#endif
@@ -1,13 +1,14 @@
 #ifndef __LHWSUTIL_IMPL_RSA_H__
 #define __LHWSUTIL_IMPL_RSA_H__
 
-#include <openssl/rsa.h> // TODO - upgrade to 1.1, support multiple versions
+#include <openssl/evp.h>
 
 #include <string>
 #include <vector>
 
 namespace LHWSUtilImplNS
 {
+    // on OpenSSL 3 the key is built from n and e with EVP_PKEY_fromdata, RSA_set0_key before it
     class RSAPublicKey
     {
         public:
@@ -23,8 +24,11 @@ namespace LHWSUtilImplNS
 
             int GetPEMFormatInto( std::string& pemOut ) const;
 
+            // owned by the RSAPublicKey, EVP_PKEY_up_ref to keep it longer
+            EVP_PKEY* GetKey() const;
+
         private:
-            RSA* rsa; 
+            EVP_PKEY* pkey;
     };
 }
 
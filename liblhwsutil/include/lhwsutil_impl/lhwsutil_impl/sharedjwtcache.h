@@ -0,0 +1,206 @@
+#ifndef __LHWSUTIL_IMPL_SHAREDJWTCACHE_H__
+#define __LHWSUTIL_IMPL_SHAREDJWTCACHE_H__
+
+#include <lhwsutil/ijwtissuercache.h>
+#include <lhwsutil/isharedjwtcache.h>
+
+#include <lhwsutil_impl/jwtissuercache.h>
+#include <lhwsutil_impl/timedmutex.h>
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace LHWSUtilImplNS
+{
+    // an issuer's url, bearer token, endpoints and keys as held in a SharedJwtCache slot, its
+    // openid-configuration is not shared
+    void SerializeJwtIssuer( const JwtIssuer& jwtIssuer, std::string& recordOut );
+    // return 0 and fill fieldsOut if record is a whole serialized issuer
+    int ParseJwtIssuerRecord( const char* record, size_t recordSize, JwtIssuerFields& fieldsOut );
+
+    // the segment is a header, numIssuerSlots slots of issuer records and numResultSlots slots of
+    // introspection results, every slot guarded by a seqlock: its seq is odd while it is written
+    // and a reader keeps what it copied only if seq was even and unchanged around the copy
+    // only the writer process publishes issuers, into the slot found by probing from the hash of
+    // their url, any process records results, into the one slot for the token's sha-256, taking
+    // the slot by setting its pid into it and dropping the result if a live process holds it, the
+    // slot of a process which died mid record is taken over
+    // the segment holds no pointers, each process may map it at its own address
+    // a writer which exits or replaces the segment of an earlier one marks it retired, and a reader
+    // which finds its segment retired maps the one under name again, from GetIssuer
+    class SharedJwtCache : public LHWSUtilNS::ISharedJwtCache
+    {
+        public:
+            // throws if the segment cannot be created or opened, or was not created by a writer of this layout
+            SharedJwtCache( const LHWSUtilNS::SharedJwtCacheParams& _params );
+            ~SharedJwtCache();
+
+            SharedJwtCache( const SharedJwtCache& other ) = delete;
+            SharedJwtCache& operator=( const SharedJwtCache& other ) = delete;
+
+            // writer only, throws in a reader or a process forked from the writer
+            void LoadIssuer( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams );
+            bool IssuerIsLoaded( const std::string& iss ) const;
+            std::shared_ptr< LHWSUtilNS::IJwtIssuer > GetIssuer( const std::string& iss );
+
+            int Freeze();
+            void Unfreeze();
+            bool IsFrozen() const;
+
+            // the issuers this process built from the segment, the segment itself is not counted
+            size_t GetMemoryUsage( std::vector< LHWSUtilNS::JwtIssuerMemoryUsage >& usageOut ) const;
+
+            size_t Refresh();
+
+            LHWSUtilNS::SharedJwtResult FindResult( const std::string& b64UrlEncodedJwt, long now ) const;
+            void RecordResult( const std::string& b64UrlEncodedJwt, bool active, long exp, long now );
+
+            void GetLockWaitStats( LockWaitStats& statsOut ) const;
+            void ResetLockWaitStats();
+
+        private:
+            struct SegmentHeader
+            {
+                // set last by the writer, once the rest of the segment is ready
+                std::atomic< uint64_t > magic;
+                uint32_t version;
+                uint32_t numIssuerSlots;
+                uint64_t maxIssuerBytes;
+                uint64_t numResultSlots;
+                // set when its writer exits or a later writer replaces it, readers then map the
+                // segment under name again
+                std::atomic< uint32_t > retired;
+            };
+
+            // followed by maxIssuerBytes of record
+            struct IssuerSlot
+            {
+                // 0 => never published
+                std::atomic< uint32_t > seq;
+                std::atomic< uint32_t > recordSize;
+                std::atomic< uint64_t > issHash;
+            };
+
+            struct ResultSlot
+            {
+                std::atomic< uint32_t > seq;
+                // the pid of the process recording into the slot, 0 => none
+                std::atomic< int32_t > recorder;
+                // a SharedJwtResult
+                std::atomic< uint32_t > result;
+                std::atomic< int64_t > expiresAt;
+                std::atomic< uint64_t > digest[ 4 ];
+            };
+
+            // a mapping of the segment, unmapped once no view of it is held
+            struct Segment
+            {
+                Segment();
+                ~Segment();
+
+                Segment( const Segment& other ) = delete;
+                Segment& operator=( const Segment& other ) = delete;
+
+                IssuerSlot& issuerSlot( size_t slot ) const;
+
+                void* base;
+                size_t size;
+                SegmentHeader* header;
+                char* issuerSlots;
+                size_t issuerSlotBytes;
+                size_t numIssuerSlots;
+                size_t maxIssuerBytes;
+                // null if the segment holds no results
+                ResultSlot* resultSlots;
+                size_t resultSlotMask;
+            };
+
+            struct LocalIssuer
+            {
+                size_t slot;
+                // the slot's seq when jwtIssuer was built from it
+                uint32_t seq;
+                std::shared_ptr< JwtIssuer > jwtIssuer;
+            };
+
+            // the segment this process maps and the issuers it built from it
+            struct LocalView
+            {
+                std::shared_ptr< Segment > segment;
+                std::unordered_map< std::string, LocalIssuer > issuers;
+            };
+
+            // counts the calling thread as a reader of the local view it points at
+            class LocalViewReader
+            {
+                public:
+                    LocalViewReader( const SharedJwtCache& sharedJwtCache );
+                    ~LocalViewReader();
+
+                    LocalViewReader( const LocalViewReader& other ) = delete;
+                    LocalViewReader& operator=( const LocalViewReader& other ) = delete;
+
+                    const LocalView* view;
+
+                private:
+                    std::atomic< size_t >* readers;
+            };
+
+            LHWSUtilNS::SharedJwtCacheRole role;
+            std::string name;
+            // the process which created the segment, the only one which publishes to or unlinks it
+            pid_t writerPid;
+            long resultLifetimeSeconds;
+            mutable TimedMutex cacheMutex;
+            // read without cacheMutex, the view is copied and replaced whole when an issuer is built
+            // or the segment is mapped again
+            std::atomic< const LocalView* > localView;
+            // owns the view localView points at, under cacheMutex
+            std::unique_ptr< LocalView > ownedLocalView;
+            // a reader of localView counts itself in localReaders[ localReadEpoch & 1 ] until it is
+            // done with the view, so that a view which is replaced is freed once no reader holds it
+            std::atomic< unsigned > localReadEpoch;
+            mutable std::atomic< size_t > localReaders[ 2 ];
+            // steady clock milliseconds before which a retired segment is not mapped again
+            std::atomic< int64_t > nextRemapAt;
+            // writer only, the params given to LoadIssuer
+            std::unordered_map< std::string, LHWSUtilNS::JwtIssuerCacheParams > issToLoadedParams;
+            // writer only, a slot is published by one thread at a time
+            std::mutex publishMutex;
+
+            // throws unless this is the writer process
+            void checkWriter() const;
+            // throws if the segment cannot be created
+            std::shared_ptr< Segment > createSegment( const LHWSUtilNS::SharedJwtCacheParams& params ) const;
+            // throws if the segment under name cannot be opened, is not ready, retired or of another layout
+            std::shared_ptr< Segment > openSegment() const;
+            // marks the segment an earlier writer left under name as retired, if there is one
+            void retireSegment() const;
+            // true if this is a reader whose segment was retired and is due to be mapped again
+            bool remapDue( const Segment& segment ) const;
+            // maps the segment under name, if it is ready, in place of the retired one
+            // assume lock held
+            void remap();
+            // return 0 and fill recordOut and seqOut with the record of iss, !=0 if there is none
+            int readIssuerRecord( const Segment& segment,
+                                  const std::string& iss,
+                                  size_t& slotOut,
+                                  uint32_t& seqOut,
+                                  std::string& recordOut ) const;
+            // return 0 if jwtIssuer is published
+            int publish( const JwtIssuer& jwtIssuer );
+            // points localView at view, then frees the view it pointed at once no reader holds it
+            // assume lock held
+            void replaceLocalView( std::unique_ptr< LocalView >&& view );
+    };
+}
+
+#endif
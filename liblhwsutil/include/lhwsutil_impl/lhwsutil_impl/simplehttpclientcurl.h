@@ -24,6 +24,9 @@ namespace LHWSUtilImplNS
         int Get( const std::string& url,
             const LHWSUtilNS::HttpRequestParams& params,
             std::string& responseBody );
+        int Get( const std::string& url,
+            const LHWSUtilNS::HttpRequestParams& params,
+            LHWSUtilNS::IHttpResponseSink& responseSink );
 
         int Post( const std::string& url,
             const std::string& data,
@@ -34,11 +37,22 @@ namespace LHWSUtilImplNS
             const std::unordered_map< std::string, std::string >& headers,
             const LHWSUtilNS::HttpRequestParams& params,
             std::string& responseBody );
+        int Post( const std::string& url,
+            const std::string& data,
+            const std::unordered_map< std::string, std::string >& headers,
+            const LHWSUtilNS::HttpRequestParams& params,
+            LHWSUtilNS::IHttpResponseSink& responseSink );
 
         std::string UrlEscape( const std::string& data );
 
     private:
         CURL* curl;
+        // reused across requests on this handle, see Get/Post
+        std::string responseBuffer;
+
+        CURLcode performHedged( const std::string& url,
+            const LHWSUtilNS::HttpRequestParams& params,
+            LHWSUtilNS::IHttpResponseSink& responseSink );
     };
 
     class SimpleHttpClientCurlFactory : public LHWSUtilNS::ISimpleHttpClientFactory
@@ -0,0 +1,44 @@
+#ifndef __LHWSUTIL_IMPL_TIMEDMUTEX_H__
+#define __LHWSUTIL_IMPL_TIMEDMUTEX_H__
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+namespace LHWSUtilImplNS
+{
+    struct LockWaitStats
+    {
+        LockWaitStats();
+
+        // acquisitions that found the mutex held
+        uint64_t contendedAcquisitions;
+        uint64_t waitNanos;
+    };
+
+    // std::mutex that accounts for the time spent waiting on contended acquisitions
+    // the uncontended path is a single try_lock, no clock is read
+    class TimedMutex
+    {
+        public:
+            TimedMutex();
+            ~TimedMutex();
+
+            TimedMutex( const TimedMutex& other ) = delete;
+            TimedMutex& operator=( const TimedMutex& other ) = delete;
+
+            void lock();
+            bool try_lock();
+            void unlock();
+
+            void GetWaitStats( LockWaitStats& statsOut ) const;
+            void ResetWaitStats();
+
+        private:
+            std::mutex mutex;
+            std::atomic< uint64_t > contendedAcquisitions;
+            std::atomic< uint64_t > waitNanos;
+    };
+}
+
+#endif
@@ -0,0 +1,85 @@
+#ifndef __LHWSUTIL_IMPL_VALIDATIONARENA_H__
+#define __LHWSUTIL_IMPL_VALIDATIONARENA_H__
+
+#include <rapidjson/document.h>
+#include <rapidjson/reader.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace LHWSUtilImplNS
+{
+    typedef rapidjson::MemoryPoolAllocator<> ArenaAllocator;
+    // values and the parse stack both come from the arena, its values are plain rapidjson::Values
+    typedef rapidjson::GenericDocument< rapidjson::UTF8<>, ArenaAllocator, ArenaAllocator > ArenaDocument;
+    typedef rapidjson::GenericReader< rapidjson::UTF8<>, rapidjson::UTF8<>, ArenaAllocator > ArenaReader;
+
+    const size_t validationArenaInitialBytes = 32 * 1024;
+    const size_t validationArenaStackBytes = 8 * 1024;
+    // initial parse stack of an ArenaDocument or ArenaReader, rapidjson's default
+    const size_t arenaParseStackCapacity = 1024;
+    // a single huge token or response should not pin its memory to the thread forever
+    const size_t validationArenaMaxBytes = 1024 * 1024;
+
+    // per thread memory for the temporaries of one validation or introspection, allocated by
+    // bumping through a buffer and released all at once when the outermost ValidationArenaScope on
+    // the thread ends
+    // the buffer grows to fit the largest call seen ( up to validationArenaMaxBytes ) so once warm
+    // parsing does not touch the heap
+    class ValidationArena
+    {
+        public:
+            ValidationArena();
+            ~ValidationArena();
+
+            ValidationArena( const ValidationArena& other ) = delete;
+            ValidationArena& operator=( const ValidationArena& other ) = delete;
+
+            ArenaAllocator& GetAllocator();
+            ArenaAllocator& GetStackAllocator();
+            size_t GetCapacity() const;
+
+            // release everything allocated, invalidates all values allocated from the arena
+            void Reset();
+
+        private:
+            friend class ValidationArenaScope;
+
+            rapidjson::CrtAllocator baseAllocator;
+            size_t bufferSize;
+            size_t stackBufferSize;
+            std::unique_ptr< char[] > buffer;
+            std::unique_ptr< char[] > stackBuffer;
+            std::unique_ptr< ArenaAllocator > allocator;
+            std::unique_ptr< ArenaAllocator > stackAllocator;
+            size_t depth;
+    };
+
+    // the calling thread's arena
+    ValidationArena& GetValidationArena();
+
+    // resets the thread's arena on destruction unless nested in another scope, e.g.
+    //
+    //   ValidationArenaScope arenaScope;
+    //   ArenaDocument json( &arenaScope.GetArena().GetAllocator(),
+    //                       arenaParseStackCapacity,
+    //                       &arenaScope.GetArena().GetStackAllocator() );
+    //
+    // declare it before anything allocated from the arena
+    class ValidationArenaScope
+    {
+        public:
+            ValidationArenaScope();
+            ~ValidationArenaScope();
+
+            ValidationArenaScope( const ValidationArenaScope& other ) = delete;
+            ValidationArenaScope& operator=( const ValidationArenaScope& other ) = delete;
+
+            ValidationArena& GetArena();
+
+        private:
+            ValidationArena& arena;
+    };
+}
+
+#endif
@@ -0,0 +1,234 @@
+#include <rapidjson/document.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include <lhwsutil/claimpath.h>
+
+#include <lhwsutil_impl/claimpath.h>
+
+namespace LHWSUtilNS
+{
+    namespace
+    {
+        // -1 unless token is a non-negative decimal integer without leading zeros
+        long arrayIndexOf( const std::string& token )
+        {
+            if ( token.empty() || ( token.size() > 9 ) || ( ( token.size() > 1 ) && ( token[ 0 ] == '0' ) ) )
+            {
+                return -1;
+            }
+
+            long index = 0;
+            for ( auto it = token.cbegin(); it != token.cend(); ++it )
+            {
+                if ( ( *it < '0' ) || ( *it > '9' ) )
+                {
+                    return -1;
+                }
+                index = ( index * 10 ) + ( *it - '0' );
+            }
+
+            return index;
+        }
+    }
+
+    ClaimPath::ClaimPath()
+        : path()
+        , tokens()
+        , indices()
+    {
+    }
+
+    ClaimPath::ClaimPath( const std::string& _path )
+        : path( _path )
+        , tokens()
+        , indices()
+    {
+        if ( path.empty() )
+        {
+            return;
+        }
+
+        bool jsonPointer = ( path[ 0 ] == '/' );
+        char separator = jsonPointer ? '/' : '.';
+        size_t tokenStart = jsonPointer ? 1 : 0;
+
+        while ( tokenStart <= path.size() )
+        {
+            size_t tokenEnd = path.find( separator, tokenStart );
+            if ( tokenEnd == std::string::npos )
+            {
+                tokenEnd = path.size();
+            }
+
+            if ( tokenEnd == tokenStart )
+            {
+                throw std::runtime_error( "empty token in claim path [" + path + "]" );
+            }
+
+            std::string token;
+            for ( size_t i = tokenStart; i < tokenEnd; ++i )
+            {
+                if ( jsonPointer && ( path[ i ] == '~' ) )
+                {
+                    char escaped = ( ( i + 1 ) < tokenEnd ) ? path[ i + 1 ] : '\0';
+                    if ( ( escaped != '0' ) && ( escaped != '1' ) )
+                    {
+                        throw std::runtime_error( "invalid escape in claim path [" + path + "]" );
+                    }
+
+                    token.push_back( ( escaped == '0' ) ? '~' : '/' );
+                    ++i;
+                }
+                else
+                {
+                    token.push_back( path[ i ] );
+                }
+            }
+
+            indices.push_back( arrayIndexOf( token ) );
+            tokens.push_back( std::move( token ) );
+            tokenStart = tokenEnd + 1;
+        }
+    }
+
+    const std::string& ClaimPath::GetPath() const
+    {
+        return path;
+    }
+
+    size_t ClaimPath::NumTokens() const
+    {
+        return tokens.size();
+    }
+
+    const std::string& ClaimPath::GetToken( size_t i ) const
+    {
+        return tokens.at( i );
+    }
+
+    long ClaimPath::GetIndex( size_t i ) const
+    {
+        return indices.at( i );
+    }
+}
+
+namespace LHWSUtilImplNS
+{
+    const rapidjson::Value* ResolveClaimPath( const rapidjson::Value& root,
+        const LHWSUtilNS::ClaimPath& path,
+        size_t fromToken )
+    {
+        const rapidjson::Value* value = &root;
+
+        for ( size_t i = fromToken; i < path.NumTokens(); ++i )
+        {
+            if ( value->IsObject() )
+            {
+                const std::string& token( path.GetToken( i ) );
+                auto member( value->FindMember( rapidjson::Value(
+                    rapidjson::StringRef( token.data(), token.size() ) ) ) );
+                if ( member == value->MemberEnd() )
+                {
+                    return nullptr;
+                }
+
+                value = &( member->value );
+            }
+            else if ( value->IsArray() )
+            {
+                long index = path.GetIndex( i );
+                if ( ( index < 0 ) || ( static_cast< size_t >( index ) >= value->Size() ) )
+                {
+                    return nullptr;
+                }
+
+                value = &( ( *value )[ static_cast< rapidjson::SizeType >( index ) ] );
+            }
+            else
+            {
+                return nullptr;
+            }
+        }
+
+        return value;
+    }
+
+    int GetClaimStrValue( const rapidjson::Value* claim, std::string& valueOut )
+    {
+        if ( !( claim && claim->IsString() ) )
+        {
+            return 1;
+        }
+
+        valueOut.assign( claim->GetString(), claim->GetStringLength() );
+
+        return 0;
+    }
+
+    int GetClaimBoolValue( const rapidjson::Value* claim, bool& valueOut )
+    {
+        if ( !( claim && claim->IsBool() ) )
+        {
+            return 1;
+        }
+
+        valueOut = claim->GetBool();
+
+        return 0;
+    }
+
+    int GetClaimIntValue( const rapidjson::Value* claim, long& valueOut )
+    {
+        if ( !( claim && claim->IsInt64() ) )
+        {
+            return 1;
+        }
+
+        valueOut = static_cast< long >( claim->GetInt64() );
+
+        return 0;
+    }
+
+    int ClaimArrayContains( const rapidjson::Value* claim, const std::string& value, bool& containsOut )
+    {
+        if ( !( claim && claim->IsArray() ) )
+        {
+            return 1;
+        }
+
+        containsOut = false;
+        for ( auto it = claim->Begin(); it != claim->End(); ++it )
+        {
+            if ( it->IsString() &&
+                ( it->GetStringLength() == value.size() ) &&
+                ( std::memcmp( it->GetString(), value.data(), value.size() ) == 0 ) )
+            {
+                containsOut = true;
+                break;
+            }
+        }
+
+        return 0;
+    }
+
+    int ForEachClaimStr( const rapidjson::Value* claim,
+        const std::function< bool( const char* str, size_t strSize ) >& visitor )
+    {
+        if ( !( claim && claim->IsArray() ) )
+        {
+            return 1;
+        }
+
+        for ( auto it = claim->Begin(); it != claim->End(); ++it )
+        {
+            if ( it->IsString() && !( visitor( it->GetString(), it->GetStringLength() ) ) )
+            {
+                break;
+            }
+        }
+
+        return 0;
+    }
+}
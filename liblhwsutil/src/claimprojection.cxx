@@ -0,0 +1,497 @@
+#include <rapidjson/document.h>
+#include <rapidjson/reader.h>
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <lhwsutil/claimprojection.h>
+#include <lhwsutil/logging.h>
+
+#include <lhwsutil_impl/claimprojection.h>
+#include <lhwsutil_impl/validationarena.h>
+
+namespace LHWSUtilNS
+{
+    ClaimProjectionBase::ClaimProjectionBase()
+        : claims()
+    {
+    }
+
+    ClaimProjectionBase::~ClaimProjectionBase()
+    {
+    }
+
+    int ClaimProjectionBase::FindClaim( const char* claim, size_t claimSize ) const
+    {
+        for ( size_t i = 0; i < claims.size(); ++i )
+        {
+            if ( ( claims[ i ].name.size() == claimSize ) &&
+                ( std::memcmp( claims[ i ].name.data(), claim, claimSize ) == 0 ) )
+            {
+                return static_cast< int >( i );
+            }
+        }
+
+        return -1;
+    }
+
+    size_t ClaimProjectionBase::NumClaims() const
+    {
+        return claims.size();
+    }
+
+    const std::string& ClaimProjectionBase::GetClaimName( size_t index ) const
+    {
+        return claims.at( index ).name;
+    }
+
+    ClaimType ClaimProjectionBase::GetClaimType( size_t index ) const
+    {
+        return claims.at( index ).type;
+    }
+
+    bool ClaimProjectionBase::ClaimIsRequired( size_t index ) const
+    {
+        return claims.at( index ).required;
+    }
+
+    size_t ClaimProjectionBase::addClaim( const std::string& claim, ClaimType type, bool required )
+    {
+        if ( FindClaim( claim.data(), claim.size() ) >= 0 )
+        {
+            throw std::runtime_error( "claim [" + claim + "] is already projected" );
+        }
+
+        if ( claims.size() >= maxProjectedClaims )
+        {
+            throw std::runtime_error( "too many projected claims" );
+        }
+
+        ProjectedClaim projectedClaim;
+        projectedClaim.name = claim;
+        projectedClaim.type = type;
+        projectedClaim.required = required;
+        claims.push_back( projectedClaim );
+
+        return claims.size() - 1;
+    }
+}
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        void appendSpaceSeparated( const LHWSUtilNS::ClaimProjectionBase& projection,
+            void* target,
+            size_t index,
+            const char* str,
+            size_t strSize )
+        {
+            const char* end = str + strSize;
+            const char* tokenStart = str;
+
+            while ( tokenStart < end )
+            {
+                const char* tokenEnd = static_cast< const char* >(
+                    std::memchr( tokenStart, ' ', end - tokenStart ) );
+                if ( !( tokenEnd ) )
+                {
+                    tokenEnd = end;
+                }
+
+                if ( tokenEnd > tokenStart )
+                {
+                    projection.AppendToList( target, index, tokenStart, tokenEnd - tokenStart );
+                }
+
+                tokenStart = tokenEnd + 1;
+            }
+        }
+
+        // return 0 if every required claim was projected, 2 otherwise
+        int checkRequiredClaims( const LHWSUtilNS::ClaimProjectionBase& projection, uint64_t projected )
+        {
+            for ( size_t i = 0; i < projection.NumClaims(); ++i )
+            {
+                if ( projection.ClaimIsRequired( i ) && !( projected & ( static_cast< uint64_t >( 1 ) << i ) ) )
+                {
+                    wsUtilLogError( "missing claim [" << projection.GetClaimName( i ) << "]" );
+                    return 2;
+                }
+            }
+
+            return 0;
+        }
+
+        // only the members of the outermost object are projected, anything nested is skipped
+        // except the elements of a projected StringList
+        class ClaimProjectionHandler
+            : public rapidjson::BaseReaderHandler< rapidjson::UTF8<>, ClaimProjectionHandler >
+        {
+            public:
+                ClaimProjectionHandler( const LHWSUtilNS::ClaimProjectionBase& _projection, void* _target );
+
+                bool Null();
+                bool Bool( bool b );
+                bool Int( int i );
+                bool Uint( unsigned u );
+                bool Int64( int64_t i );
+                bool Uint64( uint64_t u );
+                bool Double( double d );
+                bool String( const char* str, rapidjson::SizeType length, bool copy );
+                bool StartObject();
+                bool Key( const char* str, rapidjson::SizeType length, bool copy );
+                bool EndObject( rapidjson::SizeType memberCount );
+                bool StartArray();
+                bool EndArray( rapidjson::SizeType elementCount );
+
+                // bit n is set once claim n has been projected
+                uint64_t projected;
+                bool mistyped;
+
+            private:
+                const LHWSUtilNS::ClaimProjectionBase& projection;
+                void* target;
+                size_t depth;
+                // the projected claim whose value is next, -1 if the value is skipped
+                int current;
+                bool inList;
+
+                bool projectsScalar( LHWSUtilNS::ClaimType type );
+                bool setInt( int64_t i );
+                void setProjected();
+        };
+
+        ClaimProjectionHandler::ClaimProjectionHandler( const LHWSUtilNS::ClaimProjectionBase& _projection,
+            void* _target )
+            : projected( 0 )
+            , mistyped( false )
+            , projection( _projection )
+            , target( _target )
+            , depth( 0 )
+            , current( -1 )
+            , inList( false )
+        {
+        }
+
+        bool ClaimProjectionHandler::projectsScalar( LHWSUtilNS::ClaimType type )
+        {
+            if ( ( depth != 1 ) || ( current < 0 ) )
+            {
+                return false;
+            }
+
+            if ( projection.GetClaimType( current ) != type )
+            {
+                wsUtilLogError( "claim [" << projection.GetClaimName( current ) << "] has the wrong type" );
+                mistyped = true;
+            }
+
+            return true;
+        }
+
+        void ClaimProjectionHandler::setProjected()
+        {
+            projected |= ( static_cast< uint64_t >( 1 ) << current );
+            current = -1;
+        }
+
+        bool ClaimProjectionHandler::setInt( int64_t i )
+        {
+            if ( projectsScalar( LHWSUtilNS::ClaimType::Int ) )
+            {
+                if ( mistyped || ( i > LONG_MAX ) || ( i < LONG_MIN ) )
+                {
+                    mistyped = true;
+                    return false;
+                }
+
+                projection.SetInt( target, current, static_cast< long >( i ) );
+                setProjected();
+            }
+
+            return true;
+        }
+
+        bool ClaimProjectionHandler::Null()
+        {
+            // a null claim counts as absent
+            if ( depth == 1 )
+            {
+                current = -1;
+            }
+
+            return true;
+        }
+
+        bool ClaimProjectionHandler::Bool( bool b )
+        {
+            if ( projectsScalar( LHWSUtilNS::ClaimType::Bool ) )
+            {
+                if ( mistyped )
+                {
+                    return false;
+                }
+
+                projection.SetBool( target, current, b );
+                setProjected();
+            }
+
+            return true;
+        }
+
+        bool ClaimProjectionHandler::Int( int i )
+        {
+            return setInt( i );
+        }
+
+        bool ClaimProjectionHandler::Uint( unsigned u )
+        {
+            return setInt( u );
+        }
+
+        bool ClaimProjectionHandler::Int64( int64_t i )
+        {
+            return setInt( i );
+        }
+
+        bool ClaimProjectionHandler::Uint64( uint64_t u )
+        {
+            if ( u > static_cast< uint64_t >( LONG_MAX ) )
+            {
+                if ( projectsScalar( LHWSUtilNS::ClaimType::Int ) )
+                {
+                    mistyped = true;
+                    return false;
+                }
+
+                return true;
+            }
+
+            return setInt( static_cast< int64_t >( u ) );
+        }
+
+        bool ClaimProjectionHandler::Double( double )
+        {
+            if ( projectsScalar( LHWSUtilNS::ClaimType::Int ) )
+            {
+                mistyped = true;
+                return false;
+            }
+
+            return true;
+        }
+
+        bool ClaimProjectionHandler::String( const char* str, rapidjson::SizeType length, bool )
+        {
+            if ( inList )
+            {
+                if ( depth == 2 )
+                {
+                    projection.AppendToList( target, current, str, length );
+                }
+
+                return true;
+            }
+
+            if ( ( depth != 1 ) || ( current < 0 ) )
+            {
+                return true;
+            }
+
+            switch ( projection.GetClaimType( current ) )
+            {
+                case LHWSUtilNS::ClaimType::String:
+                    projection.SetString( target, current, str, length );
+                    break;
+                case LHWSUtilNS::ClaimType::StringList:
+                    projection.ClearList( target, current );
+                    appendSpaceSeparated( projection, target, current, str, length );
+                    break;
+                default:
+                    wsUtilLogError( "claim [" << projection.GetClaimName( current ) << "] has the wrong type" );
+                    mistyped = true;
+                    return false;
+            }
+
+            setProjected();
+
+            return true;
+        }
+
+        bool ClaimProjectionHandler::StartObject()
+        {
+            if ( ( depth == 1 ) && ( current >= 0 ) )
+            {
+                wsUtilLogError( "claim [" << projection.GetClaimName( current ) << "] has the wrong type" );
+                mistyped = true;
+                return false;
+            }
+
+            ++depth;
+
+            return true;
+        }
+
+        bool ClaimProjectionHandler::Key( const char* str, rapidjson::SizeType length, bool )
+        {
+            if ( depth == 1 )
+            {
+                current = projection.FindClaim( str, length );
+            }
+
+            return true;
+        }
+
+        bool ClaimProjectionHandler::EndObject( rapidjson::SizeType )
+        {
+            --depth;
+
+            return true;
+        }
+
+        bool ClaimProjectionHandler::StartArray()
+        {
+            if ( ( depth == 1 ) && ( current >= 0 ) )
+            {
+                if ( projection.GetClaimType( current ) != LHWSUtilNS::ClaimType::StringList )
+                {
+                    wsUtilLogError( "claim [" << projection.GetClaimName( current ) << "] has the wrong type" );
+                    mistyped = true;
+                    return false;
+                }
+
+                projection.ClearList( target, current );
+                inList = true;
+            }
+
+            ++depth;
+
+            return true;
+        }
+
+        bool ClaimProjectionHandler::EndArray( rapidjson::SizeType )
+        {
+            --depth;
+
+            if ( ( depth == 1 ) && inList )
+            {
+                inList = false;
+                setProjected();
+            }
+
+            return true;
+        }
+    }
+
+    int ProjectClaims( const std::string& payloadJson,
+        const LHWSUtilNS::ClaimProjectionBase& projection,
+        void* target )
+    {
+        ClaimProjectionHandler handler( projection, target );
+        // strings are copied onto the reader's stack before reaching the handler, keep it off the heap
+        ValidationArenaScope arenaScope;
+        ArenaReader reader( &arenaScope.GetArena().GetStackAllocator(), arenaParseStackCapacity );
+        rapidjson::StringStream payloadStream( payloadJson.c_str() );
+
+        size_t payloadStart = payloadJson.find_first_not_of( " \t\r\n" );
+        if ( ( payloadStart == std::string::npos ) || ( payloadJson[ payloadStart ] != '{' ) )
+        {
+            wsUtilLogError( "payload is not a json object" );
+            return 1;
+        }
+
+        rapidjson::ParseResult parsedOkay = reader.Parse< rapidjson::kParseDefaultFlags >( payloadStream, handler );
+        if ( handler.mistyped || !( parsedOkay ) )
+        {
+            wsUtilLogError( "failed to project payload[" << LHWSUtilNS::LogPayload( payloadJson ) << "]" );
+            return 1;
+        }
+
+        return checkRequiredClaims( projection, handler.projected );
+    }
+
+    int ProjectClaims( const rapidjson::Value& payload,
+        const LHWSUtilNS::ClaimProjectionBase& projection,
+        void* target )
+    {
+        uint64_t projected = 0;
+
+        if ( !( payload.IsObject() ) )
+        {
+            wsUtilLogError( "payload is not a json object" );
+            return 1;
+        }
+
+        for ( auto it = payload.MemberBegin(); it != payload.MemberEnd(); ++it )
+        {
+            int index = projection.FindClaim( it->name.GetString(), it->name.GetStringLength() );
+            const rapidjson::Value& value( it->value );
+            bool mistyped = false;
+
+            // a null claim counts as absent
+            if ( ( index < 0 ) || value.IsNull() )
+            {
+                continue;
+            }
+
+            switch ( projection.GetClaimType( index ) )
+            {
+                case LHWSUtilNS::ClaimType::String:
+                    mistyped = !( value.IsString() );
+                    if ( !( mistyped ) )
+                    {
+                        projection.SetString( target, index, value.GetString(), value.GetStringLength() );
+                    }
+                    break;
+                case LHWSUtilNS::ClaimType::Bool:
+                    mistyped = !( value.IsBool() );
+                    if ( !( mistyped ) )
+                    {
+                        projection.SetBool( target, index, value.GetBool() );
+                    }
+                    break;
+                case LHWSUtilNS::ClaimType::Int:
+                    mistyped = !( value.IsInt64() ) ||
+                        ( value.GetInt64() > LONG_MAX ) ||
+                        ( value.GetInt64() < LONG_MIN );
+                    if ( !( mistyped ) )
+                    {
+                        projection.SetInt( target, index, static_cast< long >( value.GetInt64() ) );
+                    }
+                    break;
+                case LHWSUtilNS::ClaimType::StringList:
+                    mistyped = !( value.IsString() || value.IsArray() );
+                    if ( value.IsString() )
+                    {
+                        projection.ClearList( target, index );
+                        appendSpaceSeparated( projection, target, index, value.GetString(), value.GetStringLength() );
+                    }
+                    else if ( value.IsArray() )
+                    {
+                        projection.ClearList( target, index );
+                        for ( auto element = value.Begin(); element != value.End(); ++element )
+                        {
+                            if ( element->IsString() )
+                            {
+                                projection.AppendToList( target, index, element->GetString(), element->GetStringLength() );
+                            }
+                        }
+                    }
+                    break;
+            }
+
+            if ( mistyped )
+            {
+                wsUtilLogError( "claim [" << projection.GetClaimName( index ) << "] has the wrong type" );
+                return 1;
+            }
+
+            projected |= ( static_cast< uint64_t >( 1 ) << index );
+        }
+
+        return checkRequiredClaims( projection, projected );
+    }
+}
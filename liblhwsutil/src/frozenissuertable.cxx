@@ -0,0 +1,150 @@
+#include <lhwsutil_impl/frozenissuertable.h>
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        // displacements tried per bucket before giving up, a bucket is placed within a few tries
+        // until the table is nearly full and within about NumIssuers() tries at worst
+        const uint32_t maxDisplacement = 1U << 24;
+
+        // maps the high 32 bits of hash onto [ 0, size ) without a division
+        size_t reduce( uint64_t hash, size_t size )
+        {
+            return static_cast< size_t >( ( ( hash >> 32 ) * static_cast< uint64_t >( size ) ) >> 32 );
+        }
+
+        // std::hash takes the url eight bytes at a time and is already well mixed, a byte at a time
+        // ExtendKeyHash would cost more than the rest of the lookup, the table is only ever built
+        // and read within the one process
+        uint64_t hashIss( const std::string& iss )
+        {
+            return static_cast< uint64_t >( std::hash< std::string >()( iss ) );
+        }
+    }
+
+    FrozenIssuerTable::FrozenIssuerTable( const std::vector< std::shared_ptr< LHWSUtilNS::IJwtIssuer > >& issuers )
+        : displacements()
+        , slots()
+    {
+        if ( issuers.empty() )
+        {
+            return;
+        }
+
+        if ( issuers.size() >= ( 1ULL << 32 ) )
+        {
+            throw std::runtime_error( "too many issuers to freeze" );
+        }
+
+        // two issuers per bucket on average
+        displacements.assign( ( issuers.size() + 1 ) / 2, 0 );
+        slots.resize( issuers.size() );
+
+        std::vector< uint64_t > hashes( issuers.size() );
+        std::vector< std::vector< size_t > > buckets( displacements.size() );
+        for ( size_t i = 0; i < issuers.size(); ++i )
+        {
+            hashes[ i ] = hashIss( issuers[ i ]->GetUrlView().str() );
+            buckets[ bucketFor( hashes[ i ] ) ].push_back( i );
+        }
+
+        // issuers sharing a hash could never be separated
+        std::vector< uint64_t > sortedHashes( hashes );
+        std::sort( sortedHashes.begin(), sortedHashes.end() );
+        if ( std::adjacent_find( sortedHashes.begin(), sortedHashes.end() ) != sortedHashes.end() )
+        {
+            throw std::runtime_error( "issuers to freeze share a hash" );
+        }
+
+        // the largest buckets are placed first, while most slots are free
+        std::vector< size_t > bucketOrder( buckets.size() );
+        for ( size_t i = 0; i < bucketOrder.size(); ++i )
+        {
+            bucketOrder[ i ] = i;
+        }
+        std::stable_sort( bucketOrder.begin(), bucketOrder.end(), [ &buckets ]( size_t lhs, size_t rhs )
+        {
+            return buckets[ lhs ].size() > buckets[ rhs ].size();
+        } );
+
+        std::vector< bool > slotTaken( slots.size(), false );
+        std::vector< size_t > bucketSlots;
+        for ( size_t bucket : bucketOrder )
+        {
+            const std::vector< size_t >& bucketIssuers( buckets[ bucket ] );
+            if ( bucketIssuers.empty() )
+            {
+                break;
+            }
+
+            uint32_t displacement = 0;
+            for ( ; displacement < maxDisplacement; ++displacement )
+            {
+                bucketSlots.clear();
+                for ( size_t issuer : bucketIssuers )
+                {
+                    size_t slot = slotFor( hashes[ issuer ], displacement );
+                    if ( slotTaken[ slot ] ||
+                        ( std::find( bucketSlots.begin(), bucketSlots.end(), slot ) != bucketSlots.end() ) )
+                    {
+                        break;
+                    }
+                    bucketSlots.push_back( slot );
+                }
+
+                if ( bucketSlots.size() == bucketIssuers.size() )
+                {
+                    break;
+                }
+            }
+
+            if ( displacement == maxDisplacement )
+            {
+                throw std::runtime_error( "failed to place issuers to freeze" );
+            }
+
+            displacements[ bucket ] = displacement;
+            for ( size_t i = 0; i < bucketIssuers.size(); ++i )
+            {
+                slotTaken[ bucketSlots[ i ] ] = true;
+                slots[ bucketSlots[ i ] ].iss = issuers[ bucketIssuers[ i ] ]->GetUrlView().str();
+                slots[ bucketSlots[ i ] ].issuer = issuers[ bucketIssuers[ i ] ];
+            }
+        }
+    }
+
+    const std::shared_ptr< LHWSUtilNS::IJwtIssuer >* FrozenIssuerTable::Find( const std::string& iss ) const
+    {
+        if ( slots.empty() )
+        {
+            return nullptr;
+        }
+
+        uint64_t hash = hashIss( iss );
+        const Slot& slot( slots[ slotFor( hash, displacements[ bucketFor( hash ) ] ) ] );
+
+        return ( slot.iss == iss ) ? &slot.issuer : nullptr;
+    }
+
+    size_t FrozenIssuerTable::NumIssuers() const
+    {
+        return slots.size();
+    }
+
+    // the high half of hash picks the bucket, the low half and the displacement the slot
+    size_t FrozenIssuerTable::bucketFor( uint64_t hash ) const
+    {
+        return reduce( hash, displacements.size() );
+    }
+
+    size_t FrozenIssuerTable::slotFor( uint64_t hash, uint32_t displacement ) const
+    {
+        return reduce( ( ( hash << 32 ) ^ ( displacement * 0x9e3779b97f4a7c15ULL ) ) * 0xff51afd7ed558ccdULL,
+            slots.size() );
+    }
+}
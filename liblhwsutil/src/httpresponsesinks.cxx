@@ -0,0 +1,91 @@
+#include <lhwsutil_impl/httpresponsesinks.h>
+
+namespace LHWSUtilImplNS
+{
+    StringResponseSink::StringResponseSink( std::string& _bodyOut )
+        : LHWSUtilNS::IHttpResponseSink()
+        , bodyOut( _bodyOut )
+    {
+    }
+
+    StringResponseSink::~StringResponseSink()
+    {
+    }
+
+    void StringResponseSink::ExpectSize( size_t numBytes )
+    {
+        if ( numBytes <= maxResponseSizeToReserve )
+        {
+            bodyOut.reserve( bodyOut.size() + numBytes );
+        }
+    }
+
+    int StringResponseSink::Consume( const char* data, size_t numBytes )
+    {
+        bodyOut.append( data, numBytes );
+
+        return 0;
+    }
+
+    int StringResponseSink::Finish()
+    {
+        return 0;
+    }
+
+    JsonDocumentResponseSink::JsonDocumentResponseSink()
+        : LHWSUtilNS::IHttpResponseSink()
+        , buffer()
+        , bodySize( 0 )
+        , document()
+    {
+    }
+
+    JsonDocumentResponseSink::~JsonDocumentResponseSink()
+    {
+    }
+
+    void JsonDocumentResponseSink::ExpectSize( size_t numBytes )
+    {
+        if ( numBytes <= maxResponseSizeToReserve )
+        {
+            // + 1 for the terminator required by the in situ parse
+            buffer.reserve( buffer.size() + numBytes + 1 );
+        }
+    }
+
+    int JsonDocumentResponseSink::Consume( const char* data, size_t numBytes )
+    {
+        buffer.append( data, numBytes );
+
+        return 0;
+    }
+
+    int JsonDocumentResponseSink::Finish()
+    {
+        bodySize = buffer.size();
+
+        if ( buffer.empty() )
+        {
+            return 1;
+        }
+
+        // std::string guarantees &buffer[ 0 ] is contiguous and null terminated
+        rapidjson::ParseResult parsedOkay = document.ParseInsitu( &buffer[ 0 ] );
+        if ( !( parsedOkay ) )
+        {
+            return 2;
+        }
+
+        return 0;
+    }
+
+    const rapidjson::Document& JsonDocumentResponseSink::GetDocument() const
+    {
+        return document;
+    }
+
+    size_t JsonDocumentResponseSink::GetBodySize() const
+    {
+        return bodySize;
+    }
+}
@@ -2,6 +2,33 @@
 
 namespace LHWSUtilNS
 {
+    JwtIssuerStr::JwtIssuerStr()
+    :   data( "" )
+    ,   size( 0 )
+    {
+    }
+
+    JwtIssuerStr::JwtIssuerStr( const char* _data, size_t _size )
+    :   data( _data )
+    ,   size( _size )
+    {
+    }
+
+    bool JwtIssuerStr::empty() const
+    {
+        return ( size == 0 );
+    }
+
+    std::string JwtIssuerStr::str() const
+    {
+        return std::string( data, size );
+    }
+
+    const char* JwtIssuerStr::c_str() const
+    {
+        return data;
+    }
+
     IJwtIssuer::IJwtIssuer()
     {
     }
@@ -10,6 +37,44 @@ namespace LHWSUtilNS
     {
     }
 
+    JwtIssuerStr IJwtIssuer::GetIntrospectionEndpoint() const
+    {
+        return JwtIssuerStr();
+    }
+
+    JwtIssuerStr IJwtIssuer::GetJwksUri() const
+    {
+        return JwtIssuerStr();
+    }
+
+    JwtIssuerStr IJwtIssuer::GetUrlView() const
+    {
+        const std::string& url( GetUrl() );
+
+        return JwtIssuerStr( url.c_str(), url.size() );
+    }
+
+    JwtIssuerStr IJwtIssuer::GetKeyPemForAlgView( const std::string& alg ) const
+    {
+        const std::string& keyPem( GetKeyPemForAlg( alg ) );
+
+        return JwtIssuerStr( keyPem.c_str(), keyPem.size() );
+    }
+
+    JwtIssuerStr IJwtIssuer::GetClientAuthzBearerTokenView() const
+    {
+        const std::string& clientAuthzBearerToken( GetClientAuthzBearerToken() );
+
+        return JwtIssuerStr( clientAuthzBearerToken.c_str(), clientAuthzBearerToken.size() );
+    }
+
+    JwtIssuerStr IJwtIssuer::GetOpenIdConfigurationView() const
+    {
+        const std::string& openIdConfiguration( GetOpenIdConfiguration() );
+
+        return JwtIssuerStr( openIdConfiguration.c_str(), openIdConfiguration.size() );
+    }
+
     JwtIssuerCacheParams::JwtIssuerCacheParams()
     :   iss()
     ,   clientAuthzBearerToken()
@@ -18,6 +83,21 @@ namespace LHWSUtilNS
     {
     }
 
+    JwtIssuerMemoryUsage::JwtIssuerMemoryUsage()
+    :   iss()
+    ,   bytes( 0 )
+    {
+    }
+
+    LazyJwtIssuerCacheParams::LazyJwtIssuerCacheParams()
+    :   allowedIssPatterns()
+    ,   issuerParams()
+    ,   resolver()
+    ,   maxMemoryBytes( 0 )
+    ,   failedLoadRetrySeconds( 30 )
+    {
+    }
+
     IJwtIssuerCache::IJwtIssuerCache()
     {
     }
@@ -25,4 +105,23 @@ namespace LHWSUtilNS
     IJwtIssuerCache::~IJwtIssuerCache()
     {
     }
+
+    int IJwtIssuerCache::Freeze()
+    {
+        return 2;
+    }
+
+    void IJwtIssuerCache::Unfreeze()
+    {
+    }
+
+    bool IJwtIssuerCache::IsFrozen() const
+    {
+        return false;
+    }
+
+    size_t IJwtIssuerCache::GetMemoryUsage( std::vector< JwtIssuerMemoryUsage >& ) const
+    {
+        return 0;
+    }
 }
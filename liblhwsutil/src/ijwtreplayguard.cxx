@@ -0,0 +1,19 @@
+#include <lhwsutil/ijwtreplayguard.h>
+
+namespace LHWSUtilNS
+{
+    JwtReplayGuardParams::JwtReplayGuardParams()
+    :   maxEntries( 1024 * 1024 )
+    ,   maxLifetimeSeconds( 3600 )
+    ,   failMode( JwtReplayFailMode::Closed )
+    {
+    }
+
+    IJwtReplayGuard::IJwtReplayGuard()
+    {
+    }
+
+    IJwtReplayGuard::~IJwtReplayGuard()
+    {
+    }
+}
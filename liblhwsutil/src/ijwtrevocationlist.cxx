@@ -0,0 +1,109 @@
+#include <lhwsutil/ijwtrevocationlist.h>
+
+#include <climits>
+#include <cstring>
+
+namespace LHWSUtilNS
+{
+    namespace
+    {
+        bool isBlank( char c )
+        {
+            return ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' );
+        }
+
+        // return the start of the next blank separated token of [ pos, end ) and set tokenEnd
+        const char* nextToken( const char* pos, const char* end, const char*& tokenEnd )
+        {
+            while ( ( pos < end ) && isBlank( *pos ) )
+            {
+                ++pos;
+            }
+
+            tokenEnd = pos;
+            while ( ( tokenEnd < end ) && !( isBlank( *tokenEnd ) ) )
+            {
+                ++tokenEnd;
+            }
+
+            return pos;
+        }
+    }
+
+    JwtRevocation::JwtRevocation()
+    :   claim( JwtRevocationClaim::Jti )
+    ,   value()
+    ,   exp( 0 )
+    {
+    }
+
+    JwtRevocation::JwtRevocation( JwtRevocationClaim _claim, const std::string& _value, long _exp )
+    :   claim( _claim )
+    ,   value( _value )
+    ,   exp( _exp )
+    {
+    }
+
+    IJwtRevocationList::IJwtRevocationList()
+    {
+    }
+
+    IJwtRevocationList::~IJwtRevocationList()
+    {
+    }
+
+    int ParseJwtRevocation( const char* line, size_t lineSize, JwtRevocation& revocation )
+    {
+        const char* end = line + lineSize;
+        const char* tokenEnd = nullptr;
+
+        const char* claim = nextToken( line, end, tokenEnd );
+        if ( ( claim == tokenEnd ) || ( *claim == '#' ) )
+        {
+            return 1;
+        }
+
+        if ( ( ( tokenEnd - claim ) == 3 ) && ( std::memcmp( claim, "jti", 3 ) == 0 ) )
+        {
+            revocation.claim = JwtRevocationClaim::Jti;
+        }
+        else if ( ( ( tokenEnd - claim ) == 3 ) && ( std::memcmp( claim, "sid", 3 ) == 0 ) )
+        {
+            revocation.claim = JwtRevocationClaim::Sid;
+        }
+        else
+        {
+            return 2;
+        }
+
+        const char* value = nextToken( tokenEnd, end, tokenEnd );
+        if ( value == tokenEnd )
+        {
+            return 3;
+        }
+        revocation.value.assign( value, tokenEnd - value );
+
+        const char* exp = nextToken( tokenEnd, end, tokenEnd );
+        if ( exp == tokenEnd )
+        {
+            return 4;
+        }
+
+        revocation.exp = 0;
+        for ( ; exp < tokenEnd; ++exp )
+        {
+            if ( ( *exp < '0' ) || ( *exp > '9' ) || ( revocation.exp > ( ( LONG_MAX - 9 ) / 10 ) ) )
+            {
+                return 4;
+            }
+            revocation.exp = ( revocation.exp * 10 ) + ( *exp - '0' );
+        }
+
+        if ( nextToken( tokenEnd, end, tokenEnd ) != end )
+        {
+            return 5;
+        }
+
+        return 0;
+    }
+}
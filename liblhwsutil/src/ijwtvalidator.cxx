@@ -1,10 +1,70 @@
+#include <rapidjson/document.h>
+
 #include <lhwsutil/ijwtvalidator.h>
 #include <lhwsutil/logging.h>
 
+#include <lhwsutil_impl/claimpath.h>
+#include <lhwsutil_impl/claimprojection.h>
+
+#include <cstring>
 #include <sstream>
 
 namespace LHWSUtilNS
 {
+    namespace
+    {
+        // the claim at path, parsed into claimJson from its serialized top level claim
+        const rapidjson::Value* resolveSerializedClaim( const IValidJwt& jwt,
+            const ClaimPath& path,
+            rapidjson::Document& claimJson )
+        {
+            std::string claimStr;
+
+            if ( ( path.NumTokens() == 0 ) || ( jwt.GetGrantJsonValue( path.GetToken( 0 ), claimStr ) != 0 ) )
+            {
+                return nullptr;
+            }
+
+            claimJson.Parse( claimStr.c_str(), claimStr.size() );
+            if ( claimJson.HasParseError() )
+            {
+                return nullptr;
+            }
+
+            return LHWSUtilImplNS::ResolveClaimPath( claimJson, path, 1 );
+        }
+
+        // ProjectClaims over the projected claims of jwt, serialized one at a time through it
+        int projectValidJwt( const IValidJwt& jwt, const ClaimProjectionBase& projection, void* claims )
+        {
+            rapidjson::Document payloadJson;
+            std::string claimStr;
+
+            payloadJson.SetObject();
+            for ( size_t i = 0; i < projection.NumClaims(); ++i )
+            {
+                const std::string& name( projection.GetClaimName( i ) );
+                if ( jwt.GetGrantJsonValue( name, claimStr ) != 0 )
+                {
+                    continue;
+                }
+
+                rapidjson::Document claimJson( &payloadJson.GetAllocator() );
+                claimJson.Parse( claimStr.c_str(), claimStr.size() );
+                if ( claimJson.HasParseError() )
+                {
+                    return 1;
+                }
+
+                rapidjson::Value claimName( name.c_str(), static_cast< rapidjson::SizeType >( name.size() ),
+                    payloadJson.GetAllocator() );
+                payloadJson.AddMember( claimName, claimJson.Move(), payloadJson.GetAllocator() );
+            }
+
+            return LHWSUtilImplNS::ProjectClaims( payloadJson, projection, claims );
+        }
+    }
+
     IValidJwt::IValidJwt()
     {
     }
@@ -13,6 +73,70 @@ namespace LHWSUtilNS
     {
     }
 
+    int IValidJwt::GetClaimStrValue( const ClaimPath& path, std::string& valueOut ) const
+    {
+        rapidjson::Document claimJson;
+
+        return LHWSUtilImplNS::GetClaimStrValue( resolveSerializedClaim( *this, path, claimJson ), valueOut );
+    }
+
+    int IValidJwt::GetClaimBoolValue( const ClaimPath& path, bool& valueOut ) const
+    {
+        rapidjson::Document claimJson;
+
+        return LHWSUtilImplNS::GetClaimBoolValue( resolveSerializedClaim( *this, path, claimJson ), valueOut );
+    }
+
+    int IValidJwt::GetClaimIntValue( const ClaimPath& path, long& valueOut ) const
+    {
+        rapidjson::Document claimJson;
+
+        return LHWSUtilImplNS::GetClaimIntValue( resolveSerializedClaim( *this, path, claimJson ), valueOut );
+    }
+
+    int IValidJwt::ClaimArrayContains( const ClaimPath& path, const std::string& value, bool& containsOut ) const
+    {
+        rapidjson::Document claimJson;
+
+        return LHWSUtilImplNS::ClaimArrayContains( resolveSerializedClaim( *this, path, claimJson ),
+            value,
+            containsOut );
+    }
+
+    int IValidJwt::ForEachClaimStr( const ClaimPath& path,
+        const std::function< bool( const char* str, size_t strSize ) >& visitor ) const
+    {
+        rapidjson::Document claimJson;
+
+        return LHWSUtilImplNS::ForEachClaimStr( resolveSerializedClaim( *this, path, claimJson ), visitor );
+    }
+
+    JwtIntrospectionParams::JwtIntrospectionParams()
+    :   deadline( std::chrono::steady_clock::time_point::max() )
+    ,   connectTimeoutMs( 0 )
+    ,   hedge( false )
+    ,   hedgePercentile( 0.95 )
+    ,   hedgeMinSamples( 100 )
+    {
+    }
+
+    JwtValidationChecks::JwtValidationChecks()
+    :   maxTokenSize( 64 * 1024 )
+    ,   clockSkewSeconds( 60 )
+    ,   requireExp( false )
+    ,   requireKid( false )
+    ,   algs()
+    ,   issuers()
+    ,   audiences()
+    {
+    }
+
+    JwtValidatorParams::JwtValidatorParams()
+    :   replayGuard()
+    ,   checks()
+    {
+    }
+
     IJwtValidator::IJwtValidator()
     {
     }
@@ -21,6 +145,82 @@ namespace LHWSUtilNS
     {
     }
 
+    std::unique_ptr< IValidJwt > IJwtValidator::IntrospectJwt( const std::string& b64UrlEncodedJwt,
+        const JwtIntrospectionParams& ) const
+    {
+        return IntrospectJwt( b64UrlEncodedJwt );
+    }
+
+    std::unique_ptr< IValidJwt > IJwtValidator::ValidateIntoJwt( const std::string&,
+        const JwtPolicy&,
+        JwtPolicyDecision& decision ) const
+    {
+        decision = JwtPolicyDecision::Deny;
+
+        return nullptr;
+    }
+
+    std::unique_ptr< IValidJwt > IJwtValidator::IntrospectJwt( const std::string&,
+        const JwtIntrospectionParams&,
+        const JwtPolicy&,
+        JwtPolicyDecision& decision ) const
+    {
+        decision = JwtPolicyDecision::Deny;
+
+        return nullptr;
+    }
+
+    JwtValidationResult IJwtValidator::ValidateIntoJwt( const std::string& b64UrlEncodedJwt,
+        ValidatedJwt& validatedJwt ) const
+    {
+        validatedJwt.Reset();
+        if ( validateIntoClaims( b64UrlEncodedJwt, ValidatedJwt::GetClaimProjection(), &validatedJwt ) != 0 )
+        {
+            validatedJwt.Reset();
+            validatedJwt.setResult( JwtValidationResult::Invalid );
+        }
+        else
+        {
+            validatedJwt.setResult( JwtValidationResult::Valid );
+        }
+
+        return validatedJwt.GetResult();
+    }
+
+    JwtValidationResult IJwtValidator::IntrospectJwt( const std::string& b64UrlEncodedJwt,
+        const JwtIntrospectionParams& params,
+        ValidatedJwt& validatedJwt ) const
+    {
+        std::unique_ptr< IValidJwt > jwt( IntrospectJwt( b64UrlEncodedJwt, params ) );
+
+        validatedJwt.Reset();
+        if ( !( jwt ) || ( projectValidJwt( *jwt, ValidatedJwt::GetClaimProjection(), &validatedJwt ) != 0 ) )
+        {
+            validatedJwt.Reset();
+            validatedJwt.setResult( JwtValidationResult::Invalid );
+        }
+        else
+        {
+            validatedJwt.setResult( JwtValidationResult::Valid );
+        }
+
+        return validatedJwt.GetResult();
+    }
+
+    int IJwtValidator::validateIntoClaims( const std::string& b64UrlEncodedJwt,
+        const ClaimProjectionBase& projection,
+        void* claims ) const
+    {
+        std::unique_ptr< IValidJwt > jwt( ValidateIntoJwt( b64UrlEncodedJwt ) );
+
+        if ( !( jwt ) )
+        {
+            return 1;
+        }
+
+        return ( projectValidJwt( *jwt, projection, claims ) == 0 ) ? 0 : 2;
+    }
+
     IJwtValidatorFactory::IJwtValidatorFactory()
     {
     }
@@ -28,6 +228,11 @@ namespace LHWSUtilNS
     IJwtValidatorFactory::~IJwtValidatorFactory()
     {
     }
+
+    std::unique_ptr< IJwtValidator > IJwtValidatorFactory::CreateJwtValidator( const JwtValidatorParams& ) const
+    {
+        return nullptr;
+    }
     
     UserIdentifiers::UserIdentifiers()
     :   username()
@@ -77,6 +282,23 @@ namespace LHWSUtilNS
         return 0;
     }
 
+    const ClaimProjection< UserIdentifiers >& GetUserIdentifiersProjection()
+    {
+        struct UserIdentifiersProjection : public ClaimProjection< UserIdentifiers >
+        {
+            UserIdentifiersProjection()
+            {
+                MapString( "preferred_username", &UserIdentifiers::username );
+                MapString( "email", &UserIdentifiers::email );
+                MapBool( "email_verified", &UserIdentifiers::emailVerified );
+                MapString( "sub", &UserIdentifiers::sub );
+            }
+        };
+        static const UserIdentifiersProjection projection;
+
+        return projection;
+    }
+
     int GetScopes( const IValidJwt& jwt, std::unordered_set< std::string >& scopes )
     {
         int rc = 0;
@@ -89,36 +311,25 @@ namespace LHWSUtilNS
             return 1;
         }
 
-        size_t pos = scopesStr.find( ' ' ); // end of token
-        if( pos != std::string::npos )
+        const char* end = scopesStr.data() + scopesStr.size();
+        const char* tokenStart = scopesStr.data();
+        while( tokenStart < end )
         {
-            if( pos > 0 )
+            const char* tokenEnd = static_cast< const char* >(
+                std::memchr( tokenStart, ' ', end - tokenStart ) );
+            if( !( tokenEnd ) )
             {
-                scopes.emplace( scopesStr.substr( 0, pos ) );
+                tokenEnd = end;
             }
 
-            size_t lastPos = pos;
-            pos = scopesStr.find( ' ' ); // end of token
-            while( pos != std::string::npos )
+            if( tokenEnd > tokenStart )
             {
-                if( pos > ( lastPos + 1 ) )
-                {
-                    scopes.emplace( scopesStr.substr( lastPos + 1, pos - ( lastPos + 1 ) ) );
-                }
-
-                lastPos = pos;
-                if( lastPos >= scopesStr.size() - 1 )
-                    break;
-                pos = scopesStr.find( ' ', lastPos + 1 );
+                scopes.emplace( tokenStart, tokenEnd - tokenStart );
             }
 
-            if( lastPos < scopesStr.size() )
-            {
-                scopes.emplace( scopesStr.substr( lastPos + 1 ) );
-            }
+            tokenStart = tokenEnd + 1;
         }
 
-        
         return 0;
     }
 
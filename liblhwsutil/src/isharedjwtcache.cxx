@@ -0,0 +1,22 @@
+#include <lhwsutil/isharedjwtcache.h>
+
+namespace LHWSUtilNS
+{
+    SharedJwtCacheParams::SharedJwtCacheParams()
+    :   name( "/lhwsutil.jwt" )
+    ,   role( SharedJwtCacheRole::Reader )
+    ,   maxIssuers( 64 )
+    ,   maxIssuerBytes( 32 * 1024 )
+    ,   maxResults( 0 )
+    ,   resultLifetimeSeconds( 60 )
+    {
+    }
+
+    ISharedJwtCache::ISharedJwtCache()
+    {
+    }
+
+    ISharedJwtCache::~ISharedJwtCache()
+    {
+    }
+}
@@ -1,9 +1,41 @@
 #include <lhwsutil/isimplehttpclient.h>
 
+namespace
+{
+    // hands a body read in full to a sink as if it came off the wire
+    int consumeResponseBody( const std::string& responseBody, LHWSUtilNS::IHttpResponseSink& responseSink )
+    {
+        int ret = 0;
+
+        responseSink.ExpectSize( responseBody.size() );
+        if ( responseBody.size() )
+        {
+            ret = responseSink.Consume( responseBody.data(), responseBody.size() );
+        }
+        if ( ret == 0 )
+        {
+            ret = responseSink.Finish();
+        }
+
+        return ret;
+    }
+}
+
 namespace LHWSUtilNS
 {
     HttpRequestParams::HttpRequestParams()
     :   verbose( false )
+    ,   connectTimeoutMs( 0 )
+    ,   timeoutMs( 0 )
+    ,   hedgeAfterMs( 0 )
+    {
+    }
+
+    IHttpResponseSink::IHttpResponseSink()
+    {
+    }
+
+    IHttpResponseSink::~IHttpResponseSink()
     {
     }
 
@@ -15,6 +47,38 @@ namespace LHWSUtilNS
     {
     }
 
+    int ISimpleHttpClient::Get( const std::string& url,
+                                const HttpRequestParams& params,
+                                IHttpResponseSink& responseSink )
+    {
+        std::string responseBody;
+        int ret = Get( url, params, responseBody );
+
+        if ( ret == 0 )
+        {
+            ret = consumeResponseBody( responseBody, responseSink );
+        }
+
+        return ret;
+    }
+
+    int ISimpleHttpClient::Post( const std::string& url,
+                                 const std::string& data,
+                                 const std::unordered_map< std::string, std::string >& headers,
+                                 const HttpRequestParams& params,
+                                 IHttpResponseSink& responseSink )
+    {
+        std::string responseBody;
+        int ret = Post( url, data, headers, params, responseBody );
+
+        if ( ret == 0 )
+        {
+            ret = consumeResponseBody( responseBody, responseSink );
+        }
+
+        return ret;
+    }
+
     ISimpleHttpClientFactory::ISimpleHttpClientFactory()
     {
     }
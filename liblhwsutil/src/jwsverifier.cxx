@@ -0,0 +1,422 @@
+#include <lhwsutil_impl/jwsverifier.h>
+
+#include <lhwsutil/logging.h>
+
+#include <lhsslutil/base64.h>
+
+#include <openssl/bio.h>
+#include <openssl/bn.h>
+#include <openssl/crypto.h>
+#include <openssl/ecdsa.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+
+#include <stdexcept>
+#include <vector>
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+#define EVP_MD_CTX_new EVP_MD_CTX_create
+#define EVP_MD_CTX_free EVP_MD_CTX_destroy
+#endif
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        enum class JwsAlgFamily
+        {
+            HS = 0,
+            RS,
+            ES
+        };
+
+        JwsAlgFamily familyOf( LHWSUtilNS::JwtAlg alg )
+        {
+            switch ( alg )
+            {
+                case LHWSUtilNS::JwtAlg::HS256:
+                case LHWSUtilNS::JwtAlg::HS384:
+                case LHWSUtilNS::JwtAlg::HS512:
+                    return JwsAlgFamily::HS;
+                case LHWSUtilNS::JwtAlg::RS256:
+                case LHWSUtilNS::JwtAlg::RS384:
+                case LHWSUtilNS::JwtAlg::RS512:
+                    return JwsAlgFamily::RS;
+                default:
+                    return JwsAlgFamily::ES;
+            }
+        }
+
+        // the size of each of r and s in an ES signature
+        size_t esComponentSize( LHWSUtilNS::JwtAlg alg )
+        {
+            switch ( alg )
+            {
+                case LHWSUtilNS::JwtAlg::ES256:
+                    return 32;
+                case LHWSUtilNS::JwtAlg::ES384:
+                    return 48;
+                default:
+                    return 66;
+            }
+        }
+
+        // big enough for the DER of an ES512 signature
+        const size_t maxEsDerSize = 160;
+
+        // return 0 and fill derOut with the DER ECDSA-Sig-Value of the JWS r || s signature
+        int esSignatureToDer( const unsigned char* signature,
+            size_t signatureSize,
+            size_t componentSize,
+            unsigned char* derOut,
+            size_t& derSizeOut )
+        {
+            int rc = 1;
+
+            if ( signatureSize != ( 2 * componentSize ) )
+            {
+                return 1;
+            }
+
+            ECDSA_SIG* ecdsaSig = ECDSA_SIG_new();
+            if ( !( ecdsaSig ) )
+            {
+                return 2;
+            }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+            BIGNUM* r = BN_bin2bn( signature, static_cast< int >( componentSize ), nullptr );
+            BIGNUM* s = BN_bin2bn( signature + componentSize, static_cast< int >( componentSize ), nullptr );
+            if ( !( r ) || !( s ) || ( ECDSA_SIG_set0( ecdsaSig, r, s ) != 1 ) )
+            {
+                BN_free( r );
+                BN_free( s );
+                ECDSA_SIG_free( ecdsaSig );
+
+                return 2;
+            }
+#else
+            if ( !( BN_bin2bn( signature, static_cast< int >( componentSize ), ecdsaSig->r ) ) ||
+                !( BN_bin2bn( signature + componentSize, static_cast< int >( componentSize ), ecdsaSig->s ) ) )
+            {
+                ECDSA_SIG_free( ecdsaSig );
+
+                return 2;
+            }
+#endif
+
+            int derSize = i2d_ECDSA_SIG( ecdsaSig, nullptr );
+            if ( ( derSize > 0 ) && ( static_cast< size_t >( derSize ) <= maxEsDerSize ) )
+            {
+                unsigned char* der = derOut;
+
+                derSizeOut = static_cast< size_t >( i2d_ECDSA_SIG( ecdsaSig, &der ) );
+                rc = 0;
+            }
+            ECDSA_SIG_free( ecdsaSig );
+
+            return rc;
+        }
+
+        bool keyIsForAlg( EVP_PKEY* pkey, LHWSUtilNS::JwtAlg alg )
+        {
+            JwsAlgFamily family = familyOf( alg );
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            // a provider's key, e.g. an HMAC one, need not have a legacy type
+            static const char* const keyTypes[] = { "HMAC", "RSA", "EC" };
+
+            if ( EVP_PKEY_is_a( pkey, keyTypes[ static_cast< size_t >( family ) ] ) != 1 )
+            {
+                return false;
+            }
+#else
+            static const int keyTypes[] = { EVP_PKEY_HMAC, EVP_PKEY_RSA, EVP_PKEY_EC };
+
+            if ( EVP_PKEY_base_id( pkey ) != keyTypes[ static_cast< size_t >( family ) ] )
+            {
+                return false;
+            }
+#endif
+
+            if ( family != JwsAlgFamily::ES )
+            {
+                return true;
+            }
+
+            // each ES alg names its curve, P-256, P-384 or P-521
+            size_t curveBits = ( alg == LHWSUtilNS::JwtAlg::ES512 ) ? 521 : ( esComponentSize( alg ) * 8 );
+
+            return ( static_cast< size_t >( EVP_PKEY_bits( pkey ) ) == curveBits );
+        }
+
+        // the context each Verify on a thread copies its verifier's into
+        struct ThreadVerifyCtx
+        {
+            ThreadVerifyCtx()
+                : ctx( EVP_MD_CTX_new() )
+            {
+            }
+
+            ~ThreadVerifyCtx()
+            {
+                EVP_MD_CTX_free( ctx );
+            }
+
+            EVP_MD_CTX* ctx;
+        };
+
+        EVP_MD_CTX* threadVerifyCtx()
+        {
+            thread_local ThreadVerifyCtx threadCtx;
+
+            return threadCtx.ctx;
+        }
+    }
+
+    const EVP_MD* GetJwsDigest( LHWSUtilNS::JwtAlg alg )
+    {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        // never freed, held for the life of the process
+        static EVP_MD* const sha256 = EVP_MD_fetch( nullptr, "SHA2-256", nullptr );
+        static EVP_MD* const sha384 = EVP_MD_fetch( nullptr, "SHA2-384", nullptr );
+        static EVP_MD* const sha512 = EVP_MD_fetch( nullptr, "SHA2-512", nullptr );
+#else
+        static const EVP_MD* const sha256 = EVP_sha256();
+        static const EVP_MD* const sha384 = EVP_sha384();
+        static const EVP_MD* const sha512 = EVP_sha512();
+#endif
+
+        switch ( alg )
+        {
+            case LHWSUtilNS::JwtAlg::HS256:
+            case LHWSUtilNS::JwtAlg::RS256:
+            case LHWSUtilNS::JwtAlg::ES256:
+                return sha256;
+            case LHWSUtilNS::JwtAlg::HS384:
+            case LHWSUtilNS::JwtAlg::RS384:
+            case LHWSUtilNS::JwtAlg::ES384:
+                return sha384;
+            default:
+                return sha512;
+        }
+    }
+
+    JwsVerifier::JwsVerifier( LHWSUtilNS::JwtAlg _alg, const char* key, size_t keySize )
+        : alg( _alg )
+        , pkey( nullptr )
+        , templateCtx( nullptr )
+    {
+        if ( !( key ) || ( keySize == 0 ) )
+        {
+            throw std::runtime_error( "key is empty" );
+        }
+
+        if ( familyOf( alg ) == JwsAlgFamily::HS )
+        {
+            pkey = EVP_PKEY_new_mac_key( EVP_PKEY_HMAC,
+                nullptr,
+                reinterpret_cast< const unsigned char* >( key ),
+                static_cast< int >( keySize ) );
+        }
+        else
+        {
+            BIO* bioMem = BIO_new_mem_buf( key, static_cast< int >( keySize ) );
+            if ( bioMem )
+            {
+                pkey = PEM_read_bio_PUBKEY( bioMem, nullptr, nullptr, nullptr );
+                BIO_free( bioMem );
+            }
+        }
+
+        if ( !( pkey ) )
+        {
+            ERR_clear_error();
+
+            throw std::runtime_error( std::string( "failed to read key for alg=" ) + LHWSUtilNS::JwtAlgName( alg ) );
+        }
+
+        if ( initTemplateCtx() != 0 )
+        {
+            EVP_PKEY_free( pkey );
+
+            throw std::runtime_error( std::string( "key is not one for alg=" ) + LHWSUtilNS::JwtAlgName( alg ) );
+        }
+    }
+
+    JwsVerifier::JwsVerifier( LHWSUtilNS::JwtAlg _alg, EVP_PKEY* key )
+        : alg( _alg )
+        , pkey( key )
+        , templateCtx( nullptr )
+    {
+        if ( !( pkey ) )
+        {
+            throw std::runtime_error( "key is null" );
+        }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+        EVP_PKEY_up_ref( pkey );
+#else
+        CRYPTO_add( &( pkey->references ), 1, CRYPTO_LOCK_EVP_PKEY );
+#endif
+
+        if ( initTemplateCtx() != 0 )
+        {
+            EVP_PKEY_free( pkey );
+
+            throw std::runtime_error( std::string( "key is not one for alg=" ) + LHWSUtilNS::JwtAlgName( alg ) );
+        }
+    }
+
+    JwsVerifier::~JwsVerifier()
+    {
+        EVP_MD_CTX_free( templateCtx );
+        EVP_PKEY_free( pkey );
+    }
+
+    int JwsVerifier::Verify( const char* signingInput,
+        size_t signingInputSize,
+        const unsigned char* signature,
+        size_t signatureSize ) const
+    {
+        wsUtilLogSetScope( "JwsVerifier.Verify" );
+
+        EVP_MD_CTX* ctx = threadVerifyCtx();
+        if ( !( ctx ) || ( EVP_MD_CTX_copy_ex( ctx, templateCtx ) != 1 ) )
+        {
+            wsUtilLogError( "failed to copy verify context" );
+            ERR_clear_error();
+
+            return 2;
+        }
+
+        JwsAlgFamily family = familyOf( alg );
+        if ( family == JwsAlgFamily::HS )
+        {
+            unsigned char mac[ EVP_MAX_MD_SIZE ];
+            size_t macSize = sizeof( mac );
+
+            if ( ( EVP_DigestSignUpdate( ctx, signingInput, signingInputSize ) != 1 ) ||
+                ( EVP_DigestSignFinal( ctx, mac, &macSize ) != 1 ) )
+            {
+                wsUtilLogError( "failed to compute hmac" );
+                ERR_clear_error();
+
+                return 2;
+            }
+
+            return ( ( macSize == signatureSize ) && ( CRYPTO_memcmp( mac, signature, macSize ) == 0 ) ) ? 0 : 1;
+        }
+
+        unsigned char der[ maxEsDerSize ];
+        if ( family == JwsAlgFamily::ES )
+        {
+            size_t derSize = 0;
+
+            int rc = esSignatureToDer( signature, signatureSize, esComponentSize( alg ), der, derSize );
+            if ( rc != 0 )
+            {
+                return rc;
+            }
+
+            signature = der;
+            signatureSize = derSize;
+        }
+
+        if ( EVP_DigestVerifyUpdate( ctx, signingInput, signingInputSize ) != 1 )
+        {
+            wsUtilLogError( "failed to digest signing input" );
+            ERR_clear_error();
+
+            return 2;
+        }
+
+        // 0 => the signature does not match, <0 => it could not be checked, e.g. it is malformed
+        int rc = EVP_DigestVerifyFinal( ctx, signature, signatureSize );
+        if ( rc != 1 )
+        {
+            ERR_clear_error();
+        }
+
+        return ( rc == 1 ) ? 0 : 1;
+    }
+
+    int JwsVerifier::VerifyCompact( const std::string& jwsStr ) const
+    {
+        // keep their capacity between calls
+        thread_local std::string b64UrlEncodedSignature;
+        thread_local std::vector< unsigned char > signature;
+
+        size_t signatureStart = jwsStr.rfind( '.' );
+        if ( ( signatureStart == std::string::npos ) || ( jwsStr.find( '.' ) == signatureStart ) )
+        {
+            return 2;
+        }
+
+        if ( signatureStart == ( jwsStr.size() - 1 ) )
+        {
+            // unsigned
+            return 1;
+        }
+
+        b64UrlEncodedSignature.assign( jwsStr, signatureStart + 1, std::string::npos );
+        signature.clear();
+        if ( LHSSLUtilNS::DecodeB64UrlStr( b64UrlEncodedSignature, signature ) != 0 )
+        {
+            return 2;
+        }
+
+        return Verify( jwsStr.data(), signatureStart, signature.data(), signature.size() );
+    }
+
+    LHWSUtilNS::JwtAlg JwsVerifier::GetAlg() const
+    {
+        return alg;
+    }
+
+    int JwsVerifier::initTemplateCtx()
+    {
+        wsUtilLogSetScope( "JwsVerifier.initTemplateCtx" );
+
+        JwsAlgFamily family = familyOf( alg );
+        int rc = 0;
+
+        if ( !( keyIsForAlg( pkey, alg ) ) )
+        {
+            wsUtilLogError( "key is not one for alg=" << LHWSUtilNS::JwtAlgName( alg ) );
+
+            return 1;
+        }
+
+        templateCtx = EVP_MD_CTX_new();
+        if ( !( templateCtx ) )
+        {
+            return 2;
+        }
+
+        if ( family == JwsAlgFamily::HS )
+        {
+            rc = EVP_DigestSignInit( templateCtx, nullptr, GetJwsDigest( alg ), nullptr, pkey );
+        }
+        else
+        {
+            rc = EVP_DigestVerifyInit( templateCtx, nullptr, GetJwsDigest( alg ), nullptr, pkey );
+        }
+
+        if ( rc != 1 )
+        {
+            wsUtilLogError( "failed to initialise context for alg=" << LHWSUtilNS::JwtAlgName( alg ) );
+            ERR_clear_error();
+            EVP_MD_CTX_free( templateCtx );
+            templateCtx = nullptr;
+
+            return 3;
+        }
+
+#ifdef EVP_MD_CTX_FLAG_FINALISE
+        // a copy is finalised once, the final need not keep it usable
+        EVP_MD_CTX_set_flags( templateCtx, EVP_MD_CTX_FLAG_FINALISE );
+#endif
+
+        return 0;
+    }
+}
@@ -0,0 +1,217 @@
+#include <cstring>
+
+#include <lhwsutil_impl/jwtchecks.h>
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        // whether each byte may appear in a base64url segment
+        struct Base64UrlTable
+        {
+            Base64UrlTable()
+            {
+                std::memset( isBase64Url, 0, sizeof( isBase64Url ) );
+                for ( unsigned char c = 'A'; c <= 'Z'; ++c )
+                {
+                    isBase64Url[ c ] = true;
+                }
+                for ( unsigned char c = 'a'; c <= 'z'; ++c )
+                {
+                    isBase64Url[ c ] = true;
+                }
+                for ( unsigned char c = '0'; c <= '9'; ++c )
+                {
+                    isBase64Url[ c ] = true;
+                }
+                isBase64Url[ static_cast< unsigned char >( '-' ) ] = true;
+                isBase64Url[ static_cast< unsigned char >( '_' ) ] = true;
+            }
+
+            bool isBase64Url[ 256 ];
+        };
+
+        bool isListed( const std::vector< std::string >& values, const char* value, size_t valueSize )
+        {
+            for ( const std::string& listed : values )
+            {
+                if ( ( listed.size() == valueSize ) && ( std::memcmp( listed.data(), value, valueSize ) == 0 ) )
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        bool isListed( const std::vector< std::string >& values, const rapidjson::Value& value )
+        {
+            return value.IsString() && isListed( values, value.GetString(), value.GetStringLength() );
+        }
+
+        const char* getStr( const rapidjson::Value& json, const char* name )
+        {
+            rapidjson::Value::ConstMemberIterator member = json.FindMember( name );
+
+            return ( ( member != json.MemberEnd() ) && member->value.IsString() ) ? member->value.GetString() : nullptr;
+        }
+
+        void getTimeClaim( const rapidjson::Value& payloadJson, const char* name, JwtTimeClaim& timeClaim )
+        {
+            rapidjson::Value::ConstMemberIterator member = payloadJson.FindMember( name );
+
+            timeClaim.present = ( member != payloadJson.MemberEnd() );
+            timeClaim.valid = timeClaim.present && member->value.IsInt64();
+            timeClaim.value = timeClaim.valid ? static_cast< long >( member->value.GetInt64() ) : 0;
+        }
+    }
+
+    JwtTimeClaim::JwtTimeClaim()
+        : present( false )
+        , valid( false )
+        , value( 0 )
+    {
+    }
+
+    JwtCheckedFields::JwtCheckedFields()
+        : alg( nullptr )
+        , kid( nullptr )
+        , iss( nullptr )
+        , issSize( 0 )
+        , exp()
+        , nbf()
+        , aud( nullptr )
+    {
+    }
+
+    int CheckJwtShape( const std::string& jwtStr, const LHWSUtilNS::JwtValidationChecks& checks )
+    {
+        static const Base64UrlTable table;
+        size_t numSegments = 1;
+        size_t segmentStart = 0;
+
+        if ( ( checks.maxTokenSize > 0 ) && ( jwtStr.size() > checks.maxTokenSize ) )
+        {
+            return 1;
+        }
+
+        for ( size_t i = 0; i < jwtStr.size(); ++i )
+        {
+            unsigned char c = static_cast< unsigned char >( jwtStr[ i ] );
+
+            if ( c == '.' )
+            {
+                // the header and the payload cannot be empty, the signature may be
+                if ( ( i == segmentStart ) || ( numSegments == 3 ) )
+                {
+                    return 2;
+                }
+
+                ++numSegments;
+                segmentStart = i + 1;
+            }
+            else if ( !( table.isBase64Url[ c ] ) )
+            {
+                return 3;
+            }
+        }
+
+        return ( numSegments == 3 ) ? 0 : 2;
+    }
+
+    int CheckJwtFields( const JwtCheckedFields& fields, const LHWSUtilNS::JwtValidationChecks& checks, long now )
+    {
+        if ( !( checks.algs.empty() ) &&
+            !( fields.alg && isListed( checks.algs, fields.alg, std::strlen( fields.alg ) ) ) )
+        {
+            return 1;
+        }
+
+        if ( checks.requireKid && !( fields.kid && *fields.kid ) )
+        {
+            return 2;
+        }
+
+        if ( !( fields.iss ) || ( fields.issSize == 0 ) ||
+            ( !( checks.issuers.empty() ) && !( isListed( checks.issuers, fields.iss, fields.issSize ) ) ) )
+        {
+            return 3;
+        }
+
+        if ( ( fields.exp.present && !( fields.exp.valid ) ) || ( checks.requireExp && !( fields.exp.present ) ) )
+        {
+            return 4;
+        }
+
+        if ( fields.exp.valid && ( fields.exp.value <= ( now - checks.clockSkewSeconds ) ) )
+        {
+            return 5;
+        }
+
+        if ( ( fields.nbf.present && !( fields.nbf.valid ) ) ||
+            ( fields.nbf.valid && ( fields.nbf.value > ( now + checks.clockSkewSeconds ) ) ) )
+        {
+            return 6;
+        }
+
+        if ( !( checks.audiences.empty() ) )
+        {
+            bool accepted = false;
+
+            if ( fields.aud && fields.aud->IsArray() )
+            {
+                for ( rapidjson::Value::ConstValueIterator it = fields.aud->Begin();
+                    !( accepted ) && ( it != fields.aud->End() );
+                    ++it )
+                {
+                    accepted = isListed( checks.audiences, *it );
+                }
+            }
+            else if ( fields.aud )
+            {
+                accepted = isListed( checks.audiences, *fields.aud );
+            }
+
+            if ( !( accepted ) )
+            {
+                return 7;
+            }
+        }
+
+        return 0;
+    }
+
+    void GetJwtCheckedFields( const rapidjson::Value& headerJson,
+        const rapidjson::Value& payloadJson,
+        JwtCheckedFields& fields )
+    {
+        fields = JwtCheckedFields();
+
+        if ( headerJson.IsObject() )
+        {
+            fields.alg = getStr( headerJson, "alg" );
+            fields.kid = getStr( headerJson, "kid" );
+        }
+
+        if ( !( payloadJson.IsObject() ) )
+        {
+            return;
+        }
+
+        rapidjson::Value::ConstMemberIterator iss = payloadJson.FindMember( "iss" );
+        if ( ( iss != payloadJson.MemberEnd() ) && iss->value.IsString() )
+        {
+            fields.iss = iss->value.GetString();
+            fields.issSize = iss->value.GetStringLength();
+        }
+
+        getTimeClaim( payloadJson, "exp", fields.exp );
+        getTimeClaim( payloadJson, "nbf", fields.nbf );
+
+        rapidjson::Value::ConstMemberIterator aud = payloadJson.FindMember( "aud" );
+        if ( aud != payloadJson.MemberEnd() )
+        {
+            fields.aud = &aud->value;
+        }
+    }
+}
@@ -1,23 +1,158 @@
 #include <rapidjson/document.h>
 
+#include <lhwsutil_impl/httpresponsesinks.h>
 #include <lhwsutil_impl/jwtissuercache.h>
 #include <lhwsutil_impl/jwtutils.h>
+#include <lhwsutil_impl/metricsregistry.h>
+#include <lhwsutil_impl/probes.h>
 
 #include <lhwsutil/isimplehttpclient.h>
 #include <lhwsutil/logging.h>
 
 #include <lhsslutil/base64.h>
 
+#include <cstring>
+#include <new>
 #include <stdexcept>
+#include <thread>
 
 namespace LHWSUtilImplNS
 {
-    JwtIssuer::JwtIssuer( const std::string& _url )
+    namespace
+    {
+        void addAlgKeyPem( const std::string& alg,
+            const std::string& keyPem,
+            std::vector< std::pair< LHWSUtilNS::JwtAlg, std::string > >& algKeyPems,
+            std::vector< std::pair< std::string, std::string > >& namedAlgKeyPems )
+        {
+            LHWSUtilNS::JwtAlg jwtAlg;
+            if ( LHWSUtilNS::JwtAlgForName( alg.data(), alg.size(), jwtAlg ) )
+            {
+                algKeyPems.emplace_back( jwtAlg, keyPem );
+            }
+            else
+            {
+                namedAlgKeyPems.emplace_back( alg, keyPem );
+            }
+        }
+
+        // readers of a frozen table only hash and compare iss, so this does not wait long
+        void waitForFrozenReaders( const std::atomic< size_t >& readers )
+        {
+            while ( readers.load() != 0 )
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    JwtIssuerFields::JwtIssuerFields()
+        : url()
+        , clientAuthzBearerToken()
+        , introspectionEndpoint()
+        , jwksUri()
+        , openIdConfiguration()
+        , algKeyPems()
+        , namedAlgKeyPems()
+    {
+    }
+
+    JwtIssuer::JwtIssuer( const JwtIssuerFields& fields )
         : LHWSUtilNS::IJwtIssuer()
-        , url( _url )
-        , algToKeyPem()
+        , block()
+        , blockSize( 0 )
+        , numKeys( 0 )
+        , url()
         , clientAuthzBearerToken()
+        , introspectionEndpoint()
+        , jwksUri()
+        , openIdConfiguration()
+        , stringsOnce()
+        , strings()
+        , stringsBytes( 0 )
     {
+        // the first pem of an alg is the one used
+        std::vector< const std::pair< LHWSUtilNS::JwtAlg, std::string >* > algKeyPems;
+        std::vector< const std::pair< std::string, std::string >* > namedAlgKeyPems;
+        size_t strBytes = fields.url.size() + fields.clientAuthzBearerToken.size() +
+            fields.introspectionEndpoint.size() + fields.jwksUri.size() + fields.openIdConfiguration.size() + 5;
+        for ( const auto& algKeyPem : fields.algKeyPems )
+        {
+            bool seen = false;
+            for ( const auto* seenAlgKeyPem : algKeyPems )
+            {
+                seen = seen || ( seenAlgKeyPem->first == algKeyPem.first );
+            }
+
+            if ( !( seen ) )
+            {
+                algKeyPems.push_back( &algKeyPem );
+                strBytes += algKeyPem.second.size() + 1;
+            }
+        }
+        for ( const auto& namedAlgKeyPem : fields.namedAlgKeyPems )
+        {
+            bool seen = false;
+            for ( const auto* seenAlgKeyPem : namedAlgKeyPems )
+            {
+                seen = seen || ( seenAlgKeyPem->first == namedAlgKeyPem.first );
+            }
+
+            if ( !( seen ) && !( namedAlgKeyPem.first.empty() ) )
+            {
+                namedAlgKeyPems.push_back( &namedAlgKeyPem );
+                strBytes += namedAlgKeyPem.first.size() + namedAlgKeyPem.second.size() + 2;
+            }
+        }
+
+        numKeys = algKeyPems.size() + namedAlgKeyPems.size();
+        blockSize = ( numKeys * sizeof( Key ) ) + strBytes;
+        if ( blockSize > UINT32_MAX )
+        {
+            throw std::runtime_error( "issuer=[" + fields.url + "] is too large" );
+        }
+
+        // new char[] is aligned for any object which fits, Key included
+        block.reset( new char[ blockSize ] );
+
+        size_t used = numKeys * sizeof( Key );
+        auto appendStr = [ this, &used ]( const std::string& value ) -> StrRef
+        {
+            StrRef ref;
+
+            ref.offset = static_cast< uint32_t >( used );
+            ref.size = static_cast< uint32_t >( value.size() );
+            std::memcpy( block.get() + used, value.c_str(), value.size() + 1 );
+            used += value.size() + 1;
+
+            return ref;
+        };
+
+        for ( size_t k = 0; k < numKeys; ++k )
+        {
+            Key* key = new ( block.get() + ( k * sizeof( Key ) ) ) Key();
+
+            if ( k < algKeyPems.size() )
+            {
+                key->alg = algKeyPems[ k ]->first;
+                key->name = StrRef();
+                key->pem = appendStr( algKeyPems[ k ]->second );
+            }
+            else
+            {
+                const std::pair< std::string, std::string >& namedAlgKeyPem( *namedAlgKeyPems[ k - algKeyPems.size() ] );
+
+                key->alg = LHWSUtilNS::JwtAlg();
+                key->name = appendStr( namedAlgKeyPem.first );
+                key->pem = appendStr( namedAlgKeyPem.second );
+            }
+        }
+
+        url = appendStr( fields.url );
+        clientAuthzBearerToken = appendStr( fields.clientAuthzBearerToken );
+        introspectionEndpoint = appendStr( fields.introspectionEndpoint );
+        jwksUri = appendStr( fields.jwksUri );
+        openIdConfiguration = appendStr( fields.openIdConfiguration );
     }
 
     JwtIssuer::~JwtIssuer()
@@ -26,63 +161,157 @@ namespace LHWSUtilImplNS
 
     const std::string& JwtIssuer::GetUrl() const
     {
-        return url;
+        return getStrings().url;
     }
 
     bool JwtIssuer::AlgIsSupported( const std::string& alg ) const
     {
-        if ( algToKeyPem.find( alg ) != algToKeyPem.cend() )
-        {
-            return true;
-        }
-        else
-        {
-            return false;
-        }
+        return ( findKey( alg ) != nullptr );
     }
 
     const std::string& JwtIssuer::GetKeyPemForAlg( const std::string& alg ) const
     {
-        auto it = algToKeyPem.find( alg );
-        if ( it != algToKeyPem.cend() )
-        {
-            return it->second;
-        }
-        else
+        const Key& key( getKey( alg ) );
+
+        return getStrings().keyPems[ &key - keys() ];
+    }
+
+    const std::string& JwtIssuer::GetClientAuthzBearerToken() const
+    {
+        return getStrings().clientAuthzBearerToken;
+    }
+
+    const std::string& JwtIssuer::GetOpenIdConfiguration() const
+    {
+        return getStrings().openIdConfiguration;
+    }
+
+    LHWSUtilNS::JwtIssuerStr JwtIssuer::GetIntrospectionEndpoint() const
+    {
+        return str( introspectionEndpoint );
+    }
+
+    LHWSUtilNS::JwtIssuerStr JwtIssuer::GetJwksUri() const
+    {
+        return str( jwksUri );
+    }
+
+    LHWSUtilNS::JwtIssuerStr JwtIssuer::GetUrlView() const
+    {
+        return str( url );
+    }
+
+    LHWSUtilNS::JwtIssuerStr JwtIssuer::GetKeyPemForAlgView( const std::string& alg ) const
+    {
+        return str( getKey( alg ).pem );
+    }
+
+    LHWSUtilNS::JwtIssuerStr JwtIssuer::GetClientAuthzBearerTokenView() const
+    {
+        return str( clientAuthzBearerToken );
+    }
+
+    LHWSUtilNS::JwtIssuerStr JwtIssuer::GetOpenIdConfigurationView() const
+    {
+        return str( openIdConfiguration );
+    }
+
+    size_t JwtIssuer::GetMemoryUsage() const
+    {
+        return sizeof( JwtIssuer ) + blockSize + stringsBytes.load( std::memory_order_relaxed );
+    }
+
+    LHWSUtilNS::JwtIssuerStr JwtIssuer::str( const StrRef& ref ) const
+    {
+        return LHWSUtilNS::JwtIssuerStr( block.get() + ref.offset, ref.size );
+    }
+
+    const JwtIssuer::Key& JwtIssuer::getKey( const std::string& alg ) const
+    {
+        const Key* key = findKey( alg );
+        if ( !( key ) )
         {
             std::ostringstream oss;
-            oss << "alg=[" << alg << "] unsupported by issuer=[" << url << "]";
+            oss << "alg=[" << alg << "] unsupported by issuer=[" << str( url ).data << "]";
             throw std::runtime_error( oss.str() );
         }
-    }
 
-    const std::string& JwtIssuer::GetClientAuthzBearerToken() const
-    {
-        return clientAuthzBearerToken;
+        return *key;
     }
 
-    void JwtIssuer::SetKeyPemForAlg( const std::string& alg, const std::string& keyPem )
+    const JwtIssuer::Strings& JwtIssuer::getStrings() const
     {
-        wsUtilLogSetScope( "JwtIssuerCache.SetKeyPem" );
+        std::call_once( stringsOnce, [ this ]()
+        {
+            std::unique_ptr< Strings > copies( new Strings() );
+            size_t bytes = sizeof( Strings );
+
+            copies->url = str( url ).str();
+            copies->clientAuthzBearerToken = str( clientAuthzBearerToken ).str();
+            copies->openIdConfiguration = str( openIdConfiguration ).str();
+            bytes += url.size + clientAuthzBearerToken.size + openIdConfiguration.size;
+            copies->keyPems.reserve( numKeys );
+            for ( size_t k = 0; k < numKeys; ++k )
+            {
+                copies->keyPems.push_back( str( keys()[ k ].pem ).str() );
+                bytes += sizeof( std::string ) + keys()[ k ].pem.size;
+            }
 
-        wsUtilLogTrace( "iss=" << url << " setting alg=" << alg << " to key=" << keyPem );
+            strings = std::move( copies );
+            stringsBytes.store( bytes, std::memory_order_relaxed );
+        } );
 
-        algToKeyPem.emplace( alg, keyPem );
+        return *strings;
     }
 
-    void JwtIssuer::SetClientAuthzBearerToken( const std::string& _clientAuthzBearerToken )
+    const JwtIssuer::Key* JwtIssuer::keys() const
     {
-        clientAuthzBearerToken = _clientAuthzBearerToken;
+        return reinterpret_cast< const Key* >( block.get() );
     }
 
-    const std::string& JwtIssuer::GetOpenIdConfiguration() const
+    const JwtIssuer::Key* JwtIssuer::findKey( const std::string& alg ) const
     {
-        return openIdConfiguration;
+        LHWSUtilNS::JwtAlg jwtAlg;
+        if ( LHWSUtilNS::JwtAlgForName( alg.data(), alg.size(), jwtAlg ) )
+        {
+            for ( size_t k = 0; k < numKeys; ++k )
+            {
+                if ( ( keys()[ k ].name.size == 0 ) && ( keys()[ k ].alg == jwtAlg ) )
+                {
+                    return &( keys()[ k ] );
+                }
+            }
+
+            return nullptr;
+        }
+
+        // an alg with no JwtAlg, e.g. PS256 or EdDSA, is compared by name
+        for ( size_t k = 0; k < numKeys; ++k )
+        {
+            const StrRef& name( keys()[ k ].name );
+            if ( ( name.size == alg.size() ) && ( std::memcmp( block.get() + name.offset, alg.data(), name.size ) == 0 ) )
+            {
+                return &( keys()[ k ] );
+            }
+        }
+
+        return nullptr;
     }
 
-    void JwtIssuer::SetOpenIdConfiguration( const std::string _openIdConfiguration )
+    void JwtIssuer::GetKeys( std::vector< std::pair< LHWSUtilNS::JwtAlg, std::string > >& algKeyPemsOut,
+        std::vector< std::pair< std::string, std::string > >& namedAlgKeyPemsOut ) const
     {
-        openIdConfiguration = _openIdConfiguration;
+        for ( size_t k = 0; k < numKeys; ++k )
+        {
+            if ( keys()[ k ].name.size == 0 )
+            {
+                algKeyPemsOut.emplace_back( keys()[ k ].alg, str( keys()[ k ].pem ).str() );
+            }
+            else
+            {
+                namedAlgKeyPemsOut.emplace_back( str( keys()[ k ].name ).str(), str( keys()[ k ].pem ).str() );
+            }
+        }
     }
 
     JwtIssuerCache::JwtIssuerCache()
@@ -90,22 +319,38 @@ namespace LHWSUtilImplNS
         , cacheMutex()
         , issToJwtIssuer()
         , pendingIssToCacheParams()
+        , frozenIssuers( nullptr )
+        , frozenTable()
+        , frozenReadEpoch( 0 )
+        , frozenReaders()
     {
+        frozenReaders[ 0 ].store( 0 );
+        frozenReaders[ 1 ].store( 0 );
     }
 
     JwtIssuerCache::~JwtIssuerCache()
     {
+        GetMetricsRegistry().AddPendingIssuers( -static_cast< int64_t >( pendingIssToCacheParams.size() ) );
     }
 
     void JwtIssuerCache::LoadIssuer( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams )
     {
-        const std::lock_guard<std::mutex> lock( cacheMutex );
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
 
         if ( cacheParams.iss.empty() )
         {
             throw std::runtime_error( "cacheParams.iss is empty" );
         }
 
+        if ( frozenIssuers.load( std::memory_order_relaxed ) )
+        {
+            std::ostringstream oss;
+
+            oss << "cannot load issuer=[" << cacheParams.iss << "] into a frozen cache";
+
+            throw std::runtime_error( oss.str() );
+        }
+
         auto it = issToJwtIssuer.find( cacheParams.iss );
         if ( it != issToJwtIssuer.end() )
         {
@@ -116,76 +361,64 @@ namespace LHWSUtilImplNS
             throw std::runtime_error( oss.str() );
         }
 
+        GetMetricsRegistry().RegisterIssuer( cacheParams.iss );
+
         int rc = reloadIssuer( cacheParams );
         if ( rc != 0 )
         {
             pendingIssToCacheParams.emplace( cacheParams.iss, cacheParams );
+            GetMetricsRegistry().AddPendingIssuers( 1 );
         }
     }
 
     // assume lock held
     int JwtIssuerCache::reloadIssuer( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams )
     {
-        wsUtilLogSetScope( "JwtIssuerCache.reloadIssuer" );
+        std::shared_ptr< JwtIssuer > jwtIssuer;
 
-        int ret = 0;
-        std::unordered_set< std::string > algsToFetch; // TODO - case insensitive
-
-        auto jwtIssuer( std::make_shared< JwtIssuer >( cacheParams.iss ) );
-        if ( !( jwtIssuer ) )
+        int rc = LoadJwtIssuer( cacheParams, jwtIssuer );
+        if ( rc == 0 )
         {
-            wsUtilLogFatal( "failed to allocate JwtIssuer for iss=[" << cacheParams.iss << "]" );
-
-            return 1;
+            (void)issToJwtIssuer.emplace( cacheParams.iss, jwtIssuer );
         }
 
-        if ( cacheParams.clientAuthzBearerToken.size() )
-        {
-            wsUtilLogTrace( "using client authz bearer token=[" << cacheParams.clientAuthzBearerToken << "]" );
-            jwtIssuer->SetClientAuthzBearerToken( cacheParams.clientAuthzBearerToken );
-        }
+        return rc;
+    }
 
-        for ( auto itAlgToKeyPem = cacheParams.algToKeyPem.cbegin();
-            itAlgToKeyPem != cacheParams.algToKeyPem.cend();
-            ++itAlgToKeyPem )
+    JwtIssuerCache::FrozenIssuersReader::FrozenIssuersReader( const JwtIssuerCache& jwtIssuerCache )
+        : table( nullptr )
+        , readers( nullptr )
+    {
+        // an unfrozen cache's lookups go to issToJwtIssuer without counting themselves
+        if ( !( jwtIssuerCache.frozenIssuers.load( std::memory_order_relaxed ) ) )
         {
-            if ( itAlgToKeyPem->second.empty() )
-            {
-                algsToFetch.emplace( itAlgToKeyPem->first );
-            }
-            else
-            {
-                jwtIssuer->SetKeyPemForAlg( itAlgToKeyPem->first, itAlgToKeyPem->second );
-            }
+            return;
         }
 
-        if ( cacheParams.pulldownOpenIdConfiguration )
-        {
-            int rc = FillJwtIssuerFromEndpoints( algsToFetch, *jwtIssuer );
-            if ( rc == 0 )
-            {
-                (void)issToJwtIssuer.emplace( cacheParams.iss, jwtIssuer );
-            }
-            else
-            {
-                wsUtilLogError( "failed to fill JwtIssuer for iss=[" << cacheParams.iss << "], rc=" << rc );
+        readers = &( jwtIssuerCache.frozenReaders[ jwtIssuerCache.frozenReadEpoch.load() & 1 ] );
+        readers->fetch_add( 1 );
+        table = jwtIssuerCache.frozenIssuers.load();
+    }
 
-                ret = 2;
-            }
-        }
-        else if ( algsToFetch.size() )
+    JwtIssuerCache::FrozenIssuersReader::~FrozenIssuersReader()
+    {
+        if ( readers )
         {
-            wsUtilLogError( "load is false but empty keys exist for iss=[" << cacheParams.iss << "]" );
-
-            ret = 3;
+            readers->fetch_sub( 1, std::memory_order_release );
         }
-
-        return ret;
     }
 
     bool JwtIssuerCache::IssuerIsLoaded( const std::string& iss ) const
     {
-        const std::lock_guard<std::mutex> lock( cacheMutex );
+        {
+            FrozenIssuersReader frozenReader( *this );
+            if ( frozenReader.table )
+            {
+                return ( frozenReader.table->Find( iss ) != nullptr );
+            }
+        }
+
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
         auto it = issToJwtIssuer.find( iss );
         if ( it != issToJwtIssuer.cend() )
         {
@@ -199,14 +432,34 @@ namespace LHWSUtilImplNS
 
     std::shared_ptr< LHWSUtilNS::IJwtIssuer > JwtIssuerCache::GetIssuer( const std::string& iss )
     {
-        const std::lock_guard<std::mutex> lock( cacheMutex );
+        {
+            FrozenIssuersReader frozenReader( *this );
+            const std::shared_ptr< LHWSUtilNS::IJwtIssuer >* jwtIssuer =
+                frozenReader.table ? frozenReader.table->Find( iss ) : nullptr;
+            if ( jwtIssuer )
+            {
+                MetricsRegistry::LocalShard().issuerCacheHits.Add( 1 );
+                LHWSUTIL_PROBE1( issuer_cache_hit, iss.c_str() );
+
+                return *jwtIssuer;
+            }
+            // not loaded or not frozen, reported as below
+        }
+
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
         auto it = issToJwtIssuer.find( iss );
         if ( it != issToJwtIssuer.cend() )
         {
+            MetricsRegistry::LocalShard().issuerCacheHits.Add( 1 );
+            LHWSUTIL_PROBE1( issuer_cache_hit, iss.c_str() );
+
             return it->second;
         }
         else
         {
+            MetricsRegistry::LocalShard().issuerCacheMisses.Add( 1 );
+            LHWSUTIL_PROBE1( issuer_cache_miss, iss.c_str() );
+
             bool pending = false;
             auto itPending = pendingIssToCacheParams.find( iss );
             if ( itPending != pendingIssToCacheParams.end() )
@@ -220,6 +473,7 @@ namespace LHWSUtilImplNS
                     if ( it != issToJwtIssuer.cend() )
                     {
                         pendingIssToCacheParams.erase( itPending );
+                        GetMetricsRegistry().AddPendingIssuers( -1 );
 
                         return it->second;
                     }
@@ -238,13 +492,184 @@ namespace LHWSUtilImplNS
         }
     }
 
-    int FillJwtIssuerFromEndpoints( const std::unordered_set< std::string >& algsToFetch, JwtIssuer& jwtIssuer )
+    int JwtIssuerCache::Freeze()
+    {
+        wsUtilLogSetScope( "JwtIssuerCache.Freeze" );
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
+
+        if ( frozenIssuers.load( std::memory_order_relaxed ) )
+        {
+            return 0;
+        }
+
+        // a pending issuer is loaded by GetIssuer, which a frozen table cannot do
+        if ( !( pendingIssToCacheParams.empty() ) )
+        {
+            wsUtilLogError( "cannot freeze with " << pendingIssToCacheParams.size() << " issuers pending" );
+
+            return 1;
+        }
+
+        std::vector< std::shared_ptr< LHWSUtilNS::IJwtIssuer > > jwtIssuers;
+        jwtIssuers.reserve( issToJwtIssuer.size() );
+        for ( auto it = issToJwtIssuer.cbegin(); it != issToJwtIssuer.cend(); ++it )
+        {
+            jwtIssuers.push_back( it->second );
+        }
+
+        std::unique_ptr< FrozenIssuerTable > table;
+        try
+        {
+            table.reset( new FrozenIssuerTable( jwtIssuers ) );
+        }
+        catch ( const std::exception& e )
+        {
+            wsUtilLogError( "failed to freeze " << jwtIssuers.size() << " issuers, e=[" << e.what() << "]" );
+
+            return 2;
+        }
+
+        replaceFrozenIssuers( std::move( table ) );
+        wsUtilLogInfo( "froze " << jwtIssuers.size() << " issuers" );
+
+        return 0;
+    }
+
+    void JwtIssuerCache::Unfreeze()
+    {
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
+
+        replaceFrozenIssuers( nullptr );
+    }
+
+    bool JwtIssuerCache::IsFrozen() const
+    {
+        return ( frozenIssuers.load( std::memory_order_acquire ) != nullptr );
+    }
+
+    // assume lock held
+    void JwtIssuerCache::replaceFrozenIssuers( std::unique_ptr< FrozenIssuerTable >&& table )
+    {
+        std::unique_ptr< FrozenIssuerTable > replacedTable( std::move( frozenTable ) );
+
+        frozenTable = std::move( table );
+        frozenIssuers.store( frozenTable.get() );
+        if ( !( replacedTable ) )
+        {
+            return;
+        }
+
+        // a reader which loaded replacedTable counted itself before the store above, under the
+        // current epoch, or under the other if it read the epoch before the last flip
+        // drain the other, then flip so that new readers count under it, and drain the current
+        unsigned epoch = frozenReadEpoch.load();
+        waitForFrozenReaders( frozenReaders[ ( epoch + 1 ) & 1 ] );
+        frozenReadEpoch.store( epoch + 1 );
+        waitForFrozenReaders( frozenReaders[ epoch & 1 ] );
+    }
+
+    size_t JwtIssuerCache::GetMemoryUsage( std::vector< LHWSUtilNS::JwtIssuerMemoryUsage >& usageOut ) const
+    {
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
+        size_t totalBytes = 0;
+
+        for ( auto it = issToJwtIssuer.cbegin(); it != issToJwtIssuer.cend(); ++it )
+        {
+            usageOut.emplace_back();
+            usageOut.back().iss = it->first;
+            usageOut.back().bytes = it->second->GetMemoryUsage();
+            totalBytes += usageOut.back().bytes;
+        }
+
+        return totalBytes;
+    }
+
+    void JwtIssuerCache::GetLockWaitStats( LockWaitStats& statsOut ) const
+    {
+        cacheMutex.GetWaitStats( statsOut );
+    }
+
+    void JwtIssuerCache::ResetLockWaitStats()
+    {
+        cacheMutex.ResetWaitStats();
+    }
+
+    int LoadJwtIssuer( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams, std::shared_ptr< JwtIssuer >& jwtIssuerOut )
+    {
+        wsUtilLogSetScope( "LoadJwtIssuer" );
+
+        int ret = 0;
+        std::unordered_set< std::string > algsToFetch; // TODO - case insensitive
+        MetricsShard& metricsShard( MetricsRegistry::LocalShard() );
+
+        metricsShard.issuerReloads.Add( 1 );
+        LHWSUTIL_PROBE1( issuer_reload_entry, cacheParams.iss.c_str() );
+
+        JwtIssuerFields fields;
+        fields.url = cacheParams.iss;
+        if ( cacheParams.clientAuthzBearerToken.size() )
+        {
+            wsUtilLogTrace( "using client authz bearer token=[" << cacheParams.clientAuthzBearerToken << "]" );
+            fields.clientAuthzBearerToken = cacheParams.clientAuthzBearerToken;
+        }
+
+        for ( auto itAlgToKeyPem = cacheParams.algToKeyPem.cbegin();
+            ( ret == 0 ) && ( itAlgToKeyPem != cacheParams.algToKeyPem.cend() );
+            ++itAlgToKeyPem )
+        {
+            if ( itAlgToKeyPem->second.empty() )
+            {
+                algsToFetch.emplace( itAlgToKeyPem->first );
+            }
+            else
+            {
+                wsUtilLogTrace( "iss=" << cacheParams.iss << " setting alg=" << itAlgToKeyPem->first
+                    << " to key=" << LHWSUtilNS::LogPayload( itAlgToKeyPem->second ) );
+                // an alg which is not a JwtAlg is kept by name for validators which can check it
+                addAlgKeyPem( itAlgToKeyPem->first, itAlgToKeyPem->second, fields.algKeyPems, fields.namedAlgKeyPems );
+            }
+        }
+
+        if ( ( ret == 0 ) && cacheParams.pulldownOpenIdConfiguration )
+        {
+            int rc = FillJwtIssuerFromEndpoints( algsToFetch, fields );
+            if ( rc != 0 )
+            {
+                wsUtilLogError( "failed to fill JwtIssuer for iss=[" << cacheParams.iss << "], rc=" << rc );
+
+                ret = 2;
+            }
+        }
+        else if ( ( ret == 0 ) && algsToFetch.size() )
+        {
+            wsUtilLogError( "load is false but empty keys exist for iss=[" << cacheParams.iss << "]" );
+
+            ret = 3;
+        }
+
+        if ( ret == 0 )
+        {
+            jwtIssuerOut = std::make_shared< JwtIssuer >( fields );
+        }
+
+        if ( ret != 0 )
+        {
+            metricsShard.issuerReloadFailures.Add( 1 );
+        }
+
+        LHWSUTIL_PROBE2( issuer_reload_exit, cacheParams.iss.c_str(), ret );
+
+        return ret;
+    }
+
+    int FillJwtIssuerFromEndpoints( const std::unordered_set< std::string >& algsToFetch, JwtIssuerFields& fields )
     {
         wsUtilLogSetScope( "FillJwtIssuerFromEndpoints" );
 
         int rc = 0;
         rapidjson::ParseResult parsedOkay;
-        std::unordered_map< std::string, std::string > algToKeyPem;
+        std::vector< std::pair< LHWSUtilNS::JwtAlg, std::string > > algKeyPems;
+        std::vector< std::pair< std::string, std::string > > namedAlgKeyPems;
 
         std::shared_ptr< LHWSUtilNS::ISimpleHttpClientFactory > simpleHttpClientFactory(
             LHMiscUtilNS::Singleton< LHWSUtilNS::ISimpleHttpClientFactory >::GetInstance() );
@@ -264,19 +689,19 @@ namespace LHWSUtilImplNS
             return 2;
         }
 
-        std::string issOidConfigUrl = jwtIssuer.GetUrl() + "/.well-known/openid-configuration";
+        std::string issOidConfigUrl = fields.url + "/.well-known/openid-configuration";
         std::string issOidConfigStr;
         rc = simpleHttpClient->Get( issOidConfigUrl, issOidConfigStr );
         if ( rc != 0 || issOidConfigStr.empty() )
         {
             wsUtilLogError( "failed to get openid-configuration url["
-                << issOidConfigUrl << "], body=[" << issOidConfigStr << "], rc=" << rc );
+                << issOidConfigUrl << "], body=[" << LHWSUtilNS::LogPayload( issOidConfigStr ) << "], rc=" << rc );
 
             return 3;
         }
 
         wsUtilLogInfo( "parsing openid-configuration["
-            << issOidConfigStr << "] for issuer=[" << issOidConfigUrl << "]" );
+            << LHWSUtilNS::LogPayload( issOidConfigStr ) << "] for issuer=[" << issOidConfigUrl << "]" );
 
         rapidjson::Document issOidConfigJson;
         parsedOkay = issOidConfigJson.Parse( issOidConfigStr.c_str() );
@@ -298,28 +723,28 @@ namespace LHWSUtilImplNS
 
         std::string issJwksUrl( issOidConfigJson[ "jwks_uri" ].GetString(),
             issOidConfigJson[ "jwks_uri" ].GetStringLength() );
-        std::string issJwksStr;
-        rc = simpleHttpClient->Get( issJwksUrl, issJwksStr );
-        if ( rc != 0 || issJwksStr.empty() )
+        std::string introspectionEndpoint;
+        if ( issOidConfigJson.HasMember( "introspection_endpoint" ) &&
+            issOidConfigJson[ "introspection_endpoint" ].IsString() )
         {
-            wsUtilLogError( "failed to get jwks url["
-                << issJwksUrl << "], body=[" << issJwksStr << "], rc=" << rc );
-
-            return 6;
+            introspectionEndpoint.assign( issOidConfigJson[ "introspection_endpoint" ].GetString(),
+                issOidConfigJson[ "introspection_endpoint" ].GetStringLength() );
         }
-
-        wsUtilLogInfo( "parsing jwks["
-            << issJwksStr << "] for issuer=[" << issOidConfigUrl << "]" );
-
-        rapidjson::Document issJwksJson;
-        parsedOkay = issJwksJson.Parse( issJwksStr.c_str() );
-        if ( !( parsedOkay ) )
+        LHWSUtilNS::HttpRequestParams jwksRequestParams;
+        JsonDocumentResponseSink issJwksSink;
+        rc = simpleHttpClient->Get( issJwksUrl, jwksRequestParams, issJwksSink );
+        if ( rc != 0 )
         {
-            wsUtilLogError( "failed to parse jwks" );
+            wsUtilLogError( "failed to get or parse jwks url["
+                << issJwksUrl << "], size=" << issJwksSink.GetBodySize() << ", rc=" << rc );
 
             return 6;
         }
 
+        wsUtilLogInfo( "parsed jwks of size=" << issJwksSink.GetBodySize()
+            << " for issuer=[" << issOidConfigUrl << "]" );
+
+        const rapidjson::Document& issJwksJson( issJwksSink.GetDocument() );
         if ( !( issJwksJson.IsObject() ) )
         {
             wsUtilLogError( "jwks json is not an object" );
@@ -368,7 +793,7 @@ namespace LHWSUtilImplNS
                     rc = FillKeyStrFromJwkJson( alg, keyJwkJson, keyPem );
                     if ( rc == 0 )
                     {
-                        algToKeyPem.emplace( alg, keyPem );
+                        addAlgKeyPem( alg, keyPem, algKeyPems, namedAlgKeyPems );
                     }
                 }
             }
@@ -396,22 +821,32 @@ namespace LHWSUtilImplNS
             rc = FillKeyStrFromJwkJson( alg, issJwksJson, keyPem );
             if ( rc == 0 )
             {
-                algToKeyPem.emplace( alg, keyPem );
+                addAlgKeyPem( alg, keyPem, algKeyPems, namedAlgKeyPems );
             }
         }
 
-        if ( algToKeyPem.empty() && algsToFetch.size() )
+        if ( algKeyPems.empty() && namedAlgKeyPems.empty() && algsToFetch.size() )
         {
             wsUtilLogError( "failed to fetch any alg key pems" );
 
             return 10;
         }
 
-        jwtIssuer.SetOpenIdConfiguration( issOidConfigStr );
+        fields.introspectionEndpoint = std::move( introspectionEndpoint );
+        fields.jwksUri = std::move( issJwksUrl );
+        // the parsed endpoints are all a validation needs, the document is kept to debug with
+        if ( wsUtilLogSeverityEnabled( LHWSUtilNS::SeverityLevel::debug ) )
+        {
+            fields.openIdConfiguration = std::move( issOidConfigStr );
+        }
 
-        for ( auto itAlgToKeyPem = algToKeyPem.cbegin(); itAlgToKeyPem != algToKeyPem.cend(); ++itAlgToKeyPem )
+        for ( auto& algKeyPem : algKeyPems )
+        {
+            fields.algKeyPems.push_back( std::move( algKeyPem ) );
+        }
+        for ( auto& namedAlgKeyPem : namedAlgKeyPems )
         {
-            jwtIssuer.SetKeyPemForAlg( itAlgToKeyPem->first, itAlgToKeyPem->second );
+            fields.namedAlgKeyPems.push_back( std::move( namedAlgKeyPem ) );
         }
 
         return 0;
@@ -429,9 +864,9 @@ namespace LHWSUtilNS
         const std::string& clientSecret,
         std::string& authzBearerTokenOut )
     {
-        wsUtilLogSetScope( "AuthzBearerTokenForClientIdSecret" )
+        wsUtilLogSetScope( "AuthzBearerTokenForClientIdSecret" );
 
-            int rc = 0;
+        int rc = 0;
         std::ostringstream oss;
         std::string b64EncodedStr;
 
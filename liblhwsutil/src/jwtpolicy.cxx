@@ -0,0 +1,394 @@
+#include <rapidjson/document.h>
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <lhwsutil/ijwtvalidator.h>
+#include <lhwsutil/jwtpolicy.h>
+#include <lhwsutil/logging.h>
+
+#include <lhwsutil_impl/claimpath.h>
+#include <lhwsutil_impl/jwtpolicy.h>
+#include <lhwsutil_impl/validationarena.h>
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        bool matchString( const LHWSUtilNS::JwtPolicyCondition& condition,
+            const std::string& value,
+            const char* str,
+            size_t strSize )
+        {
+            switch ( condition.op )
+            {
+                case LHWSUtilNS::JwtPolicyOp::Exists:
+                    return true;
+                case LHWSUtilNS::JwtPolicyOp::Equals:
+                    return ( strSize == value.size() ) && ( std::memcmp( str, value.data(), strSize ) == 0 );
+                case LHWSUtilNS::JwtPolicyOp::Contains:
+                {
+                    const char* end = str + strSize;
+                    const char* tokenStart = str;
+                    while ( tokenStart < end )
+                    {
+                        const char* tokenEnd = static_cast< const char* >(
+                            std::memchr( tokenStart, ' ', end - tokenStart ) );
+                        if ( !( tokenEnd ) )
+                        {
+                            tokenEnd = end;
+                        }
+
+                        if ( ( static_cast< size_t >( tokenEnd - tokenStart ) == value.size() ) &&
+                            ( std::memcmp( tokenStart, value.data(), value.size() ) == 0 ) )
+                        {
+                            return true;
+                        }
+
+                        tokenStart = tokenEnd + 1;
+                    }
+
+                    return false;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        bool matchScalar( const LHWSUtilNS::JwtPolicyCondition& condition, const rapidjson::Value& claim )
+        {
+            if ( claim.IsBool() )
+            {
+                return condition.valueIsBool && ( claim.GetBool() == condition.boolValue );
+            }
+            else if ( claim.IsInt64() )
+            {
+                return condition.valueIsInt && ( claim.GetInt64() == condition.intValue );
+            }
+
+            return false;
+        }
+
+        bool matchValue( const LHWSUtilNS::JwtPolicyCondition& condition,
+            const std::string& value,
+            const rapidjson::Value& claim )
+        {
+            if ( condition.op == LHWSUtilNS::JwtPolicyOp::Exists )
+            {
+                return true;
+            }
+
+            if ( claim.IsString() )
+            {
+                return matchString( condition, value, claim.GetString(), claim.GetStringLength() );
+            }
+
+            if ( claim.IsArray() )
+            {
+                bool contains = false;
+                ClaimArrayContains( &claim, value, contains );
+                return contains;
+            }
+
+            return ( condition.op == LHWSUtilNS::JwtPolicyOp::Equals ) && matchScalar( condition, claim );
+        }
+
+        // the index of str in strs, appended if it is not there yet
+        size_t internString( std::vector< std::string >& strs, const std::string& str )
+        {
+            for ( size_t i = 0; i < strs.size(); ++i )
+            {
+                if ( strs[ i ] == str )
+                {
+                    return i;
+                }
+            }
+
+            strs.push_back( str );
+
+            return strs.size() - 1;
+        }
+
+        // a bare word or a "quoted string" with \" and \\ escapes
+        // return 0 and set token, return 1 at the end of the expression, return 2 if a quote is unterminated
+        int nextPolicyToken( const std::string& expression, size_t& pos, std::string& token, bool& quoted )
+        {
+            while ( ( pos < expression.size() ) && std::isspace( static_cast< unsigned char >( expression[ pos ] ) ) )
+            {
+                ++pos;
+            }
+
+            if ( pos >= expression.size() )
+            {
+                return 1;
+            }
+
+            token.clear();
+            quoted = ( expression[ pos ] == '"' );
+            if ( quoted )
+            {
+                for ( ++pos; pos < expression.size(); ++pos )
+                {
+                    if ( expression[ pos ] == '"' )
+                    {
+                        ++pos;
+                        return 0;
+                    }
+
+                    if ( ( expression[ pos ] == '\\' ) && ( ( pos + 1 ) < expression.size() ) )
+                    {
+                        ++pos;
+                    }
+                    token.push_back( expression[ pos ] );
+                }
+
+                return 2;
+            }
+
+            while ( ( pos < expression.size() ) && !( std::isspace( static_cast< unsigned char >( expression[ pos ] ) ) ) )
+            {
+                token.push_back( expression[ pos++ ] );
+            }
+
+            return 0;
+        }
+    }
+
+    LHWSUtilNS::JwtPolicyDecision EvaluateJwtPolicy( const LHWSUtilNS::JwtPolicy& policy,
+        const rapidjson::Value& claims )
+    {
+        const std::vector< LHWSUtilNS::JwtPolicyCondition >& conditions( policy.GetConditions() );
+        const std::vector< std::string >& values( policy.GetValues() );
+
+        for ( auto it = conditions.cbegin(); it != conditions.cend(); ++it )
+        {
+            const rapidjson::Value* claim = ResolveClaimPath( claims, it->claimPath );
+            if ( !( claim && matchValue( *it, values[ it->valueIndex ], *claim ) ) )
+            {
+                wsUtilLogDebug( "policy denied on [" << it->path << "]" );
+                return LHWSUtilNS::JwtPolicyDecision::Deny;
+            }
+        }
+
+        return LHWSUtilNS::JwtPolicyDecision::Allow;
+    }
+}
+
+namespace LHWSUtilNS
+{
+    JwtPolicyCondition::JwtPolicyCondition()
+        : path()
+        , claimPath()
+        , op( JwtPolicyOp::Exists )
+        , claimIndex( 0 )
+        , valueIndex( 0 )
+        , valueIsBool( false )
+        , boolValue( false )
+        , valueIsInt( false )
+        , intValue( 0 )
+    {
+    }
+
+    JwtPolicy::JwtPolicy()
+        : conditions()
+        , claimNames()
+        , values()
+    {
+    }
+
+    int JwtPolicy::Compile( const std::string& expression, std::string& errorStr )
+    {
+        JwtPolicy compiled;
+        size_t pos = 0;
+        std::string path;
+        std::string op;
+        std::string value;
+        std::string conjunction;
+        bool quoted = false;
+        int rc = 0;
+
+        do
+        {
+            rc = LHWSUtilImplNS::nextPolicyToken( expression, pos, path, quoted );
+            if ( ( rc != 0 ) || quoted )
+            {
+                errorStr = "expected a claim path at offset " + std::to_string( pos );
+                return 1;
+            }
+
+            rc = LHWSUtilImplNS::nextPolicyToken( expression, pos, op, quoted );
+            if ( ( rc != 0 ) || quoted )
+            {
+                errorStr = "expected exists, == or contains after [" + path + "]";
+                return 2;
+            }
+
+            try
+            {
+                if ( op == "exists" )
+                {
+                    compiled.RequireClaim( path );
+                }
+                else if ( ( op == "==" ) || ( op == "contains" ) )
+                {
+                    rc = LHWSUtilImplNS::nextPolicyToken( expression, pos, value, quoted );
+                    if ( rc != 0 )
+                    {
+                        errorStr = "expected a value after [" + path + " " + op + "]";
+                        return 3;
+                    }
+
+                    // "true" and "42" only match strings
+                    compiled.addCondition( path,
+                        ( op == "==" ) ? JwtPolicyOp::Equals : JwtPolicyOp::Contains,
+                        value,
+                        !( quoted ) );
+                }
+                else
+                {
+                    errorStr = "unknown operator [" + op + "] after [" + path + "]";
+                    return 4;
+                }
+            }
+            catch ( const std::exception& e )
+            {
+                errorStr = e.what();
+                return 5;
+            }
+
+            rc = LHWSUtilImplNS::nextPolicyToken( expression, pos, conjunction, quoted );
+            if ( ( rc == 0 ) && ( quoted || ( conjunction != "AND" ) ) )
+            {
+                errorStr = "expected AND at offset " + std::to_string( pos );
+                return 6;
+            }
+            else if ( rc == 2 )
+            {
+                errorStr = "unterminated quote";
+                return 7;
+            }
+        }
+        while ( rc == 0 );
+
+        for ( auto it = compiled.conditions.begin(); it != compiled.conditions.end(); ++it )
+        {
+            const std::string& value( compiled.values[ it->valueIndex ] );
+            insertCondition( std::move( *it ), value );
+        }
+
+        return 0;
+    }
+
+    void JwtPolicy::RequireClaim( const std::string& path )
+    {
+        addCondition( path, JwtPolicyOp::Exists, "", false );
+    }
+
+    void JwtPolicy::RequireClaimEquals( const std::string& path, const std::string& value )
+    {
+        addCondition( path, JwtPolicyOp::Equals, value, true );
+    }
+
+    void JwtPolicy::RequireClaimContains( const std::string& path, const std::string& value )
+    {
+        addCondition( path, JwtPolicyOp::Contains, value, true );
+    }
+
+    const std::vector< JwtPolicyCondition >& JwtPolicy::GetConditions() const
+    {
+        return conditions;
+    }
+
+    const std::vector< std::string >& JwtPolicy::GetClaimNames() const
+    {
+        return claimNames;
+    }
+
+    const std::vector< std::string >& JwtPolicy::GetValues() const
+    {
+        return values;
+    }
+
+    JwtPolicyDecision JwtPolicy::Evaluate( const IValidJwt& jwt ) const
+    {
+        // claimStr keeps its capacity between evaluations
+        thread_local std::string claimStr;
+
+        LHWSUtilImplNS::ValidationArenaScope arenaScope;
+        LHWSUtilImplNS::ValidationArena& arena( arenaScope.GetArena() );
+        LHWSUtilImplNS::ArenaDocument claimsJson( &arena.GetAllocator(),
+            LHWSUtilImplNS::arenaParseStackCapacity,
+            &arena.GetStackAllocator() );
+        LHWSUtilImplNS::ArenaDocument claimJson( &arena.GetAllocator(),
+            LHWSUtilImplNS::arenaParseStackCapacity,
+            &arena.GetStackAllocator() );
+
+        // only the claims the policy names, each once however many conditions are on it
+        claimsJson.SetObject();
+        for ( auto it = claimNames.cbegin(); it != claimNames.cend(); ++it )
+        {
+            if ( jwt.GetGrantJsonValue( *it, claimStr ) != 0 )
+            {
+                continue;
+            }
+
+            claimJson.Parse( claimStr.c_str(), claimStr.size() );
+            if ( claimJson.HasParseError() )
+            {
+                continue;
+            }
+
+            rapidjson::Value claimName( rapidjson::StringRef( it->c_str(), it->size() ) );
+            claimsJson.AddMember( claimName, claimJson.Move(), arena.GetAllocator() );
+        }
+
+        return LHWSUtilImplNS::EvaluateJwtPolicy( *this, claimsJson );
+    }
+
+    void JwtPolicy::addCondition( const std::string& path,
+        JwtPolicyOp op,
+        const std::string& value,
+        bool parseLiterals )
+    {
+        JwtPolicyCondition condition;
+
+        condition.claimPath = ClaimPath( path );
+        if ( condition.claimPath.NumTokens() == 0 )
+        {
+            throw std::runtime_error( "empty claim path" );
+        }
+
+        condition.path = path;
+        condition.op = op;
+        condition.valueIsBool = parseLiterals && ( ( value == "true" ) || ( value == "false" ) );
+        condition.boolValue = ( value == "true" );
+        if ( parseLiterals && !( value.empty() ) )
+        {
+            char* end = nullptr;
+            errno = 0;
+            long intValue = std::strtol( value.c_str(), &end, 10 );
+            condition.valueIsInt = ( errno == 0 ) && ( *end == '\0' );
+            condition.intValue = intValue;
+        }
+
+        insertCondition( std::move( condition ), value );
+    }
+
+    void JwtPolicy::insertCondition( JwtPolicyCondition&& condition, const std::string& value )
+    {
+        condition.claimIndex = LHWSUtilImplNS::internString( claimNames, condition.claimPath.GetToken( 0 ) );
+        condition.valueIndex = LHWSUtilImplNS::internString( values, value );
+
+        // top level claims first, they are the cheapest to check and stop a denial soonest
+        auto insertAt( conditions.begin() );
+        while ( ( insertAt != conditions.end() ) &&
+            ( insertAt->claimPath.NumTokens() <= condition.claimPath.NumTokens() ) )
+        {
+            ++insertAt;
+        }
+        conditions.insert( insertAt, std::move( condition ) );
+    }
+}
@@ -0,0 +1,277 @@
+#include <lhwsutil/ijwtreplayguard.h>
+
+#include <lhwsutil_impl/jwtreplayguard.h>
+#include <lhwsutil_impl/keyhash.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+namespace LHWSUtilNS
+{
+    std::shared_ptr< IJwtReplayGuard > GetStandardJwtReplayGuard( const JwtReplayGuardParams& params )
+    {
+        return std::make_shared< LHWSUtilImplNS::JwtReplayGuard >( params );
+    }
+}
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        // bits of time covered by a slot of level 1, 2 and 3
+        const unsigned levelShifts[] = { 8, 14, 20 };
+    }
+
+    // odr-used by the ternaries below
+    const uint32_t ReplayTimingWheel::noEntry;
+
+    ReplayTimingWheel::ReplayTimingWheel( size_t _capacity, long now )
+        : capacity( std::max< size_t >( _capacity, 1 ) )
+        , bucketMask( 0 )
+        , time( now )
+        , numEntries( 0 )
+        , freeEntries( 0 )
+        , entries()
+        , buckets()
+    {
+        if ( capacity >= noEntry )
+        {
+            throw std::runtime_error( "replay timing wheel capacity is too large" );
+        }
+
+        size_t numBuckets = 1;
+        while ( numBuckets < capacity )
+        {
+            numBuckets <<= 1;
+        }
+        bucketMask = numBuckets - 1;
+
+        entries.reset( new Entry[ capacity ] );
+        for ( size_t i = 0; i < capacity; ++i )
+        {
+            entries[ i ].nextInBucket = ( ( i + 1 ) < capacity ) ? static_cast< uint32_t >( i + 1 ) : noEntry;
+        }
+
+        buckets.reset( new uint32_t[ numBuckets ] );
+        std::fill( buckets.get(), buckets.get() + numBuckets, noEntry );
+        std::fill( slots, slots + numSlots, noEntry );
+    }
+
+    void ReplayTimingWheel::Advance( long now )
+    {
+        while ( time < now )
+        {
+            // nothing to expire, jump straight to now
+            if ( numEntries == 0 )
+            {
+                time = now;
+                break;
+            }
+
+            tick();
+        }
+    }
+
+    LHWSUtilNS::JwtReplayCheck ReplayTimingWheel::Insert( uint64_t hash, long exp )
+    {
+        uint32_t* bucket = &buckets[ hash & bucketMask ];
+
+        for ( uint32_t entry = *bucket; entry != noEntry; entry = entries[ entry ].nextInBucket )
+        {
+            if ( entries[ entry ].hash == hash )
+            {
+                return LHWSUtilNS::JwtReplayCheck::Replayed;
+            }
+        }
+
+        if ( ( freeEntries == noEntry ) || ( exp <= time ) )
+        {
+            return LHWSUtilNS::JwtReplayCheck::Unrecorded;
+        }
+
+        uint32_t entry = freeEntries;
+        entries[ entry ].hash = hash;
+        entries[ entry ].exp = exp;
+        if ( !( schedule( entry ) ) )
+        {
+            return LHWSUtilNS::JwtReplayCheck::Unrecorded;
+        }
+
+        freeEntries = entries[ entry ].nextInBucket;
+        entries[ entry ].nextInBucket = *bucket;
+        *bucket = entry;
+        ++numEntries;
+
+        return LHWSUtilNS::JwtReplayCheck::First;
+    }
+
+    size_t ReplayTimingWheel::NumEntries() const
+    {
+        return numEntries;
+    }
+
+    void ReplayTimingWheel::tick()
+    {
+        ++time;
+
+        // higher levels first so that their entries can fall through to level 0
+        if ( ( time & ( ( 1L << levelShifts[ 0 ] ) - 1 ) ) == 0 )
+        {
+            if ( ( time & ( ( 1L << levelShifts[ 1 ] ) - 1 ) ) == 0 )
+            {
+                if ( ( time & ( ( 1L << levelShifts[ 2 ] ) - 1 ) ) == 0 )
+                {
+                    cascade( level0Slots + ( 2 * levelSlots ) + ( ( time >> levelShifts[ 2 ] ) & ( levelSlots - 1 ) ) );
+                }
+                cascade( level0Slots + levelSlots + ( ( time >> levelShifts[ 1 ] ) & ( levelSlots - 1 ) ) );
+            }
+            cascade( level0Slots + ( ( time >> levelShifts[ 0 ] ) & ( levelSlots - 1 ) ) );
+        }
+
+        // every entry left in the slot has exp == time
+        uint32_t* slot = &slots[ time & ( level0Slots - 1 ) ];
+        uint32_t entry = *slot;
+        *slot = noEntry;
+        while ( entry != noEntry )
+        {
+            uint32_t nextEntry = entries[ entry ].nextInSlot;
+            remove( entry );
+            entry = nextEntry;
+        }
+    }
+
+    void ReplayTimingWheel::cascade( size_t slot )
+    {
+        uint32_t entry = slots[ slot ];
+
+        slots[ slot ] = noEntry;
+        while ( entry != noEntry )
+        {
+            uint32_t nextEntry = entries[ entry ].nextInSlot;
+            // the entry was scheduled closer to time than its slot covers, it always fits lower
+            if ( ( entries[ entry ].exp <= time ) || !( schedule( entry ) ) )
+            {
+                remove( entry );
+            }
+            entry = nextEntry;
+        }
+    }
+
+    bool ReplayTimingWheel::schedule( uint32_t entry )
+    {
+        long exp = entries[ entry ].exp;
+        size_t slot = 0;
+
+        if ( ( exp - time ) < static_cast< long >( level0Slots ) )
+        {
+            slot = static_cast< size_t >( exp & ( level0Slots - 1 ) );
+        }
+        else
+        {
+            size_t level = 0;
+            while ( ( level < ( numLevels - 1 ) ) &&
+                ( ( ( exp >> levelShifts[ level ] ) - ( time >> levelShifts[ level ] ) ) >= static_cast< long >( levelSlots ) ) )
+            {
+                ++level;
+            }
+
+            if ( level == ( numLevels - 1 ) )
+            {
+                return false;
+            }
+
+            slot = level0Slots + ( level * levelSlots ) +
+                static_cast< size_t >( ( exp >> levelShifts[ level ] ) & ( levelSlots - 1 ) );
+        }
+
+        entries[ entry ].nextInSlot = slots[ slot ];
+        slots[ slot ] = entry;
+
+        return true;
+    }
+
+    void ReplayTimingWheel::remove( uint32_t entry )
+    {
+        uint32_t* link = &buckets[ entries[ entry ].hash & bucketMask ];
+
+        while ( *link != entry )
+        {
+            link = &entries[ *link ].nextInBucket;
+        }
+        *link = entries[ entry ].nextInBucket;
+
+        entries[ entry ].nextInBucket = freeEntries;
+        freeEntries = entry;
+        --numEntries;
+    }
+
+    JwtReplayGuard::Shard::Shard( size_t capacity, long now )
+        : mutex()
+        , wheel( capacity, now )
+    {
+    }
+
+    JwtReplayGuard::JwtReplayGuard( const LHWSUtilNS::JwtReplayGuardParams& _params )
+        : LHWSUtilNS::IJwtReplayGuard()
+        , params( _params )
+        , shards( new std::unique_ptr< Shard >[ numShards ] )
+    {
+        if ( params.maxEntries == 0 )
+        {
+            throw std::runtime_error( "replay guard needs maxEntries > 0" );
+        }
+
+        long now = std::chrono::duration_cast< std::chrono::seconds >(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+        size_t shardCapacity = ( params.maxEntries + numShards - 1 ) / numShards;
+        for ( size_t i = 0; i < numShards; ++i )
+        {
+            shards[ i ].reset( new Shard( shardCapacity, now ) );
+        }
+    }
+
+    JwtReplayGuard::~JwtReplayGuard()
+    {
+    }
+
+    LHWSUtilNS::JwtReplayCheck JwtReplayGuard::CheckAndRecord( const char* iss, size_t issSize,
+        const char* jti, size_t jtiSize,
+        long exp, long now )
+    {
+        if ( ( exp <= now ) || ( ( exp - now ) > params.maxLifetimeSeconds ) )
+        {
+            return LHWSUtilNS::JwtReplayCheck::Unrecorded;
+        }
+
+        // issSize separates iss from jti, so that iss "ab" jti "c" is not iss "a" jti "bc"
+        uint64_t hash = ExtendKeyHash( keyHashSeed, iss, issSize );
+        hash = ExtendKeyHash( hash, reinterpret_cast< const char* >( &issSize ), sizeof( issSize ) );
+        hash = FinishKeyHash( ExtendKeyHash( hash, jti, jtiSize ) );
+        // the wheel's buckets use the low bits
+        Shard& shard = *shards[ hash >> 58 ];
+
+        std::lock_guard< std::mutex > shardLock( shard.mutex );
+        shard.wheel.Advance( now );
+
+        return shard.wheel.Insert( hash, exp );
+    }
+
+    LHWSUtilNS::JwtReplayFailMode JwtReplayGuard::GetFailMode() const
+    {
+        return params.failMode;
+    }
+
+    size_t JwtReplayGuard::NumEntries() const
+    {
+        size_t numEntries = 0;
+
+        for ( size_t i = 0; i < numShards; ++i )
+        {
+            std::lock_guard< std::mutex > shardLock( shards[ i ]->mutex );
+            numEntries += shards[ i ]->wheel.NumEntries();
+        }
+
+        return numEntries;
+    }
+}
@@ -0,0 +1,344 @@
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <lhwsutil/ijwtrevocationlist.h>
+#include <lhwsutil/logging.h>
+
+namespace LHWSUtilNS
+{
+    namespace
+    {
+        const size_t feedReadBytes = 16 * 1024;
+        const long feedExpireEverySeconds = 60;
+
+        bool lineIs( const char* line, size_t lineSize, const char* word )
+        {
+            size_t wordSize = std::strlen( word );
+
+            while ( ( lineSize > 0 ) && ( ( line[ lineSize - 1 ] == ' ' ) ||
+                ( line[ lineSize - 1 ] == '\t' ) || ( line[ lineSize - 1 ] == '\r' ) ) )
+            {
+                --lineSize;
+            }
+
+            return ( lineSize == wordSize ) && ( std::memcmp( line, word, wordSize ) == 0 );
+        }
+    }
+
+    JwtRevocationFeed::JwtRevocationFeed( const std::shared_ptr< IJwtRevocationList >& _revocationList )
+    :   revocationList( _revocationList )
+    ,   path()
+    ,   isSocket( false )
+    ,   fd( -1 )
+    ,   fileDev( 0 )
+    ,   fileIno( 0 )
+    ,   fileOffset( 0 )
+    ,   pendingLine()
+    ,   inBulkReload( false )
+    ,   fileReloadPending( false )
+    ,   bulkRevocations()
+    ,   numInvalidLines( 0 )
+    ,   lastExpiredAt( 0 )
+    {
+    }
+
+    JwtRevocationFeed::~JwtRevocationFeed()
+    {
+        closeSource();
+    }
+
+    int JwtRevocationFeed::TailFile( const std::string& _path )
+    {
+        closeSource();
+        path = _path;
+        isSocket = false;
+
+        return openFile();
+    }
+
+    int JwtRevocationFeed::ConnectUnixSocket( const std::string& _path )
+    {
+        closeSource();
+        path = _path;
+        isSocket = true;
+
+        return connectSocket();
+    }
+
+    int JwtRevocationFeed::Poll( int timeoutMs )
+    {
+        wsUtilLogSetScope( "JwtRevocationFeed::Poll" );
+        char buffer[ feedReadBytes ];
+        ssize_t numRead = 0;
+
+        if ( path.empty() )
+        {
+            return 1;
+        }
+
+        long now = std::chrono::duration_cast< std::chrono::seconds >(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+        if ( ( now - lastExpiredAt ) >= feedExpireEverySeconds )
+        {
+            revocationList->Expire( now );
+            lastExpiredAt = now;
+        }
+
+        if ( ( fd < 0 ) && ( ( isSocket ? connectSocket() : openFile() ) != 0 ) )
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( timeoutMs ) );
+            return 2;
+        }
+
+        if ( isSocket )
+        {
+            struct pollfd pollFd;
+            pollFd.fd = fd;
+            pollFd.events = POLLIN;
+            pollFd.revents = 0;
+
+            int rc = poll( &pollFd, 1, timeoutMs );
+            if ( rc <= 0 )
+            {
+                return ( ( rc == 0 ) || ( errno == EINTR ) ) ? 0 : 3;
+            }
+
+            numRead = read( fd, buffer, sizeof( buffer ) );
+            if ( numRead <= 0 )
+            {
+                if ( ( numRead < 0 ) && ( errno == EINTR ) )
+                {
+                    return 0;
+                }
+
+                wsUtilLogInfo( "revocation socket[" << path << "] closed" );
+                closeSource();
+                return 4;
+            }
+
+            consume( buffer, numRead );
+
+            return 0;
+        }
+
+        struct stat pathStat;
+        if ( ( stat( path.c_str(), &pathStat ) == 0 ) &&
+            ( ( static_cast< unsigned long long >( pathStat.st_dev ) != fileDev ) ||
+              ( static_cast< unsigned long long >( pathStat.st_ino ) != fileIno ) ) )
+        {
+            wsUtilLogInfo( "revocation file[" << path << "] was replaced, reloading" );
+            closeSource();
+            if ( openFile() != 0 )
+            {
+                return 2;
+            }
+        }
+
+        struct stat fdStat;
+        if ( ( fstat( fd, &fdStat ) == 0 ) && ( fdStat.st_size < fileOffset ) )
+        {
+            wsUtilLogInfo( "revocation file[" << path << "] was truncated, reloading" );
+            closeSource();
+            if ( openFile() != 0 )
+            {
+                return 2;
+            }
+        }
+
+        bool readAny = false;
+        while ( ( numRead = read( fd, buffer, sizeof( buffer ) ) ) > 0 )
+        {
+            fileOffset += numRead;
+            consume( buffer, numRead );
+            readAny = true;
+        }
+
+        if ( numRead < 0 )
+        {
+            wsUtilLogError( "failed to read revocation file[" << path << "], errno=" << errno );
+            closeSource();
+            return 3;
+        }
+
+        // the whole file read from its start replaces the revocations
+        if ( fileReloadPending )
+        {
+            revocationList->Reload( bulkRevocations );
+            bulkRevocations.clear();
+            inBulkReload = false;
+            fileReloadPending = false;
+        }
+
+        if ( !( readAny ) )
+        {
+            std::this_thread::sleep_for( std::chrono::milliseconds( timeoutMs ) );
+        }
+
+        return 0;
+    }
+
+    size_t JwtRevocationFeed::NumInvalidLines() const
+    {
+        return numInvalidLines;
+    }
+
+    void JwtRevocationFeed::closeSource()
+    {
+        if ( fd >= 0 )
+        {
+            close( fd );
+            fd = -1;
+        }
+
+        // a partial line or reload cannot be completed from a new source
+        pendingLine.clear();
+        inBulkReload = false;
+        fileReloadPending = false;
+        bulkRevocations.clear();
+    }
+
+    int JwtRevocationFeed::openFile()
+    {
+        wsUtilLogSetScope( "JwtRevocationFeed::openFile" );
+        struct stat fdStat;
+
+        fd = open( path.c_str(), O_RDONLY | O_CLOEXEC );
+        if ( fd < 0 )
+        {
+            wsUtilLogError( "failed to open revocation file[" << path << "], errno=" << errno );
+            return 1;
+        }
+
+        if ( fstat( fd, &fdStat ) != 0 )
+        {
+            wsUtilLogError( "failed to stat revocation file[" << path << "], errno=" << errno );
+            closeSource();
+            return 2;
+        }
+
+        fileDev = static_cast< unsigned long long >( fdStat.st_dev );
+        fileIno = static_cast< unsigned long long >( fdStat.st_ino );
+        fileOffset = 0;
+        inBulkReload = true;
+        fileReloadPending = true;
+
+        return 0;
+    }
+
+    int JwtRevocationFeed::connectSocket()
+    {
+        wsUtilLogSetScope( "JwtRevocationFeed::connectSocket" );
+        struct sockaddr_un address;
+
+        if ( path.size() >= sizeof( address.sun_path ) )
+        {
+            wsUtilLogError( "revocation socket path[" << path << "] is too long" );
+            return 1;
+        }
+
+        std::memset( &address, 0, sizeof( address ) );
+        address.sun_family = AF_UNIX;
+        std::memcpy( address.sun_path, path.c_str(), path.size() );
+
+        fd = socket( AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0 );
+        if ( fd < 0 )
+        {
+            wsUtilLogError( "failed to create socket, errno=" << errno );
+            return 2;
+        }
+
+        if ( connect( fd, reinterpret_cast< struct sockaddr* >( &address ), sizeof( address ) ) != 0 )
+        {
+            wsUtilLogError( "failed to connect to revocation socket[" << path << "], errno=" << errno );
+            closeSource();
+            return 3;
+        }
+
+        return 0;
+    }
+
+    void JwtRevocationFeed::consume( const char* data, size_t dataSize )
+    {
+        const char* end = data + dataSize;
+
+        while ( data < end )
+        {
+            const char* lineEnd = static_cast< const char* >( std::memchr( data, '\n', end - data ) );
+            if ( !( lineEnd ) )
+            {
+                pendingLine.append( data, end - data );
+                return;
+            }
+
+            if ( pendingLine.empty() )
+            {
+                applyLine( data, lineEnd - data );
+            }
+            else
+            {
+                pendingLine.append( data, lineEnd - data );
+                applyLine( pendingLine.data(), pendingLine.size() );
+                pendingLine.clear();
+            }
+
+            data = lineEnd + 1;
+        }
+    }
+
+    void JwtRevocationFeed::applyLine( const char* line, size_t lineSize )
+    {
+        wsUtilLogSetScope( "JwtRevocationFeed::applyLine" );
+        // keeps its capacity between lines
+        thread_local JwtRevocation revocation;
+
+        if ( lineIs( line, lineSize, "begin" ) )
+        {
+            inBulkReload = true;
+            bulkRevocations.clear();
+            return;
+        }
+
+        if ( lineIs( line, lineSize, "end" ) )
+        {
+            if ( inBulkReload )
+            {
+                revocationList->Reload( bulkRevocations );
+                bulkRevocations.clear();
+                inBulkReload = false;
+                fileReloadPending = false;
+            }
+            return;
+        }
+
+        int rc = ParseJwtRevocation( line, lineSize, revocation );
+        if ( rc == 1 )
+        {
+            return;
+        }
+
+        if ( rc != 0 )
+        {
+            wsUtilLogError( "invalid revocation[" << std::string( line, lineSize ) << "], rc=" << rc );
+            ++numInvalidLines;
+            return;
+        }
+
+        if ( inBulkReload )
+        {
+            bulkRevocations.push_back( revocation );
+        }
+        else
+        {
+            revocationList->Revoke( revocation );
+        }
+    }
+}
@@ -0,0 +1,301 @@
+#include <lhwsutil/ijwtrevocationlist.h>
+#include <lhwsutil/logging.h>
+
+#include <lhwsutil_impl/jwtrevocationlist.h>
+#include <lhwsutil_impl/keyhash.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace LHWSUtilNS
+{
+    std::shared_ptr< IJwtRevocationList > GetStandardJwtRevocationList( size_t expectedRevocations )
+    {
+        return std::make_shared< LHWSUtilImplNS::JwtRevocationList >( expectedRevocations );
+    }
+}
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        // shared by every list so that a thread's cached set can never be mistaken for another's
+        std::atomic< uint64_t > nextRevocationSetGeneration( 1 );
+
+        long secondsSinceEpoch()
+        {
+            return std::chrono::duration_cast< std::chrono::seconds >(
+                std::chrono::system_clock::now().time_since_epoch() ).count();
+        }
+
+        char claimKeyPrefix( LHWSUtilNS::JwtRevocationClaim claim )
+        {
+            return static_cast< char >( '0' + static_cast< int >( claim ) );
+        }
+    }
+
+    RevocationBloomFilter::RevocationBloomFilter( size_t _capacity )
+        : capacity( std::max< size_t >( _capacity, 1 ) )
+        , numBlocks( ( ( capacity * bitsPerKey ) + ( 64 * wordsPerBlock ) - 1 ) / ( 64 * wordsPerBlock ) )
+        , words( new std::atomic< uint64_t >[ numBlocks * wordsPerBlock ] )
+    {
+        for ( size_t i = 0; i < ( numBlocks * wordsPerBlock ); ++i )
+        {
+            words[ i ].store( 0, std::memory_order_relaxed );
+        }
+    }
+
+    void RevocationBloomFilter::Add( uint64_t hash )
+    {
+        std::atomic< uint64_t >* block = &words[ ( ( hash >> 32 ) % numBlocks ) * wordsPerBlock ];
+        uint64_t bits = hash * 0x9E3779B97F4A7C15ULL;
+
+        for ( size_t i = 0; i < wordsPerBlock; ++i )
+        {
+            block[ i ].fetch_or( static_cast< uint64_t >( 1 ) << ( ( bits >> ( 16 + ( 6 * i ) ) ) & 63 ),
+                std::memory_order_relaxed );
+        }
+    }
+
+    bool RevocationBloomFilter::MayContain( uint64_t hash ) const
+    {
+        const std::atomic< uint64_t >* block = &words[ ( ( hash >> 32 ) % numBlocks ) * wordsPerBlock ];
+        uint64_t bits = hash * 0x9E3779B97F4A7C15ULL;
+
+        for ( size_t i = 0; i < wordsPerBlock; ++i )
+        {
+            uint64_t bit = static_cast< uint64_t >( 1 ) << ( ( bits >> ( 16 + ( 6 * i ) ) ) & 63 );
+            if ( !( block[ i ].load( std::memory_order_relaxed ) & bit ) )
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    size_t RevocationBloomFilter::GetCapacity() const
+    {
+        return capacity;
+    }
+
+    uint64_t HashRevocation( LHWSUtilNS::JwtRevocationClaim claim, const char* value, size_t valueSize )
+    {
+        char prefix = claimKeyPrefix( claim );
+
+        return FinishKeyHash( ExtendKeyHash( ExtendKeyHash( keyHashSeed, &prefix, 1 ), value, valueSize ) );
+    }
+
+    JwtRevocationList::RevocationSet::RevocationSet( size_t capacity )
+        : filter( capacity )
+        , shards()
+        , numRevocations( 0 )
+        , numStaleInFilter( 0 )
+    {
+    }
+
+    JwtRevocationList::JwtRevocationList( size_t _expectedRevocations )
+        : LHWSUtilNS::IJwtRevocationList()
+        , expectedRevocations( std::max< size_t >( _expectedRevocations, 1 ) )
+        , writeMutex()
+        , currentSetMutex()
+        , currentSet( std::make_shared< RevocationSet >( expectedRevocations ) )
+        , generation( nextRevocationSetGeneration.fetch_add( 1 ) )
+    {
+    }
+
+    JwtRevocationList::~JwtRevocationList()
+    {
+    }
+
+    void JwtRevocationList::Revoke( const LHWSUtilNS::JwtRevocation& revocation )
+    {
+        // as in Reload, a revocation past its exp revokes nothing and would only wait for Expire
+        if ( revocation.value.empty() || ( revocation.exp <= secondsSinceEpoch() ) )
+        {
+            return;
+        }
+
+        std::lock_guard< std::mutex > writeLock( writeMutex );
+
+        if ( currentSet->numRevocations >= currentSet->filter.GetCapacity() )
+        {
+            wsUtilLogInfo( "growing revocation filter past "
+                << currentSet->filter.GetCapacity() << " revocations" );
+            replaceSet( rebuild( *currentSet,
+                std::max( expectedRevocations, 2 * currentSet->numRevocations ),
+                secondsSinceEpoch() ) );
+        }
+
+        insert( *currentSet, revocation );
+    }
+
+    void JwtRevocationList::Reload( const std::vector< LHWSUtilNS::JwtRevocation >& revocations )
+    {
+        long now = secondsSinceEpoch();
+        std::shared_ptr< RevocationSet > revocationSet(
+            std::make_shared< RevocationSet >( std::max( expectedRevocations, revocations.size() ) ) );
+
+        for ( const LHWSUtilNS::JwtRevocation& revocation : revocations )
+        {
+            if ( !( revocation.value.empty() ) && ( revocation.exp > now ) )
+            {
+                insert( *revocationSet, revocation );
+            }
+        }
+
+        std::lock_guard< std::mutex > writeLock( writeMutex );
+        replaceSet( revocationSet );
+    }
+
+    size_t JwtRevocationList::Expire( long now )
+    {
+        std::lock_guard< std::mutex > writeLock( writeMutex );
+        size_t numExpired = 0;
+
+        for ( Shard& shard : currentSet->shards )
+        {
+            std::lock_guard< std::mutex > shardLock( shard.mutex );
+            for ( auto it = shard.revocations.begin(); it != shard.revocations.end(); )
+            {
+                if ( it->second <= now )
+                {
+                    it = shard.revocations.erase( it );
+                    ++numExpired;
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        currentSet->numRevocations -= numExpired;
+        currentSet->numStaleInFilter += numExpired;
+
+        // the filter's false positives grow with its stale bits, rebuild once they outnumber the
+        // live revocations
+        if ( currentSet->numStaleInFilter > currentSet->numRevocations )
+        {
+            replaceSet( rebuild( *currentSet,
+                std::max( expectedRevocations, currentSet->numRevocations ),
+                now ) );
+        }
+
+        return numExpired;
+    }
+
+    size_t JwtRevocationList::NumRevocations() const
+    {
+        std::lock_guard< std::mutex > writeLock( writeMutex );
+
+        return currentSet->numRevocations;
+    }
+
+    bool JwtRevocationList::IsRevoked( LHWSUtilNS::JwtRevocationClaim claim,
+        const char* value,
+        size_t valueSize,
+        long now ) const
+    {
+        // keeps its capacity between calls
+        thread_local std::string key;
+
+        if ( !( value ) || ( valueSize == 0 ) )
+        {
+            return false;
+        }
+
+        RevocationSet& revocationSet = acquireSet();
+        uint64_t hash = HashRevocation( claim, value, valueSize );
+        if ( !( revocationSet.filter.MayContain( hash ) ) )
+        {
+            return false;
+        }
+
+        key.assign( 1, claimKeyPrefix( claim ) ).append( value, valueSize );
+
+        Shard& shard = revocationSet.shards[ hash % numShards ];
+        std::lock_guard< std::mutex > shardLock( shard.mutex );
+        auto it = shard.revocations.find( key );
+
+        return ( it != shard.revocations.end() ) && ( it->second > now );
+    }
+
+    JwtRevocationList::RevocationSet& JwtRevocationList::acquireSet() const
+    {
+        // the thread keeps the set it last used alive, so the common case is one atomic load
+        // rather than a shared_ptr copy whose reference count every thread would contend on
+        thread_local std::shared_ptr< RevocationSet > cachedSet;
+        thread_local uint64_t cachedGeneration = 0;
+
+        uint64_t currentGeneration = generation.load( std::memory_order_acquire );
+        if ( currentGeneration != cachedGeneration )
+        {
+            std::lock_guard< std::mutex > currentSetLock( currentSetMutex );
+            cachedSet = currentSet;
+            cachedGeneration = generation.load( std::memory_order_relaxed );
+        }
+
+        return *cachedSet;
+    }
+
+    void JwtRevocationList::replaceSet( const std::shared_ptr< RevocationSet >& revocationSet )
+    {
+        std::lock_guard< std::mutex > currentSetLock( currentSetMutex );
+
+        currentSet = revocationSet;
+        generation.store( nextRevocationSetGeneration.fetch_add( 1 ), std::memory_order_release );
+    }
+
+    bool JwtRevocationList::insert( RevocationSet& revocationSet, const LHWSUtilNS::JwtRevocation& revocation )
+    {
+        std::string key( 1, claimKeyPrefix( revocation.claim ) );
+        key.append( revocation.value );
+        uint64_t hash = HashRevocation( revocation.claim, revocation.value.data(), revocation.value.size() );
+
+        // filter first so that once in the set the revocation is never hidden by the filter
+        revocationSet.filter.Add( hash );
+
+        Shard& shard = revocationSet.shards[ hash % numShards ];
+        std::lock_guard< std::mutex > shardLock( shard.mutex );
+        auto inserted = shard.revocations.emplace( std::move( key ), revocation.exp );
+        if ( !( inserted.second ) )
+        {
+            inserted.first->second = std::max( inserted.first->second, revocation.exp );
+            return false;
+        }
+
+        ++revocationSet.numRevocations;
+
+        return true;
+    }
+
+    std::shared_ptr< JwtRevocationList::RevocationSet > JwtRevocationList::rebuild( RevocationSet& revocationSet,
+        size_t capacity,
+        long now )
+    {
+        std::shared_ptr< RevocationSet > rebuiltSet( std::make_shared< RevocationSet >( capacity ) );
+
+        for ( Shard& shard : revocationSet.shards )
+        {
+            std::lock_guard< std::mutex > shardLock( shard.mutex );
+            for ( const auto& revocation : shard.revocations )
+            {
+                if ( revocation.second <= now )
+                {
+                    continue;
+                }
+
+                uint64_t hash = HashRevocation(
+                    static_cast< LHWSUtilNS::JwtRevocationClaim >( revocation.first[ 0 ] - '0' ),
+                    revocation.first.data() + 1,
+                    revocation.first.size() - 1 );
+                rebuiltSet->filter.Add( hash );
+                rebuiltSet->shards[ hash % numShards ].revocations.emplace( revocation.first, revocation.second );
+                ++rebuiltSet->numRevocations;
+            }
+        }
+
+        return rebuiltSet;
+    }
+}
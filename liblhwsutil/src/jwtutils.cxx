@@ -35,10 +35,12 @@ namespace LHWSUtilImplNS
             return 4;
         }
 
-        b64UrlEncodedHeaderOut = jwtStr.substr( 0, headerDelimiterPos );
-        b64UrlEncodedPayloadOut = jwtStr.substr( headerDelimiterPos + 1,
+        // assign rather than substr so the outputs' capacity is reused
+        b64UrlEncodedHeaderOut.assign( jwtStr, 0, headerDelimiterPos );
+        b64UrlEncodedPayloadOut.assign( jwtStr,
+            headerDelimiterPos + 1,
             payloadDelimiterPos - ( headerDelimiterPos + 1 ) );
-        b64UrlEncodedSignatureOut = jwtStr.substr( payloadDelimiterPos + 1 );
+        b64UrlEncodedSignatureOut.assign( jwtStr, payloadDelimiterPos + 1, std::string::npos );
 
         return 0;
     }
@@ -49,14 +51,18 @@ namespace LHWSUtilImplNS
         std::string& decodedPayloadOut )
     {
         int rc = 0;
-        std::vector< unsigned char > decodedHeaderData;
-        std::vector< unsigned char > decodedPayloadData;
+        // keep their capacity between calls
+        thread_local std::vector< unsigned char > decodedHeaderData;
+        thread_local std::vector< unsigned char > decodedPayloadData;
 
         if ( b64UrlEncodedHeader.empty() || b64UrlEncodedPayload.empty() )
         {
             return 1;
         }
 
+        decodedHeaderData.clear();
+        decodedPayloadData.clear();
+
         rc = LHSSLUtilNS::DecodeB64UrlStr( b64UrlEncodedHeader, decodedHeaderData );
         if ( rc != 0 )
         {
@@ -82,9 +88,10 @@ namespace LHWSUtilImplNS
         std::string& decodedPayloadOut,
         std::string& b64UrlEncodedSignatureOut )
     {
-        std::string b64UrlEncodedHeader;
-        std::string b64UrlEncodedPayload;
-        std::string b64UrlEncodedSignature;
+        // keep their capacity between calls
+        thread_local std::string b64UrlEncodedHeader;
+        thread_local std::string b64UrlEncodedPayload;
+        thread_local std::string b64UrlEncodedSignature;
         int rc = 0;
 
         rc = DecomposeJwtStr( jwtStr,
@@ -105,7 +112,7 @@ namespace LHWSUtilImplNS
             return 2;
         }
 
-        b64UrlEncodedSignatureOut = std::move( b64UrlEncodedSignature );
+        b64UrlEncodedSignatureOut.assign( b64UrlEncodedSignature );
 
         return 0;
     }
@@ -161,11 +168,11 @@ namespace LHWSUtilImplNS
         rc = WriteOutRSAPubKeyComponentsAsPEM( nBytes, eBytes, rsaPublicKeyPEMStr );
         if ( rc != 0 || rsaPublicKeyPEMStr.empty() )
         {
-            wsUtilLogError( "failed to write out pem, rc=" << rc << ", pem=[" << rsaPublicKeyPEMStr << "]" );
+            wsUtilLogError( "failed to write out pem, rc=" << rc << ", pem=[" << LHWSUtilNS::LogPayload( rsaPublicKeyPEMStr ) << "]" );
             return 4;
         }
 
-        wsUtilLogTrace( "n=[" << nStr << "], e=[" << eStr << "], pem=[" << rsaPublicKeyPEMStr << "]" );
+        wsUtilLogTrace( "n=[" << nStr << "], e=[" << eStr << "], pem=[" << LHWSUtilNS::LogPayload( rsaPublicKeyPEMStr ) << "]" );
 
         keyStrOut = std::move( rsaPublicKeyPEMStr );
 
@@ -176,7 +183,9 @@ namespace LHWSUtilImplNS
     {
         wsUtilLogSetScope( "FillKeyStrFromJwkJson" );
 
-        if ( alg == "RS256" || alg == "RS384" || alg == "RS512" )
+        // a PSx key is an RSA key like an RSx one, only its signature padding differs
+        if ( alg == "RS256" || alg == "RS384" || alg == "RS512" ||
+             alg == "PS256" || alg == "PS384" || alg == "PS512" )
         {
             return FillRSxKeyFromJwkJson( key, keyStrOut );
         }
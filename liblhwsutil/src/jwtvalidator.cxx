@@ -7,6 +7,8 @@
 #include <rapidjson/writer.h>
 #include <rapidjson/stringbuffer.h>
 
+#include <chrono>
+#include <cstring>
 #include <memory>
 #include <stdexcept>
 #include <unordered_map>
@@ -15,11 +17,23 @@
 
 #include <lhwsutil/ijwtvalidator.h>
 #include <lhwsutil/ijwtissuercache.h>
+#include <lhwsutil/ijwtrevocationlist.h>
+#include <lhwsutil/isharedjwtcache.h>
 #include <lhwsutil/isimplehttpclient.h>
 #include <lhwsutil/logging.h>
+#include <lhwsutil/metrics.h>
+#include <lhwsutil/staticjwtvalidator.h>
 
 #include <lhwsutil_impl/jwtvalidator.h>
+#include <lhwsutil_impl/claimpath.h>
+#include <lhwsutil_impl/claimprojection.h>
+#include <lhwsutil_impl/jwtchecks.h>
+#include <lhwsutil_impl/jwtpolicy.h>
 #include <lhwsutil_impl/jwtutils.h>
+#include <lhwsutil_impl/latencyhistogram.h>
+#include <lhwsutil_impl/metricsregistry.h>
+#include <lhwsutil_impl/probes.h>
+#include <lhwsutil_impl/validationarena.h>
 
 namespace LHWSUtilNS
 {
@@ -33,7 +47,264 @@ namespace LHWSUtilImplNS
 {
     namespace
     {
-        int getKeyForJwt( const jwt_t* jwtIn, jwt_key_t* keyOut )
+        // for validations not made by a JwtValidator
+        const LHWSUtilNS::JwtValidationChecks& defaultValidationChecks()
+        {
+            static const LHWSUtilNS::JwtValidationChecks checks;
+
+            return checks;
+        }
+
+        // records a single validation when it goes out of scope, an unset result is an error
+        class JwtValidationRecorder
+        {
+            public:
+                JwtValidationRecorder( LHWSUtilNS::JwtValidationMethod _method );
+                ~JwtValidationRecorder();
+
+                JwtValidationRecorder( const JwtValidationRecorder& other ) = delete;
+                JwtValidationRecorder& operator=( const JwtValidationRecorder& other ) = delete;
+
+                LHWSUtilNS::JwtValidationMethod method;
+                LHWSUtilNS::JwtValidationResult result;
+                LHWSUtilNS::JwtValidationStage stage;
+                size_t issuerIndex;
+                size_t algIndex;
+                // read and set by getKeyForJwt, libjwt gives the callback no user data
+                const LHWSUtilNS::JwtPolicy* policy;
+                // the token's payload, parsed by the validator for getKeyForJwt to evaluate policy on
+                const rapidjson::Value* payloadJson;
+                bool policyDenied;
+                bool revoked;
+                // read by getKeyForJwt and getStaticKeyForJwt, never null
+                const LHWSUtilNS::JwtValidationChecks* checks;
+                // set by the key callbacks, see CheckJwtFields
+                int checkRc;
+                // the validator's, checked once the token passed every other check
+                LHWSUtilNS::IJwtReplayGuard* replayGuard;
+                // read by getStaticKeyForJwt, null terminated, null or empty => any issuer
+                const char* const* allowedIssuers;
+                bool keyLookedUp;
+                int keyLookupRc;
+                // set by the key callbacks, libjwt verifies with the issuer's key pem after they return
+                // so the issuer is held until jwt_decode_2 does, even if the cache evicts it meanwhile
+                std::shared_ptr< LHWSUtilNS::IJwtIssuer > keyIssuer;
+
+            private:
+                std::chrono::steady_clock::time_point start;
+        };
+
+        JwtValidationRecorder::JwtValidationRecorder( LHWSUtilNS::JwtValidationMethod _method )
+            : method( _method )
+            , result( LHWSUtilNS::JwtValidationResult::Error )
+            , stage( LHWSUtilNS::JwtValidationStage::Decode )
+            , issuerIndex( otherMetricsIssuer )
+            , algIndex( otherMetricsAlg )
+            , policy( nullptr )
+            , payloadJson( nullptr )
+            , policyDenied( false )
+            , revoked( false )
+            , checks( &defaultValidationChecks() )
+            , checkRc( 0 )
+            , replayGuard( nullptr )
+            , allowedIssuers( nullptr )
+            , keyLookedUp( false )
+            , keyLookupRc( 0 )
+            , keyIssuer()
+            , start( std::chrono::steady_clock::now() )
+        {
+        }
+
+        JwtValidationRecorder::~JwtValidationRecorder()
+        {
+            uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start ).count();
+
+            RecordJwtValidation( method, result, stage, issuerIndex, algIndex, micros );
+            LHWSUTIL_PROBE4( validate_exit,
+                static_cast<int>( method ),
+                static_cast<int>( result ),
+                static_cast<int>( stage ),
+                micros );
+        }
+
+        thread_local JwtValidationRecorder* currentValidationRecorder = nullptr;
+
+        // whether jti or sid, either may be null, is in the IJwtRevocationList singleton if one is set
+        bool jwtIsRevoked( const char* jti, size_t jtiSize, const char* sid, size_t sidSize )
+        {
+            auto revocationList(
+                LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtRevocationList >::GetInstance() );
+            if ( !( revocationList ) )
+            {
+                return false;
+            }
+
+            long now = std::chrono::duration_cast< std::chrono::seconds >(
+                std::chrono::system_clock::now().time_since_epoch() ).count();
+
+            return revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Jti, jti, jtiSize, now ) ||
+                revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Sid, sid, sidSize, now );
+        }
+
+        // as above for the claims libjwt parsed, flagging currentValidationRecorder
+        bool jwtIsRevoked( const jwt_t* jwtIn )
+        {
+            jwt_t* jwt = const_cast<jwt_t*>( jwtIn );
+            const char* jti = jwt_get_grant( jwt, "jti" );
+            const char* sid = jwt_get_grant( jwt, "sid" );
+
+            if ( !( jwtIsRevoked( jti, jti ? std::strlen( jti ) : 0, sid, sid ? std::strlen( sid ) : 0 ) ) )
+            {
+                return false;
+            }
+
+            if ( currentValidationRecorder )
+            {
+                currentValidationRecorder->revoked = true;
+            }
+
+            return true;
+        }
+
+        // as jwtIsRevoked( jti, ... ) for the claims of a parsed payload
+        bool jwtIsRevoked( const rapidjson::Value& payloadJson )
+        {
+            rapidjson::Value::ConstMemberIterator jti = payloadJson.FindMember( "jti" );
+            rapidjson::Value::ConstMemberIterator sid = payloadJson.FindMember( "sid" );
+            bool hasJti = ( jti != payloadJson.MemberEnd() ) && jti->value.IsString();
+            bool hasSid = ( sid != payloadJson.MemberEnd() ) && sid->value.IsString();
+
+            return jwtIsRevoked( hasJti ? jti->value.GetString() : nullptr,
+                hasJti ? jti->value.GetStringLength() : 0,
+                hasSid ? sid->value.GetString() : nullptr,
+                hasSid ? sid->value.GetStringLength() : 0 );
+        }
+
+        // libjwt offers the claims it parsed only by serializing them again, so those read as a
+        // document are parsed from the token here, once per validation
+        // return 0 if the payload was decoded and parsed into payloadJson
+        template< typename Document >
+        int parseJwtPayload( const std::string& b64UrlEncodedJwt, Document& payloadJson )
+        {
+            // keep their capacity between calls
+            thread_local std::string decodedHeaderJsonStr;
+            thread_local std::string decodedPayloadJsonStr;
+            thread_local std::string b64UrlEncodedSignature;
+
+            int rc = DecomposeAndDecodeJwtStr( b64UrlEncodedJwt,
+                decodedHeaderJsonStr,
+                decodedPayloadJsonStr,
+                b64UrlEncodedSignature );
+            if ( rc != 0 )
+            {
+                return rc;
+            }
+
+            payloadJson.Parse( decodedPayloadJsonStr.c_str(), decodedPayloadJsonStr.size() );
+            if ( payloadJson.HasParseError() || !( payloadJson.IsObject() ) )
+            {
+                return 10;
+            }
+
+            return 0;
+        }
+
+        void getJwtTimeClaim( jwt_t* jwt, const char* name, JwtTimeClaim& timeClaim )
+        {
+            errno = 0;
+            timeClaim.value = jwt_get_grant_int( jwt, name );
+            timeClaim.present = ( errno != ENOENT );
+            timeClaim.valid = ( errno == 0 );
+        }
+
+        // whether the token libjwt parsed fails currentValidationRecorder's checks, flagging it if so
+        bool jwtFailsChecks( const jwt_t* jwtIn )
+        {
+            if ( !( currentValidationRecorder ) )
+            {
+                return false;
+            }
+
+            const LHWSUtilNS::JwtValidationChecks& checks( *currentValidationRecorder->checks );
+            jwt_t* jwt = const_cast<jwt_t*>( jwtIn );
+            JwtCheckedFields fields;
+            rapidjson::Value audStr;
+            // only an array aud is parsed again
+            std::unique_ptr< rapidjson::Document > audJson;
+
+            fields.alg = jwt_alg_str( jwt_get_alg( jwtIn ) );
+            fields.kid = jwt_get_header( jwt, "kid" );
+            fields.iss = jwt_get_grant( jwt, "iss" );
+            fields.issSize = fields.iss ? std::strlen( fields.iss ) : 0;
+            getJwtTimeClaim( jwt, "exp", fields.exp );
+            getJwtTimeClaim( jwt, "nbf", fields.nbf );
+
+            if ( !( checks.audiences.empty() ) )
+            {
+                const char* aud = jwt_get_grant( jwt, "aud" );
+                char* audJsonStr = aud ? nullptr : jwt_get_grants_json( jwt, "aud" );
+
+                if ( aud )
+                {
+                    audStr.SetString( rapidjson::StringRef( aud ) );
+                    fields.aud = &audStr;
+                }
+                else if ( audJsonStr )
+                {
+                    audJson.reset( new rapidjson::Document() );
+                    audJson->Parse( audJsonStr );
+                    jwt_free_str( audJsonStr );
+                    if ( !( audJson->HasParseError() ) )
+                    {
+                        fields.aud = audJson.get();
+                    }
+                }
+            }
+
+            long now = std::chrono::duration_cast< std::chrono::seconds >(
+                std::chrono::system_clock::now().time_since_epoch() ).count();
+            currentValidationRecorder->checkRc = CheckJwtFields( fields, checks, now );
+
+            return ( currentValidationRecorder->checkRc != 0 );
+        }
+
+        // return true if the token may be accepted by recorder.replayGuard, otherwise set recorder.result
+        bool checkReplay( const char* iss, size_t issSize,
+                          const char* jti, size_t jtiSize,
+                          bool hasExp, long exp,
+                          JwtValidationRecorder& recorder )
+        {
+            if ( !( jti ) || ( jtiSize == 0 ) || !( hasExp ) )
+            {
+                wsUtilLogInfo( "one-time token without jti or exp" );
+                recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
+                return false;
+            }
+
+            long now = std::chrono::duration_cast< std::chrono::seconds >(
+                std::chrono::system_clock::now().time_since_epoch() ).count();
+            switch ( recorder.replayGuard->CheckAndRecord( iss, issSize, jti, jtiSize, exp, now ) )
+            {
+                case LHWSUtilNS::JwtReplayCheck::First:
+                    return true;
+                case LHWSUtilNS::JwtReplayCheck::Replayed:
+                    wsUtilLogInfo( "replayed jti[" << std::string( jti, jtiSize ) << "]" );
+                    recorder.result = LHWSUtilNS::JwtValidationResult::Replayed;
+                    return false;
+                default:
+                    if ( recorder.replayGuard->GetFailMode() == LHWSUtilNS::JwtReplayFailMode::Open )
+                    {
+                        wsUtilLogInfo( "accepting unrecorded jti[" << std::string( jti, jtiSize ) << "]" );
+                        return true;
+                    }
+                    wsUtilLogError( "rejecting unrecorded jti[" << std::string( jti, jtiSize ) << "]" );
+                    recorder.result = LHWSUtilNS::JwtValidationResult::Error;
+                    return false;
+            }
+        }
+
+        int findKeyForJwt( const jwt_t* jwtIn, jwt_key_t* keyOut )
         {
             wsUtilLogSetScope( "getKeyForJwt" );
 
@@ -46,7 +317,9 @@ namespace LHWSUtilImplNS
                 // accept non-const wtf
                 ValidJwt jwt( const_cast<jwt_t*>( jwtIn ), false );
                 int rc = 0;
-                std::string iss;
+                // keep their capacity between calls
+                thread_local std::string iss;
+                thread_local std::string alg;
 
                 rc = jwt.GetGrantStrValue( "iss", iss );
                 if ( rc || iss.empty() )
@@ -57,13 +330,19 @@ namespace LHWSUtilImplNS
 
                 jwt_alg_t jwtAlgType = jwt_get_alg( jwtIn );
                 const char* jwtAlg( jwt_alg_str( jwtAlgType ) );
+                if ( currentValidationRecorder )
+                {
+                    currentValidationRecorder->issuerIndex = GetMetricsRegistry().IssuerIndex( iss );
+                    currentValidationRecorder->algIndex = MetricsAlgIndex( jwtAlg );
+                }
+
                 if ( !( jwtAlg ) )
                 {
                     wsUtilLogError( "invalid 'alg'" );
                     return 2;
                 }
 
-                std::string alg( jwtAlg );
+                alg.assign( jwtAlg );
 
                 auto jwtIssuerCache(
                     LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::GetInstance() );
@@ -80,12 +359,19 @@ namespace LHWSUtilImplNS
                     return 4;
                 }
 
-                const std::string& keyPem( jwtIssuer->GetKeyPemForAlg( alg ) );
+                if ( !( currentValidationRecorder ) )
+                {
+                    wsUtilLogError( "no validation to hold issuer[" << iss << "] while verifying" );
+                    return 9;
+                }
+
+                LHWSUtilNS::JwtIssuerStr keyPem( jwtIssuer->GetKeyPemForAlgView( alg ) );
 
-                wsUtilLogTrace( "using key=[" << keyPem << "]" );
+                wsUtilLogTrace( "using key=[" << LHWSUtilNS::LogPayload( keyPem.data, keyPem.size ) << "]" );
 
-                keyOut->jwt_key = reinterpret_cast<const unsigned char*>( keyPem.c_str() );
-                keyOut->jwt_key_len = keyPem.size();
+                keyOut->jwt_key = reinterpret_cast<const unsigned char*>( keyPem.data );
+                keyOut->jwt_key_len = keyPem.size;
+                currentValidationRecorder->keyIssuer = std::move( jwtIssuer );
 
                 return 0;
             }
@@ -100,12 +386,642 @@ namespace LHWSUtilImplNS
                 return -2;
             }
         }
+
+        int getKeyForJwt( const jwt_t* jwtIn, jwt_key_t* keyOut )
+        {
+            // 8 => failed a JwtValidationChecks check, the cheapest to make so made first
+            if ( jwtFailsChecks( jwtIn ) )
+            {
+                return 8;
+            }
+
+            // libjwt has parsed the claims but not yet verified the signature, a denial here skips
+            // the key lookup and verification
+            if ( currentValidationRecorder && currentValidationRecorder->policy )
+            {
+                if ( !( currentValidationRecorder->payloadJson ) ||
+                    ( EvaluateJwtPolicy( *currentValidationRecorder->policy, *currentValidationRecorder->payloadJson ) !=
+                        LHWSUtilNS::JwtPolicyDecision::Allow ) )
+                {
+                    currentValidationRecorder->policyDenied = true;
+                    return 5;
+                }
+            }
+
+            // 7 => revoked, skipping the key lookup and verification as well
+            if ( jwtIsRevoked( jwtIn ) )
+            {
+                return 7;
+            }
+
+            int rc = findKeyForJwt( jwtIn, keyOut );
+
+            if ( currentValidationRecorder )
+            {
+                currentValidationRecorder->keyLookedUp = true;
+                currentValidationRecorder->keyLookupRc = rc;
+            }
+
+            return rc;
+        }
+
+        // libjwt's alg for each LHWSUtilNS::JwtAlg
+        constexpr jwt_alg_t jwtAlgs[] =
+        {
+            JWT_ALG_HS256,
+            JWT_ALG_HS384,
+            JWT_ALG_HS512,
+            JWT_ALG_RS256,
+            JWT_ALG_RS384,
+            JWT_ALG_RS512,
+            JWT_ALG_ES256,
+            JWT_ALG_ES384,
+            JWT_ALG_ES512
+        };
+
+        // findKeyForJwt for a validator fixed to Alg, the alg is compared as a constant and the
+        // issuer's key fetched without building an alg string per call
+        template< LHWSUtilNS::JwtAlg Alg >
+        int findStaticKeyForJwt( const jwt_t* jwtIn, jwt_key_t* keyOut )
+        {
+            wsUtilLogSetScope( "getStaticKeyForJwt" );
+
+            static const std::string alg( LHWSUtilNS::JwtAlgName( Alg ) );
+            static const size_t algIndex = MetricsAlgIndex( alg.c_str() );
+
+            try
+            {
+                // keeps its capacity between calls
+                thread_local std::string iss;
+
+                if ( currentValidationRecorder )
+                {
+                    currentValidationRecorder->algIndex = algIndex;
+                }
+
+                if ( jwt_get_alg( jwtIn ) != jwtAlgs[ static_cast< size_t >( Alg ) ] )
+                {
+                    wsUtilLogError( "alg is not " << alg );
+                    return 2;
+                }
+
+                const char* jwtIss = jwt_get_grant( const_cast<jwt_t*>( jwtIn ), "iss" );
+                if ( !( jwtIss ) || !( *jwtIss ) )
+                {
+                    wsUtilLogError( "missing 'iss'" );
+                    return 1;
+                }
+
+                iss.assign( jwtIss );
+                if ( currentValidationRecorder )
+                {
+                    currentValidationRecorder->issuerIndex = GetMetricsRegistry().IssuerIndex( iss );
+
+                    const char* const* allowedIssuer = currentValidationRecorder->allowedIssuers;
+                    if ( allowedIssuer && *allowedIssuer )
+                    {
+                        while ( *allowedIssuer && ( iss != *allowedIssuer ) )
+                        {
+                            ++allowedIssuer;
+                        }
+
+                        if ( !( *allowedIssuer ) )
+                        {
+                            // 6 => the issuer is not accepted by this validator
+                            wsUtilLogError( "issuer[" << iss << "] is not allowed" );
+                            return 6;
+                        }
+                    }
+                }
+
+                auto jwtIssuerCache(
+                    LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::GetInstance() );
+                if ( !jwtIssuerCache )
+                {
+                    wsUtilLogError( "failed to fetch issuer cache" );
+                    return 3;
+                }
+
+                auto jwtIssuer = jwtIssuerCache->GetIssuer( iss );
+                if ( !( jwtIssuer ) )
+                {
+                    wsUtilLogError( "failed to get issuer[" << iss << "]" );
+                    return 6;
+                }
+
+                if ( !( currentValidationRecorder ) )
+                {
+                    wsUtilLogError( "no validation to hold issuer[" << iss << "] while verifying" );
+                    return 9;
+                }
+
+                // throws if the issuer has no key for alg, saving the separate AlgIsSupported lookup
+                LHWSUtilNS::JwtIssuerStr keyPem( jwtIssuer->GetKeyPemForAlgView( alg ) );
+
+                keyOut->jwt_key = reinterpret_cast<const unsigned char*>( keyPem.data );
+                keyOut->jwt_key_len = keyPem.size;
+                currentValidationRecorder->keyIssuer = std::move( jwtIssuer );
+
+                return 0;
+            }
+            catch ( const std::exception& e )
+            {
+                wsUtilLogError( "exception e=[" << e.what() << "]" );
+                return 4;
+            }
+            catch ( ... )
+            {
+                wsUtilLogError( "unknown exception" );
+                return -2;
+            }
+        }
+
+        template< LHWSUtilNS::JwtAlg Alg >
+        int getStaticKeyForJwt( const jwt_t* jwtIn, jwt_key_t* keyOut )
+        {
+            if ( jwtFailsChecks( jwtIn ) )
+            {
+                return 8;
+            }
+
+            if ( jwtIsRevoked( jwtIn ) )
+            {
+                return 7;
+            }
+
+            int rc = findStaticKeyForJwt< Alg >( jwtIn, keyOut );
+
+            if ( currentValidationRecorder )
+            {
+                currentValidationRecorder->keyLookedUp = true;
+                currentValidationRecorder->keyLookupRc = rc;
+            }
+
+            return rc;
+        }
+
+        // return the verified jwt, nullptr with recorder.result set if it is invalid or denied
+        // a payload parsed for the policy is parsed into payloadJsonOut, if given, for the caller to keep
+        jwt_t* decodeAndVerifyJwt( const std::string& b64UrlEncodedJwt,
+            JwtValidationRecorder& recorder,
+            jwt_key_p_t keyProvider = &getKeyForJwt,
+            rapidjson::Document* payloadJsonOut = nullptr )
+        {
+            int rc = 0;
+            jwt_t* jwt = nullptr;
+
+            if ( b64UrlEncodedJwt.empty() )
+            {
+                wsUtilLogFatal( "jwt is empty" );
+                recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
+                return nullptr;
+            }
+
+            rc = CheckJwtShape( b64UrlEncodedJwt, *recorder.checks );
+            if ( rc != 0 )
+            {
+                wsUtilLogInfo( "malformed jwt, rc=" << rc );
+                recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
+                return nullptr;
+            }
+
+            // the policy is evaluated on the parsed payload unless the caller parsed it already
+            ValidationArenaScope arenaScope;
+            ValidationArena& arena( arenaScope.GetArena() );
+            ArenaDocument payloadJson( &arena.GetAllocator(), arenaParseStackCapacity, &arena.GetStackAllocator() );
+            if ( recorder.policy && !( recorder.payloadJson ) )
+            {
+                rc = payloadJsonOut ?
+                    parseJwtPayload( b64UrlEncodedJwt, *payloadJsonOut ) :
+                    parseJwtPayload( b64UrlEncodedJwt, payloadJson );
+                if ( rc != 0 )
+                {
+                    wsUtilLogInfo( "malformed payload, rc=" << rc );
+                    recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
+                    return nullptr;
+                }
+                recorder.payloadJson = payloadJsonOut ?
+                    static_cast< const rapidjson::Value* >( payloadJsonOut ) : &payloadJson;
+            }
+
+            // libjwt decodes, calls getKeyForJwt and verifies in one go
+            LHWSUtilNS::TraceScope decodeAndVerifySpan( "decode_and_verify" );
+            currentValidationRecorder = &recorder;
+            rc = jwt_decode_2( &jwt, b64UrlEncodedJwt.c_str(), keyProvider );
+            currentValidationRecorder = nullptr;
+            // the key is no longer needed once verified
+            recorder.keyIssuer.reset();
+            if ( ( recorder.payloadJson == &payloadJson ) || ( recorder.payloadJson == payloadJsonOut ) )
+            {
+                recorder.payloadJson = nullptr;
+            }
+            decodeAndVerifySpan.End();
+
+            if ( recorder.keyLookedUp )
+            {
+                recorder.stage = ( recorder.keyLookupRc == 0 ) ?
+                    LHWSUtilNS::JwtValidationStage::Verify : LHWSUtilNS::JwtValidationStage::KeyLookup;
+            }
+
+            if ( recorder.checkRc != 0 )
+            {
+                wsUtilLogInfo( "failed validation checks, rc=" << recorder.checkRc );
+                recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
+
+                return nullptr;
+            }
+
+            if ( recorder.policyDenied )
+            {
+                wsUtilLogInfo( "denied by policy" );
+                recorder.result = LHWSUtilNS::JwtValidationResult::Denied;
+
+                return nullptr;
+            }
+
+            if ( recorder.revoked )
+            {
+                wsUtilLogInfo( "revoked" );
+                recorder.result = LHWSUtilNS::JwtValidationResult::Revoked;
+
+                return nullptr;
+            }
+
+            if ( rc != 0 )
+            {
+                wsUtilLogInfo( "failed to decode, rc=" << rc );
+
+                // 3 => no issuer cache, nothing to do with the token
+                recorder.result = ( recorder.keyLookupRc == 3 ) ?
+                    LHWSUtilNS::JwtValidationResult::Error : LHWSUtilNS::JwtValidationResult::Invalid;
+
+                return nullptr;
+            }
+
+            if ( recorder.replayGuard )
+            {
+                const char* iss = jwt_get_grant( jwt, "iss" );
+                const char* jti = jwt_get_grant( jwt, "jti" );
+                errno = 0;
+                long exp = jwt_get_grant_int( jwt, "exp" );
+                bool hasExp = ( errno == 0 );
+
+                if ( !( checkReplay( iss, iss ? std::strlen( iss ) : 0,
+                        jti, jti ? std::strlen( jti ) : 0,
+                        hasExp, exp,
+                        recorder ) ) )
+                {
+                    jwt_free( jwt );
+                    return nullptr;
+                }
+            }
+
+            recorder.result = LHWSUtilNS::JwtValidationResult::Valid;
+
+            return jwt;
+        }
+
+        // projects a claim libjwt has no typed accessor for, a list or a null, from its serialized
+        // value, the only way libjwt offers it
+        // return 0 if set or null ( absent ), 1 if it has the wrong type
+        int projectSerializedJwtClaim( jwt_t* jwt,
+            const LHWSUtilNS::ClaimProjectionBase& projection,
+            void* claims,
+            size_t index,
+            bool& projectedOut )
+        {
+            const std::string& name( projection.GetClaimName( index ) );
+            char* claimJsonStr = jwt_get_grants_json( jwt, name.c_str() );
+            ValidationArenaScope arenaScope;
+            ValidationArena& arena( arenaScope.GetArena() );
+            ArenaDocument claimJson( &arena.GetAllocator(), arenaParseStackCapacity, &arena.GetStackAllocator() );
+
+            if ( !( claimJsonStr ) )
+            {
+                return 1;
+            }
+            claimJson.Parse( claimJsonStr );
+            jwt_free_str( claimJsonStr );
+
+            if ( claimJson.HasParseError() )
+            {
+                return 1;
+            }
+
+            if ( claimJson.IsNull() )
+            {
+                projectedOut = false;
+                return 0;
+            }
+
+            if ( ( projection.GetClaimType( index ) != LHWSUtilNS::ClaimType::StringList ) || !( claimJson.IsArray() ) )
+            {
+                return 1;
+            }
+
+            projection.ClearList( claims, index );
+            for ( auto element = claimJson.Begin(); element != claimJson.End(); ++element )
+            {
+                if ( element->IsString() )
+                {
+                    projection.AppendToList( claims, index, element->GetString(), element->GetStringLength() );
+                }
+            }
+            projectedOut = true;
+
+            return 0;
+        }
+
+        // ProjectClaims over the claims libjwt decoded while verifying, rather than decoding the
+        // payload a second time, each claim is read through libjwt's typed accessors
+        // return 0 if every required claim of projection was set
+        // return 1 if a projected claim has the wrong type, 2 if a required claim is missing
+        int projectJwtClaims( jwt_t* jwt, const LHWSUtilNS::ClaimProjectionBase& projection, void* claims )
+        {
+            for ( size_t index = 0; index < projection.NumClaims(); ++index )
+            {
+                const std::string& name( projection.GetClaimName( index ) );
+                bool projected = true;
+                const char* str = nullptr;
+                long intValue = 0;
+                int boolValue = 0;
+                // libjwt's errno, ENOENT => absent, EINVAL => of another type
+                int claimErrno = 0;
+
+                errno = 0;
+                switch ( projection.GetClaimType( index ) )
+                {
+                    case LHWSUtilNS::ClaimType::String:
+                        str = jwt_get_grant( jwt, name.c_str() );
+                        claimErrno = errno;
+                        if ( str )
+                        {
+                            projection.SetString( claims, index, str, std::strlen( str ) );
+                        }
+                        break;
+                    case LHWSUtilNS::ClaimType::Bool:
+                        boolValue = jwt_get_grant_bool( jwt, name.c_str() );
+                        claimErrno = errno;
+                        if ( claimErrno == 0 )
+                        {
+                            projection.SetBool( claims, index, boolValue != 0 );
+                        }
+                        break;
+                    case LHWSUtilNS::ClaimType::Int:
+                        intValue = jwt_get_grant_int( jwt, name.c_str() );
+                        claimErrno = errno;
+                        if ( claimErrno == 0 )
+                        {
+                            projection.SetInt( claims, index, intValue );
+                        }
+                        break;
+                    case LHWSUtilNS::ClaimType::StringList:
+                        str = jwt_get_grant( jwt, name.c_str() );
+                        claimErrno = errno;
+                        if ( str )
+                        {
+                            projection.ClearList( claims, index );
+                            size_t strSize = std::strlen( str );
+                            for ( const char* tokenStart = str; tokenStart < str + strSize; )
+                            {
+                                const char* tokenEnd = static_cast< const char* >(
+                                    std::memchr( tokenStart, ' ', str + strSize - tokenStart ) );
+                                if ( !( tokenEnd ) )
+                                {
+                                    tokenEnd = str + strSize;
+                                }
+
+                                if ( tokenEnd > tokenStart )
+                                {
+                                    projection.AppendToList( claims, index, tokenStart, tokenEnd - tokenStart );
+                                }
+                                tokenStart = tokenEnd + 1;
+                            }
+                        }
+                        break;
+                }
+
+                if ( claimErrno == ENOENT )
+                {
+                    projected = false;
+                }
+                else if ( ( claimErrno != 0 ) &&
+                    ( projectSerializedJwtClaim( jwt, projection, claims, index, projected ) != 0 ) )
+                {
+                    wsUtilLogError( "claim [" << name << "] has the wrong type" );
+                    return 1;
+                }
+
+                if ( !( projected ) && projection.ClaimIsRequired( index ) )
+                {
+                    wsUtilLogError( "missing claim [" << name << "]" );
+                    return 2;
+                }
+            }
+
+            return 0;
+        }
+
+        // return 0 if the jwt is valid and was projected into claims
+        // return 1 if it is invalid, 2 if a projected claim is missing or has the wrong type
+        // recorder.result is set either way
+        int verifyAndProjectClaims( const std::string& b64UrlEncodedJwt,
+            const LHWSUtilNS::ClaimProjectionBase& projection,
+            void* claims,
+            JwtValidationRecorder& recorder,
+            jwt_key_p_t keyProvider = &getKeyForJwt )
+        {
+            jwt_t* jwt = decodeAndVerifyJwt( b64UrlEncodedJwt, recorder, keyProvider );
+            if ( !( jwt ) )
+            {
+                return 1;
+            }
+
+            wsUtilTraceSpan( "project" );
+            int rc = projectJwtClaims( jwt, projection, claims );
+            jwt_free( jwt );
+            if ( rc != 0 )
+            {
+                recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
+                return 2;
+            }
+
+            return 0;
+        }
+
+        // posts b64UrlEncodedJwt to the introspection_endpoint of iss, setting recorder.stage as it goes
+        // return 0 and set activeOut from the response, !=0 on an error
+        int postIntrospection( const std::string& b64UrlEncodedJwt,
+            const std::string& iss,
+            const LHWSUtilNS::JwtIntrospectionParams& params,
+            LHWSUtilNS::ISimpleHttpClient& simpleHttpClient,
+            ValidationArena& arena,
+            JwtValidationRecorder& recorder,
+            bool& activeOut )
+        {
+            // keep their capacity between calls, headers keeps its keys and only its values change
+            thread_local std::unordered_map< std::string, std::string > headers;
+            thread_local std::string postData;
+            thread_local std::string responseBody;
+            thread_local std::string introspectionEndpoint;
+            int rc = 0;
+
+            recorder.stage = LHWSUtilNS::JwtValidationStage::KeyLookup;
+
+            LHWSUtilNS::TraceScope keyLookupSpan( "key_lookup" );
+            auto jwtIssuerCache(
+                LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::GetInstance() );
+            if ( !jwtIssuerCache )
+            {
+                wsUtilLogError( "failed to get jwtIssuerCache" );
+
+                return 1;
+            }
+
+            auto jwtIssuer = jwtIssuerCache->GetIssuer( iss );
+            if ( !( jwtIssuer ) )
+            {
+                wsUtilLogError( "failed to get issuer[" << iss << "]" );
+
+                return 1;
+            }
+
+            if ( jwtIssuer->GetIntrospectionEndpoint().empty() )
+            {
+                wsUtilLogError( "missing introspection_endpoint for issuer[" << iss << "]" );
+
+                return 1;
+            }
+
+            if ( jwtIssuer->GetClientAuthzBearerTokenView().empty() )
+            {
+                wsUtilLogError( "missing bearer token for issuer[" << iss << "]" );
+
+                return 1;
+            }
+
+            introspectionEndpoint.assign( jwtIssuer->GetIntrospectionEndpoint().data,
+                jwtIssuer->GetIntrospectionEndpoint().size );
+            keyLookupSpan.End();
+
+            LHWSUtilNS::JwtIssuerStr clientAuthzBearerToken( jwtIssuer->GetClientAuthzBearerTokenView() );
+            wsUtilLogDebug( "using Bearer token[" << clientAuthzBearerToken.data << "]" );
+            headers[ "Authorization" ].assign( "Basic " ).append( clientAuthzBearerToken.data, clientAuthzBearerToken.size );
+            headers[ "Content-Type" ].assign( "application/x-www-form-urlencoded" );
+            headers[ "Accept" ].assign( "application/json" );
+            postData.assign( "token_type_hint=requesting_party_token&token=" ).append( b64UrlEncodedJwt );
+
+            LHWSUtilNS::HttpRequestParams httpRequestParams;
+            rc = FillIntrospectionRequestParams( params, httpRequestParams );
+            if ( rc != 0 )
+            {
+                wsUtilLogError( "deadline passed before posting to introspection_endpoint["
+                    << introspectionEndpoint << "]" );
+
+                return 1;
+            }
+
+            recorder.stage = LHWSUtilNS::JwtValidationStage::Introspect;
+            LHWSUtilNS::TraceScope httpSpan( "http" );
+            auto postStart( std::chrono::steady_clock::now() );
+            rc = simpleHttpClient.Post( introspectionEndpoint, postData, headers, httpRequestParams, responseBody );
+            httpSpan.End();
+            // failures and timeouts included, they are the slow tail the hedge is meant to cut
+            IntrospectionLatencies().Record( std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - postStart ).count() );
+            if ( rc != 0 )
+            {
+                wsUtilLogError( "failed to post to introspection_endpoint["
+                    << introspectionEndpoint << "], rc=" << rc );
+
+                return 1;
+            }
+
+            wsUtilTraceSpan( "parse" );
+            ArenaDocument responseJson( &arena.GetAllocator(), arenaParseStackCapacity, &arena.GetStackAllocator() );
+            rapidjson::ParseResult parsedOkay = responseJson.Parse( responseBody.c_str() );
+            if ( !( parsedOkay ) )
+            {
+                wsUtilLogError( "failed to parse introspection_endpoint response["
+                    << LHWSUtilNS::LogPayload( responseBody ) << "]" );
+
+                return 1;
+            }
+
+            if ( !( responseJson.HasMember( "active" ) && responseJson[ "active" ].IsBool() ) )
+            {
+                wsUtilLogError( "missing 'active' in introspection_endpoint response["
+                    << LHWSUtilNS::LogPayload( responseBody ) << "]" );
+
+                return 1;
+            }
+
+            activeOut = responseJson[ "active" ].GetBool();
+
+            return 0;
+        }
+    }
+
+    LatencyHistogram& IntrospectionLatencies()
+    {
+        static LatencyHistogram latencies;
+
+        return latencies;
+    }
+
+    int FillIntrospectionRequestParams( const LHWSUtilNS::JwtIntrospectionParams& params,
+        LHWSUtilNS::HttpRequestParams& httpRequestParams )
+    {
+        httpRequestParams.connectTimeoutMs = params.connectTimeoutMs;
+
+        if ( params.deadline != std::chrono::steady_clock::time_point::max() )
+        {
+            long remainingMs = static_cast<long>( std::chrono::duration_cast<std::chrono::milliseconds>(
+                params.deadline - std::chrono::steady_clock::now() ).count() );
+            if ( remainingMs <= 0 )
+            {
+                return 1;
+            }
+
+            httpRequestParams.timeoutMs = remainingMs;
+            if ( ( httpRequestParams.connectTimeoutMs <= 0 ) ||
+                ( httpRequestParams.connectTimeoutMs > remainingMs ) )
+            {
+                httpRequestParams.connectTimeoutMs = remainingMs;
+            }
+        }
+
+        if ( params.hedge && ( IntrospectionLatencies().GetCount() >= params.hedgeMinSamples ) )
+        {
+            long hedgeAfterMs = static_cast<long>(
+                IntrospectionLatencies().GetPercentileMicros( params.hedgePercentile ) / 1000 );
+            if ( hedgeAfterMs <= 0 )
+            {
+                hedgeAfterMs = 1;
+            }
+
+            // no point hedging if the hedge could not start before the deadline
+            if ( ( httpRequestParams.timeoutMs <= 0 ) || ( hedgeAfterMs < httpRequestParams.timeoutMs ) )
+            {
+                httpRequestParams.hedgeAfterMs = hedgeAfterMs;
+            }
+        }
+
+        return 0;
     }
 
     ValidJwt::ValidJwt( jwt_t** lpJwt )
+        : ValidJwt( lpJwt, std::unique_ptr< rapidjson::Document >() )
+    {
+    }
+
+    ValidJwt::ValidJwt( jwt_t** lpJwt, std::unique_ptr< rapidjson::Document >&& _claims )
         : LHWSUtilNS::IValidJwt()
         , jwt( nullptr )
         , owning( false )
+        , claimsGiven( _claims != nullptr )
+        , claimsParsed()
+        , claims( std::move( _claims ) )
     {
         if ( lpJwt && *lpJwt )
         {
@@ -123,6 +1039,9 @@ namespace LHWSUtilImplNS
         : LHWSUtilNS::IValidJwt()
         , jwt( nullptr )
         , owning( false )
+        , claimsGiven( false )
+        , claimsParsed()
+        , claims()
     {
         if ( _jwt )
         {
@@ -248,7 +1167,65 @@ namespace LHWSUtilImplNS
         return errno;
     }
 
+    const rapidjson::Value* ValidJwt::resolveClaim( const LHWSUtilNS::ClaimPath& path ) const
+    {
+        if ( !( claimsGiven ) )
+        {
+            std::call_once( claimsParsed, [ this ]()
+            {
+                char* grantsJson = jwt_get_grants_json( jwt, nullptr );
+                if ( grantsJson )
+                {
+                    claims.reset( new rapidjson::Document() );
+                    claims->Parse( grantsJson );
+                    jwt_free_str( grantsJson );
+                }
+            } );
+        }
+
+        if ( !( claims ) || claims->HasParseError() || !( claims->IsObject() ) )
+        {
+            return nullptr;
+        }
+
+        return ResolveClaimPath( *claims, path );
+    }
+
+    int ValidJwt::GetClaimStrValue( const LHWSUtilNS::ClaimPath& path,
+        std::string& valueOut ) const
+    {
+        return LHWSUtilImplNS::GetClaimStrValue( resolveClaim( path ), valueOut );
+    }
+
+    int ValidJwt::GetClaimBoolValue( const LHWSUtilNS::ClaimPath& path,
+        bool& valueOut ) const
+    {
+        return LHWSUtilImplNS::GetClaimBoolValue( resolveClaim( path ), valueOut );
+    }
+
+    int ValidJwt::GetClaimIntValue( const LHWSUtilNS::ClaimPath& path,
+        long& valueOut ) const
+    {
+        return LHWSUtilImplNS::GetClaimIntValue( resolveClaim( path ), valueOut );
+    }
+
+    int ValidJwt::ClaimArrayContains( const LHWSUtilNS::ClaimPath& path,
+        const std::string& value,
+        bool& containsOut ) const
+    {
+        return LHWSUtilImplNS::ClaimArrayContains( resolveClaim( path ), value, containsOut );
+    }
+
+    int ValidJwt::ForEachClaimStr( const LHWSUtilNS::ClaimPath& path,
+        const std::function< bool( const char* str, size_t strSize ) >& visitor ) const
+    {
+        return LHWSUtilImplNS::ForEachClaimStr( resolveClaim( path ), visitor );
+    }
+
     ValidJwtJson::ValidJwtJson( const rapidjson::Value& _jsonValue )
+        : LHWSUtilNS::IValidJwt()
+        , insituBuffer()
+        , jsonValue()
     {
         jsonValue.CopyFrom( _jsonValue, jsonValue.GetAllocator() );
         if ( !( jsonValue.IsObject() ) )
@@ -257,6 +1234,17 @@ namespace LHWSUtilImplNS
         }
     }
 
+    ValidJwtJson::ValidJwtJson( rapidjson::Document&& _jsonValue, std::unique_ptr< std::string >&& _insituBuffer )
+        : LHWSUtilNS::IValidJwt()
+        , insituBuffer( std::move( _insituBuffer ) )
+        , jsonValue( std::move( _jsonValue ) )
+    {
+        if ( !( jsonValue.IsObject() ) )
+        {
+            throw std::runtime_error( "json value is not a valid object" );
+        }
+    }
+
     ValidJwtJson::~ValidJwtJson()
     {
     }
@@ -369,51 +1357,192 @@ namespace LHWSUtilImplNS
         out.assign( buffer.GetString(), buffer.GetSize() );
     }
 
+    int ValidJwtJson::GetClaimStrValue( const LHWSUtilNS::ClaimPath& path,
+        std::string& valueOut ) const
+    {
+        return LHWSUtilImplNS::GetClaimStrValue( ResolveClaimPath( jsonValue, path ), valueOut );
+    }
+
+    int ValidJwtJson::GetClaimBoolValue( const LHWSUtilNS::ClaimPath& path,
+        bool& valueOut ) const
+    {
+        return LHWSUtilImplNS::GetClaimBoolValue( ResolveClaimPath( jsonValue, path ), valueOut );
+    }
+
+    int ValidJwtJson::GetClaimIntValue( const LHWSUtilNS::ClaimPath& path,
+        long& valueOut ) const
+    {
+        return LHWSUtilImplNS::GetClaimIntValue( ResolveClaimPath( jsonValue, path ), valueOut );
+    }
+
+    int ValidJwtJson::ClaimArrayContains( const LHWSUtilNS::ClaimPath& path,
+        const std::string& value,
+        bool& containsOut ) const
+    {
+        return LHWSUtilImplNS::ClaimArrayContains( ResolveClaimPath( jsonValue, path ), value, containsOut );
+    }
+
+    int ValidJwtJson::ForEachClaimStr( const LHWSUtilNS::ClaimPath& path,
+        const std::function< bool( const char* str, size_t strSize ) >& visitor ) const
+    {
+        return LHWSUtilImplNS::ForEachClaimStr( ResolveClaimPath( jsonValue, path ), visitor );
+    }
+
 
     JwtValidator::JwtValidator()
         : LHWSUtilNS::IJwtValidator()
+        , replayGuard()
+        , checks()
+    {
+    }
+
+    JwtValidator::JwtValidator( const LHWSUtilNS::JwtValidatorParams& params )
+        : LHWSUtilNS::IJwtValidator()
+        , replayGuard( params.replayGuard )
+        , checks( params.checks )
     {
     }
 
     std::unique_ptr< LHWSUtilNS::IValidJwt > JwtValidator::ValidateIntoJwt( const std::string& b64UrlEncodedJwt ) const
     {
-        wsUtilLogSetScope( "JwtValidator.ValidateIntoJwt" );
+        LHWSUtilNS::JwtPolicyDecision decision;
 
-        int rc = 0;
-        jwt_t* jwt = nullptr;
+        return validateIntoJwt( b64UrlEncodedJwt, nullptr, decision );
+    }
 
-        if ( b64UrlEncodedJwt.empty() )
+    std::unique_ptr< LHWSUtilNS::IValidJwt > JwtValidator::ValidateIntoJwt( const std::string& b64UrlEncodedJwt,
+        const LHWSUtilNS::JwtPolicy& policy,
+        LHWSUtilNS::JwtPolicyDecision& decision ) const
+    {
+        return validateIntoJwt( b64UrlEncodedJwt, &policy, decision );
+    }
+
+    std::unique_ptr< LHWSUtilNS::IValidJwt > JwtValidator::validateIntoJwt( const std::string& b64UrlEncodedJwt,
+        const LHWSUtilNS::JwtPolicy* policy,
+        LHWSUtilNS::JwtPolicyDecision& decision ) const
+    {
+        wsUtilLogSetScope( "JwtValidator.ValidateIntoJwt" );
+
+        LHWSUTIL_PROBE2( validate_entry,
+            static_cast<int>( LHWSUtilNS::JwtValidationMethod::ValidateIntoJwt ),
+            b64UrlEncodedJwt.size() );
+        JwtValidationRecorder recorder( LHWSUtilNS::JwtValidationMethod::ValidateIntoJwt );
+        recorder.policy = policy;
+        recorder.checks = &checks;
+        recorder.replayGuard = replayGuard.get();
+        decision = LHWSUtilNS::JwtPolicyDecision::Deny;
+
+        // the payload parsed to evaluate the policy on is kept by the returned jwt for its nested claims
+        std::unique_ptr< rapidjson::Document > payloadJson( policy ? new rapidjson::Document() : nullptr );
+        jwt_t* jwt = decodeAndVerifyJwt( b64UrlEncodedJwt, recorder, &getKeyForJwt, payloadJson.get() );
+        if ( !( jwt ) )
         {
-            wsUtilLogFatal( "jwt is empty" );
             return nullptr;
         }
 
-        rc = jwt_decode_2( &jwt, b64UrlEncodedJwt.c_str(), &getKeyForJwt );
-        if ( rc != 0 )
-        {
-            wsUtilLogInfo( "failed to decode, rc=" << rc );
+        decision = LHWSUtilNS::JwtPolicyDecision::Allow;
 
-            return nullptr;
+        return std::unique_ptr< LHWSUtilNS::IValidJwt >( new ValidJwt( &jwt, std::move( payloadJson ) ) );
+    }
+
+    int JwtValidator::validateIntoClaims( const std::string& b64UrlEncodedJwt,
+        const LHWSUtilNS::ClaimProjectionBase& projection,
+        void* claims ) const
+    {
+        wsUtilLogSetScope( "JwtValidator.ValidateIntoClaims" );
+
+        LHWSUTIL_PROBE2( validate_entry,
+            static_cast<int>( LHWSUtilNS::JwtValidationMethod::ValidateIntoJwt ),
+            b64UrlEncodedJwt.size() );
+        JwtValidationRecorder recorder( LHWSUtilNS::JwtValidationMethod::ValidateIntoJwt );
+        recorder.checks = &checks;
+        recorder.replayGuard = replayGuard.get();
+
+        return verifyAndProjectClaims( b64UrlEncodedJwt, projection, claims, recorder );
+    }
+
+    LHWSUtilNS::JwtValidationResult JwtValidator::ValidateIntoJwt( const std::string& b64UrlEncodedJwt,
+        LHWSUtilNS::ValidatedJwt& validatedJwt ) const
+    {
+        wsUtilLogSetScope( "JwtValidator.ValidateIntoJwt" );
+
+        LHWSUTIL_PROBE2( validate_entry,
+            static_cast<int>( LHWSUtilNS::JwtValidationMethod::ValidateIntoJwt ),
+            b64UrlEncodedJwt.size() );
+        JwtValidationRecorder recorder( LHWSUtilNS::JwtValidationMethod::ValidateIntoJwt );
+        recorder.checks = &checks;
+        recorder.replayGuard = replayGuard.get();
+
+        validatedJwt.Reset();
+        if ( verifyAndProjectClaims( b64UrlEncodedJwt,
+                LHWSUtilNS::ValidatedJwt::GetClaimProjection(),
+                &validatedJwt,
+                recorder ) != 0 )
+        {
+            validatedJwt.Reset();
         }
+        validatedJwt.setResult( recorder.result );
 
-        return std::unique_ptr< LHWSUtilNS::IValidJwt >( new ValidJwt( &jwt ) );
+        return recorder.result;
     }
 
     std::unique_ptr< LHWSUtilNS::IValidJwt > JwtValidator::IntrospectJwt( const std::string& b64UrlEncodedJwt ) const
     {
-        wsUtilLogSetScope( "JwtValidator.IntrospectJwt" );
+        LHWSUtilNS::JwtIntrospectionParams params;
+
+        return IntrospectJwt( b64UrlEncodedJwt, params );
+    }
+
+    std::unique_ptr< LHWSUtilNS::IValidJwt > JwtValidator::IntrospectJwt( const std::string& b64UrlEncodedJwt,
+        const LHWSUtilNS::JwtIntrospectionParams& params ) const
+    {
+        LHWSUtilNS::JwtPolicyDecision decision;
+
+        return introspectJwt( b64UrlEncodedJwt, params, nullptr, decision );
+    }
 
+    std::unique_ptr< LHWSUtilNS::IValidJwt > JwtValidator::IntrospectJwt( const std::string& b64UrlEncodedJwt,
+        const LHWSUtilNS::JwtIntrospectionParams& params,
+        const LHWSUtilNS::JwtPolicy& policy,
+        LHWSUtilNS::JwtPolicyDecision& decision ) const
+    {
+        return introspectJwt( b64UrlEncodedJwt, params, &policy, decision );
+    }
+
+    template< typename PayloadDocument >
+    LHWSUtilNS::JwtValidationResult JwtValidator::introspectIntoJson( const std::string& b64UrlEncodedJwt,
+        const LHWSUtilNS::JwtIntrospectionParams& params,
+        const LHWSUtilNS::JwtPolicy* policy,
+        LHWSUtilNS::JwtPolicyDecision& decision,
+        std::string& payloadBuffer,
+        PayloadDocument& payloadJson,
+        const LHWSUtilNS::ClaimProjectionBase* projection,
+        void* claims ) const
+    {
+        // keep their capacity between calls
+        thread_local std::string decodedHeaderJsonStr;
+        thread_local std::string b64UrlEncodedSignature;
+        thread_local std::string iss;
         int rc = 0;
-        std::string clientAuthzBearerToken;
-        std::unordered_map< std::string, std::string > headers;
-        std::string postData = "token_type_hint=requesting_party_token&token=" + b64UrlEncodedJwt;
-        std::string decodedHeaderJsonStr;
-        std::string decodedPayloadJsonStr;
-        std::string b64UrlEncodedSignature;
-        std::string iss;
-        std::string responseBody;
-        std::string introspectionEndpoint;
+        // the documents parsed below other than the payload are released together when this returns
+        ValidationArenaScope arenaScope;
+        ValidationArena& arena( arenaScope.GetArena() );
+        LHWSUTIL_PROBE2( validate_entry,
+            static_cast<int>( LHWSUtilNS::JwtValidationMethod::IntrospectJwt ),
+            b64UrlEncodedJwt.size() );
+        JwtValidationRecorder recorder( LHWSUtilNS::JwtValidationMethod::IntrospectJwt );
+        recorder.checks = &checks;
+        recorder.replayGuard = replayGuard.get();
+        decision = LHWSUtilNS::JwtPolicyDecision::Deny;
+
+        rc = CheckJwtShape( b64UrlEncodedJwt, checks );
+        if ( rc != 0 )
+        {
+            wsUtilLogInfo( "malformed jwt, rc=" << rc );
+            recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
 
+            return recorder.result;
+        }
 
         auto simpleHttpClientFactory(
             LHMiscUtilNS::Singleton< LHWSUtilNS::ISimpleHttpClientFactory >::GetInstance() );
@@ -421,7 +1550,7 @@ namespace LHWSUtilImplNS
         {
             wsUtilLogFatal( "failed to get simpleHttpClientFactory" );
 
-            return nullptr;
+            return recorder.result;
         }
 
         auto simpleHttpClient( simpleHttpClientFactory->CreateSimpleHttpClient() );
@@ -429,140 +1558,212 @@ namespace LHWSUtilImplNS
         {
             wsUtilLogFatal( "failed to create simpleHttpClient" );
 
-            return nullptr;
+            return recorder.result;
         }
 
+        LHWSUtilNS::TraceScope decodeSpan( "decode" );
         rc = DecomposeAndDecodeJwtStr( b64UrlEncodedJwt,
             decodedHeaderJsonStr,
-            decodedPayloadJsonStr,
+            payloadBuffer,
             b64UrlEncodedSignature );
         if ( rc != 0 )
         {
-            return nullptr;
+            recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
+
+            return recorder.result;
         }
 
-        rapidjson::Document headerJson;
+        ArenaDocument headerJson( &arena.GetAllocator(), arenaParseStackCapacity, &arena.GetStackAllocator() );
         rapidjson::ParseResult parsedOkay = headerJson.Parse( decodedHeaderJsonStr.c_str() );
         if ( !( parsedOkay ) )
         {
-            wsUtilLogError( "failed to parse header json[" << decodedHeaderJsonStr << "]" );
+            wsUtilLogError( "failed to parse header json[" << LHWSUtilNS::LogPayload( decodedHeaderJsonStr ) << "]" );
+            recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
 
-            return nullptr;
+            return recorder.result;
         }
 
-        rapidjson::Document payloadJson;
-        parsedOkay = payloadJson.Parse( decodedPayloadJsonStr.c_str() );
+        if ( headerJson.IsObject() && headerJson.HasMember( "alg" ) && headerJson[ "alg" ].IsString() )
+        {
+            recorder.algIndex = MetricsAlgIndex( headerJson[ "alg" ].GetString() );
+        }
+
+        parsedOkay = payloadJson.ParseInsitu( &payloadBuffer[ 0 ] );
         if ( !( parsedOkay ) )
         {
-            wsUtilLogError( "failed to parse payload json[" << decodedPayloadJsonStr << "]" );
+            wsUtilLogError( "failed to parse payload json of jwt["
+                << LHWSUtilNS::LogPayload( b64UrlEncodedJwt ) << "]" );
+            recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
 
-            return nullptr;
+            return recorder.result;
         }
 
         if ( !( payloadJson.IsObject() &&
             payloadJson.HasMember( "iss" ) &&
             payloadJson[ "iss" ].IsString() ) )
         {
-            wsUtilLogError( "iss missing or invalid in payload json[" << decodedPayloadJsonStr << "]" );
+            wsUtilLogError( "iss missing or invalid in payload json of jwt["
+                << LHWSUtilNS::LogPayload( b64UrlEncodedJwt ) << "]" );
+            recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
 
-            return nullptr;
+            return recorder.result;
         }
 
         iss.assign( payloadJson[ "iss" ].GetString(), payloadJson[ "iss" ].GetStringLength() );
+        recorder.issuerIndex = GetMetricsRegistry().IssuerIndex( iss );
 
-        auto jwtIssuerCache(
-            LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::GetInstance() );
-        if ( !jwtIssuerCache )
+        long now = std::chrono::duration_cast< std::chrono::seconds >(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+        JwtCheckedFields checkedFields;
+        GetJwtCheckedFields( headerJson, payloadJson, checkedFields );
+        rc = CheckJwtFields( checkedFields, checks, now );
+        if ( rc != 0 )
         {
-            wsUtilLogError( "failed to get jwtIssuerCache" );
+            wsUtilLogInfo( "failed validation checks, rc=" << rc );
+            recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
 
-            return nullptr;
+            return recorder.result;
         }
 
-        auto jwtIssuer = jwtIssuerCache->GetIssuer( iss );
-        if ( !( jwtIssuer ) )
+        // the returned jwt holds these same claims, deny before spending a round trip on the token
+        if ( policy && ( EvaluateJwtPolicy( *policy, payloadJson ) != LHWSUtilNS::JwtPolicyDecision::Allow ) )
         {
-            wsUtilLogError( "failed to get issuer[" << iss << "]" );
+            wsUtilLogInfo( "denied by policy" );
+            recorder.result = LHWSUtilNS::JwtValidationResult::Denied;
 
-            return nullptr;
+            return recorder.result;
         }
 
-        if ( jwtIssuer->GetOpenIdConfiguration().empty() )
+        if ( jwtIsRevoked( payloadJson ) )
         {
-            wsUtilLogError( "missing openid config for issuer[" << iss << "]" );
+            wsUtilLogInfo( "revoked" );
+            recorder.result = LHWSUtilNS::JwtValidationResult::Revoked;
 
-            return nullptr;
+            return recorder.result;
         }
 
-        if ( jwtIssuer->GetClientAuthzBearerToken().empty() )
+        decodeSpan.End();
+
+        // another worker process may have introspected the token already, see ISharedJwtCache
+        auto sharedJwtCache( LHMiscUtilNS::Singleton< LHWSUtilNS::ISharedJwtCache >::GetInstance() );
+        LHWSUtilNS::SharedJwtResult sharedResult( sharedJwtCache ?
+            sharedJwtCache->FindResult( b64UrlEncodedJwt, now ) : LHWSUtilNS::SharedJwtResult::Unknown );
+        if ( sharedResult == LHWSUtilNS::SharedJwtResult::Unknown )
         {
-            wsUtilLogError( "missing bearer token for issuer[" << iss << "]" );
+            bool active = false;
+            if ( postIntrospection( b64UrlEncodedJwt, iss, params, *simpleHttpClient, arena, recorder, active ) != 0 )
+            {
+                return recorder.result;
+            }
 
-            return nullptr;
+            if ( sharedJwtCache )
+            {
+                sharedJwtCache->RecordResult( b64UrlEncodedJwt,
+                    active,
+                    checkedFields.exp.valid ? checkedFields.exp.value : 0,
+                    now );
+            }
+            sharedResult = active ? LHWSUtilNS::SharedJwtResult::Active : LHWSUtilNS::SharedJwtResult::Inactive;
         }
 
-        rapidjson::Document openIdConfigurationJson;
-        parsedOkay = openIdConfigurationJson.Parse( jwtIssuer->GetOpenIdConfiguration().c_str() );
-        if ( !( parsedOkay ) )
+        if ( sharedResult == LHWSUtilNS::SharedJwtResult::Inactive )
         {
-            wsUtilLogError( "failed to parse openid config json["
-                << jwtIssuer->GetOpenIdConfiguration() << "]" );
+            wsUtilLogDebug( "token no longer active[" << LHWSUtilNS::LogPayload( b64UrlEncodedJwt ) << "]" );
+            recorder.result = LHWSUtilNS::JwtValidationResult::Inactive;
 
-            return nullptr;
+            return recorder.result;
+        }
+
+        if ( recorder.replayGuard )
+        {
+            rapidjson::Value::ConstMemberIterator iss = payloadJson.FindMember( "iss" );
+            rapidjson::Value::ConstMemberIterator jti = payloadJson.FindMember( "jti" );
+            rapidjson::Value::ConstMemberIterator exp = payloadJson.FindMember( "exp" );
+            bool hasIss = ( iss != payloadJson.MemberEnd() ) && iss->value.IsString();
+            bool hasJti = ( jti != payloadJson.MemberEnd() ) && jti->value.IsString();
+            bool hasExp = ( exp != payloadJson.MemberEnd() ) && exp->value.IsInt64();
+
+            if ( !( checkReplay( hasIss ? iss->value.GetString() : nullptr,
+                    hasIss ? iss->value.GetStringLength() : 0,
+                    hasJti ? jti->value.GetString() : nullptr,
+                    hasJti ? jti->value.GetStringLength() : 0,
+                    hasExp,
+                    hasExp ? static_cast< long >( exp->value.GetInt64() ) : 0,
+                    recorder ) ) )
+            {
+                return recorder.result;
+            }
         }
 
-        if ( !( openIdConfigurationJson.IsObject() &&
-            openIdConfigurationJson.HasMember( "introspection_endpoint" ) &&
-            openIdConfigurationJson[ "introspection_endpoint" ].IsString() ) )
+        if ( projection && ( ProjectClaims( payloadJson, *projection, claims ) != 0 ) )
         {
-            wsUtilLogError( "introspection_endpoint missing or invalid in openid config json["
-                << jwtIssuer->GetOpenIdConfiguration() << "]" );
+            recorder.result = LHWSUtilNS::JwtValidationResult::Invalid;
 
-            return nullptr;
+            return recorder.result;
         }
 
-        introspectionEndpoint.assign( openIdConfigurationJson[ "introspection_endpoint" ].GetString(),
-            openIdConfigurationJson[ "introspection_endpoint" ].GetStringLength() );
+        recorder.result = LHWSUtilNS::JwtValidationResult::Valid;
+        decision = LHWSUtilNS::JwtPolicyDecision::Allow;
 
-        wsUtilLogDebug( "using Bearer token[" << jwtIssuer->GetClientAuthzBearerToken() << "]" );
-        headers.emplace( "Authorization", "Basic " + jwtIssuer->GetClientAuthzBearerToken() );
-        headers.emplace( "Content-Type", "application/x-www-form-urlencoded" );
-        headers.emplace( "Accept", "application/json" );
+        return recorder.result;
+    }
 
-        rc = simpleHttpClient->Post( introspectionEndpoint, postData, headers, responseBody );
-        if ( rc != 0 )
-        {
-            wsUtilLogError( "failed to post to introspection_endpoint["
-                << introspectionEndpoint << "], rc=" << rc );
+    std::unique_ptr< LHWSUtilNS::IValidJwt > JwtValidator::introspectJwt( const std::string& b64UrlEncodedJwt,
+        const LHWSUtilNS::JwtIntrospectionParams& params,
+        const LHWSUtilNS::JwtPolicy* policy,
+        LHWSUtilNS::JwtPolicyDecision& decision ) const
+    {
+        wsUtilLogSetScope( "JwtValidator.IntrospectJwt" );
 
-            return nullptr;
-        }
+        // the payload is parsed in situ into a document handed to the returned jwt
+        std::unique_ptr< std::string > payloadBuffer( new std::string() );
+        rapidjson::Document payloadJson;
 
-        rapidjson::Document responseJson;
-        parsedOkay = responseJson.Parse( responseBody.c_str() );
-        if ( !( parsedOkay ) )
+        if ( introspectIntoJson( b64UrlEncodedJwt,
+                params,
+                policy,
+                decision,
+                *payloadBuffer,
+                payloadJson,
+                nullptr,
+                nullptr ) != LHWSUtilNS::JwtValidationResult::Valid )
         {
-            wsUtilLogError( "failed to parse introspection_endpoint response[" << responseBody << "]" );
-
             return nullptr;
         }
 
-        if ( !( responseJson.HasMember( "active" ) && responseJson[ "active" ].IsBool() ) )
-        {
-            wsUtilLogError( "missing 'active' in introspection_endpoint response[" << responseBody << "]" );
+        return std::unique_ptr< LHWSUtilNS::IValidJwt >(
+            new ValidJwtJson( std::move( payloadJson ), std::move( payloadBuffer ) ) );
+    }
 
-            return nullptr;
-        }
+    LHWSUtilNS::JwtValidationResult JwtValidator::IntrospectJwt( const std::string& b64UrlEncodedJwt,
+        const LHWSUtilNS::JwtIntrospectionParams& params,
+        LHWSUtilNS::ValidatedJwt& validatedJwt ) const
+    {
+        wsUtilLogSetScope( "JwtValidator.IntrospectJwt" );
 
-        if ( !( responseJson[ "active" ].GetBool() ) )
+        // keeps its capacity between calls, the payload only lives until it is projected
+        thread_local std::string payloadBuffer;
+        LHWSUtilNS::JwtPolicyDecision decision;
+        ValidationArenaScope arenaScope;
+        ValidationArena& arena( arenaScope.GetArena() );
+        ArenaDocument payloadJson( &arena.GetAllocator(), arenaParseStackCapacity, &arena.GetStackAllocator() );
+
+        validatedJwt.Reset();
+        LHWSUtilNS::JwtValidationResult result = introspectIntoJson( b64UrlEncodedJwt,
+            params,
+            nullptr,
+            decision,
+            payloadBuffer,
+            payloadJson,
+            &LHWSUtilNS::ValidatedJwt::GetClaimProjection(),
+            &validatedJwt );
+        if ( result != LHWSUtilNS::JwtValidationResult::Valid )
         {
-            wsUtilLogDebug( "token no longer active[" << b64UrlEncodedJwt << "]" );
-
-            return nullptr;
+            validatedJwt.Reset();
         }
+        validatedJwt.setResult( result );
 
-
-        return std::unique_ptr< LHWSUtilNS::IValidJwt >( new ValidJwtJson( payloadJson ) );
+        return result;
     }
 
     JwtValidatorFactory::JwtValidatorFactory()
@@ -578,4 +1779,105 @@ namespace LHWSUtilImplNS
     {
         return std::unique_ptr< LHWSUtilNS::IJwtValidator >( new JwtValidator() );
     }
+
+    std::unique_ptr< LHWSUtilNS::IJwtValidator > JwtValidatorFactory::CreateJwtValidator(
+        const LHWSUtilNS::JwtValidatorParams& params ) const
+    {
+        return std::unique_ptr< LHWSUtilNS::IJwtValidator >( new JwtValidator( params ) );
+    }
+}
+
+namespace LHWSUtilNS
+{
+    constexpr uint32_t RequiredClaims<>::strClaimMask;
+    constexpr uint32_t RequiredClaims<>::intClaimMask;
+
+    const char* JwtAlgName( JwtAlg alg )
+    {
+        static const char* const jwtAlgNames[] =
+        {
+            "HS256",
+            "HS384",
+            "HS512",
+            "RS256",
+            "RS384",
+            "RS512",
+            "ES256",
+            "ES384",
+            "ES512"
+        };
+
+        return jwtAlgNames[ static_cast< size_t >( alg ) ];
+    }
+
+    bool JwtAlgForName( const char* name, size_t nameSize, JwtAlg& algOut )
+    {
+        for ( size_t a = 0; a <= static_cast< size_t >( JwtAlg::ES512 ); ++a )
+        {
+            const char* algName = JwtAlgName( static_cast< JwtAlg >( a ) );
+            if ( ( std::strlen( algName ) == nameSize ) && ( std::memcmp( algName, name, nameSize ) == 0 ) )
+            {
+                algOut = static_cast< JwtAlg >( a );
+
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    template< JwtAlg Alg >
+    JwtValidationResult ValidateStaticJwt( const std::string& b64UrlEncodedJwt,
+        uint32_t requiredStrClaims,
+        uint32_t requiredIntClaims,
+        const char* const* allowedIssuers,
+        size_t numAllowedIssuers,
+        ValidatedJwt& validatedJwt )
+    {
+        wsUtilLogSetScope( "StaticJwtValidator.ValidateIntoJwt" );
+
+        LHWSUTIL_PROBE2( validate_entry,
+            static_cast<int>( JwtValidationMethod::ValidateIntoJwt ),
+            b64UrlEncodedJwt.size() );
+        LHWSUtilImplNS::JwtValidationRecorder recorder( JwtValidationMethod::ValidateIntoJwt );
+        recorder.allowedIssuers = ( numAllowedIssuers > 0 ) ? allowedIssuers : nullptr;
+
+        validatedJwt.Reset();
+        if ( LHWSUtilImplNS::verifyAndProjectClaims( b64UrlEncodedJwt,
+                ValidatedJwt::GetClaimProjection(),
+                &validatedJwt,
+                recorder,
+                &LHWSUtilImplNS::getStaticKeyForJwt< Alg > ) != 0 )
+        {
+            validatedJwt.Reset();
+        }
+        else if ( !( validatedJwt.HasClaims( requiredStrClaims, requiredIntClaims ) ) )
+        {
+            wsUtilLogInfo( "missing a required claim" );
+            recorder.result = JwtValidationResult::Invalid;
+            validatedJwt.Reset();
+        }
+        validatedJwt.setResult( recorder.result );
+
+        return recorder.result;
+    }
+
+    template JwtValidationResult ValidateStaticJwt< JwtAlg::HS256 >( const std::string&, uint32_t, uint32_t,
+        const char* const*, size_t, ValidatedJwt& );
+    template JwtValidationResult ValidateStaticJwt< JwtAlg::HS384 >( const std::string&, uint32_t, uint32_t,
+        const char* const*, size_t, ValidatedJwt& );
+    template JwtValidationResult ValidateStaticJwt< JwtAlg::HS512 >( const std::string&, uint32_t, uint32_t,
+        const char* const*, size_t, ValidatedJwt& );
+    template JwtValidationResult ValidateStaticJwt< JwtAlg::RS256 >( const std::string&, uint32_t, uint32_t,
+        const char* const*, size_t, ValidatedJwt& );
+    template JwtValidationResult ValidateStaticJwt< JwtAlg::RS384 >( const std::string&, uint32_t, uint32_t,
+        const char* const*, size_t, ValidatedJwt& );
+    template JwtValidationResult ValidateStaticJwt< JwtAlg::RS512 >( const std::string&, uint32_t, uint32_t,
+        const char* const*, size_t, ValidatedJwt& );
+    template JwtValidationResult ValidateStaticJwt< JwtAlg::ES256 >( const std::string&, uint32_t, uint32_t,
+        const char* const*, size_t, ValidatedJwt& );
+    template JwtValidationResult ValidateStaticJwt< JwtAlg::ES384 >( const std::string&, uint32_t, uint32_t,
+        const char* const*, size_t, ValidatedJwt& );
+    template JwtValidationResult ValidateStaticJwt< JwtAlg::ES512 >( const std::string&, uint32_t, uint32_t,
+        const char* const*, size_t, ValidatedJwt& );
 }
@@ -0,0 +1,101 @@
+#include <lhwsutil_impl/latencyhistogram.h>
+
+namespace LHWSUtilImplNS
+{
+    size_t LatencyBucketForMicros( uint64_t micros )
+    {
+        if ( micros < 4 )
+        {
+            return static_cast<size_t>( micros );
+        }
+
+        size_t msb = 63 - __builtin_clzll( micros );
+        size_t sub = static_cast<size_t>( micros >> ( msb - 2 ) ) & 3;
+        size_t bucket = ( msb - 1 ) * 4 + sub;
+
+        return ( bucket < numLatencyBuckets ) ? bucket : ( numLatencyBuckets - 1 );
+    }
+
+    uint64_t LatencyBucketUpperBoundMicros( size_t bucket )
+    {
+        if ( bucket < 4 )
+        {
+            return bucket + 1;
+        }
+
+        size_t msb = ( bucket / 4 ) + 1;
+        uint64_t sub = bucket % 4;
+        uint64_t lowerBound = ( 4 + sub ) << ( msb - 2 );
+
+        return lowerBound + ( static_cast<uint64_t>( 1 ) << ( msb - 2 ) );
+    }
+
+    LatencyHistogram::LatencyHistogram()
+        : count( 0 )
+    {
+        for ( size_t i = 0; i < numLatencyBuckets; ++i )
+        {
+            buckets[ i ].store( 0, std::memory_order_relaxed );
+        }
+    }
+
+    LatencyHistogram::~LatencyHistogram()
+    {
+    }
+
+    void LatencyHistogram::Record( uint64_t micros )
+    {
+        buckets[ LatencyBucketForMicros( micros ) ].fetch_add( 1, std::memory_order_relaxed );
+        count.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    void LatencyHistogram::Merge( const LatencyHistogram& other )
+    {
+        for ( size_t i = 0; i < numLatencyBuckets; ++i )
+        {
+            uint64_t n = other.buckets[ i ].load( std::memory_order_relaxed );
+            buckets[ i ].fetch_add( n, std::memory_order_relaxed );
+            count.fetch_add( n, std::memory_order_relaxed );
+        }
+    }
+
+    uint64_t LatencyHistogram::GetCount() const
+    {
+        return count.load( std::memory_order_relaxed );
+    }
+
+    uint64_t LatencyHistogram::GetPercentileMicros( double percentile ) const
+    {
+        uint64_t total = 0;
+        uint64_t snapshot[ numLatencyBuckets ];
+
+        for ( size_t i = 0; i < numLatencyBuckets; ++i )
+        {
+            snapshot[ i ] = buckets[ i ].load( std::memory_order_relaxed );
+            total += snapshot[ i ];
+        }
+
+        if ( total == 0 )
+        {
+            return 0;
+        }
+
+        uint64_t rank = static_cast<uint64_t>( percentile * total );
+        if ( rank == 0 )
+        {
+            rank = 1;
+        }
+
+        uint64_t seen = 0;
+        for ( size_t i = 0; i < numLatencyBuckets; ++i )
+        {
+            seen += snapshot[ i ];
+            if ( seen >= rank )
+            {
+                return LatencyBucketUpperBoundMicros( i );
+            }
+        }
+
+        return LatencyBucketUpperBoundMicros( numLatencyBuckets - 1 );
+    }
+}
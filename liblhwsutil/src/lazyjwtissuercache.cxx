@@ -0,0 +1,347 @@
+#include <lhwsutil_impl/lazyjwtissuercache.h>
+#include <lhwsutil_impl/metricsregistry.h>
+#include <lhwsutil_impl/probes.h>
+
+#include <lhwsutil/logging.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace LHWSUtilNS
+{
+    std::shared_ptr< IJwtIssuerCache > GetStandardJwtIssuerCache( const LazyJwtIssuerCacheParams& params )
+    {
+        return std::make_shared< LHWSUtilImplNS::LazyJwtIssuerCache >( params );
+    }
+}
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        // what the cache holds for an iss besides its issuer, the entry and its map and lru nodes
+        size_t entryBytes( const std::string& iss )
+        {
+            return iss.capacity() + 128;
+        }
+
+        const char segmentEnds[] = "/?#";
+    }
+
+    bool IssMatchesPattern( const std::string& iss, const std::string& pattern )
+    {
+        size_t star = pattern.find( '*' );
+        if ( star == std::string::npos )
+        {
+            return ( iss == pattern );
+        }
+
+        size_t suffixSize = pattern.size() - star - 1;
+        if ( ( iss.size() <= ( star + suffixSize ) ) ||
+            ( iss.compare( 0, star, pattern, 0, star ) != 0 ) ||
+            ( iss.compare( iss.size() - suffixSize, suffixSize, pattern, star + 1, suffixSize ) != 0 ) )
+        {
+            return false;
+        }
+
+        // the star stays within a path segment, the issuer's urls are built from iss
+        return ( std::find_first_of( iss.begin() + star,
+            iss.end() - suffixSize,
+            segmentEnds,
+            segmentEnds + std::strlen( segmentEnds ) ) == ( iss.end() - suffixSize ) );
+    }
+
+    LazyJwtIssuerCache::Entry::Entry()
+        : state( EntryState::Loading )
+        , jwtIssuer()
+        , bytes( 0 )
+        , retryAt()
+        , lruPosition()
+    {
+    }
+
+    LazyJwtIssuerCache::LazyJwtIssuerCache( const LHWSUtilNS::LazyJwtIssuerCacheParams& _params )
+        : LHWSUtilNS::IJwtIssuerCache()
+        , params( _params )
+        , cacheMutex()
+        , loadedCondition()
+        , issToEntry()
+        , lru()
+        , memoryBytes( 0 )
+        , issToLoadedParams()
+    {
+        for ( const std::string& pattern : params.allowedIssPatterns )
+        {
+            if ( std::count( pattern.begin(), pattern.end(), '*' ) > 1 )
+            {
+                throw std::runtime_error( "allowed iss pattern=[" + pattern + "] has more than one '*'" );
+            }
+        }
+    }
+
+    LazyJwtIssuerCache::~LazyJwtIssuerCache()
+    {
+    }
+
+    void LazyJwtIssuerCache::LoadIssuer( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams )
+    {
+        wsUtilLogSetScope( "LazyJwtIssuerCache.LoadIssuer" );
+
+        if ( cacheParams.iss.empty() )
+        {
+            throw std::runtime_error( "cacheParams.iss is empty" );
+        }
+
+        {
+            const std::lock_guard<TimedMutex> lock( cacheMutex );
+
+            if ( !( issToLoadedParams.emplace( cacheParams.iss, cacheParams ).second ) )
+            {
+                std::ostringstream oss;
+
+                oss << "issuer=[" << cacheParams.iss << "] is already in the cache";
+
+                throw std::runtime_error( oss.str() );
+            }
+        }
+
+        GetMetricsRegistry().RegisterIssuer( cacheParams.iss );
+
+        // one which fails is loaded again by GetIssuer after failedLoadRetrySeconds
+        try
+        {
+            (void)GetIssuer( cacheParams.iss );
+        }
+        catch ( const std::exception& e )
+        {
+            wsUtilLogError( "failed to load issuer=[" << cacheParams.iss << "], e=[" << e.what() << "]" );
+        }
+    }
+
+    bool LazyJwtIssuerCache::IssuerIsLoaded( const std::string& iss ) const
+    {
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
+        auto it = issToEntry.find( iss );
+
+        return ( it != issToEntry.cend() ) && ( it->second.state == EntryState::Loaded );
+    }
+
+    std::shared_ptr< LHWSUtilNS::IJwtIssuer > LazyJwtIssuerCache::GetIssuer( const std::string& iss )
+    {
+        wsUtilLogSetScope( "LazyJwtIssuerCache.GetIssuer" );
+        std::unique_lock<TimedMutex> lock( cacheMutex );
+
+        auto it = issToEntry.find( iss );
+        while ( ( it != issToEntry.end() ) && ( it->second.state == EntryState::Loading ) )
+        {
+            loadedCondition.wait( lock );
+            it = issToEntry.find( iss );
+        }
+
+        if ( ( it != issToEntry.end() ) && ( it->second.state == EntryState::Loaded ) )
+        {
+            MetricsRegistry::LocalShard().issuerCacheHits.Add( 1 );
+            LHWSUTIL_PROBE1( issuer_cache_hit, iss.c_str() );
+            lru.splice( lru.begin(), lru, it->second.lruPosition );
+
+            return it->second.jwtIssuer;
+        }
+
+        MetricsRegistry::LocalShard().issuerCacheMisses.Add( 1 );
+        LHWSUTIL_PROBE1( issuer_cache_miss, iss.c_str() );
+
+        if ( it != issToEntry.end() )
+        {
+            if ( std::chrono::steady_clock::now() < it->second.retryAt )
+            {
+                std::ostringstream oss;
+
+                oss << "issuer=[" << iss << "] failed to load and is not retried yet";
+
+                throw std::runtime_error( oss.str() );
+            }
+
+            lru.erase( it->second.lruPosition );
+            memoryBytes -= it->second.bytes;
+            it->second.bytes = 0;
+            it->second.state = EntryState::Loading;
+        }
+        else
+        {
+            issToEntry.emplace( iss, Entry() );
+        }
+
+        LHWSUtilNS::JwtIssuerCacheParams cacheParams;
+        auto itLoaded = issToLoadedParams.find( iss );
+        bool allowed = ( itLoaded != issToLoadedParams.end() );
+        if ( allowed )
+        {
+            cacheParams = itLoaded->second;
+        }
+
+        // other GetIssuers of iss wait on loadedCondition meanwhile
+        lock.unlock();
+        std::shared_ptr< JwtIssuer > jwtIssuer;
+        try
+        {
+            allowed = allowed || resolve( iss, cacheParams );
+            if ( allowed && ( LoadJwtIssuer( cacheParams, jwtIssuer ) != 0 ) )
+            {
+                jwtIssuer.reset();
+            }
+        }
+        catch ( const std::exception& e )
+        {
+            wsUtilLogError( "failed to load issuer=[" << iss << "], e=[" << e.what() << "]" );
+            jwtIssuer.reset();
+        }
+        catch ( ... )
+        {
+            wsUtilLogError( "failed to load issuer=[" << iss << "], unknown exception" );
+            jwtIssuer.reset();
+        }
+        lock.lock();
+
+        if ( !( allowed ) )
+        {
+            issToEntry.erase( iss );
+            loadedCondition.notify_all();
+
+            std::ostringstream oss;
+
+            oss << "issuer=[" << iss << "] is not allowed";
+
+            throw std::runtime_error( oss.str() );
+        }
+
+        completeLoad( iss, jwtIssuer );
+        loadedCondition.notify_all();
+
+        if ( !( jwtIssuer ) )
+        {
+            std::ostringstream oss;
+
+            oss << "issuer=[" << iss << "] failed to load";
+
+            throw std::runtime_error( oss.str() );
+        }
+
+        return jwtIssuer;
+    }
+
+    int LazyJwtIssuerCache::Freeze()
+    {
+        wsUtilLogSetScope( "LazyJwtIssuerCache.Freeze" );
+
+        wsUtilLogError( "a lazily loading cache cannot be frozen" );
+
+        return 2;
+    }
+
+    void LazyJwtIssuerCache::Unfreeze()
+    {
+    }
+
+    bool LazyJwtIssuerCache::IsFrozen() const
+    {
+        return false;
+    }
+
+    size_t LazyJwtIssuerCache::GetMemoryUsage( std::vector< LHWSUtilNS::JwtIssuerMemoryUsage >& usageOut ) const
+    {
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
+        size_t totalBytes = 0;
+
+        for ( auto it = issToEntry.cbegin(); it != issToEntry.cend(); ++it )
+        {
+            if ( it->second.state == EntryState::Loaded )
+            {
+                usageOut.emplace_back();
+                usageOut.back().iss = it->first;
+                usageOut.back().bytes = it->second.bytes;
+                totalBytes += it->second.bytes;
+            }
+        }
+
+        return totalBytes;
+    }
+
+    void LazyJwtIssuerCache::GetLockWaitStats( LockWaitStats& statsOut ) const
+    {
+        cacheMutex.GetWaitStats( statsOut );
+    }
+
+    void LazyJwtIssuerCache::ResetLockWaitStats()
+    {
+        cacheMutex.ResetWaitStats();
+    }
+
+    bool LazyJwtIssuerCache::resolve( const std::string& iss, LHWSUtilNS::JwtIssuerCacheParams& cacheParams ) const
+    {
+        for ( const std::string& pattern : params.allowedIssPatterns )
+        {
+            if ( IssMatchesPattern( iss, pattern ) )
+            {
+                cacheParams = params.issuerParams;
+                cacheParams.iss = iss;
+
+                return true;
+            }
+        }
+
+        if ( params.resolver )
+        {
+            cacheParams = LHWSUtilNS::JwtIssuerCacheParams();
+            cacheParams.iss = iss;
+
+            return params.resolver( iss, cacheParams );
+        }
+
+        return false;
+    }
+
+    // assume lock held
+    void LazyJwtIssuerCache::completeLoad( const std::string& iss, const std::shared_ptr< JwtIssuer >& jwtIssuer )
+    {
+        auto it = issToEntry.find( iss );
+        Entry& entry( it->second );
+
+        entry.jwtIssuer = jwtIssuer;
+        entry.bytes = entryBytes( it->first );
+        if ( jwtIssuer )
+        {
+            entry.state = EntryState::Loaded;
+            entry.bytes += jwtIssuer->GetMemoryUsage();
+        }
+        else
+        {
+            entry.state = EntryState::Failed;
+            entry.retryAt = std::chrono::steady_clock::now() + std::chrono::seconds( params.failedLoadRetrySeconds );
+        }
+
+        lru.push_front( &it->first );
+        entry.lruPosition = lru.begin();
+        memoryBytes += entry.bytes;
+
+        evict();
+    }
+
+    // assume lock held
+    void LazyJwtIssuerCache::evict()
+    {
+        wsUtilLogSetScope( "LazyJwtIssuerCache.evict" );
+
+        // the most recently used issuer stays even if it alone is over the limit
+        while ( ( params.maxMemoryBytes > 0 ) && ( memoryBytes > params.maxMemoryBytes ) && ( lru.size() > 1 ) )
+        {
+            auto it = issToEntry.find( *lru.back() );
+
+            wsUtilLogDebug( "evicting issuer=[" << it->first << "] of " << it->second.bytes << " bytes" );
+            memoryBytes -= it->second.bytes;
+            lru.pop_back();
+            issToEntry.erase( it );
+        }
+    }
+}
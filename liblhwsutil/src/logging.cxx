@@ -1,6 +1,15 @@
 #include <lhwsutil/logging.h>
 
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
 #include <boost/log/expressions/keyword.hpp>
+#include <boost/log/sinks/async_frontend.hpp>
+#include <boost/log/sinks/bounded_fifo_queue.hpp>
+#include <boost/log/sinks/drop_on_overflow.hpp>
+#include <boost/log/sinks/text_ostream_backend.hpp>
+
+#include <mutex>
+#include <stdexcept>
 
 BOOST_LOG_GLOBAL_LOGGER_INIT( LHWSUtilLoggerGeneric, LHWSUtilNS::LoggerType )
 {
@@ -10,3 +19,92 @@ BOOST_LOG_GLOBAL_LOGGER_INIT( LHWSUtilLoggerGeneric, LHWSUtilNS::LoggerType )
 
     return logger;
 }
+
+namespace LHWSUtilNS
+{
+    namespace
+    {
+        typedef boost::log::sinks::asynchronous_sink<
+            boost::log::sinks::text_ostream_backend,
+            boost::log::sinks::bounded_fifo_queue< asyncLogSinkCapacity, boost::log::sinks::drop_on_overflow > >
+            AsyncLogSinkType;
+
+        std::mutex asyncLogSinkMutex;
+        boost::shared_ptr< AsyncLogSinkType > asyncLogSink;
+
+        BOOST_LOG_ATTRIBUTE_KEYWORD( lhwsutilSeverity, "Severity", SeverityLevel )
+        BOOST_LOG_ATTRIBUTE_KEYWORD( lhwsutilChannel, "Channel", std::string )
+    }
+
+    std::atomic< int > logSeverityThreshold( static_cast< int >( SeverityLevel::trace ) );
+
+    void SetLogSeverityThreshold( SeverityLevel severity )
+    {
+        logSeverityThreshold.store( static_cast< int >( severity ), std::memory_order_relaxed );
+    }
+
+    LogPayload::LogPayload( const std::string& _data, size_t _maxBytes )
+        : data( _data.data() )
+        , size( _data.size() )
+        , maxBytes( _maxBytes )
+    {
+    }
+
+    LogPayload::LogPayload( const char* _data, size_t _size, size_t _maxBytes )
+        : data( _data )
+        , size( _data ? _size : 0 )
+        , maxBytes( _maxBytes )
+    {
+    }
+
+    std::ostream& operator<<( std::ostream& os, const LogPayload& payload )
+    {
+        if ( payload.size <= payload.maxBytes )
+        {
+            os.write( payload.data, payload.size );
+        }
+        else
+        {
+            os.write( payload.data, payload.maxBytes );
+            os << "...(" << payload.size << " bytes)";
+        }
+
+        return os;
+    }
+
+    void EnableAsyncLogSink( const std::shared_ptr< std::ostream >& stream, SeverityLevel minSeverity )
+    {
+        const std::lock_guard< std::mutex > lock( asyncLogSinkMutex );
+
+        if ( asyncLogSink )
+        {
+            throw std::runtime_error( "async log sink is already enabled" );
+        }
+
+        auto backend( boost::make_shared< boost::log::sinks::text_ostream_backend >() );
+        // the stream is kept alive by the deleter capturing it
+        backend->add_stream( boost::shared_ptr< std::ostream >( stream.get(), [ stream ]( std::ostream* ) {} ) );
+
+        asyncLogSink = boost::make_shared< AsyncLogSinkType >( backend );
+        asyncLogSink->set_filter( ( lhwsutilChannel == LHWSUTIL_LOGGER_CHANNEL_NAME_GENERIC ) &&
+                                  ( lhwsutilSeverity >= minSeverity ) );
+        asyncLogSink->set_formatter( boost::log::expressions::stream
+                                     << "[" << lhwsutilSeverity << "] "
+                                     << boost::log::expressions::smessage );
+
+        boost::log::core::get()->add_sink( asyncLogSink );
+    }
+
+    void DisableAsyncLogSink()
+    {
+        const std::lock_guard< std::mutex > lock( asyncLogSinkMutex );
+
+        if ( asyncLogSink )
+        {
+            boost::log::core::get()->remove_sink( asyncLogSink );
+            asyncLogSink->stop();
+            asyncLogSink->flush();
+            asyncLogSink.reset();
+        }
+    }
+}
@@ -0,0 +1,296 @@
+#include <lhwsutil/metrics.h>
+
+#include <sstream>
+
+#include <lhwsutil_impl/metricsregistry.h>
+
+namespace LHWSUtilNS
+{
+    namespace
+    {
+        void writeLabelValue( std::ostringstream& oss, const std::string& value )
+        {
+            for ( auto it = value.cbegin(); it != value.cend(); ++it )
+            {
+                switch ( *it )
+                {
+                    case '\\':
+                        oss << "\\\\";
+                        break;
+                    case '"':
+                        oss << "\\\"";
+                        break;
+                    case '\n':
+                        oss << "\\n";
+                        break;
+                    default:
+                        oss << *it;
+                        break;
+                }
+            }
+        }
+
+        void writeHeader( std::ostringstream& oss, const char* name, const char* type, const char* help )
+        {
+            oss << "# HELP lhwsutil_" << name << " " << help << "\n"
+                << "# TYPE lhwsutil_" << name << " " << type << "\n";
+        }
+
+        void writeCountsByResult( std::ostringstream& oss,
+                                  const char* name,
+                                  const char* label,
+                                  const std::string& labelValue,
+                                  const JwtValidationCounts& counts )
+        {
+            for ( size_t r = 0; r < numJwtValidationResults; ++r )
+            {
+                oss << "lhwsutil_" << name << "{" << label << "=\"";
+                writeLabelValue( oss, labelValue );
+                oss << "\",result=\"" << JwtValidationResultName( static_cast< JwtValidationResult >( r ) )
+                    << "\"} " << counts[ r ] << "\n";
+            }
+        }
+
+        // only the power of two bounds are exposed, they are bucket boundaries so the counts stay exact
+        void writeHistogram( std::ostringstream& oss,
+                             const char* name,
+                             const char* label,
+                             const char* labelValue,
+                             const HistogramSnapshot& histogram )
+        {
+            uint64_t cumulative = 0;
+            for ( size_t i = 0; i < histogram.bucketCounts.size(); ++i )
+            {
+                cumulative += histogram.bucketCounts[ i ];
+                if ( ( i < 4 ) || ( ( i % 4 ) == 3 ) )
+                {
+                    oss << "lhwsutil_" << name << "_bucket{" << label << "=\"" << labelValue
+                        << "\",le=\"" << ( histogram.bucketUpperBoundsMicros[ i ] / 1e6 ) << "\"} "
+                        << cumulative << "\n";
+                }
+            }
+
+            oss << "lhwsutil_" << name << "_bucket{" << label << "=\"" << labelValue
+                << "\",le=\"+Inf\"} " << histogram.count << "\n"
+                << "lhwsutil_" << name << "_sum{" << label << "=\"" << labelValue
+                << "\"} " << ( histogram.sumMicros / 1e6 ) << "\n"
+                << "lhwsutil_" << name << "_count{" << label << "=\"" << labelValue
+                << "\"} " << histogram.count << "\n";
+        }
+    }
+
+    HistogramSnapshot::HistogramSnapshot()
+        : count( 0 )
+        , sumMicros( 0 )
+        , bucketUpperBoundsMicros()
+        , bucketCounts()
+    {
+    }
+
+    MetricsSnapshot::MetricsSnapshot()
+        : validationsByIssuer()
+        , validationsByAlg()
+        , issuerCacheHits( 0 )
+        , issuerCacheMisses( 0 )
+        , issuerReloads( 0 )
+        , issuerReloadFailures( 0 )
+        , pendingIssuers( 0 )
+        , httpHedgedRequests( 0 )
+    {
+        for ( size_t m = 0; m < numJwtValidationMethods; ++m )
+        {
+            validationsByMethod[ m ].fill( 0 );
+        }
+
+        for ( size_t s = 0; s < numJwtValidationStages; ++s )
+        {
+            validationsByStage[ s ].fill( 0 );
+        }
+
+        for ( size_t o = 0; o < numHttpRequestOutcomes; ++o )
+        {
+            httpRequests[ o ] = 0;
+        }
+    }
+
+    void GetMetricsSnapshot( MetricsSnapshot& snapshotOut )
+    {
+        LHWSUtilImplNS::GetMetricsRegistry().GetSnapshot( snapshotOut );
+    }
+
+    void FormatMetricsPrometheus( const MetricsSnapshot& snapshot, std::string& out )
+    {
+        std::ostringstream oss;
+
+        // enough digits for the largest bucket bound in seconds
+        oss.precision( 12 );
+
+        writeHeader( oss, "jwt_validations_total", "counter", "Jwt validations by method and result." );
+        for ( size_t m = 0; m < numJwtValidationMethods; ++m )
+        {
+            writeCountsByResult( oss,
+                "jwt_validations_total",
+                "method",
+                JwtValidationMethodName( static_cast< JwtValidationMethod >( m ) ),
+                snapshot.validationsByMethod[ m ] );
+        }
+
+        writeHeader( oss, "jwt_validations_by_stage_total", "counter",
+            "Jwt validations by the last stage reached and result." );
+        for ( size_t s = 0; s < numJwtValidationStages; ++s )
+        {
+            writeCountsByResult( oss,
+                "jwt_validations_by_stage_total",
+                "stage",
+                JwtValidationStageName( static_cast< JwtValidationStage >( s ) ),
+                snapshot.validationsByStage[ s ] );
+        }
+
+        writeHeader( oss, "jwt_validations_by_issuer_total", "counter", "Jwt validations by issuer and result." );
+        for ( auto it = snapshot.validationsByIssuer.cbegin(); it != snapshot.validationsByIssuer.cend(); ++it )
+        {
+            writeCountsByResult( oss, "jwt_validations_by_issuer_total", "issuer", it->first, it->second );
+        }
+
+        writeHeader( oss, "jwt_validations_by_alg_total", "counter", "Jwt validations by alg and result." );
+        for ( auto it = snapshot.validationsByAlg.cbegin(); it != snapshot.validationsByAlg.cend(); ++it )
+        {
+            writeCountsByResult( oss, "jwt_validations_by_alg_total", "alg", it->first, it->second );
+        }
+
+        writeHeader( oss, "jwt_validation_duration_seconds", "histogram", "Jwt validation latency by method." );
+        for ( size_t m = 0; m < numJwtValidationMethods; ++m )
+        {
+            writeHistogram( oss,
+                "jwt_validation_duration_seconds",
+                "method",
+                JwtValidationMethodName( static_cast< JwtValidationMethod >( m ) ),
+                snapshot.validationLatency[ m ] );
+        }
+
+        writeHeader( oss, "issuer_cache_lookups_total", "counter", "Issuer cache lookups by result." );
+        oss << "lhwsutil_issuer_cache_lookups_total{result=\"hit\"} " << snapshot.issuerCacheHits << "\n"
+            << "lhwsutil_issuer_cache_lookups_total{result=\"miss\"} " << snapshot.issuerCacheMisses << "\n";
+
+        writeHeader( oss, "issuer_cache_reloads_total", "counter", "Issuer (re)loads by result." );
+        oss << "lhwsutil_issuer_cache_reloads_total{result=\"ok\"} "
+            << ( snapshot.issuerReloads - snapshot.issuerReloadFailures ) << "\n"
+            << "lhwsutil_issuer_cache_reloads_total{result=\"failed\"} " << snapshot.issuerReloadFailures << "\n";
+
+        writeHeader( oss, "issuer_cache_pending_issuers", "gauge", "Issuers waiting to be reloaded." );
+        oss << "lhwsutil_issuer_cache_pending_issuers " << snapshot.pendingIssuers << "\n";
+
+        writeHeader( oss, "http_requests_total", "counter", "Http requests by outcome." );
+        for ( size_t o = 0; o < numHttpRequestOutcomes; ++o )
+        {
+            oss << "lhwsutil_http_requests_total{outcome=\""
+                << HttpRequestOutcomeName( static_cast< HttpRequestOutcome >( o ) ) << "\"} "
+                << snapshot.httpRequests[ o ] << "\n";
+        }
+
+        writeHeader( oss, "http_hedged_requests_total", "counter", "Http requests that launched a hedge." );
+        oss << "lhwsutil_http_hedged_requests_total " << snapshot.httpHedgedRequests << "\n";
+
+        writeHeader( oss, "http_request_phase_seconds", "histogram",
+            "Time from the start of an http request until the end of each phase." );
+        for ( size_t t = 0; t < numHttpTimings; ++t )
+        {
+            writeHistogram( oss,
+                "http_request_phase_seconds",
+                "phase",
+                HttpTimingName( static_cast< HttpTiming >( t ) ),
+                snapshot.httpTimings[ t ] );
+        }
+
+        out = oss.str();
+    }
+
+    const char* JwtValidationMethodName( JwtValidationMethod method )
+    {
+        switch ( method )
+        {
+            case JwtValidationMethod::ValidateIntoJwt:
+                return "validate";
+            case JwtValidationMethod::IntrospectJwt:
+                return "introspect";
+            default:
+                return "unknown";
+        }
+    }
+
+    const char* JwtValidationResultName( JwtValidationResult result )
+    {
+        switch ( result )
+        {
+            case JwtValidationResult::Valid:
+                return "valid";
+            case JwtValidationResult::Invalid:
+                return "invalid";
+            case JwtValidationResult::Inactive:
+                return "inactive";
+            case JwtValidationResult::Error:
+                return "error";
+            case JwtValidationResult::Denied:
+                return "denied";
+            case JwtValidationResult::Revoked:
+                return "revoked";
+            case JwtValidationResult::Replayed:
+                return "replayed";
+            default:
+                return "unknown";
+        }
+    }
+
+    const char* JwtValidationStageName( JwtValidationStage stage )
+    {
+        switch ( stage )
+        {
+            case JwtValidationStage::Decode:
+                return "decode";
+            case JwtValidationStage::KeyLookup:
+                return "key_lookup";
+            case JwtValidationStage::Verify:
+                return "verify";
+            case JwtValidationStage::Introspect:
+                return "introspect";
+            default:
+                return "unknown";
+        }
+    }
+
+    const char* HttpRequestOutcomeName( HttpRequestOutcome outcome )
+    {
+        switch ( outcome )
+        {
+            case HttpRequestOutcome::Ok:
+                return "ok";
+            case HttpRequestOutcome::TimedOut:
+                return "timed_out";
+            case HttpRequestOutcome::Failed:
+                return "failed";
+            default:
+                return "unknown";
+        }
+    }
+
+    const char* HttpTimingName( HttpTiming timing )
+    {
+        switch ( timing )
+        {
+            case HttpTiming::NameLookup:
+                return "namelookup";
+            case HttpTiming::Connect:
+                return "connect";
+            case HttpTiming::AppConnect:
+                return "appconnect";
+            case HttpTiming::PreTransfer:
+                return "pretransfer";
+            case HttpTiming::StartTransfer:
+                return "starttransfer";
+            case HttpTiming::Total:
+                return "total";
+            default:
+                return "unknown";
+        }
+    }
+}
@@ -0,0 +1,375 @@
+#include <lhwsutil_impl/metricsregistry.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace LHWSUtilImplNS
+{
+    const char* const metricsAlgNames[] = {
+        "none",
+        "HS256", "HS384", "HS512",
+        "RS256", "RS384", "RS512",
+        "ES256", "ES384", "ES512",
+        "PS256", "PS384", "PS512",
+        "EdDSA",
+        "other" };
+
+    namespace
+    {
+        class LocalShardHandle
+        {
+            public:
+                LocalShardHandle();
+                ~LocalShardHandle();
+
+                LocalShardHandle( const LocalShardHandle& other ) = delete;
+                LocalShardHandle& operator=( const LocalShardHandle& other ) = delete;
+
+                MetricsShard* shard;
+        };
+
+        LocalShardHandle::LocalShardHandle()
+            : shard( new MetricsShard() )
+        {
+            GetMetricsRegistry().AttachShard( shard );
+        }
+
+        LocalShardHandle::~LocalShardHandle()
+        {
+            GetMetricsRegistry().DetachShard( shard );
+            delete shard;
+            shard = nullptr;
+        }
+
+        void addCounts( const ShardCounter ( &from )[ LHWSUtilNS::numJwtValidationResults ],
+                        LHWSUtilNS::JwtValidationCounts& to )
+        {
+            for ( size_t i = 0; i < LHWSUtilNS::numJwtValidationResults; ++i )
+            {
+                to[ i ] += from[ i ].Get();
+            }
+        }
+
+        void addHistogram( const ShardHistogram& from, LHWSUtilNS::HistogramSnapshot& to )
+        {
+            to.count += from.count.Get();
+            to.sumMicros += from.sumMicros.Get();
+            for ( size_t i = 0; i < numLatencyBuckets; ++i )
+            {
+                to.bucketCounts[ i ] += from.buckets[ i ].Get();
+            }
+        }
+
+        void initHistogram( LHWSUtilNS::HistogramSnapshot& histogram )
+        {
+            histogram.count = 0;
+            histogram.sumMicros = 0;
+            histogram.bucketCounts.assign( numLatencyBuckets, 0 );
+            histogram.bucketUpperBoundsMicros.resize( numLatencyBuckets );
+            for ( size_t i = 0; i < numLatencyBuckets; ++i )
+            {
+                histogram.bucketUpperBoundsMicros[ i ] = LatencyBucketUpperBoundMicros( i );
+            }
+        }
+
+        bool anyCounts( const LHWSUtilNS::JwtValidationCounts& counts )
+        {
+            return std::any_of( counts.cbegin(), counts.cend(), []( uint64_t count ) { return count != 0; } );
+        }
+
+        void foldCounter( const ShardCounter& from, ShardCounter& to )
+        {
+            to.Add( from.Get() );
+        }
+
+        void foldHistogram( const ShardHistogram& from, ShardHistogram& to )
+        {
+            foldCounter( from.count, to.count );
+            foldCounter( from.sumMicros, to.sumMicros );
+            for ( size_t i = 0; i < numLatencyBuckets; ++i )
+            {
+                foldCounter( from.buckets[ i ], to.buckets[ i ] );
+            }
+        }
+
+        // sums from into to, only used under the registry mutex
+        void foldShard( const MetricsShard& from, MetricsShard& to )
+        {
+            for ( size_t r = 0; r < LHWSUtilNS::numJwtValidationResults; ++r )
+            {
+                for ( size_t m = 0; m < LHWSUtilNS::numJwtValidationMethods; ++m )
+                {
+                    foldCounter( from.validationsByMethod[ m ][ r ], to.validationsByMethod[ m ][ r ] );
+                }
+                for ( size_t s = 0; s < LHWSUtilNS::numJwtValidationStages; ++s )
+                {
+                    foldCounter( from.validationsByStage[ s ][ r ], to.validationsByStage[ s ][ r ] );
+                }
+                for ( size_t i = 0; i < numMetricsIssuers; ++i )
+                {
+                    foldCounter( from.validationsByIssuer[ i ][ r ], to.validationsByIssuer[ i ][ r ] );
+                }
+                for ( size_t a = 0; a < numMetricsAlgs; ++a )
+                {
+                    foldCounter( from.validationsByAlg[ a ][ r ], to.validationsByAlg[ a ][ r ] );
+                }
+            }
+
+            for ( size_t m = 0; m < LHWSUtilNS::numJwtValidationMethods; ++m )
+            {
+                foldHistogram( from.validationLatency[ m ], to.validationLatency[ m ] );
+            }
+
+            foldCounter( from.issuerCacheHits, to.issuerCacheHits );
+            foldCounter( from.issuerCacheMisses, to.issuerCacheMisses );
+            foldCounter( from.issuerReloads, to.issuerReloads );
+            foldCounter( from.issuerReloadFailures, to.issuerReloadFailures );
+
+            for ( size_t o = 0; o < LHWSUtilNS::numHttpRequestOutcomes; ++o )
+            {
+                foldCounter( from.httpRequests[ o ], to.httpRequests[ o ] );
+            }
+            foldCounter( from.httpHedgedRequests, to.httpHedgedRequests );
+            for ( size_t t = 0; t < LHWSUtilNS::numHttpTimings; ++t )
+            {
+                foldHistogram( from.httpTimings[ t ], to.httpTimings[ t ] );
+            }
+        }
+    }
+
+    ShardCounter::ShardCounter()
+        : value( 0 )
+    {
+    }
+
+    MetricsRegistry::IssuerSlot::IssuerSlot()
+        : used( false )
+        , hash( 0 )
+        , index( 0 )
+        , iss()
+    {
+    }
+
+    MetricsRegistry::MetricsRegistry()
+        : registryMutex()
+        , shards()
+        , retired()
+        , numIssuers( 0 )
+        , pendingIssuers( 0 )
+    {
+    }
+
+    MetricsRegistry::~MetricsRegistry()
+    {
+    }
+
+    MetricsShard& MetricsRegistry::LocalShard()
+    {
+        static thread_local LocalShardHandle handle;
+
+        return *( handle.shard );
+    }
+
+    void MetricsRegistry::RegisterIssuer( const std::string& iss )
+    {
+        const std::lock_guard< std::mutex > lock( registryMutex );
+
+        size_t hash = std::hash< std::string >()( iss );
+        size_t index = numIssuers.load( std::memory_order_relaxed );
+        if ( index >= maxMetricsIssuers )
+        {
+            return;
+        }
+
+        for ( size_t probe = 0; probe < numIssuerSlots; ++probe )
+        {
+            IssuerSlot& slot( issuerSlots[ ( hash + probe ) % numIssuerSlots ] );
+            if ( slot.used.load( std::memory_order_relaxed ) )
+            {
+                if ( ( slot.hash == hash ) && ( slot.iss == iss ) )
+                {
+                    return;
+                }
+            }
+            else
+            {
+                slot.hash = hash;
+                slot.index = index;
+                slot.iss = iss;
+                issuerLabels[ index ] = iss;
+                // publishes the fields above to IssuerIndex
+                slot.used.store( true, std::memory_order_release );
+                numIssuers.store( index + 1, std::memory_order_release );
+                return;
+            }
+        }
+    }
+
+    size_t MetricsRegistry::IssuerIndex( const std::string& iss ) const
+    {
+        size_t hash = std::hash< std::string >()( iss );
+
+        for ( size_t probe = 0; probe < numIssuerSlots; ++probe )
+        {
+            const IssuerSlot& slot( issuerSlots[ ( hash + probe ) % numIssuerSlots ] );
+            if ( !( slot.used.load( std::memory_order_acquire ) ) )
+            {
+                break;
+            }
+
+            if ( ( slot.hash == hash ) && ( slot.iss == iss ) )
+            {
+                return slot.index;
+            }
+        }
+
+        return otherMetricsIssuer;
+    }
+
+    void MetricsRegistry::AddPendingIssuers( int64_t delta )
+    {
+        pendingIssuers.fetch_add( delta, std::memory_order_relaxed );
+    }
+
+    void MetricsRegistry::AttachShard( MetricsShard* shard )
+    {
+        const std::lock_guard< std::mutex > lock( registryMutex );
+
+        shards.push_back( shard );
+    }
+
+    void MetricsRegistry::DetachShard( MetricsShard* shard )
+    {
+        const std::lock_guard< std::mutex > lock( registryMutex );
+
+        auto it = std::find( shards.begin(), shards.end(), shard );
+        if ( it != shards.end() )
+        {
+            foldShard( *shard, retired );
+            shards.erase( it );
+        }
+    }
+
+    void MetricsRegistry::GetSnapshot( LHWSUtilNS::MetricsSnapshot& snapshotOut ) const
+    {
+        MetricsShard total;
+        size_t issuers = 0;
+
+        {
+            const std::lock_guard< std::mutex > lock( registryMutex );
+
+            foldShard( retired, total );
+            for ( auto it = shards.cbegin(); it != shards.cend(); ++it )
+            {
+                foldShard( **it, total );
+            }
+
+            issuers = numIssuers.load( std::memory_order_acquire );
+            snapshotOut.validationsByIssuer.clear();
+            for ( size_t i = 0; i < issuers; ++i )
+            {
+                LHWSUtilNS::JwtValidationCounts counts;
+
+                counts.fill( 0 );
+                addCounts( total.validationsByIssuer[ i ], counts );
+                if ( anyCounts( counts ) )
+                {
+                    snapshotOut.validationsByIssuer[ issuerLabels[ i ] ] = counts;
+                }
+            }
+        }
+
+        LHWSUtilNS::JwtValidationCounts otherIssuerCounts;
+        otherIssuerCounts.fill( 0 );
+        addCounts( total.validationsByIssuer[ otherMetricsIssuer ], otherIssuerCounts );
+        if ( anyCounts( otherIssuerCounts ) )
+        {
+            snapshotOut.validationsByIssuer[ "other" ] = otherIssuerCounts;
+        }
+
+        snapshotOut.validationsByAlg.clear();
+        for ( size_t a = 0; a < numMetricsAlgs; ++a )
+        {
+            LHWSUtilNS::JwtValidationCounts counts;
+
+            counts.fill( 0 );
+            addCounts( total.validationsByAlg[ a ], counts );
+            if ( anyCounts( counts ) )
+            {
+                snapshotOut.validationsByAlg[ metricsAlgNames[ a ] ] = counts;
+            }
+        }
+
+        for ( size_t m = 0; m < LHWSUtilNS::numJwtValidationMethods; ++m )
+        {
+            snapshotOut.validationsByMethod[ m ].fill( 0 );
+            addCounts( total.validationsByMethod[ m ], snapshotOut.validationsByMethod[ m ] );
+            initHistogram( snapshotOut.validationLatency[ m ] );
+            addHistogram( total.validationLatency[ m ], snapshotOut.validationLatency[ m ] );
+        }
+
+        for ( size_t s = 0; s < LHWSUtilNS::numJwtValidationStages; ++s )
+        {
+            snapshotOut.validationsByStage[ s ].fill( 0 );
+            addCounts( total.validationsByStage[ s ], snapshotOut.validationsByStage[ s ] );
+        }
+
+        snapshotOut.issuerCacheHits = total.issuerCacheHits.Get();
+        snapshotOut.issuerCacheMisses = total.issuerCacheMisses.Get();
+        snapshotOut.issuerReloads = total.issuerReloads.Get();
+        snapshotOut.issuerReloadFailures = total.issuerReloadFailures.Get();
+        snapshotOut.pendingIssuers = pendingIssuers.load( std::memory_order_relaxed );
+
+        for ( size_t o = 0; o < LHWSUtilNS::numHttpRequestOutcomes; ++o )
+        {
+            snapshotOut.httpRequests[ o ] = total.httpRequests[ o ].Get();
+        }
+        snapshotOut.httpHedgedRequests = total.httpHedgedRequests.Get();
+        for ( size_t t = 0; t < LHWSUtilNS::numHttpTimings; ++t )
+        {
+            initHistogram( snapshotOut.httpTimings[ t ] );
+            addHistogram( total.httpTimings[ t ], snapshotOut.httpTimings[ t ] );
+        }
+    }
+
+    MetricsRegistry& GetMetricsRegistry()
+    {
+        static MetricsRegistry* registry = new MetricsRegistry();
+
+        return *registry;
+    }
+
+    size_t MetricsAlgIndex( const char* alg )
+    {
+        if ( alg )
+        {
+            for ( size_t a = 0; a < otherMetricsAlg; ++a )
+            {
+                if ( strcmp( alg, metricsAlgNames[ a ] ) == 0 )
+                {
+                    return a;
+                }
+            }
+        }
+
+        return otherMetricsAlg;
+    }
+
+    void RecordJwtValidation( LHWSUtilNS::JwtValidationMethod method,
+                              LHWSUtilNS::JwtValidationResult result,
+                              LHWSUtilNS::JwtValidationStage stage,
+                              size_t issuerIndex,
+                              size_t algIndex,
+                              uint64_t micros )
+    {
+        MetricsShard& shard( MetricsRegistry::LocalShard() );
+        size_t r = static_cast< size_t >( result );
+
+        shard.validationsByMethod[ static_cast< size_t >( method ) ][ r ].Add( 1 );
+        shard.validationsByStage[ static_cast< size_t >( stage ) ][ r ].Add( 1 );
+        shard.validationsByIssuer[ std::min( issuerIndex, otherMetricsIssuer ) ][ r ].Add( 1 );
+        shard.validationsByAlg[ std::min( algIndex, otherMetricsAlg ) ][ r ].Add( 1 );
+        shard.validationLatency[ static_cast< size_t >( method ) ].Record( micros );
+    }
+}
@@ -1,5 +1,10 @@
-#include <openssl/bn.h> // TODO - upgrade to 1.1, support multiple versions
-#include <openssl/pem.h> // TODO - upgrade to 1.1, support multiple versions
+#include <openssl/bn.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/param_build.h>
+#endif
 
 #include <lhwsutil/logging.h>
 #include <lhwsutil_impl/rsa.h>
@@ -8,23 +13,110 @@
 
 namespace LHWSUtilImplNS
 {
+    namespace
+    {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        // imports n and e as parameters, without an RSA object or a pem round trip
+        EVP_PKEY* rsaPublicKeyFromData( BIGNUM* n, BIGNUM* e )
+        {
+            EVP_PKEY* pkey = nullptr;
+            OSSL_PARAM_BLD* paramBld = OSSL_PARAM_BLD_new();
+            OSSL_PARAM* params = nullptr;
+            EVP_PKEY_CTX* pkeyCtx = nullptr;
+
+            if ( paramBld &&
+                OSSL_PARAM_BLD_push_BN( paramBld, OSSL_PKEY_PARAM_RSA_N, n ) &&
+                OSSL_PARAM_BLD_push_BN( paramBld, OSSL_PKEY_PARAM_RSA_E, e ) )
+            {
+                params = OSSL_PARAM_BLD_to_param( paramBld );
+            }
+
+            if ( params )
+            {
+                pkeyCtx = EVP_PKEY_CTX_new_from_name( nullptr, "RSA", nullptr );
+            }
+
+            if ( pkeyCtx &&
+                ( EVP_PKEY_fromdata_init( pkeyCtx ) == 1 ) &&
+                ( EVP_PKEY_fromdata( pkeyCtx, &pkey, EVP_PKEY_PUBLIC_KEY, params ) != 1 ) )
+            {
+                pkey = nullptr;
+            }
+
+            EVP_PKEY_CTX_free( pkeyCtx );
+            OSSL_PARAM_free( params );
+            OSSL_PARAM_BLD_free( paramBld );
+            BN_free( n );
+            BN_free( e );
+
+            return pkey;
+        }
+#else
+        // takes n and e
+        EVP_PKEY* rsaPublicKeyFromData( BIGNUM* n, BIGNUM* e )
+        {
+            EVP_PKEY* pkey = nullptr;
+            RSA* rsa = RSA_new();
+
+            if ( !( rsa ) )
+            {
+                BN_free( n );
+                BN_free( e );
+
+                return nullptr;
+            }
+
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+            if ( RSA_set0_key( rsa, n, e, nullptr ) != 1 )
+            {
+                BN_free( n );
+                BN_free( e );
+                RSA_free( rsa );
+
+                return nullptr;
+            }
+#else
+            rsa->n = n;
+            rsa->e = e;
+#endif
+
+            pkey = EVP_PKEY_new();
+            if ( pkey && ( EVP_PKEY_set1_RSA( pkey, rsa ) != 1 ) )
+            {
+                EVP_PKEY_free( pkey );
+                pkey = nullptr;
+            }
+            RSA_free( rsa );
+
+            return pkey;
+        }
+#endif
+    }
+
     RSAPublicKey::RSAPublicKey( const std::vector< unsigned char >& nBytes,
         const std::vector< unsigned char >& eBytes )
-        : rsa( nullptr )
+        : pkey( nullptr )
     {
         if ( nBytes.empty() || eBytes.empty() )
         {
             throw std::runtime_error( "n or e is empty" );
         }
 
-        rsa = RSA_new();
-        if ( !( rsa ) )
+        BIGNUM* n = BN_bin2bn( nBytes.data(), static_cast< int >( nBytes.size() ), nullptr );
+        BIGNUM* e = BN_bin2bn( eBytes.data(), static_cast< int >( eBytes.size() ), nullptr );
+        if ( !( n ) || !( e ) )
         {
-            throw std::runtime_error( "" );
+            BN_free( n );
+            BN_free( e );
+
+            throw std::runtime_error( "failed to convert n or e" );
         }
 
-        rsa->n = BN_bin2bn( nBytes.data(), nBytes.size(), nullptr );
-        rsa->e = BN_bin2bn( eBytes.data(), eBytes.size(), nullptr );
+        pkey = rsaPublicKeyFromData( n, e );
+        if ( !( pkey ) )
+        {
+            throw std::runtime_error( "failed to build rsa public key" );
+        }
     }
 
     int RSAPublicKey::GetPEMFormatInto( std::string& pemOut ) const
@@ -48,7 +140,7 @@ namespace LHWSUtilImplNS
 
             rc = BIO_set_close( bioMem, BIO_CLOSE );
 
-            rc = PEM_write_bio_RSA_PUBKEY( bioMem, rsa );
+            rc = PEM_write_bio_PUBKEY( bioMem, pkey );
             if ( rc != 1 )
             {
                 wsUtilLogError( "failed to write rsa pubkey to bio" );
@@ -79,12 +171,17 @@ namespace LHWSUtilImplNS
         }
     }
 
+    EVP_PKEY* RSAPublicKey::GetKey() const
+    {
+        return pkey;
+    }
+
     RSAPublicKey::~RSAPublicKey()
     {
-        if ( rsa )
+        if ( pkey )
         {
-            RSA_free( rsa );
-            rsa = nullptr;
+            EVP_PKEY_free( pkey );
+            pkey = nullptr;
         }
     }
 }
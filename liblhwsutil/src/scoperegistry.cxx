@@ -0,0 +1,148 @@
+#include <lhwsutil/ijwtvalidator.h>
+#include <lhwsutil/logging.h>
+#include <lhwsutil/scoperegistry.h>
+
+#include <cstring>
+#include <stdexcept>
+
+namespace LHWSUtilNS
+{
+    namespace
+    {
+        // fnv-1a, hashes the token in place where std::hash would need a std::string
+        size_t hashScope( const char* scope, size_t scopeSize )
+        {
+            uint64_t hash = 14695981039346656037ULL;
+            for ( size_t i = 0; i < scopeSize; ++i )
+            {
+                hash ^= static_cast< unsigned char >( scope[ i ] );
+                hash *= 1099511628211ULL;
+            }
+
+            return static_cast< size_t >( hash );
+        }
+    }
+
+    ScopeRegistry::ScopeRegistry()
+        : names()
+        , slots( numSlots, 0 )
+    {
+    }
+
+    size_t ScopeRegistry::RegisterScope( const std::string& scope )
+    {
+        if ( scope.empty() || ( scope.find( ' ' ) != std::string::npos ) )
+        {
+            throw std::runtime_error( "invalid scope [" + scope + "]" );
+        }
+
+        size_t hash = hashScope( scope.data(), scope.size() );
+        for ( size_t probe = 0; probe < numSlots; ++probe )
+        {
+            uint8_t& slot( slots[ ( hash + probe ) % numSlots ] );
+            if ( slot == 0 )
+            {
+                if ( names.size() >= maxRegisteredScopes )
+                {
+                    throw std::runtime_error( "too many scopes registered" );
+                }
+
+                names.push_back( scope );
+                slot = static_cast< uint8_t >( names.size() );
+                return names.size() - 1;
+            }
+            else if ( names[ slot - 1 ] == scope )
+            {
+                return slot - 1;
+            }
+        }
+
+        throw std::runtime_error( "too many scopes registered" );
+    }
+
+    ScopeSet ScopeRegistry::RegisterScopes( const std::vector< std::string >& scopes )
+    {
+        ScopeSet scopeSet;
+
+        for ( auto it = scopes.cbegin(); it != scopes.cend(); ++it )
+        {
+            scopeSet.set( RegisterScope( *it ) );
+        }
+
+        return scopeSet;
+    }
+
+    int ScopeRegistry::FindScope( const char* scope, size_t scopeSize, size_t& bit ) const
+    {
+        size_t hash = hashScope( scope, scopeSize );
+        for ( size_t probe = 0; probe < numSlots; ++probe )
+        {
+            uint8_t slot( slots[ ( hash + probe ) % numSlots ] );
+            if ( slot == 0 )
+            {
+                return 1;
+            }
+
+            const std::string& name( names[ slot - 1 ] );
+            if ( ( name.size() == scopeSize ) && ( std::memcmp( name.data(), scope, scopeSize ) == 0 ) )
+            {
+                bit = slot - 1;
+                return 0;
+            }
+        }
+
+        return 1;
+    }
+
+    void ScopeRegistry::ParseScopes( const char* scopesStr, size_t scopesStrSize, ScopeSet& scopes ) const
+    {
+        const char* end = scopesStr + scopesStrSize;
+        const char* tokenStart = scopesStr;
+
+        while ( tokenStart < end )
+        {
+            const char* tokenEnd = static_cast< const char* >(
+                std::memchr( tokenStart, ' ', end - tokenStart ) );
+            if ( !( tokenEnd ) )
+            {
+                tokenEnd = end;
+            }
+
+            size_t bit = 0;
+            if ( ( tokenEnd > tokenStart ) && ( FindScope( tokenStart, tokenEnd - tokenStart, bit ) == 0 ) )
+            {
+                scopes.set( bit );
+            }
+
+            tokenStart = tokenEnd + 1;
+        }
+    }
+
+    size_t ScopeRegistry::NumScopes() const
+    {
+        return names.size();
+    }
+
+    const std::string& ScopeRegistry::ScopeName( size_t bit ) const
+    {
+        return names.at( bit );
+    }
+
+    int GetScopes( const IValidJwt& jwt, const ScopeRegistry& registry, ScopeSet& scopes )
+    {
+        // keeps its capacity between calls so the claim is copied without allocating
+        thread_local std::string scopesStr;
+        int rc = 0;
+
+        rc = jwt.GetGrantStrValue( "scope", scopesStr );
+        if( rc != 0 )
+        {
+            wsUtilLogError( "jwt is missing scope" );
+            return 1;
+        }
+
+        registry.ParseScopes( scopesStr.data(), scopesStr.size(), scopes );
+
+        return 0;
+    }
+}
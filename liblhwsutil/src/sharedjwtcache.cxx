@@ -0,0 +1,980 @@
+#include <openssl/sha.h>
+
+#include <lhwsutil_impl/keyhash.h>
+#include <lhwsutil_impl/metricsregistry.h>
+#include <lhwsutil_impl/probes.h>
+#include <lhwsutil_impl/sharedjwtcache.h>
+
+#include <lhwsutil/logging.h>
+#include <lhwsutil/staticjwtvalidator.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace LHWSUtilNS
+{
+    std::shared_ptr< ISharedJwtCache > GetSharedJwtCache( const SharedJwtCacheParams& params )
+    {
+        return std::make_shared< LHWSUtilImplNS::SharedJwtCache >( params );
+    }
+}
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        const uint64_t segmentMagic = 0x6c6877736a777463ULL;
+        // bumped whenever the segment's layout or the issuer record changes
+        const uint32_t segmentVersion = 4;
+        const size_t maxSegmentIssuers = 1 << 16;
+        const size_t minSegmentIssuerBytes = 256;
+        const size_t maxSegmentIssuerBytes = 16 * 1024 * 1024;
+        const size_t maxSegmentResults = 1 << 24;
+        // copies of a slot attempted while its writer is mid write, which takes a memcpy
+        const int maxReadTries = 64;
+        const size_t numJwtAlgs = 9;
+        // how often a reader whose segment was retired tries to map the one which replaced it
+        const int64_t remapIntervalMs = 1000;
+
+        int64_t steadyNowMs()
+        {
+            return std::chrono::duration_cast< std::chrono::milliseconds >(
+                std::chrono::steady_clock::now().time_since_epoch() ).count();
+        }
+
+        size_t alignedSize( size_t size )
+        {
+            return ( size + 63 ) & ~static_cast< size_t >( 63 );
+        }
+
+        // 0 marks a slot never published
+        uint64_t issuerHash( const char* iss, size_t issSize )
+        {
+            uint64_t hash = FinishKeyHash( ExtendKeyHash( keyHashSeed, iss, issSize ) );
+
+            return ( hash == 0 ) ? 1 : hash;
+        }
+
+        void appendRecordU32( uint32_t value, std::string& recordOut )
+        {
+            recordOut.append( reinterpret_cast< const char* >( &value ), sizeof( value ) );
+        }
+
+        void appendRecordStr( const LHWSUtilNS::JwtIssuerStr& str, std::string& recordOut )
+        {
+            appendRecordU32( static_cast< uint32_t >( str.size ), recordOut );
+            recordOut.append( str.data, str.size );
+        }
+
+        void appendRecordStr( const std::string& str, std::string& recordOut )
+        {
+            appendRecordStr( LHWSUtilNS::JwtIssuerStr( str.data(), str.size() ), recordOut );
+        }
+
+        // return 0 and advance record past the value if there is one
+        int readRecordU32( const char*& record, const char* recordEnd, uint32_t& valueOut )
+        {
+            if ( static_cast< size_t >( recordEnd - record ) < sizeof( valueOut ) )
+            {
+                return 1;
+            }
+
+            std::memcpy( &valueOut, record, sizeof( valueOut ) );
+            record += sizeof( valueOut );
+
+            return 0;
+        }
+
+        int readRecordStr( const char*& record, const char* recordEnd, std::string& strOut )
+        {
+            uint32_t size = 0;
+            if ( ( readRecordU32( record, recordEnd, size ) != 0 ) ||
+                ( static_cast< size_t >( recordEnd - record ) < size ) )
+            {
+                return 1;
+            }
+
+            strOut.assign( record, size );
+            record += size;
+
+            return 0;
+        }
+
+        void digestJwt( const std::string& b64UrlEncodedJwt, uint64_t digestOut[ 4 ] )
+        {
+            unsigned char digest[ SHA256_DIGEST_LENGTH ];
+
+            SHA256( reinterpret_cast< const unsigned char* >( b64UrlEncodedJwt.data() ), b64UrlEncodedJwt.size(), digest );
+            std::memcpy( digestOut, digest, sizeof( digest ) );
+        }
+
+        // readers of the local issuers only hash and compare iss, so this does not wait long
+        void waitForLocalReaders( const std::atomic< size_t >& readers )
+        {
+            while ( readers.load() != 0 )
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void SerializeJwtIssuer( const JwtIssuer& jwtIssuer, std::string& recordOut )
+    {
+        std::vector< std::pair< LHWSUtilNS::JwtAlg, std::string > > algKeyPems;
+        std::vector< std::pair< std::string, std::string > > namedAlgKeyPems;
+        jwtIssuer.GetKeys( algKeyPems, namedAlgKeyPems );
+
+        recordOut.clear();
+        appendRecordStr( jwtIssuer.GetUrlView(), recordOut );
+        appendRecordStr( jwtIssuer.GetClientAuthzBearerTokenView(), recordOut );
+        appendRecordStr( jwtIssuer.GetIntrospectionEndpoint(), recordOut );
+        appendRecordStr( jwtIssuer.GetJwksUri(), recordOut );
+
+        appendRecordU32( static_cast< uint32_t >( algKeyPems.size() ), recordOut );
+        for ( const auto& algKeyPem : algKeyPems )
+        {
+            appendRecordU32( static_cast< uint32_t >( algKeyPem.first ), recordOut );
+            appendRecordStr( algKeyPem.second, recordOut );
+        }
+
+        appendRecordU32( static_cast< uint32_t >( namedAlgKeyPems.size() ), recordOut );
+        for ( const auto& namedAlgKeyPem : namedAlgKeyPems )
+        {
+            appendRecordStr( namedAlgKeyPem.first, recordOut );
+            appendRecordStr( namedAlgKeyPem.second, recordOut );
+        }
+    }
+
+    int ParseJwtIssuerRecord( const char* record, size_t recordSize, JwtIssuerFields& fieldsOut )
+    {
+        const char* recordEnd = record + recordSize;
+        uint32_t numKeys = 0;
+
+        if ( ( readRecordStr( record, recordEnd, fieldsOut.url ) != 0 ) ||
+            ( readRecordStr( record, recordEnd, fieldsOut.clientAuthzBearerToken ) != 0 ) ||
+            ( readRecordStr( record, recordEnd, fieldsOut.introspectionEndpoint ) != 0 ) ||
+            ( readRecordStr( record, recordEnd, fieldsOut.jwksUri ) != 0 ) ||
+            ( readRecordU32( record, recordEnd, numKeys ) != 0 ) ||
+            ( numKeys > numJwtAlgs ) )
+        {
+            return 1;
+        }
+
+        fieldsOut.algKeyPems.clear();
+        for ( uint32_t i = 0; i < numKeys; ++i )
+        {
+            uint32_t alg = 0;
+            fieldsOut.algKeyPems.emplace_back();
+            if ( ( readRecordU32( record, recordEnd, alg ) != 0 ) ||
+                ( alg >= numJwtAlgs ) ||
+                ( readRecordStr( record, recordEnd, fieldsOut.algKeyPems.back().second ) != 0 ) )
+            {
+                return 2;
+            }
+            fieldsOut.algKeyPems.back().first = static_cast< LHWSUtilNS::JwtAlg >( alg );
+        }
+
+        uint32_t numNamedKeys = 0;
+        if ( readRecordU32( record, recordEnd, numNamedKeys ) != 0 )
+        {
+            return 4;
+        }
+
+        fieldsOut.namedAlgKeyPems.clear();
+        for ( uint32_t i = 0; i < numNamedKeys; ++i )
+        {
+            fieldsOut.namedAlgKeyPems.emplace_back();
+            if ( ( readRecordStr( record, recordEnd, fieldsOut.namedAlgKeyPems.back().first ) != 0 ) ||
+                ( readRecordStr( record, recordEnd, fieldsOut.namedAlgKeyPems.back().second ) != 0 ) )
+            {
+                return 5;
+            }
+        }
+
+        return ( record == recordEnd ) ? 0 : 3;
+    }
+
+    SharedJwtCache::Segment::Segment()
+        : base( MAP_FAILED )
+        , size( 0 )
+        , header( nullptr )
+        , issuerSlots( nullptr )
+        , issuerSlotBytes( 0 )
+        , numIssuerSlots( 0 )
+        , maxIssuerBytes( 0 )
+        , resultSlots( nullptr )
+        , resultSlotMask( 0 )
+    {
+    }
+
+    SharedJwtCache::Segment::~Segment()
+    {
+        if ( base != MAP_FAILED )
+        {
+            munmap( base, size );
+        }
+    }
+
+    SharedJwtCache::IssuerSlot& SharedJwtCache::Segment::issuerSlot( size_t slot ) const
+    {
+        return *reinterpret_cast< IssuerSlot* >( issuerSlots + ( slot * issuerSlotBytes ) );
+    }
+
+    SharedJwtCache::SharedJwtCache( const LHWSUtilNS::SharedJwtCacheParams& _params )
+        : LHWSUtilNS::ISharedJwtCache()
+        , role( _params.role )
+        , name( _params.name )
+        , writerPid( 0 )
+        , resultLifetimeSeconds( _params.resultLifetimeSeconds )
+        , cacheMutex()
+        , localView( nullptr )
+        , ownedLocalView( new LocalView() )
+        , localReadEpoch( 0 )
+        , localReaders()
+        , nextRemapAt( 0 )
+        , issToLoadedParams()
+        , publishMutex()
+    {
+        wsUtilLogSetScope( "SharedJwtCache" );
+
+        localReaders[ 0 ].store( 0 );
+        localReaders[ 1 ].store( 0 );
+
+        if ( ( name.size() < 2 ) || ( name[ 0 ] != '/' ) || ( name.find( '/', 1 ) != std::string::npos ) )
+        {
+            throw std::runtime_error( "shared cache name=[" + name + "] is not a '/' followed by a name" );
+        }
+
+        std::atomic< uint64_t > probe( 0 );
+        if ( !( probe.is_lock_free() ) )
+        {
+            throw std::runtime_error( "64 bit atomics are not lock free, they cannot be shared between processes" );
+        }
+
+        if ( role == LHWSUtilNS::SharedJwtCacheRole::Writer )
+        {
+            ownedLocalView->segment = createSegment( _params );
+            writerPid = getpid();
+        }
+        else
+        {
+            ownedLocalView->segment = openSegment();
+        }
+        localView.store( ownedLocalView.get() );
+
+        const Segment& segment( *( ownedLocalView->segment ) );
+        wsUtilLogInfo( "mapped shared cache=[" << name << "] of " << segment.size << " bytes, " <<
+            segment.numIssuerSlots << " issuers and " << ( segment.resultSlots ? ( segment.resultSlotMask + 1 ) : 0 ) <<
+            " results" );
+    }
+
+    SharedJwtCache::~SharedJwtCache()
+    {
+        // a process forked from the writer which exits leaves the segment to the writer
+        if ( ( role == LHWSUtilNS::SharedJwtCacheRole::Writer ) && ( writerPid == getpid() ) )
+        {
+            ownedLocalView->segment->header->retired.store( 1, std::memory_order_release );
+            shm_unlink( name.c_str() );
+        }
+    }
+
+    std::shared_ptr< SharedJwtCache::Segment > SharedJwtCache::createSegment(
+        const LHWSUtilNS::SharedJwtCacheParams& params ) const
+    {
+        if ( ( params.maxIssuers == 0 ) || ( params.maxIssuers > maxSegmentIssuers ) ||
+            ( params.maxIssuerBytes < minSegmentIssuerBytes ) || ( params.maxIssuerBytes > maxSegmentIssuerBytes ) ||
+            ( params.maxResults > maxSegmentResults ) )
+        {
+            throw std::runtime_error( "shared cache maxIssuers, maxIssuerBytes or maxResults is out of range" );
+        }
+
+        std::shared_ptr< Segment > segment( std::make_shared< Segment >() );
+        size_t numResultSlots = 0;
+        segment->numIssuerSlots = params.maxIssuers;
+        segment->maxIssuerBytes = params.maxIssuerBytes;
+        if ( params.maxResults > 0 )
+        {
+            numResultSlots = 1;
+            while ( numResultSlots < params.maxResults )
+            {
+                numResultSlots <<= 1;
+            }
+        }
+
+        // replaces the segment of an earlier writer, readers which still map it keep it until they
+        // find it retired
+        retireSegment();
+        if ( ( shm_unlink( name.c_str() ) != 0 ) && ( errno != ENOENT ) )
+        {
+            wsUtilLogError( "failed to unlink shared cache=[" << name << "], errno=" << errno );
+        }
+
+        int fd = shm_open( name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR );
+        if ( fd < 0 )
+        {
+            std::ostringstream oss;
+
+            oss << "failed to open shared cache=[" << name << "], errno=" << errno;
+
+            throw std::runtime_error( oss.str() );
+        }
+
+        segment->issuerSlotBytes = alignedSize( sizeof( IssuerSlot ) + segment->maxIssuerBytes );
+        segment->size = alignedSize( sizeof( SegmentHeader ) ) + ( segment->numIssuerSlots * segment->issuerSlotBytes ) +
+            ( numResultSlots * sizeof( ResultSlot ) );
+        if ( ftruncate( fd, static_cast< off_t >( segment->size ) ) != 0 )
+        {
+            int ftruncateErrno = errno;
+            close( fd );
+            shm_unlink( name.c_str() );
+
+            std::ostringstream oss;
+
+            oss << "failed to size shared cache=[" << name << "] to " << segment->size << " bytes, errno=" << ftruncateErrno;
+
+            throw std::runtime_error( oss.str() );
+        }
+
+        segment->base = mmap( nullptr, segment->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close( fd );
+        if ( segment->base == MAP_FAILED )
+        {
+            int mmapErrno = errno;
+            shm_unlink( name.c_str() );
+
+            std::ostringstream oss;
+
+            oss << "failed to map shared cache=[" << name << "], errno=" << mmapErrno;
+
+            throw std::runtime_error( oss.str() );
+        }
+
+        // the segment is zero filled, the atomics are constructed over it all the same
+        segment->header = new ( segment->base ) SegmentHeader();
+        segment->header->version = segmentVersion;
+        segment->header->numIssuerSlots = static_cast< uint32_t >( segment->numIssuerSlots );
+        segment->header->maxIssuerBytes = segment->maxIssuerBytes;
+        segment->header->numResultSlots = numResultSlots;
+
+        segment->issuerSlots = static_cast< char* >( segment->base ) + alignedSize( sizeof( SegmentHeader ) );
+        for ( size_t i = 0; i < segment->numIssuerSlots; ++i )
+        {
+            new ( &( segment->issuerSlot( i ) ) ) IssuerSlot();
+        }
+        if ( numResultSlots > 0 )
+        {
+            segment->resultSlots = reinterpret_cast< ResultSlot* >(
+                segment->issuerSlots + ( segment->numIssuerSlots * segment->issuerSlotBytes ) );
+            segment->resultSlotMask = numResultSlots - 1;
+            for ( size_t i = 0; i < numResultSlots; ++i )
+            {
+                new ( &( segment->resultSlots[ i ] ) ) ResultSlot();
+            }
+        }
+
+        segment->header->magic.store( segmentMagic, std::memory_order_release );
+
+        return segment;
+    }
+
+    std::shared_ptr< SharedJwtCache::Segment > SharedJwtCache::openSegment() const
+    {
+        int fd = shm_open( name.c_str(), O_RDWR, 0 );
+        if ( fd < 0 )
+        {
+            std::ostringstream oss;
+
+            oss << "failed to open shared cache=[" << name << "], errno=" << errno;
+
+            throw std::runtime_error( oss.str() );
+        }
+
+        std::shared_ptr< Segment > segment( std::make_shared< Segment >() );
+        struct stat segmentStat;
+        if ( ( fstat( fd, &segmentStat ) != 0 ) ||
+            ( static_cast< size_t >( segmentStat.st_size ) < alignedSize( sizeof( SegmentHeader ) ) ) )
+        {
+            close( fd );
+
+            throw std::runtime_error( "shared cache=[" + name + "] has not been created by a writer" );
+        }
+        segment->size = static_cast< size_t >( segmentStat.st_size );
+
+        segment->base = mmap( nullptr, segment->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        close( fd );
+        if ( segment->base == MAP_FAILED )
+        {
+            std::ostringstream oss;
+
+            oss << "failed to map shared cache=[" << name << "], errno=" << errno;
+
+            throw std::runtime_error( oss.str() );
+        }
+
+        segment->header = static_cast< SegmentHeader* >( segment->base );
+        if ( ( segment->header->magic.load( std::memory_order_acquire ) != segmentMagic ) ||
+            ( segment->header->version != segmentVersion ) )
+        {
+            throw std::runtime_error( "shared cache=[" + name + "] is not ready or of another version" );
+        }
+
+        if ( segment->header->retired.load( std::memory_order_acquire ) != 0 )
+        {
+            throw std::runtime_error( "shared cache=[" + name + "] is retired" );
+        }
+
+        size_t numResultSlots = segment->header->numResultSlots;
+        segment->numIssuerSlots = segment->header->numIssuerSlots;
+        segment->maxIssuerBytes = segment->header->maxIssuerBytes;
+        segment->issuerSlotBytes = alignedSize( sizeof( IssuerSlot ) + segment->maxIssuerBytes );
+        if ( segment->size < ( alignedSize( sizeof( SegmentHeader ) ) + ( segment->numIssuerSlots * segment->issuerSlotBytes ) +
+            ( numResultSlots * sizeof( ResultSlot ) ) ) )
+        {
+            throw std::runtime_error( "shared cache=[" + name + "] is smaller than its layout" );
+        }
+
+        segment->issuerSlots = static_cast< char* >( segment->base ) + alignedSize( sizeof( SegmentHeader ) );
+        if ( numResultSlots > 0 )
+        {
+            segment->resultSlots = reinterpret_cast< ResultSlot* >(
+                segment->issuerSlots + ( segment->numIssuerSlots * segment->issuerSlotBytes ) );
+            segment->resultSlotMask = numResultSlots - 1;
+        }
+
+        return segment;
+    }
+
+    void SharedJwtCache::retireSegment() const
+    {
+        // an earlier writer which exited retired and unlinked its own, one which died did not
+        int fd = shm_open( name.c_str(), O_RDWR, 0 );
+        if ( fd < 0 )
+        {
+            return;
+        }
+
+        struct stat segmentStat;
+        void* base = MAP_FAILED;
+        if ( ( fstat( fd, &segmentStat ) == 0 ) &&
+            ( static_cast< size_t >( segmentStat.st_size ) >= alignedSize( sizeof( SegmentHeader ) ) ) )
+        {
+            base = mmap( nullptr, alignedSize( sizeof( SegmentHeader ) ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+        }
+        close( fd );
+
+        if ( base != MAP_FAILED )
+        {
+            SegmentHeader* header = static_cast< SegmentHeader* >( base );
+            if ( ( header->magic.load( std::memory_order_acquire ) == segmentMagic ) &&
+                ( header->version == segmentVersion ) )
+            {
+                header->retired.store( 1, std::memory_order_release );
+            }
+            munmap( base, alignedSize( sizeof( SegmentHeader ) ) );
+        }
+    }
+
+    bool SharedJwtCache::remapDue( const Segment& segment ) const
+    {
+        return ( role == LHWSUtilNS::SharedJwtCacheRole::Reader ) &&
+            ( segment.header->retired.load( std::memory_order_relaxed ) != 0 ) &&
+            ( steadyNowMs() >= nextRemapAt.load( std::memory_order_relaxed ) );
+    }
+
+    // assume lock held
+    void SharedJwtCache::remap()
+    {
+        wsUtilLogSetScope( "SharedJwtCache.remap" );
+
+        std::unique_ptr< LocalView > view( new LocalView() );
+        try
+        {
+            view->segment = openSegment();
+        }
+        catch ( const std::exception& e )
+        {
+            // a writer may not have replaced the segment yet, it is tried again after an interval
+            nextRemapAt.store( steadyNowMs() + remapIntervalMs, std::memory_order_relaxed );
+            wsUtilLogDebug( "keeping retired shared cache=[" << name << "], e=[" << e.what() << "]" );
+
+            return;
+        }
+
+        // the issuers are built again from the new segment's slots as they are looked up
+        replaceLocalView( std::move( view ) );
+
+        wsUtilLogInfo( "mapped shared cache=[" << name << "] again after its writer replaced it" );
+    }
+
+    void SharedJwtCache::checkWriter() const
+    {
+        if ( role != LHWSUtilNS::SharedJwtCacheRole::Writer )
+        {
+            throw std::runtime_error( "issuers of shared cache=[" + name + "] are loaded by its writer" );
+        }
+
+        if ( writerPid != getpid() )
+        {
+            throw std::runtime_error( "issuers of shared cache=[" + name + "] are loaded by the process which created it" );
+        }
+    }
+
+    void SharedJwtCache::LoadIssuer( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams )
+    {
+        wsUtilLogSetScope( "SharedJwtCache.LoadIssuer" );
+
+        checkWriter();
+
+        if ( cacheParams.iss.empty() )
+        {
+            throw std::runtime_error( "cacheParams.iss is empty" );
+        }
+
+        {
+            const std::lock_guard<TimedMutex> lock( cacheMutex );
+
+            if ( !( issToLoadedParams.emplace( cacheParams.iss, cacheParams ).second ) )
+            {
+                std::ostringstream oss;
+
+                oss << "issuer=[" << cacheParams.iss << "] is already in the cache";
+
+                throw std::runtime_error( oss.str() );
+            }
+        }
+
+        GetMetricsRegistry().RegisterIssuer( cacheParams.iss );
+
+        // one which fails is loaded again by Refresh
+        std::shared_ptr< JwtIssuer > jwtIssuer;
+        if ( ( LoadJwtIssuer( cacheParams, jwtIssuer ) != 0 ) || ( publish( *jwtIssuer ) != 0 ) )
+        {
+            wsUtilLogError( "failed to load issuer=[" << cacheParams.iss << "] into shared cache=[" << name << "]" );
+        }
+    }
+
+    size_t SharedJwtCache::Refresh()
+    {
+        wsUtilLogSetScope( "SharedJwtCache.Refresh" );
+
+        checkWriter();
+
+        std::vector< LHWSUtilNS::JwtIssuerCacheParams > loadedParams;
+        {
+            const std::lock_guard<TimedMutex> lock( cacheMutex );
+
+            for ( auto it = issToLoadedParams.cbegin(); it != issToLoadedParams.cend(); ++it )
+            {
+                loadedParams.push_back( it->second );
+            }
+        }
+
+        size_t numFailed = 0;
+        for ( const LHWSUtilNS::JwtIssuerCacheParams& cacheParams : loadedParams )
+        {
+            std::shared_ptr< JwtIssuer > jwtIssuer;
+            try
+            {
+                if ( ( LoadJwtIssuer( cacheParams, jwtIssuer ) != 0 ) || ( publish( *jwtIssuer ) != 0 ) )
+                {
+                    wsUtilLogError( "failed to refresh issuer=[" << cacheParams.iss << "]" );
+                    ++numFailed;
+                }
+            }
+            catch ( const std::exception& e )
+            {
+                wsUtilLogError( "failed to refresh issuer=[" << cacheParams.iss << "], e=[" << e.what() << "]" );
+                ++numFailed;
+            }
+        }
+
+        return numFailed;
+    }
+
+    int SharedJwtCache::publish( const JwtIssuer& jwtIssuer )
+    {
+        wsUtilLogSetScope( "SharedJwtCache.publish" );
+
+        // the writer's segment is never replaced, the view only keeps it mapped
+        LocalViewReader localReader( *this );
+        const Segment& segment( *( localReader.view->segment ) );
+
+        std::string record;
+        SerializeJwtIssuer( jwtIssuer, record );
+        if ( record.size() > segment.maxIssuerBytes )
+        {
+            wsUtilLogError( "issuer=[" << jwtIssuer.GetUrlView().data << "] takes " << record.size() <<
+                " bytes, more than segment.maxIssuerBytes=" << segment.maxIssuerBytes );
+
+            return 1;
+        }
+
+        const std::lock_guard< std::mutex > lock( publishMutex );
+        LHWSUtilNS::JwtIssuerStr url( jwtIssuer.GetUrlView() );
+        uint64_t hash = issuerHash( url.data, url.size );
+        size_t slot = 0;
+        size_t probe = 0;
+        std::string slotRecord;
+        uint32_t slotSeq = 0;
+        // its own slot if published before, otherwise the first never published
+        if ( readIssuerRecord( segment, url.str(), slot, slotSeq, slotRecord ) != 0 )
+        {
+            for ( ; probe < segment.numIssuerSlots; ++probe )
+            {
+                slot = ( hash + probe ) % segment.numIssuerSlots;
+                if ( segment.issuerSlot( slot ).seq.load( std::memory_order_relaxed ) == 0 )
+                {
+                    break;
+                }
+            }
+        }
+
+        if ( probe == segment.numIssuerSlots )
+        {
+            wsUtilLogError( "shared cache=[" << name << "] has no slot left for issuer=[" << url.data << "]" );
+
+            return 2;
+        }
+
+        // the only writer, the seq can be set without an exchange
+        IssuerSlot& issuer( segment.issuerSlot( slot ) );
+        uint32_t seq = issuer.seq.load( std::memory_order_relaxed );
+        issuer.seq.store( seq + 1, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+        issuer.issHash.store( hash, std::memory_order_relaxed );
+        issuer.recordSize.store( static_cast< uint32_t >( record.size() ), std::memory_order_relaxed );
+        std::memcpy( reinterpret_cast< char* >( &issuer ) + sizeof( IssuerSlot ), record.data(), record.size() );
+        issuer.seq.store( seq + 2, std::memory_order_release );
+
+        wsUtilLogDebug( "published issuer=[" << url.data << "] of " << record.size() << " bytes" );
+
+        return 0;
+    }
+
+    int SharedJwtCache::readIssuerRecord( const Segment& segment,
+        const std::string& iss,
+        size_t& slotOut,
+        uint32_t& seqOut,
+        std::string& recordOut ) const
+    {
+        uint64_t hash = issuerHash( iss.data(), iss.size() );
+
+        for ( size_t probe = 0; probe < segment.numIssuerSlots; ++probe )
+        {
+            size_t slot = ( hash + probe ) % segment.numIssuerSlots;
+            const IssuerSlot& issuer( segment.issuerSlot( slot ) );
+            const char* record = reinterpret_cast< const char* >( &issuer ) + sizeof( IssuerSlot );
+
+            for ( int tries = 0; tries < maxReadTries; ++tries )
+            {
+                uint32_t seq = issuer.seq.load( std::memory_order_acquire );
+                if ( seq == 0 )
+                {
+                    // never published, nor any slot probed after it
+                    return 1;
+                }
+
+                if ( ( seq & 1 ) != 0 )
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                uint64_t slotHash = issuer.issHash.load( std::memory_order_relaxed );
+                uint32_t recordSize = issuer.recordSize.load( std::memory_order_relaxed );
+                if ( ( slotHash == hash ) && ( recordSize <= segment.maxIssuerBytes ) )
+                {
+                    recordOut.assign( record, recordSize );
+                }
+                std::atomic_thread_fence( std::memory_order_acquire );
+                if ( issuer.seq.load( std::memory_order_relaxed ) != seq )
+                {
+                    continue;
+                }
+
+                uint32_t urlSize = 0;
+                if ( ( slotHash == hash ) && ( recordSize <= segment.maxIssuerBytes ) &&
+                    ( recordOut.size() >= sizeof( urlSize ) ) )
+                {
+                    std::memcpy( &urlSize, recordOut.data(), sizeof( urlSize ) );
+                    if ( ( urlSize == iss.size() ) && ( recordOut.size() >= ( sizeof( urlSize ) + urlSize ) ) &&
+                        ( recordOut.compare( sizeof( urlSize ), urlSize, iss ) == 0 ) )
+                    {
+                        slotOut = slot;
+                        seqOut = seq;
+
+                        return 0;
+                    }
+                }
+
+                // another issuer's slot
+                break;
+            }
+        }
+
+        return 2;
+    }
+
+    bool SharedJwtCache::IssuerIsLoaded( const std::string& iss ) const
+    {
+        LocalViewReader localReader( *this );
+        size_t slot = 0;
+        uint32_t seq = 0;
+        std::string record;
+
+        return ( readIssuerRecord( *( localReader.view->segment ), iss, slot, seq, record ) == 0 );
+    }
+
+    SharedJwtCache::LocalViewReader::LocalViewReader( const SharedJwtCache& sharedJwtCache )
+        : view( nullptr )
+        , readers( &( sharedJwtCache.localReaders[ sharedJwtCache.localReadEpoch.load() & 1 ] ) )
+    {
+        readers->fetch_add( 1 );
+        view = sharedJwtCache.localView.load();
+    }
+
+    SharedJwtCache::LocalViewReader::~LocalViewReader()
+    {
+        readers->fetch_sub( 1, std::memory_order_release );
+    }
+
+    // assume lock held
+    void SharedJwtCache::replaceLocalView( std::unique_ptr< LocalView >&& view )
+    {
+        std::unique_ptr< LocalView > replacedView( std::move( ownedLocalView ) );
+
+        ownedLocalView = std::move( view );
+        localView.store( ownedLocalView.get() );
+
+        // as JwtIssuerCache::replaceFrozenIssuers, a reader which loaded replacedView counted itself
+        // under the current epoch, or under the other if it read the epoch before the last flip
+        unsigned epoch = localReadEpoch.load();
+        waitForLocalReaders( localReaders[ ( epoch + 1 ) & 1 ] );
+        localReadEpoch.store( epoch + 1 );
+        waitForLocalReaders( localReaders[ epoch & 1 ] );
+    }
+
+    std::shared_ptr< LHWSUtilNS::IJwtIssuer > SharedJwtCache::GetIssuer( const std::string& iss )
+    {
+        wsUtilLogSetScope( "SharedJwtCache.GetIssuer" );
+
+        // unchanged since it was built, the common case costs a load of the slot's seq and of the
+        // segment's retired flag, and takes no lock
+        {
+            LocalViewReader localReader( *this );
+            const LocalView& view( *( localReader.view ) );
+            auto it = view.issuers.find( iss );
+            if ( ( it != view.issuers.end() ) &&
+                ( view.segment->issuerSlot( it->second.slot ).seq.load( std::memory_order_acquire ) == it->second.seq ) &&
+                !( remapDue( *( view.segment ) ) ) )
+            {
+                MetricsRegistry::LocalShard().issuerCacheHits.Add( 1 );
+                LHWSUTIL_PROBE1( issuer_cache_hit, iss.c_str() );
+
+                return it->second.jwtIssuer;
+            }
+        }
+
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
+
+        if ( remapDue( *( ownedLocalView->segment ) ) )
+        {
+            remap();
+        }
+
+        // built by another thread while this one waited for the lock
+        const LocalView& view( *ownedLocalView );
+        auto it = view.issuers.find( iss );
+        if ( ( it != view.issuers.end() ) &&
+            ( view.segment->issuerSlot( it->second.slot ).seq.load( std::memory_order_acquire ) == it->second.seq ) )
+        {
+            MetricsRegistry::LocalShard().issuerCacheHits.Add( 1 );
+            LHWSUTIL_PROBE1( issuer_cache_hit, iss.c_str() );
+
+            return it->second.jwtIssuer;
+        }
+
+        MetricsRegistry::LocalShard().issuerCacheMisses.Add( 1 );
+        LHWSUTIL_PROBE1( issuer_cache_miss, iss.c_str() );
+
+        LocalIssuer localIssuer;
+        std::string record;
+        JwtIssuerFields fields;
+        if ( readIssuerRecord( *( view.segment ), iss, localIssuer.slot, localIssuer.seq, record ) != 0 )
+        {
+            // a previously built one outlives a slot being written for longer than the reads tried
+            if ( it != view.issuers.end() )
+            {
+                return it->second.jwtIssuer;
+            }
+
+            std::ostringstream oss;
+
+            oss << "issuer=[" << iss << "] is not in shared cache=[" << name << "]";
+
+            throw std::runtime_error( oss.str() );
+        }
+
+        if ( ParseJwtIssuerRecord( record.data(), record.size(), fields ) != 0 )
+        {
+            std::ostringstream oss;
+
+            oss << "issuer=[" << iss << "] has a malformed record in shared cache=[" << name << "]";
+
+            throw std::runtime_error( oss.str() );
+        }
+
+        localIssuer.jwtIssuer = std::make_shared< JwtIssuer >( fields );
+        wsUtilLogDebug( "built issuer=[" << iss << "] from seq=" << localIssuer.seq );
+        // the issuer replaced here is freed with its last holder, a validation holds the issuer whose
+        // key libjwt is verifying with until it is done, see JwtValidationRecorder::keyIssuer
+        std::unique_ptr< LocalView > builtView( new LocalView( view ) );
+        builtView->issuers[ iss ] = localIssuer;
+        replaceLocalView( std::move( builtView ) );
+
+        return localIssuer.jwtIssuer;
+    }
+
+    int SharedJwtCache::Freeze()
+    {
+        wsUtilLogSetScope( "SharedJwtCache.Freeze" );
+
+        wsUtilLogError( "a shared cache cannot be frozen" );
+
+        return 2;
+    }
+
+    void SharedJwtCache::Unfreeze()
+    {
+    }
+
+    bool SharedJwtCache::IsFrozen() const
+    {
+        return false;
+    }
+
+    size_t SharedJwtCache::GetMemoryUsage( std::vector< LHWSUtilNS::JwtIssuerMemoryUsage >& usageOut ) const
+    {
+        const std::lock_guard<TimedMutex> lock( cacheMutex );
+        size_t totalBytes = 0;
+
+        for ( auto it = ownedLocalView->issuers.cbegin(); it != ownedLocalView->issuers.cend(); ++it )
+        {
+            usageOut.emplace_back();
+            usageOut.back().iss = it->first;
+            usageOut.back().bytes = it->second.jwtIssuer->GetMemoryUsage();
+            totalBytes += usageOut.back().bytes;
+        }
+
+        return totalBytes;
+    }
+
+    LHWSUtilNS::SharedJwtResult SharedJwtCache::FindResult( const std::string& b64UrlEncodedJwt, long now ) const
+    {
+        LocalViewReader localReader( *this );
+        const Segment& segment( *( localReader.view->segment ) );
+        if ( !( segment.resultSlots ) )
+        {
+            return LHWSUtilNS::SharedJwtResult::Unknown;
+        }
+
+        uint64_t digest[ 4 ];
+        digestJwt( b64UrlEncodedJwt, digest );
+        const ResultSlot& slot( segment.resultSlots[ digest[ 0 ] & segment.resultSlotMask ] );
+
+        // a slot being recorded is a miss rather than waited on
+        uint32_t seq = slot.seq.load( std::memory_order_acquire );
+        if ( ( seq & 1 ) != 0 )
+        {
+            return LHWSUtilNS::SharedJwtResult::Unknown;
+        }
+
+        uint32_t result = slot.result.load( std::memory_order_relaxed );
+        int64_t expiresAt = slot.expiresAt.load( std::memory_order_relaxed );
+        bool sameDigest = true;
+        for ( size_t i = 0; i < 4; ++i )
+        {
+            sameDigest = sameDigest && ( slot.digest[ i ].load( std::memory_order_relaxed ) == digest[ i ] );
+        }
+        std::atomic_thread_fence( std::memory_order_acquire );
+        if ( ( slot.seq.load( std::memory_order_relaxed ) != seq ) || !( sameDigest ) || ( expiresAt <= now ) ||
+            ( result > static_cast< uint32_t >( LHWSUtilNS::SharedJwtResult::Inactive ) ) )
+        {
+            return LHWSUtilNS::SharedJwtResult::Unknown;
+        }
+
+        return static_cast< LHWSUtilNS::SharedJwtResult >( result );
+    }
+
+    void SharedJwtCache::RecordResult( const std::string& b64UrlEncodedJwt, bool active, long exp, long now )
+    {
+        LocalViewReader localReader( *this );
+        const Segment& segment( *( localReader.view->segment ) );
+        if ( !( segment.resultSlots ) )
+        {
+            return;
+        }
+
+        int64_t expiresAt = static_cast< int64_t >( now ) + resultLifetimeSeconds;
+        if ( ( exp > 0 ) && ( exp < expiresAt ) )
+        {
+            expiresAt = exp;
+        }
+
+        if ( expiresAt <= now )
+        {
+            return;
+        }
+
+        uint64_t digest[ 4 ];
+        digestJwt( b64UrlEncodedJwt, digest );
+        ResultSlot& slot( segment.resultSlots[ digest[ 0 ] & segment.resultSlotMask ] );
+
+        // a process which dies mid record leaves its pid in the slot, the next recorder finds it gone
+        // and takes the slot over, the processes sharing a segment share a pid namespace
+        int32_t pid = static_cast< int32_t >( getpid() );
+        int32_t recorder = 0;
+        if ( !( slot.recorder.compare_exchange_strong( recorder, pid, std::memory_order_acquire, std::memory_order_relaxed ) ) &&
+            ( ( kill( static_cast< pid_t >( recorder ), 0 ) == 0 ) || ( errno != ESRCH ) ||
+              !( slot.recorder.compare_exchange_strong( recorder, pid, std::memory_order_acquire, std::memory_order_relaxed ) ) ) )
+        {
+            return;
+        }
+
+        // odd already if the recorder taken over from died mid record
+        uint32_t seq = slot.seq.load( std::memory_order_relaxed ) | 1;
+        slot.seq.store( seq, std::memory_order_relaxed );
+        std::atomic_thread_fence( std::memory_order_release );
+
+        slot.result.store( static_cast< uint32_t >( active ?
+            LHWSUtilNS::SharedJwtResult::Active : LHWSUtilNS::SharedJwtResult::Inactive ), std::memory_order_relaxed );
+        slot.expiresAt.store( expiresAt, std::memory_order_relaxed );
+        for ( size_t i = 0; i < 4; ++i )
+        {
+            slot.digest[ i ].store( digest[ i ], std::memory_order_relaxed );
+        }
+        slot.seq.store( seq + 1, std::memory_order_release );
+        slot.recorder.store( 0, std::memory_order_release );
+    }
+
+    void SharedJwtCache::GetLockWaitStats( LockWaitStats& statsOut ) const
+    {
+        cacheMutex.GetWaitStats( statsOut );
+    }
+
+    void SharedJwtCache::ResetLockWaitStats()
+    {
+        cacheMutex.ResetWaitStats();
+    }
+}
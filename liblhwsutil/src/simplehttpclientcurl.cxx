@@ -1,11 +1,16 @@
 #include <curl/curl.h>
 
+#include <chrono>
 #include <mutex>
 #include <stdexcept>
 #include <string>
 
+#include <lhwsutil_impl/httpresponsesinks.h>
+#include <lhwsutil_impl/metricsregistry.h>
+#include <lhwsutil_impl/probes.h>
 #include <lhwsutil_impl/simplehttpclientcurl.h>
 #include <lhwsutil/logging.h>
+#include <lhwsutil/metrics.h>
 
 namespace LHWSUtilImplNS
 {
@@ -13,20 +18,109 @@ namespace LHWSUtilImplNS
     {
         struct curlWriteCallbackData
         {
+            CURL* curl;
             const std::string& url;
-            std::string& dataOut;
+            LHWSUtilNS::IHttpResponseSink& sink;
+            bool sizeChecked;
 
-            curlWriteCallbackData( const std::string& _url, std::string& _dataOut );
+            curlWriteCallbackData( CURL* _curl,
+                const std::string& _url,
+                LHWSUtilNS::IHttpResponseSink& _sink );
 
             curlWriteCallbackData() = delete;
         };
 
-        curlWriteCallbackData::curlWriteCallbackData( const std::string& _url, std::string& _dataOut )
-            : url( _url )
-            , dataOut( _dataOut )
+        curlWriteCallbackData::curlWriteCallbackData( CURL* _curl,
+            const std::string& _url,
+            LHWSUtilNS::IHttpResponseSink& _sink )
+            : curl( _curl )
+            , url( _url )
+            , sink( _sink )
+            , sizeChecked( false )
         {
         }
 
+        // headers have been read by the time the first chunk of the body arrives
+        void checkExpectedSize( curlWriteCallbackData& callbackData )
+        {
+            callbackData.sizeChecked = true;
+
+#if LIBCURL_VERSION_NUM >= 0x073700
+            curl_off_t contentLength = -1;
+            if ( ( curl_easy_getinfo( callbackData.curl,
+                CURLINFO_CONTENT_LENGTH_DOWNLOAD_T,
+                &contentLength ) == CURLE_OK ) &&
+                ( contentLength > 0 ) )
+            {
+                callbackData.sink.ExpectSize( static_cast<size_t>( contentLength ) );
+            }
+#else
+            double contentLength = -1;
+            if ( ( curl_easy_getinfo( callbackData.curl,
+                CURLINFO_CONTENT_LENGTH_DOWNLOAD,
+                &contentLength ) == CURLE_OK ) &&
+                ( contentLength > 0 ) )
+            {
+                callbackData.sink.ExpectSize( static_cast<size_t>( contentLength ) );
+            }
+#endif
+        }
+
+        // must be called before handle is reset, phase timings are only kept for requests that succeeded
+        void recordHttpRequest( CURL* handle, CURLcode rc )
+        {
+            MetricsShard& shard( MetricsRegistry::LocalShard() );
+
+            if ( rc == CURLE_OPERATION_TIMEDOUT )
+            {
+                shard.httpRequests[ static_cast<size_t>( LHWSUtilNS::HttpRequestOutcome::TimedOut ) ].Add( 1 );
+                return;
+            }
+            else if ( rc != CURLE_OK )
+            {
+                shard.httpRequests[ static_cast<size_t>( LHWSUtilNS::HttpRequestOutcome::Failed ) ].Add( 1 );
+                return;
+            }
+
+            shard.httpRequests[ static_cast<size_t>( LHWSUtilNS::HttpRequestOutcome::Ok ) ].Add( 1 );
+
+#if LIBCURL_VERSION_NUM >= 0x073d00
+            static const CURLINFO timingInfos[ LHWSUtilNS::numHttpTimings ] = {
+                CURLINFO_NAMELOOKUP_TIME_T,
+                CURLINFO_CONNECT_TIME_T,
+                CURLINFO_APPCONNECT_TIME_T,
+                CURLINFO_PRETRANSFER_TIME_T,
+                CURLINFO_STARTTRANSFER_TIME_T,
+                CURLINFO_TOTAL_TIME_T };
+
+            for ( size_t t = 0; t < LHWSUtilNS::numHttpTimings; ++t )
+            {
+                curl_off_t micros = 0;
+                if ( ( curl_easy_getinfo( handle, timingInfos[ t ], &micros ) == CURLE_OK ) && ( micros >= 0 ) )
+                {
+                    shard.httpTimings[ t ].Record( static_cast<uint64_t>( micros ) );
+                }
+            }
+#else
+            static const CURLINFO timingInfos[ LHWSUtilNS::numHttpTimings ] = {
+                CURLINFO_NAMELOOKUP_TIME,
+                CURLINFO_CONNECT_TIME,
+                CURLINFO_APPCONNECT_TIME,
+                CURLINFO_PRETRANSFER_TIME,
+                CURLINFO_STARTTRANSFER_TIME,
+                CURLINFO_TOTAL_TIME };
+
+            for ( size_t t = 0; t < LHWSUtilNS::numHttpTimings; ++t )
+            {
+                double seconds = 0;
+                if ( ( curl_easy_getinfo( handle, timingInfos[ t ], &seconds ) == CURLE_OK ) && ( seconds >= 0 ) )
+                {
+                    shard.httpTimings[ t ].Record( static_cast<uint64_t>( seconds * 1e6 ) );
+                }
+            }
+#endif
+        }
+
         size_t curlWriteCallback( char *ptr, size_t size, size_t nmemb, void *userdata )
         {
             bool failed = false;
@@ -39,7 +133,15 @@ namespace LHWSUtilImplNS
                 if ( nmemb && ptr )
                 {
                     curlWriteCallbackData* callbackData( static_cast<curlWriteCallbackData*>( userdata ) );
-                    callbackData->dataOut.append( ptr, nmemb );
+                    if ( !( callbackData->sizeChecked ) )
+                    {
+                        checkExpectedSize( *callbackData );
+                    }
+
+                    if ( callbackData->sink.Consume( ptr, nmemb ) != 0 )
+                    {
+                        failed = true;
+                    }
                 }
             }
             catch ( const std::exception& e )
@@ -83,18 +185,18 @@ namespace LHWSUtilImplNS
                 wsUtilLogSetScope( "debug_callback" );
                 if ( data && size )
                 {
-                    std::string debugLine( data, size );
                     if ( userptr )
                     {
                         std::ostringstream* oss( static_cast<std::ostringstream*>( userptr ) );
                         if ( oss )
                         {
-                            *oss << debugLine;
+                            oss->write( data, size );
                         }
                     }
                     else
                     {
-                        wsUtilLogWithSeverity( LHWSUtilNS::SeverityLevel::debug, debugLine );
+                        wsUtilLogWithSeverity( LHWSUtilNS::SeverityLevel::debug,
+                            LHWSUtilNS::LogPayload( data, size ) );
                     }
                 }
             }
@@ -106,9 +208,35 @@ namespace LHWSUtilImplNS
         }
     }
 
+    namespace
+    {
+        void setRequestOptions( CURL* curl, const LHWSUtilNS::HttpRequestParams& params )
+        {
+            // signals cannot be used to time out name resolution in multithreaded programs
+            curl_easy_setopt( curl, CURLOPT_NOSIGNAL, 1L );
+
+            if ( params.connectTimeoutMs > 0 )
+            {
+                curl_easy_setopt( curl, CURLOPT_CONNECTTIMEOUT_MS, params.connectTimeoutMs );
+            }
+
+            if ( params.timeoutMs > 0 )
+            {
+                curl_easy_setopt( curl, CURLOPT_TIMEOUT_MS, params.timeoutMs );
+            }
+        }
+
+        long millisSince( const std::chrono::steady_clock::time_point& start )
+        {
+            return static_cast<long>( std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start ).count() );
+        }
+    }
+
     SimpleHttpClientCurl::SimpleHttpClientCurl()
         : LHWSUtilNS::ISimpleHttpClient()
         , curl( nullptr )
+        , responseBuffer()
     {
         curl = curl_easy_init();
         if ( !( curl ) )
@@ -136,13 +264,30 @@ namespace LHWSUtilImplNS
     int SimpleHttpClientCurl::Get( const std::string& url,
         const LHWSUtilNS::HttpRequestParams& params,
         std::string& responseBody )
+    {
+        // the body is read into the handle's buffer and swapped out on success so that
+        // the caller's previous string becomes the buffer for the next request
+        responseBuffer.clear();
+        StringResponseSink responseSink( responseBuffer );
+
+        int ret = Get( url, params, responseSink );
+        if ( ret == 0 )
+        {
+            responseBody.swap( responseBuffer );
+        }
+
+        return ret;
+    }
+
+    int SimpleHttpClientCurl::Get( const std::string& url,
+        const LHWSUtilNS::HttpRequestParams& params,
+        LHWSUtilNS::IHttpResponseSink& responseSink )
     {
         wsUtilLogSetScope( "SimpleHttpClientCurl.Get" );
 
         CURLcode rc( CURLE_OK );
         int ret = 0;
-        std::string dataStr;
-        curlWriteCallbackData callbackData( url, dataStr );
+        curlWriteCallbackData callbackData( curl, url, responseSink );
 
         if ( !( curl ) )
         {
@@ -151,6 +296,7 @@ namespace LHWSUtilImplNS
 
         curl_easy_setopt( curl, CURLOPT_URL, url.c_str() );
         curl_easy_setopt( curl, CURLOPT_HTTPGET, 1L );
+        setRequestOptions( curl, params );
         curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, curlWriteCallback );
         curl_easy_setopt( curl, CURLOPT_WRITEDATA, &callbackData );
 
@@ -167,7 +313,17 @@ namespace LHWSUtilImplNS
         }
 
         wsUtilLogWithSeverity( logLevel, "getting url=[" << url << "], rc=" << rc );
-        rc = curl_easy_perform( curl );
+        LHWSUTIL_PROBE1( http_perform_entry, url.c_str() );
+        if ( params.hedgeAfterMs > 0 )
+        {
+            rc = performHedged( url, params, responseSink );
+        }
+        else
+        {
+            rc = curl_easy_perform( curl );
+            recordHttpRequest( curl, rc );
+        }
+        LHWSUTIL_PROBE3( http_perform_exit, url.c_str(), static_cast<int>( rc ), params.hedgeAfterMs );
         if ( params.verbose )
         {
             wsUtilLogWithSeverity( logLevel, "curl trace[" << debugOutput.str() << "]" );
@@ -176,8 +332,13 @@ namespace LHWSUtilImplNS
 
         if ( rc == CURLE_OK )
         {
-            responseBody = std::move( dataStr );
-            ret = 0;
+            ret = responseSink.Finish();
+            if ( ret != 0 )
+            {
+                wsUtilLogWithSeverity( LHWSUtilNS::SeverityLevel::info,
+                    "failed to finish response from url=[" << url << "], rc=" << ret );
+                ret = 2;
+            }
         }
         else
         {
@@ -249,12 +410,29 @@ namespace LHWSUtilImplNS
         const LHWSUtilNS::HttpRequestParams& params,
         std::string& responseBody )
     {
-        wsUtilLogSetScope( "SimpleHttpClientCurl.Get" );
+        responseBuffer.clear();
+        StringResponseSink responseSink( responseBuffer );
+
+        int ret = Post( url, data, headers, params, responseSink );
+        if ( ret == 0 )
+        {
+            responseBody.swap( responseBuffer );
+        }
+
+        return ret;
+    }
+
+    int SimpleHttpClientCurl::Post( const std::string& url,
+        const std::string& data,
+        const std::unordered_map< std::string, std::string >& headers,
+        const LHWSUtilNS::HttpRequestParams& params,
+        LHWSUtilNS::IHttpResponseSink& responseSink )
+    {
+        wsUtilLogSetScope( "SimpleHttpClientCurl.Post" );
 
         CURLcode rc;
         int ret = 0;
-        std::string dataStr;
-        curlWriteCallbackData callbackData( url, dataStr );
+        curlWriteCallbackData callbackData( curl, url, responseSink );
 
         if ( !( curl ) )
         {
@@ -265,6 +443,7 @@ namespace LHWSUtilImplNS
         curl_easy_setopt( curl, CURLOPT_POST, 1L );
         curl_easy_setopt( curl, CURLOPT_POSTFIELDSIZE, data.size() );
         curl_easy_setopt( curl, CURLOPT_POSTFIELDS, data.c_str() );
+        setRequestOptions( curl, params );
         curl_easy_setopt( curl, CURLOPT_WRITEFUNCTION, curlWriteCallback );
         curl_easy_setopt( curl, CURLOPT_WRITEDATA, &callbackData );
 
@@ -295,8 +474,18 @@ namespace LHWSUtilImplNS
             curl_easy_setopt( curl, CURLOPT_HTTPHEADER, curlSList.Get() );
         }
 
-        wsUtilLogWithSeverity( logLevel, "posting data=[" << data << "] to url=[" << url << "]" );
-        rc = curl_easy_perform( curl );
+        wsUtilLogWithSeverity( logLevel, "posting data=[" << LHWSUtilNS::LogPayload( data ) << "] to url=[" << url << "]" );
+        LHWSUTIL_PROBE1( http_perform_entry, url.c_str() );
+        if ( params.hedgeAfterMs > 0 )
+        {
+            rc = performHedged( url, params, responseSink );
+        }
+        else
+        {
+            rc = curl_easy_perform( curl );
+            recordHttpRequest( curl, rc );
+        }
+        LHWSUTIL_PROBE3( http_perform_exit, url.c_str(), static_cast<int>( rc ), params.hedgeAfterMs );
         if ( params.verbose )
         {
             wsUtilLogWithSeverity( logLevel, "curl trace[" << debugOutput.str() << "]" );
@@ -305,8 +494,13 @@ namespace LHWSUtilImplNS
 
         if ( rc == CURLE_OK )
         {
-            responseBody = std::move( dataStr );
-            ret = 0;
+            ret = responseSink.Finish();
+            if ( ret != 0 )
+            {
+                wsUtilLogWithSeverity( LHWSUtilNS::SeverityLevel::info,
+                    "failed to finish response from url=[" << url << "], rc=" << ret );
+                ret = 2;
+            }
         }
         else
         {
@@ -318,6 +512,161 @@ namespace LHWSUtilImplNS
         return ret;
     }
 
+    // assume all options except the write callback data have been set on curl
+    // both attempts are buffered, the winner's body is handed to responseSink
+    CURLcode SimpleHttpClientCurl::performHedged( const std::string& url,
+        const LHWSUtilNS::HttpRequestParams& params,
+        LHWSUtilNS::IHttpResponseSink& responseSink )
+    {
+        wsUtilLogSetScope( "SimpleHttpClientCurl.performHedged" );
+
+        CURLcode rc( CURLE_OK );
+        CURLcode primaryRc( CURLE_OK );
+        CURLcode hedgeRc( CURLE_OK );
+        bool primaryDone = false;
+        bool hedgeDone = false;
+        CURL* winner = nullptr;
+        CURL* hedge = nullptr;
+        std::string primaryBody;
+        std::string hedgeBody;
+        StringResponseSink primarySink( primaryBody );
+        StringResponseSink hedgeSink( hedgeBody );
+        curlWriteCallbackData primaryData( curl, url, primarySink );
+        curlWriteCallbackData hedgeData( nullptr, url, hedgeSink );
+        auto start( std::chrono::steady_clock::now() );
+
+        CURLM* multi = curl_multi_init();
+        if ( !( multi ) )
+        {
+            wsUtilLogError( "curl_multi_init failed, not hedging" );
+
+            rc = curl_easy_perform( curl );
+            recordHttpRequest( curl, rc );
+
+            return rc;
+        }
+
+        curl_easy_setopt( curl, CURLOPT_WRITEDATA, &primaryData );
+        curl_multi_add_handle( multi, curl );
+
+        while ( !( winner ) && !( primaryDone && ( hedgeDone || !( hedge ) ) ) )
+        {
+            int running = 0;
+            CURLMcode mrc = curl_multi_perform( multi, &running );
+            if ( mrc != CURLM_OK )
+            {
+                wsUtilLogError( "curl_multi_perform failed, mrc=" << mrc );
+                primaryRc = CURLE_FAILED_INIT;
+                break;
+            }
+
+            int msgsLeft = 0;
+            CURLMsg* msg = nullptr;
+            while ( ( msg = curl_multi_info_read( multi, &msgsLeft ) ) )
+            {
+                if ( msg->msg != CURLMSG_DONE )
+                {
+                    continue;
+                }
+
+                if ( msg->easy_handle == curl )
+                {
+                    primaryDone = true;
+                    primaryRc = msg->data.result;
+                }
+                else if ( msg->easy_handle == hedge )
+                {
+                    hedgeDone = true;
+                    hedgeRc = msg->data.result;
+                }
+
+                if ( ( msg->data.result == CURLE_OK ) && !( winner ) )
+                {
+                    winner = msg->easy_handle;
+                }
+            }
+
+            if ( winner || ( primaryDone && ( hedgeDone || !( hedge ) ) ) )
+            {
+                break;
+            }
+
+            long elapsedMs = millisSince( start );
+            if ( !( hedge ) && !( primaryDone ) && ( elapsedMs >= params.hedgeAfterMs ) &&
+                ( ( params.timeoutMs <= 0 ) || ( elapsedMs < params.timeoutMs ) ) )
+            {
+                hedge = curl_easy_duphandle( curl );
+                if ( hedge )
+                {
+                    wsUtilLogDebug( "hedging url=[" << url << "] after " << elapsedMs << "ms" );
+                    MetricsRegistry::LocalShard().httpHedgedRequests.Add( 1 );
+
+                    hedgeData.curl = hedge;
+                    curl_easy_setopt( hedge, CURLOPT_WRITEDATA, &hedgeData );
+                    if ( params.timeoutMs > 0 )
+                    {
+                        // both attempts share the caller's deadline
+                        curl_easy_setopt( hedge, CURLOPT_TIMEOUT_MS, params.timeoutMs - elapsedMs );
+                    }
+                    curl_multi_add_handle( multi, hedge );
+                    continue;
+                }
+            }
+
+            int waitMs = 100;
+            if ( !( hedge ) && !( primaryDone ) )
+            {
+                long untilHedgeMs = params.hedgeAfterMs - elapsedMs;
+                if ( untilHedgeMs < waitMs )
+                {
+                    waitMs = ( untilHedgeMs > 0 ) ? static_cast<int>( untilHedgeMs ) : 0;
+                }
+            }
+
+            curl_multi_wait( multi, nullptr, 0, waitMs, nullptr );
+        }
+
+        curl_multi_remove_handle( multi, curl );
+        if ( hedge )
+        {
+            curl_multi_remove_handle( multi, hedge );
+        }
+        curl_multi_cleanup( multi );
+
+        if ( winner )
+        {
+            const std::string& winnerBody( ( winner == curl ) ? primaryBody : hedgeBody );
+
+            wsUtilLogDebug( "url=[" << url << "] answered by the "
+                << ( ( winner == curl ) ? "primary" : "hedged" ) << " request" );
+
+            responseSink.ExpectSize( winnerBody.size() );
+            if ( winnerBody.size() &&
+                ( responseSink.Consume( winnerBody.data(), winnerBody.size() ) != 0 ) )
+            {
+                rc = CURLE_WRITE_ERROR;
+            }
+        }
+        else
+        {
+            rc = ( primaryRc != CURLE_OK ) ? primaryRc : hedgeRc;
+            if ( rc == CURLE_OK )
+            {
+                rc = CURLE_OPERATION_TIMEDOUT;
+            }
+        }
+
+        recordHttpRequest( winner ? winner : curl, winner ? CURLE_OK : rc );
+
+        if ( hedge )
+        {
+            curl_easy_cleanup( hedge );
+            hedge = nullptr;
+        }
+
+        return rc;
+    }
+
     std::string SimpleHttpClientCurl::UrlEscape( const std::string& data )
     {
         if ( !( curl ) )
@@ -0,0 +1,61 @@
+#include <lhwsutil_impl/timedmutex.h>
+
+#include <chrono>
+
+namespace LHWSUtilImplNS
+{
+    LockWaitStats::LockWaitStats()
+        : contendedAcquisitions( 0 )
+        , waitNanos( 0 )
+    {
+    }
+
+    TimedMutex::TimedMutex()
+        : mutex()
+        , contendedAcquisitions( 0 )
+        , waitNanos( 0 )
+    {
+    }
+
+    TimedMutex::~TimedMutex()
+    {
+    }
+
+    void TimedMutex::lock()
+    {
+        if ( mutex.try_lock() )
+        {
+            return;
+        }
+
+        auto start( std::chrono::steady_clock::now() );
+        mutex.lock();
+        auto waited( std::chrono::steady_clock::now() - start );
+
+        contendedAcquisitions.fetch_add( 1, std::memory_order_relaxed );
+        waitNanos.fetch_add( std::chrono::duration_cast<std::chrono::nanoseconds>( waited ).count(),
+            std::memory_order_relaxed );
+    }
+
+    bool TimedMutex::try_lock()
+    {
+        return mutex.try_lock();
+    }
+
+    void TimedMutex::unlock()
+    {
+        mutex.unlock();
+    }
+
+    void TimedMutex::GetWaitStats( LockWaitStats& statsOut ) const
+    {
+        statsOut.contendedAcquisitions = contendedAcquisitions.load( std::memory_order_relaxed );
+        statsOut.waitNanos = waitNanos.load( std::memory_order_relaxed );
+    }
+
+    void TimedMutex::ResetWaitStats()
+    {
+        contendedAcquisitions.store( 0, std::memory_order_relaxed );
+        waitNanos.store( 0, std::memory_order_relaxed );
+    }
+}
@@ -0,0 +1,211 @@
+#include <lhwsutil/tracing.h>
+
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace LHWSUtilNS
+{
+    namespace
+    {
+        struct TraceSpan
+        {
+            const char* name;
+            uint32_t tid;
+            uint64_t startMicros;
+            uint64_t durationMicros;
+        };
+
+        std::atomic< bool > tracingEnabled( false );
+        std::atomic< size_t > tracingSampleEvery( 1 );
+        std::atomic< size_t > tracingMaxSpansPerTrace( 256 );
+        std::atomic< uint32_t > nextTraceTid( 1 );
+
+        std::mutex traceSpansMutex;
+        std::deque< TraceSpan > traceSpans;
+        size_t traceMaxSpans = 0;
+
+        thread_local const char* currentScopeName = "";
+        thread_local size_t scopeDepth = 0;
+        thread_local bool traceSampled = false;
+        thread_local size_t traceSampleCounter = 0;
+        thread_local uint32_t traceTid = 0;
+        // only constructed on threads that sample a trace
+        thread_local std::vector< TraceSpan > pendingSpans;
+
+        uint64_t microsSinceEpoch( std::chrono::steady_clock::time_point timePoint )
+        {
+            return std::chrono::duration_cast< std::chrono::microseconds >( timePoint.time_since_epoch() ).count();
+        }
+
+        void publishSpans( std::vector< TraceSpan >& spans )
+        {
+            const std::lock_guard< std::mutex > lock( traceSpansMutex );
+
+            for ( auto it = spans.cbegin(); it != spans.cend(); ++it )
+            {
+                traceSpans.push_back( *it );
+            }
+
+            while ( traceSpans.size() > traceMaxSpans )
+            {
+                traceSpans.pop_front();
+            }
+
+            spans.clear();
+        }
+
+        void writeJsonString( std::ostringstream& oss, const char* str )
+        {
+            oss << '"';
+            for ( const char* c = str; *c; ++c )
+            {
+                if ( ( *c == '"' ) || ( *c == '\\' ) )
+                {
+                    oss << '\\';
+                }
+                oss << *c;
+            }
+            oss << '"';
+        }
+    }
+
+    TracingParams::TracingParams()
+        : sampleEvery( 100 )
+        , maxSpans( 65536 )
+        , maxSpansPerTrace( 256 )
+    {
+    }
+
+    void EnableTracing( const TracingParams& params )
+    {
+        {
+            const std::lock_guard< std::mutex > lock( traceSpansMutex );
+
+            traceMaxSpans = params.maxSpans;
+        }
+
+        tracingSampleEvery.store( params.sampleEvery ? params.sampleEvery : 1, std::memory_order_relaxed );
+        tracingMaxSpansPerTrace.store( params.maxSpansPerTrace, std::memory_order_relaxed );
+        tracingEnabled.store( true, std::memory_order_relaxed );
+    }
+
+    void DisableTracing()
+    {
+        tracingEnabled.store( false, std::memory_order_relaxed );
+    }
+
+    void ClearTraceSpans()
+    {
+        const std::lock_guard< std::mutex > lock( traceSpansMutex );
+
+        traceSpans.clear();
+    }
+
+    void GetChromeTraceJson( std::string& out )
+    {
+        std::ostringstream oss;
+        pid_t pid = getpid();
+
+        oss << "{\"traceEvents\":[";
+        {
+            const std::lock_guard< std::mutex > lock( traceSpansMutex );
+
+            for ( auto it = traceSpans.cbegin(); it != traceSpans.cend(); ++it )
+            {
+                if ( it != traceSpans.cbegin() )
+                {
+                    oss << ",";
+                }
+
+                oss << "{\"name\":";
+                writeJsonString( oss, it->name );
+                oss << ",\"cat\":\"lhwsutil\",\"ph\":\"X\""
+                    << ",\"ts\":" << it->startMicros
+                    << ",\"dur\":" << it->durationMicros
+                    << ",\"pid\":" << pid
+                    << ",\"tid\":" << it->tid << "}";
+            }
+        }
+        oss << "],\"displayTimeUnit\":\"ms\"}";
+
+        out = oss.str();
+    }
+
+    const char* CurrentTraceScopeName()
+    {
+        return currentScopeName;
+    }
+
+    TraceScope::TraceScope( const char* _name )
+        : name( _name )
+        , parentName( currentScopeName )
+        , ended( false )
+        , recording( false )
+        , start()
+    {
+        currentScopeName = name;
+
+        if ( scopeDepth++ == 0 )
+        {
+            traceSampled = tracingEnabled.load( std::memory_order_relaxed ) &&
+                ( ( ++traceSampleCounter % tracingSampleEvery.load( std::memory_order_relaxed ) ) == 0 );
+        }
+
+        if ( traceSampled )
+        {
+            recording = true;
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    TraceScope::~TraceScope()
+    {
+        End();
+    }
+
+    void TraceScope::End()
+    {
+        if ( ended )
+        {
+            return;
+        }
+
+        ended = true;
+        currentScopeName = parentName;
+        --scopeDepth;
+
+        if ( recording )
+        {
+            std::vector< TraceSpan >& spans( pendingSpans );
+            if ( traceTid == 0 )
+            {
+                traceTid = nextTraceTid.fetch_add( 1, std::memory_order_relaxed );
+            }
+
+            if ( spans.size() < tracingMaxSpansPerTrace.load( std::memory_order_relaxed ) )
+            {
+                TraceSpan span;
+
+                span.name = name;
+                span.tid = traceTid;
+                span.startMicros = microsSinceEpoch( start );
+                span.durationMicros = std::chrono::duration_cast< std::chrono::microseconds >(
+                    std::chrono::steady_clock::now() - start ).count();
+
+                spans.push_back( span );
+            }
+
+            if ( scopeDepth == 0 )
+            {
+                traceSampled = false;
+                publishSpans( spans );
+            }
+        }
+    }
+}
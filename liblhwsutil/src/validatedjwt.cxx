@@ -0,0 +1,248 @@
+#include <cstring>
+#include <utility>
+
+#include <lhwsutil/claimprojection.h>
+#include <lhwsutil/validatedjwt.h>
+
+namespace LHWSUtilNS
+{
+    // claims 0 to numJwtStrClaims - 1 are the JwtStrClaims, the JwtIntClaims follow
+    class ValidatedJwt::Projection : public ClaimProjectionBase
+    {
+        public:
+            Projection()
+                : ClaimProjectionBase()
+            {
+                addClaim( "iss", ClaimType::String, false );
+                addClaim( "sub", ClaimType::String, false );
+                addClaim( "azp", ClaimType::String, false );
+                addClaim( "jti", ClaimType::String, false );
+                addClaim( "sid", ClaimType::String, false );
+                addClaim( "aud", ClaimType::StringList, false );
+                addClaim( "scope", ClaimType::StringList, false );
+                addClaim( "exp", ClaimType::Int, false );
+                addClaim( "iat", ClaimType::Int, false );
+                addClaim( "nbf", ClaimType::Int, false );
+            }
+
+            void SetString( void* target, size_t index, const char* str, size_t strSize ) const
+            {
+                ValidatedJwt* validatedJwt = static_cast< ValidatedJwt* >( target );
+                validatedJwt->startStr( index );
+                validatedJwt->appendStr( index, str, strSize );
+            }
+
+            void SetBool( void*, size_t, bool ) const
+            {
+            }
+
+            void SetInt( void* target, size_t index, long value ) const
+            {
+                ValidatedJwt* validatedJwt = static_cast< ValidatedJwt* >( target );
+                size_t claim = index - numJwtStrClaims;
+                validatedJwt->intClaims[ claim ] = value;
+                validatedJwt->intClaimsPresent |= ( static_cast< uint32_t >( 1 ) << claim );
+            }
+
+            void ClearList( void* target, size_t index ) const
+            {
+                static_cast< ValidatedJwt* >( target )->startStr( index );
+            }
+
+            void AppendToList( void* target, size_t index, const char* str, size_t strSize ) const
+            {
+                ValidatedJwt* validatedJwt = static_cast< ValidatedJwt* >( target );
+                if ( validatedJwt->strSizes[ index ] > 0 )
+                {
+                    validatedJwt->appendStr( index, " ", 1 );
+                }
+                validatedJwt->appendStr( index, str, strSize );
+            }
+    };
+
+    ValidatedJwt::ValidatedJwt()
+        : result( JwtValidationResult::Error )
+        , strClaimsPresent( 0 )
+        , intClaimsPresent( 0 )
+        , strsUsed( 0 )
+        , strsSpilled( false )
+        , spilledStrs()
+    {
+    }
+
+    ValidatedJwt::~ValidatedJwt()
+    {
+    }
+
+    ValidatedJwt::ValidatedJwt( ValidatedJwt&& other )
+        : result( JwtValidationResult::Error )
+        , strClaimsPresent( 0 )
+        , intClaimsPresent( 0 )
+        , strsUsed( 0 )
+        , strsSpilled( false )
+        , spilledStrs()
+    {
+        *this = std::move( other );
+    }
+
+    ValidatedJwt& ValidatedJwt::operator=( ValidatedJwt&& other )
+    {
+        if ( this == &other )
+        {
+            return *this;
+        }
+
+        result = other.result;
+        strClaimsPresent = other.strClaimsPresent;
+        intClaimsPresent = other.intClaimsPresent;
+        std::memcpy( strOffsets, other.strOffsets, sizeof( strOffsets ) );
+        std::memcpy( strSizes, other.strSizes, sizeof( strSizes ) );
+        std::memcpy( intClaims, other.intClaims, sizeof( intClaims ) );
+        strsUsed = other.strsUsed;
+        strsSpilled = other.strsSpilled;
+        if ( strsSpilled )
+        {
+            spilledStrs.swap( other.spilledStrs );
+        }
+        else
+        {
+            std::memcpy( inlineStrs, other.inlineStrs, strsUsed );
+        }
+
+        other.Reset();
+
+        return *this;
+    }
+
+    JwtValidationResult ValidatedJwt::GetResult() const
+    {
+        return result;
+    }
+
+    bool ValidatedJwt::IsValid() const
+    {
+        return ( result == JwtValidationResult::Valid );
+    }
+
+    int ValidatedJwt::GetStrClaim( JwtStrClaim claim, const char*& strOut, size_t& strSizeOut ) const
+    {
+        size_t i = static_cast< size_t >( claim );
+
+        if ( ( i >= numJwtStrClaims ) || !( strClaimsPresent & ( static_cast< uint32_t >( 1 ) << i ) ) )
+        {
+            return 1;
+        }
+
+        strOut = strs() + strOffsets[ i ];
+        strSizeOut = strSizes[ i ];
+
+        return 0;
+    }
+
+    int ValidatedJwt::GetIntClaim( JwtIntClaim claim, long& valueOut ) const
+    {
+        size_t i = static_cast< size_t >( claim );
+
+        if ( ( i >= numJwtIntClaims ) || !( intClaimsPresent & ( static_cast< uint32_t >( 1 ) << i ) ) )
+        {
+            return 1;
+        }
+
+        valueOut = intClaims[ i ];
+
+        return 0;
+    }
+
+    bool ValidatedJwt::HasClaims( uint32_t strClaimMask, uint32_t intClaimMask ) const
+    {
+        return ( ( strClaimsPresent & strClaimMask ) == strClaimMask ) &&
+            ( ( intClaimsPresent & intClaimMask ) == intClaimMask );
+    }
+
+    bool ValidatedJwt::StrClaimHasToken( JwtStrClaim claim, const char* value, size_t valueSize ) const
+    {
+        const char* str = nullptr;
+        size_t strSize = 0;
+
+        if ( ( valueSize == 0 ) || ( GetStrClaim( claim, str, strSize ) != 0 ) )
+        {
+            return false;
+        }
+
+        const char* end = str + strSize;
+        const char* tokenStart = str;
+        while ( tokenStart < end )
+        {
+            const char* tokenEnd = static_cast< const char* >( std::memchr( tokenStart, ' ', end - tokenStart ) );
+            if ( !( tokenEnd ) )
+            {
+                tokenEnd = end;
+            }
+
+            if ( ( static_cast< size_t >( tokenEnd - tokenStart ) == valueSize ) &&
+                ( std::memcmp( tokenStart, value, valueSize ) == 0 ) )
+            {
+                return true;
+            }
+
+            tokenStart = tokenEnd + 1;
+        }
+
+        return false;
+    }
+
+    void ValidatedJwt::Reset()
+    {
+        result = JwtValidationResult::Error;
+        strClaimsPresent = 0;
+        intClaimsPresent = 0;
+        strsUsed = 0;
+        strsSpilled = false;
+        spilledStrs.clear();
+    }
+
+    void ValidatedJwt::setResult( JwtValidationResult _result )
+    {
+        result = _result;
+    }
+
+    const ClaimProjectionBase& ValidatedJwt::GetClaimProjection()
+    {
+        static const Projection projection;
+
+        return projection;
+    }
+
+    const char* ValidatedJwt::strs() const
+    {
+        return strsSpilled ? spilledStrs.data() : inlineStrs;
+    }
+
+    void ValidatedJwt::startStr( size_t claim )
+    {
+        strOffsets[ claim ] = strsUsed;
+        strSizes[ claim ] = 0;
+        strClaimsPresent |= ( static_cast< uint32_t >( 1 ) << claim );
+    }
+
+    void ValidatedJwt::appendStr( size_t claim, const char* str, size_t strSize )
+    {
+        if ( !( strsSpilled ) && ( ( strsUsed + strSize ) > validatedJwtInlineBytes ) )
+        {
+            spilledStrs.assign( inlineStrs, strsUsed );
+            strsSpilled = true;
+        }
+
+        if ( strsSpilled )
+        {
+            spilledStrs.append( str, strSize );
+        }
+        else
+        {
+            std::memcpy( inlineStrs + strsUsed, str, strSize );
+        }
+
+        strsUsed += strSize;
+        strSizes[ claim ] += strSize;
+    }
+}
@@ -0,0 +1,100 @@
+#include <lhwsutil_impl/validationarena.h>
+
+namespace LHWSUtilImplNS
+{
+    namespace
+    {
+        // clear pool, first growing its buffer if the last call overflowed it into heap chunks
+        void resetPool( rapidjson::CrtAllocator& baseAllocator,
+            size_t& bufferSize,
+            std::unique_ptr< char[] >& buffer,
+            std::unique_ptr< ArenaAllocator >& pool )
+        {
+            // the buffer also holds the pool's chunk header
+            size_t used = pool->Size() + 64;
+
+            if ( ( used <= bufferSize ) || ( bufferSize >= validationArenaMaxBytes ) )
+            {
+                pool->Clear();
+                return;
+            }
+
+            while ( ( bufferSize < used ) && ( bufferSize < validationArenaMaxBytes ) )
+            {
+                bufferSize *= 2;
+            }
+
+            pool.reset();
+            buffer.reset( new char[ bufferSize ] );
+            pool.reset( new ArenaAllocator( buffer.get(), bufferSize, bufferSize, &baseAllocator ) );
+        }
+    }
+
+    ValidationArena::ValidationArena()
+        : baseAllocator()
+        , bufferSize( validationArenaInitialBytes )
+        , stackBufferSize( validationArenaStackBytes )
+        , buffer( new char[ validationArenaInitialBytes ] )
+        , stackBuffer( new char[ validationArenaStackBytes ] )
+        , allocator()
+        , stackAllocator()
+        , depth( 0 )
+    {
+        allocator.reset( new ArenaAllocator( buffer.get(), bufferSize, bufferSize, &baseAllocator ) );
+        stackAllocator.reset( new ArenaAllocator( stackBuffer.get(), stackBufferSize, stackBufferSize, &baseAllocator ) );
+    }
+
+    ValidationArena::~ValidationArena()
+    {
+        // the pools go before the buffers they point into
+        allocator.reset();
+        stackAllocator.reset();
+    }
+
+    ArenaAllocator& ValidationArena::GetAllocator()
+    {
+        return *allocator;
+    }
+
+    ArenaAllocator& ValidationArena::GetStackAllocator()
+    {
+        return *stackAllocator;
+    }
+
+    size_t ValidationArena::GetCapacity() const
+    {
+        return bufferSize + stackBufferSize;
+    }
+
+    void ValidationArena::Reset()
+    {
+        resetPool( baseAllocator, bufferSize, buffer, allocator );
+        resetPool( baseAllocator, stackBufferSize, stackBuffer, stackAllocator );
+    }
+
+    ValidationArena& GetValidationArena()
+    {
+        static thread_local ValidationArena arena;
+
+        return arena;
+    }
+
+    ValidationArenaScope::ValidationArenaScope()
+        : arena( GetValidationArena() )
+    {
+        ++arena.depth;
+    }
+
+    ValidationArenaScope::~ValidationArenaScope()
+    {
+        if ( --arena.depth == 0 )
+        {
+            arena.Reset();
+        }
+    }
+
+    ValidationArena& ValidationArenaScope::GetArena()
+    {
+        return arena;
+    }
+}
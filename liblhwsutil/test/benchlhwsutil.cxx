@@ -0,0 +1,709 @@
+#include <benchmark/benchmark.h>
+
+#include <jwt.h> // C
+
+#include <rapidjson/document.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <unordered_set>
+
+#include <unistd.h>
+
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+
+#include <lhsslutil/base64.h>
+
+#include <lhwsutil/ijwtreplayguard.h>
+#include <lhwsutil/ijwtrevocationlist.h>
+#include <lhwsutil/ijwtvalidator.h>
+#include <lhwsutil/scoperegistry.h>
+
+#include <lhwsutil_impl/jwsverifier.h>
+#include <lhwsutil_impl/jwtissuercache.h>
+#include <lhwsutil_impl/jwtutils.h>
+#include <lhwsutil_impl/jwtvalidator.h>
+#include <lhwsutil_impl/rsa.h>
+#include <lhwsutil_impl/sharedjwtcache.h>
+
+#include "mockopenidprovider.h"
+
+// micro benchmarks for the jwt utility hot functions
+//
+// every benchmark reports allocs/op, counted by interposing the libc allocator so
+// allocations made inside libjwt, jansson and openssl are included
+//
+// pass --benchmark_out=<file> --benchmark_out_format=json for machine readable results
+namespace
+{
+    std::atomic< uint64_t > allocationCount( 0 );
+}
+
+extern "C"
+{
+    void* __libc_malloc( size_t size );
+    void* __libc_calloc( size_t count, size_t size );
+    void* __libc_realloc( void* ptr, size_t size );
+
+    void* malloc( size_t size )
+    {
+        allocationCount.fetch_add( 1, std::memory_order_relaxed );
+        return __libc_malloc( size );
+    }
+
+    void* calloc( size_t count, size_t size )
+    {
+        allocationCount.fetch_add( 1, std::memory_order_relaxed );
+        return __libc_calloc( count, size );
+    }
+
+    void* realloc( void* ptr, size_t size )
+    {
+        allocationCount.fetch_add( 1, std::memory_order_relaxed );
+        return __libc_realloc( ptr, size );
+    }
+}
+
+namespace TestLHWSUtilNS
+{
+    namespace
+    {
+        // minimum encoded sizes, the smallest is whatever an unpadded token signed by a
+        // 2048 bit key comes to, each benchmark reports the actual token_bytes
+        const int benchTokenSizes[] = { 300, 1024, 4096, 16384 };
+        const int numBenchTokenSizes = sizeof( benchTokenSizes ) / sizeof( benchTokenSizes[ 0 ] );
+        const int benchKeyBits[] = { 2048, 4096 };
+        const int numBenchKeyBits = sizeof( benchKeyBits ) / sizeof( benchKeyBits[ 0 ] );
+
+        std::map< int, TestRsaKey > bitsToKey;
+        std::map< int, std::string > sizeToToken;
+
+        // key provider for jwt_decode_2, all tokens are signed by the 2048 bit key
+        int benchKeyProvider( const jwt_t* jwt, jwt_key_t* keyOut )
+        {
+            (void)jwt;
+
+            const std::string& keyPem( bitsToKey[ 2048 ].publicKeyPem );
+            keyOut->jwt_key = reinterpret_cast< const unsigned char* >( keyPem.c_str() );
+            keyOut->jwt_key_len = keyPem.size();
+
+            return 0;
+        }
+
+        std::unique_ptr< LHWSUtilNS::IValidJwt > libJwtValidJwt( const std::string& token )
+        {
+            jwt_t* jwt = nullptr;
+            if ( jwt_decode_2( &jwt, token.c_str(), &benchKeyProvider ) != 0 )
+            {
+                return nullptr;
+            }
+
+            return std::unique_ptr< LHWSUtilNS::IValidJwt >( new LHWSUtilImplNS::ValidJwt( &jwt ) );
+        }
+
+        std::unique_ptr< LHWSUtilNS::IValidJwt > rapidJsonValidJwt( const std::string& token )
+        {
+            std::string header;
+            std::string payload;
+            std::string signature;
+            rapidjson::Document payloadJson;
+
+            if ( ( LHWSUtilImplNS::DecomposeAndDecodeJwtStr( token, header, payload, signature ) != 0 ) ||
+                 payloadJson.Parse( payload.c_str() ).HasParseError() )
+            {
+                return nullptr;
+            }
+
+            return std::unique_ptr< LHWSUtilNS::IValidJwt >( new LHWSUtilImplNS::ValidJwtJson( payloadJson ) );
+        }
+
+        std::unique_ptr< LHWSUtilNS::IValidJwt > validJwtFor( int kind, const std::string& token )
+        {
+            return ( kind == 0 ) ? libJwtValidJwt( token ) : rapidJsonValidJwt( token );
+        }
+
+        const char* validJwtKindName( int kind )
+        {
+            return ( kind == 0 ) ? "ValidJwt" : "ValidJwtJson";
+        }
+
+        // tracks allocations over the timed loop only
+        class AllocationCounter
+        {
+            public:
+                AllocationCounter()
+                    : start( 0 )
+                    , total( 0 )
+                {
+                }
+
+                void Resume()
+                {
+                    start = allocationCount.load( std::memory_order_relaxed );
+                }
+
+                void Pause()
+                {
+                    total += allocationCount.load( std::memory_order_relaxed ) - start;
+                }
+
+                void Report( benchmark::State& state )
+                {
+                    state.counters[ "allocs/op" ] = benchmark::Counter( total, benchmark::Counter::kAvgIterations );
+                }
+
+            private:
+                uint64_t start;
+                uint64_t total;
+        };
+
+        void tokenSizes( benchmark::internal::Benchmark* benchmark )
+        {
+            for ( int i = 0; i < numBenchTokenSizes; ++i )
+            {
+                benchmark->Arg( benchTokenSizes[ i ] );
+            }
+        }
+
+        void validJwtKindsAndTokenSizes( benchmark::internal::Benchmark* benchmark )
+        {
+            for ( int kind = 0; kind < 2; ++kind )
+            {
+                for ( int i = 0; i < numBenchTokenSizes; ++i )
+                {
+                    benchmark->Args( { kind, benchTokenSizes[ i ] } );
+                }
+            }
+        }
+
+        void keyBits( benchmark::internal::Benchmark* benchmark )
+        {
+            for ( int i = 0; i < numBenchKeyBits; ++i )
+            {
+                benchmark->Arg( benchKeyBits[ i ] );
+            }
+        }
+    }
+
+    void BM_DecomposeJwtStr( benchmark::State& state )
+    {
+        const std::string& token( sizeToToken[ state.range( 0 ) ] );
+        std::string header;
+        std::string payload;
+        std::string signature;
+        AllocationCounter allocations;
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( LHWSUtilImplNS::DecomposeJwtStr( token, header, payload, signature ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetBytesProcessed( state.iterations() * token.size() );
+        state.counters[ "token_bytes" ] = token.size();
+    }
+    BENCHMARK( BM_DecomposeJwtStr )->Apply( tokenSizes );
+
+    void BM_DecodeDecomposedJwtStrs( benchmark::State& state )
+    {
+        const std::string& token( sizeToToken[ state.range( 0 ) ] );
+        std::string b64Header;
+        std::string b64Payload;
+        std::string b64Signature;
+        std::string header;
+        std::string payload;
+        AllocationCounter allocations;
+
+        LHWSUtilImplNS::DecomposeJwtStr( token, b64Header, b64Payload, b64Signature );
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize(
+                LHWSUtilImplNS::DecodeDecomposedJwtStrs( b64Header, b64Payload, header, payload ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetBytesProcessed( state.iterations() * ( b64Header.size() + b64Payload.size() ) );
+        state.counters[ "token_bytes" ] = token.size();
+    }
+    BENCHMARK( BM_DecodeDecomposedJwtStrs )->Apply( tokenSizes );
+
+    void BM_DecomposeAndDecodeJwtStr( benchmark::State& state )
+    {
+        const std::string& token( sizeToToken[ state.range( 0 ) ] );
+        std::string header;
+        std::string payload;
+        std::string signature;
+        AllocationCounter allocations;
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize(
+                LHWSUtilImplNS::DecomposeAndDecodeJwtStr( token, header, payload, signature ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetBytesProcessed( state.iterations() * token.size() );
+        state.counters[ "token_bytes" ] = token.size();
+    }
+    BENCHMARK( BM_DecomposeAndDecodeJwtStr )->Apply( tokenSizes );
+
+    void BM_GetScopes( benchmark::State& state )
+    {
+        auto validJwt( validJwtFor( state.range( 0 ), sizeToToken[ state.range( 1 ) ] ) );
+        std::unordered_set< std::string > scopes;
+        AllocationCounter allocations;
+
+        if ( !( validJwt ) )
+        {
+            state.SkipWithError( "failed to create valid jwt" );
+            return;
+        }
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            scopes.clear();
+            benchmark::DoNotOptimize( LHWSUtilNS::GetScopes( *validJwt, scopes ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetLabel( validJwtKindName( state.range( 0 ) ) );
+    }
+    BENCHMARK( BM_GetScopes )->Apply( validJwtKindsAndTokenSizes );
+
+    void BM_GetScopesRegistry( benchmark::State& state )
+    {
+        auto validJwt( validJwtFor( state.range( 0 ), sizeToToken[ state.range( 1 ) ] ) );
+        LHWSUtilNS::ScopeRegistry registry;
+        LHWSUtilNS::ScopeSet required( registry.RegisterScopes( { "openid", "email", "profile" } ) );
+        LHWSUtilNS::ScopeSet scopes;
+        AllocationCounter allocations;
+
+        if ( !( validJwt ) )
+        {
+            state.SkipWithError( "failed to create valid jwt" );
+            return;
+        }
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            scopes.reset();
+            benchmark::DoNotOptimize( LHWSUtilNS::GetScopes( *validJwt, registry, scopes ) );
+            benchmark::DoNotOptimize( LHWSUtilNS::HasAllScopes( scopes, required ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetLabel( validJwtKindName( state.range( 0 ) ) );
+    }
+    BENCHMARK( BM_GetScopesRegistry )->Apply( validJwtKindsAndTokenSizes );
+
+    // lookups of a jti which is not revoked ( range 1 == 0 ) or is, against range 0 revocations
+    void BM_RevocationListIsRevoked( benchmark::State& state )
+    {
+        const long exp = 4102444800L;
+        auto revocationList( LHWSUtilNS::GetStandardJwtRevocationList( state.range( 0 ) ) );
+        std::vector< LHWSUtilNS::JwtRevocation > revocations;
+        std::string jti( "550e8400-e29b-41d4-a716-446655440000" );
+        AllocationCounter allocations;
+
+        for ( long i = 0; i < state.range( 0 ); ++i )
+        {
+            revocations.emplace_back( LHWSUtilNS::JwtRevocationClaim::Jti, jti + std::to_string( i ), exp );
+        }
+        revocationList->Reload( revocations );
+        jti.append( state.range( 1 ) ? "0" : "x" );
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Jti,
+                jti.data(),
+                jti.size(),
+                0 ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+    }
+    BENCHMARK( BM_RevocationListIsRevoked )->ArgsProduct( { { 1000, 1000000 }, { 0, 1 } } );
+
+    // distinct jtis recorded into one guard, expiring as fast as they arrive once it is warm
+    void BM_ReplayGuardCheckAndRecord( benchmark::State& state )
+    {
+        LHWSUtilNS::JwtReplayGuardParams params;
+        auto replayGuard( LHWSUtilNS::GetStandardJwtReplayGuard( params ) );
+        std::string iss( "https://issuer.example.com" );
+        std::string jti( "550e8400-e29b-41d4-a716-" );
+        size_t jtiPrefixSize = jti.size();
+        long now = std::chrono::duration_cast< std::chrono::seconds >(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+        long i = 0;
+
+        while ( state.KeepRunning() )
+        {
+            jti.resize( jtiPrefixSize );
+            jti.append( std::to_string( i ) );
+            benchmark::DoNotOptimize( replayGuard->CheckAndRecord( iss.data(), iss.size(),
+                jti.data(), jti.size(), now + 300, now + ( i >> 10 ) ) );
+            ++i;
+        }
+
+        state.SetItemsProcessed( state.iterations() );
+    }
+    BENCHMARK( BM_ReplayGuardCheckAndRecord );
+
+    // lookups of one of range 0 loaded issuers, through the locked map ( range 1 == 0 ) or frozen
+    void BM_IssuerCacheGetIssuer( benchmark::State& state )
+    {
+        const std::string issPrefix( "https://idp.example.com/realms/customer-" );
+        LHWSUtilImplNS::JwtIssuerCache jwtIssuerCache;
+        LHWSUtilNS::JwtIssuerCacheParams cacheParams;
+        AllocationCounter allocations;
+
+        cacheParams.algToKeyPem[ "RS256" ] = "pem";
+        for ( long i = 0; i < state.range( 0 ); ++i )
+        {
+            cacheParams.iss = issPrefix + std::to_string( i );
+            jwtIssuerCache.LoadIssuer( cacheParams );
+        }
+        if ( state.range( 1 ) )
+        {
+            jwtIssuerCache.Freeze();
+        }
+        const std::string iss( issPrefix + std::to_string( state.range( 0 ) / 2 ) );
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( jwtIssuerCache.GetIssuer( iss ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+    }
+    BENCHMARK( BM_IssuerCacheGetIssuer )->ArgsProduct( { { 10, 10000 }, { 0, 1 } } );
+
+    void BM_GetIdentifiers( benchmark::State& state )
+    {
+        auto validJwt( validJwtFor( state.range( 0 ), sizeToToken[ state.range( 1 ) ] ) );
+        LHWSUtilNS::UserIdentifiers userIdentifiers;
+        AllocationCounter allocations;
+
+        if ( !( validJwt ) )
+        {
+            state.SkipWithError( "failed to create valid jwt" );
+            return;
+        }
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( LHWSUtilNS::GetIdentifiers( *validJwt, userIdentifiers ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetLabel( validJwtKindName( state.range( 0 ) ) );
+    }
+    BENCHMARK( BM_GetIdentifiers )->Apply( validJwtKindsAndTokenSizes );
+
+    void BM_GetGrantStrValue( benchmark::State& state )
+    {
+        auto validJwt( validJwtFor( state.range( 0 ), sizeToToken[ state.range( 1 ) ] ) );
+        const std::string grant( "preferred_username" );
+        std::string value;
+        AllocationCounter allocations;
+
+        if ( !( validJwt ) )
+        {
+            state.SkipWithError( "failed to create valid jwt" );
+            return;
+        }
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( validJwt->GetGrantStrValue( grant, value ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetLabel( validJwtKindName( state.range( 0 ) ) );
+    }
+    BENCHMARK( BM_GetGrantStrValue )->Apply( validJwtKindsAndTokenSizes );
+
+    void BM_GetGrantIntValue( benchmark::State& state )
+    {
+        auto validJwt( validJwtFor( state.range( 0 ), sizeToToken[ state.range( 1 ) ] ) );
+        const std::string grant( "exp" );
+        long value = 0;
+        AllocationCounter allocations;
+
+        if ( !( validJwt ) )
+        {
+            state.SkipWithError( "failed to create valid jwt" );
+            return;
+        }
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( validJwt->GetGrantIntValue( grant, value ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetLabel( validJwtKindName( state.range( 0 ) ) );
+    }
+    BENCHMARK( BM_GetGrantIntValue )->Apply( validJwtKindsAndTokenSizes );
+
+    void BM_GetGrantBoolValue( benchmark::State& state )
+    {
+        auto validJwt( validJwtFor( state.range( 0 ), sizeToToken[ state.range( 1 ) ] ) );
+        const std::string grant( "email_verified" );
+        bool value = false;
+        AllocationCounter allocations;
+
+        if ( !( validJwt ) )
+        {
+            state.SkipWithError( "failed to create valid jwt" );
+            return;
+        }
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( validJwt->GetGrantBoolValue( grant, value ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetLabel( validJwtKindName( state.range( 0 ) ) );
+    }
+    BENCHMARK( BM_GetGrantBoolValue )->Apply( validJwtKindsAndTokenSizes );
+
+    // realm_access grows with the token size
+    void BM_GetGrantJsonValue( benchmark::State& state )
+    {
+        auto validJwt( validJwtFor( state.range( 0 ), sizeToToken[ state.range( 1 ) ] ) );
+        const std::string grant( "realm_access" );
+        std::string value;
+        AllocationCounter allocations;
+
+        if ( !( validJwt ) )
+        {
+            state.SkipWithError( "failed to create valid jwt" );
+            return;
+        }
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( validJwt->GetGrantJsonValue( grant, value ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+        state.SetLabel( validJwtKindName( state.range( 0 ) ) );
+    }
+    BENCHMARK( BM_GetGrantJsonValue )->Apply( validJwtKindsAndTokenSizes );
+
+    void BM_FillRSxKeyFromJwkJson( benchmark::State& state )
+    {
+        const TestRsaKey& key( bitsToKey[ state.range( 0 ) ] );
+        std::string jwkStr( "{\"kty\":\"RSA\",\"alg\":\"RS256\",\"use\":\"sig\",\"n\":\"" + key.nB64Url +
+                            "\",\"e\":\"" + key.eB64Url + "\"}" );
+        rapidjson::Document jwkJson;
+        std::string keyPem;
+        AllocationCounter allocations;
+
+        jwkJson.Parse( jwkStr.c_str() );
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( LHWSUtilImplNS::FillRSxKeyFromJwkJson( jwkJson, keyPem ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+    }
+    BENCHMARK( BM_FillRSxKeyFromJwkJson )->Apply( keyBits );
+
+    void BM_RSAPublicKeyGetPEMFormatInto( benchmark::State& state )
+    {
+        const TestRsaKey& key( bitsToKey[ state.range( 0 ) ] );
+        std::vector< unsigned char > nBytes;
+        std::vector< unsigned char > eBytes;
+        std::string keyPem;
+        AllocationCounter allocations;
+
+        LHSSLUtilNS::DecodeB64UrlStr( key.nB64Url, nBytes );
+        LHSSLUtilNS::DecodeB64UrlStr( key.eB64Url, eBytes );
+        LHWSUtilImplNS::RSAPublicKey rsaPublicKey( nBytes, eBytes );
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( rsaPublicKey.GetPEMFormatInto( keyPem ) );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+    }
+    BENCHMARK( BM_RSAPublicKeyGetPEMFormatInto )->Apply( keyBits );
+
+    // kind 0 builds the key from n and e only, kind 1 also round trips it through a pem the way
+    // a key for libjwt is imported
+    void BM_RSAPublicKeyImport( benchmark::State& state )
+    {
+        const TestRsaKey& key( bitsToKey[ state.range( 0 ) ] );
+        std::vector< unsigned char > nBytes;
+        std::vector< unsigned char > eBytes;
+        std::string keyPem;
+        AllocationCounter allocations;
+
+        LHSSLUtilNS::DecodeB64UrlStr( key.nB64Url, nBytes );
+        LHSSLUtilNS::DecodeB64UrlStr( key.eB64Url, eBytes );
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            LHWSUtilImplNS::RSAPublicKey rsaPublicKey( nBytes, eBytes );
+            if ( state.range( 1 ) == 1 )
+            {
+                rsaPublicKey.GetPEMFormatInto( keyPem );
+                BIO* bioMem = BIO_new_mem_buf( keyPem.data(), static_cast< int >( keyPem.size() ) );
+                EVP_PKEY* pkey = PEM_read_bio_PUBKEY( bioMem, nullptr, nullptr, nullptr );
+                benchmark::DoNotOptimize( pkey );
+                EVP_PKEY_free( pkey );
+                BIO_free( bioMem );
+            }
+            benchmark::DoNotOptimize( rsaPublicKey.GetKey() );
+        }
+        allocations.Pause();
+
+        allocations.Report( state );
+    }
+    BENCHMARK( BM_RSAPublicKeyImport )->ArgsProduct( { { 2048, 4096 }, { 0, 1 } } );
+
+    // kind 0 verifies the way the OpenSSL 1.0 backend does, reading the pem, looking up the
+    // digest by name and creating and initialising a context on every call, kind 1 verifies
+    // with a JwsVerifier
+    void BM_JwsVerify( benchmark::State& state )
+    {
+        const std::string& token( sizeToToken[ state.range( 1 ) ] );
+        const std::string& keyPem( bitsToKey[ 2048 ].publicKeyPem );
+        size_t signatureStart = token.rfind( '.' );
+        std::vector< unsigned char > signature;
+        AllocationCounter allocations;
+
+        LHSSLUtilNS::DecodeB64UrlStr( token.substr( signatureStart + 1 ), signature );
+        LHWSUtilImplNS::JwsVerifier jwsVerifier( LHWSUtilNS::JwtAlg::RS256, keyPem.data(), keyPem.size() );
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            if ( state.range( 0 ) == 0 )
+            {
+                BIO* bioMem = BIO_new_mem_buf( keyPem.data(), static_cast< int >( keyPem.size() ) );
+                EVP_PKEY* pkey = PEM_read_bio_PUBKEY( bioMem, nullptr, nullptr, nullptr );
+                EVP_MD_CTX* ctx = EVP_MD_CTX_create();
+                EVP_DigestVerifyInit( ctx, nullptr, EVP_get_digestbyname( "SHA256" ), nullptr, pkey );
+                EVP_DigestVerifyUpdate( ctx, token.data(), signatureStart );
+                benchmark::DoNotOptimize( EVP_DigestVerifyFinal( ctx, signature.data(), signature.size() ) );
+                EVP_MD_CTX_destroy( ctx );
+                EVP_PKEY_free( pkey );
+                BIO_free( bioMem );
+            }
+            else
+            {
+                benchmark::DoNotOptimize(
+                    jwsVerifier.Verify( token.data(), signatureStart, signature.data(), signature.size() ) );
+            }
+        }
+        allocations.Pause();
+
+        state.counters[ "token_bytes" ] = token.size();
+        allocations.Report( state );
+    }
+    BENCHMARK( BM_JwsVerify )->ArgsProduct( { { 0, 1 }, { 300, 4096 } } );
+
+    // the lookup a worker makes before introspecting a token, the token's sha-256 dominates
+    void BM_SharedJwtCacheFindResult( benchmark::State& state )
+    {
+        const std::string& token( sizeToToken[ state.range( 0 ) ] );
+        long now = std::chrono::duration_cast< std::chrono::seconds >(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+        LHWSUtilNS::SharedJwtCacheParams sharedParams;
+        AllocationCounter allocations;
+
+        sharedParams.name = "/lhwsutil.bench." + std::to_string( getpid() );
+        sharedParams.role = LHWSUtilNS::SharedJwtCacheRole::Writer;
+        sharedParams.maxResults = 1024;
+        LHWSUtilImplNS::SharedJwtCache sharedCache( sharedParams );
+        sharedCache.RecordResult( token, true, 0, now );
+
+        allocations.Resume();
+        while ( state.KeepRunning() )
+        {
+            benchmark::DoNotOptimize( sharedCache.FindResult( token, now ) );
+        }
+        allocations.Pause();
+
+        state.counters[ "token_bytes" ] = token.size();
+        allocations.Report( state );
+    }
+    BENCHMARK( BM_SharedJwtCacheFindResult )->Arg( 300 )->Arg( 4096 );
+}
+
+int main( int argc, char** argv )
+{
+    using namespace TestLHWSUtilNS;
+
+    for ( int i = 0; i < numBenchKeyBits; ++i )
+    {
+        if ( GenerateTestRsaKey( benchKeyBits[ i ], bitsToKey[ benchKeyBits[ i ] ] ) != 0 )
+        {
+            std::cerr << "failed to generate " << benchKeyBits[ i ] << " bit key" << std::endl;
+            return 1;
+        }
+    }
+
+    for ( int i = 0; i < numBenchTokenSizes; ++i )
+    {
+        TestTokenParams tokenParams;
+
+        tokenParams.iss = "http://127.0.0.1/realms/bench";
+        tokenParams.minEncodedSize = benchTokenSizes[ i ];
+        if ( CreateTestToken( tokenParams, bitsToKey[ 2048 ], sizeToToken[ benchTokenSizes[ i ] ] ) != 0 )
+        {
+            std::cerr << "failed to create " << benchTokenSizes[ i ] << " byte token" << std::endl;
+            return 2;
+        }
+    }
+
+    benchmark::Initialize( &argc, argv );
+    if ( benchmark::ReportUnrecognizedArguments( argc, argv ) )
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+
+    return 0;
+}
@@ -0,0 +1,290 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include <lhmiscutil/singleton.h>
+
+#include <lhwsutil/ijwtissuercache.h>
+#include <lhwsutil/ijwtvalidator.h>
+#include <lhwsutil/isimplehttpclient.h>
+
+#include <lhwsutil_impl/jwtissuercache.h>
+
+#include "mockopenidprovider.h"
+
+// end to end benchmarks against a localhost stand in for the IdP
+//
+// environment:
+//   LHWSUTIL_MOCK_IDP_LATENCY_US   - latency added to every IdP response
+//   LHWSUTIL_MOCK_IDP_FAILURE_RATE - fraction of IdP responses that are 500s
+//   LHWSUTIL_MOCK_IDP_KEY_BITS     - rsa key size, 2048 by default
+//
+// pass --benchmark_out=<file> --benchmark_out_format=json for machine readable results
+namespace TestLHWSUtilNS
+{
+    namespace
+    {
+        const char* benchAlgs[] = { "RS256", "RS384", "RS512" };
+        const int numBenchAlgs = sizeof( benchAlgs ) / sizeof( benchAlgs[ 0 ] );
+        const int benchTokenSizes[] = { 300, 1024, 4096, 16384 };
+        const int numBenchTokenSizes = sizeof( benchTokenSizes ) / sizeof( benchTokenSizes[ 0 ] );
+
+        std::unique_ptr< MockOpenIdProvider > mockProvider;
+
+        LHWSUtilNS::JwtIssuerCacheParams mockIssuerCacheParams()
+        {
+            LHWSUtilNS::JwtIssuerCacheParams cacheParams;
+
+            cacheParams.iss = mockProvider->GetIssuerUrl();
+            cacheParams.clientAuthzBearerToken = "bGh3c3V0aWwtdGVzdDpzZWNyZXQ=";
+            cacheParams.pulldownOpenIdConfiguration = true;
+            for ( int i = 0; i < numBenchAlgs; ++i )
+            {
+                cacheParams.algToKeyPem[ benchAlgs[ i ] ] = "";
+            }
+
+            return cacheParams;
+        }
+
+        void algsAndTokenSizes( benchmark::internal::Benchmark* benchmark )
+        {
+            for ( int i = 0; i < numBenchAlgs; ++i )
+            {
+                for ( int j = 0; j < numBenchTokenSizes; ++j )
+                {
+                    benchmark->Args( { i, benchTokenSizes[ j ] } );
+                }
+            }
+        }
+
+        void tokenSizes( benchmark::internal::Benchmark* benchmark )
+        {
+            for ( int j = 0; j < numBenchTokenSizes; ++j )
+            {
+                benchmark->Args( { 0, benchTokenSizes[ j ] } );
+            }
+        }
+
+        void reportTokenAndFailures( benchmark::State& state,
+                                     const std::string& alg,
+                                     const std::string& token,
+                                     size_t failures )
+        {
+            state.SetLabel( alg );
+            state.counters[ "token_bytes" ] = token.size();
+            state.counters[ "failures" ] = benchmark::Counter( failures, benchmark::Counter::kAvgIterations );
+        }
+    }
+
+    void BM_ValidateIntoJwt( benchmark::State& state )
+    {
+        const std::string alg( benchAlgs[ state.range( 0 ) ] );
+        std::string token;
+        size_t failures = 0;
+
+        if ( mockProvider->IssueToken( alg, state.range( 1 ), token ) != 0 )
+        {
+            state.SkipWithError( "failed to issue token" );
+            return;
+        }
+
+        auto jwtValidator( LHWSUtilNS::GetStandardJwtValidatorFactory()->CreateJwtValidator() );
+
+        while ( state.KeepRunning() )
+        {
+            auto validJwt( jwtValidator->ValidateIntoJwt( token ) );
+            if ( !( validJwt ) )
+            {
+                ++failures;
+            }
+            benchmark::DoNotOptimize( validJwt );
+        }
+
+        reportTokenAndFailures( state, alg, token, failures );
+    }
+    BENCHMARK( BM_ValidateIntoJwt )->Apply( algsAndTokenSizes );
+
+    void BM_ValidateIntoJwtGetIdentifiers( benchmark::State& state )
+    {
+        const std::string alg( benchAlgs[ state.range( 0 ) ] );
+        std::string token;
+        LHWSUtilNS::UserIdentifiers userIdentifiers;
+        size_t failures = 0;
+
+        if ( mockProvider->IssueToken( alg, state.range( 1 ), token ) != 0 )
+        {
+            state.SkipWithError( "failed to issue token" );
+            return;
+        }
+
+        auto jwtValidator( LHWSUtilNS::GetStandardJwtValidatorFactory()->CreateJwtValidator() );
+
+        while ( state.KeepRunning() )
+        {
+            auto validJwt( jwtValidator->ValidateIntoJwt( token ) );
+            if ( !( validJwt ) || ( LHWSUtilNS::GetIdentifiers( *validJwt, userIdentifiers ) != 0 ) )
+            {
+                ++failures;
+            }
+        }
+
+        reportTokenAndFailures( state, alg, token, failures );
+    }
+    BENCHMARK( BM_ValidateIntoJwtGetIdentifiers )->Apply( algsAndTokenSizes );
+
+    void BM_ValidateIntoClaims( benchmark::State& state )
+    {
+        const std::string alg( benchAlgs[ state.range( 0 ) ] );
+        std::string token;
+        LHWSUtilNS::UserIdentifiers userIdentifiers;
+        size_t failures = 0;
+
+        if ( mockProvider->IssueToken( alg, state.range( 1 ), token ) != 0 )
+        {
+            state.SkipWithError( "failed to issue token" );
+            return;
+        }
+
+        auto jwtValidator( LHWSUtilNS::GetStandardJwtValidatorFactory()->CreateJwtValidator() );
+
+        while ( state.KeepRunning() )
+        {
+            if ( jwtValidator->ValidateIntoClaims( token,
+                                                   LHWSUtilNS::GetUserIdentifiersProjection(),
+                                                   userIdentifiers ) != 0 )
+            {
+                ++failures;
+            }
+        }
+
+        reportTokenAndFailures( state, alg, token, failures );
+    }
+    BENCHMARK( BM_ValidateIntoClaims )->Apply( algsAndTokenSizes );
+
+    void BM_ValidateIntoValidatedJwt( benchmark::State& state )
+    {
+        const std::string alg( benchAlgs[ state.range( 0 ) ] );
+        std::string token;
+        LHWSUtilNS::ValidatedJwt validatedJwt;
+        size_t failures = 0;
+
+        if ( mockProvider->IssueToken( alg, state.range( 1 ), token ) != 0 )
+        {
+            state.SkipWithError( "failed to issue token" );
+            return;
+        }
+
+        auto jwtValidator( LHWSUtilNS::GetStandardJwtValidatorFactory()->CreateJwtValidator() );
+
+        while ( state.KeepRunning() )
+        {
+            if ( jwtValidator->ValidateIntoJwt( token, validatedJwt ) != LHWSUtilNS::JwtValidationResult::Valid )
+            {
+                ++failures;
+            }
+        }
+
+        reportTokenAndFailures( state, alg, token, failures );
+    }
+    BENCHMARK( BM_ValidateIntoValidatedJwt )->Apply( algsAndTokenSizes );
+
+    void BM_IntrospectJwt( benchmark::State& state )
+    {
+        const std::string alg( benchAlgs[ state.range( 0 ) ] );
+        std::string token;
+        size_t failures = 0;
+
+        if ( mockProvider->IssueToken( alg, state.range( 1 ), token ) != 0 )
+        {
+            state.SkipWithError( "failed to issue token" );
+            return;
+        }
+
+        auto jwtValidator( LHWSUtilNS::GetStandardJwtValidatorFactory()->CreateJwtValidator() );
+
+        while ( state.KeepRunning() )
+        {
+            auto validJwt( jwtValidator->IntrospectJwt( token ) );
+            if ( !( validJwt ) )
+            {
+                ++failures;
+            }
+            benchmark::DoNotOptimize( validJwt );
+        }
+
+        reportTokenAndFailures( state, alg, token, failures );
+    }
+    BENCHMARK( BM_IntrospectJwt )->Apply( tokenSizes )->UseRealTime();
+
+    // openid-configuration + jwks round trips and jwk -> pem conversion for every alg
+    void BM_LoadIssuer( benchmark::State& state )
+    {
+        LHWSUtilNS::JwtIssuerCacheParams cacheParams( mockIssuerCacheParams() );
+        size_t failures = 0;
+
+        while ( state.KeepRunning() )
+        {
+            LHWSUtilImplNS::JwtIssuerCache jwtIssuerCache;
+
+            jwtIssuerCache.LoadIssuer( cacheParams );
+            if ( !( jwtIssuerCache.IssuerIsLoaded( cacheParams.iss ) ) )
+            {
+                ++failures;
+            }
+        }
+
+        state.counters[ "failures" ] = benchmark::Counter( failures, benchmark::Counter::kAvgIterations );
+    }
+    BENCHMARK( BM_LoadIssuer )->UseRealTime();
+}
+
+int main( int argc, char** argv )
+{
+    using namespace TestLHWSUtilNS;
+
+    MockOpenIdProviderParams providerParams;
+
+    const char* latencyUs = getenv( "LHWSUTIL_MOCK_IDP_LATENCY_US" );
+    if ( latencyUs )
+    {
+        providerParams.latency = std::chrono::microseconds( strtol( latencyUs, nullptr, 10 ) );
+    }
+
+    const char* failureRate = getenv( "LHWSUTIL_MOCK_IDP_FAILURE_RATE" );
+    if ( failureRate )
+    {
+        providerParams.failureRate = strtod( failureRate, nullptr );
+    }
+
+    const char* keyBits = getenv( "LHWSUTIL_MOCK_IDP_KEY_BITS" );
+    if ( keyBits )
+    {
+        providerParams.keyBits = static_cast< int >( strtol( keyBits, nullptr, 10 ) );
+    }
+
+    mockProvider.reset( new MockOpenIdProvider( providerParams ) );
+    if ( mockProvider->Start() != 0 )
+    {
+        std::cerr << "failed to start mock openid provider" << std::endl;
+        return 1;
+    }
+
+    LHMiscUtilNS::Singleton< LHWSUtilNS::ISimpleHttpClientFactory >::SetInstance(
+        LHWSUtilNS::GetStandardSimpleHttpClientFactoryOnce() );
+    LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::SetInstance(
+        LHWSUtilNS::GetStandardJwtIssuerCache() );
+    LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::GetInstance()->LoadIssuer( mockIssuerCacheParams() );
+
+    benchmark::Initialize( &argc, argv );
+    if ( benchmark::ReportUnrecognizedArguments( argc, argv ) )
+    {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+
+    mockProvider->Stop();
+
+    return 0;
+}
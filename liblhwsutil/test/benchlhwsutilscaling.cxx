@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <lhmiscutil/singleton.h>
+
+#include <lhwsutil/ijwtissuercache.h>
+#include <lhwsutil/ijwtvalidator.h>
+
+#include <lhwsutil_impl/jwtissuercache.h>
+#include <lhwsutil_impl/latencyhistogram.h>
+
+#include "mockopenidprovider.h"
+
+// drives JwtIssuerCache::GetIssuer, JwtValidator::ValidateIntoJwt and the singleton lookup
+// they depend on from 1 to N threads over several issuer mixes
+//
+// prints one json object per line per run: throughput, latency percentiles over all threads,
+// the worst per thread p99 and the time spent waiting on JwtIssuerCache::cacheMutex
+//
+// usage: benchlhwsutilscaling [--max-threads N] [--duration-ms N] [--workload GetIssuer|ValidateIntoJwt|SingletonLookup]
+namespace TestLHWSUtilNS
+{
+    namespace
+    {
+        enum class Workload
+        {
+            GetIssuer,
+            ValidateIntoJwt,
+            SingletonLookup
+        };
+
+        const char* workloadName( Workload workload )
+        {
+            switch ( workload )
+            {
+                case Workload::GetIssuer:
+                    return "GetIssuer";
+                case Workload::ValidateIntoJwt:
+                    return "ValidateIntoJwt";
+                default:
+                    return "SingletonLookup";
+            }
+        }
+
+        struct IssuerMix
+        {
+            const char* name;
+            size_t numIssuers;
+            // 0 => uniform, otherwise the zipf exponent
+            double skew;
+        };
+
+        const IssuerMix issuerMixes[] = {
+            { "single", 1, 0 },
+            { "uniform8", 8, 0 },
+            { "uniform64", 64, 0 },
+            { "zipf64", 64, 1.1 } };
+
+        struct Options
+        {
+            Options()
+                : maxThreads( std::max( 1u, std::thread::hardware_concurrency() ) )
+                , durationMs( 1000 )
+                , workloads( { Workload::GetIssuer, Workload::ValidateIntoJwt, Workload::SingletonLookup } )
+            {
+            }
+
+            unsigned maxThreads;
+            long durationMs;
+            std::vector< Workload > workloads;
+        };
+
+        // a LatencyHistogram over nanoseconds, whose buckets are unit agnostic, since most of the
+        // workloads take well under a microsecond
+        class NanosHistogram
+        {
+            public:
+                void Record( std::chrono::nanoseconds elapsed )
+                {
+                    histogram.Record( static_cast< uint64_t >( elapsed.count() ) );
+                }
+
+                void Merge( const NanosHistogram& other )
+                {
+                    histogram.Merge( other.histogram );
+                }
+
+                uint64_t GetPercentileNanos( double percentile ) const
+                {
+                    return histogram.GetPercentileMicros( percentile );
+                }
+
+            private:
+                LHWSUtilImplNS::LatencyHistogram histogram;
+        };
+
+        struct ThreadResult
+        {
+            ThreadResult()
+                : ops( 0 )
+                , failures( 0 )
+                , latencies( new NanosHistogram() )
+            {
+            }
+
+            uint64_t ops;
+            uint64_t failures;
+            std::unique_ptr< NanosHistogram > latencies;
+        };
+
+        std::string issuerUrl( size_t i )
+        {
+            std::ostringstream oss;
+            oss << "https://idp.example.com/realms/tenant-" << i;
+            return oss.str();
+        }
+
+        // pre-computed so choosing an issuer costs an index increment inside the timed loop
+        std::vector< size_t > issuerSequence( const IssuerMix& mix, unsigned seed )
+        {
+            std::vector< size_t > sequence( 1 << 16 );
+            std::mt19937 generator( seed );
+
+            if ( mix.skew <= 0 )
+            {
+                std::uniform_int_distribution< size_t > distribution( 0, mix.numIssuers - 1 );
+                for ( size_t i = 0; i < sequence.size(); ++i )
+                {
+                    sequence[ i ] = distribution( generator );
+                }
+            }
+            else
+            {
+                std::vector< double > weights( mix.numIssuers );
+                for ( size_t i = 0; i < mix.numIssuers; ++i )
+                {
+                    weights[ i ] = 1.0 / std::pow( static_cast< double >( i + 1 ), mix.skew );
+                }
+                std::discrete_distribution< size_t > distribution( weights.begin(), weights.end() );
+                for ( size_t i = 0; i < sequence.size(); ++i )
+                {
+                    sequence[ i ] = distribution( generator );
+                }
+            }
+
+            return sequence;
+        }
+
+        void runThread( Workload workload,
+                        const std::vector< size_t >& sequence,
+                        const std::vector< std::string >& issuers,
+                        const std::vector< std::string >& tokens,
+                        const std::atomic< bool >& started,
+                        const std::atomic< bool >& stopped,
+                        ThreadResult& result )
+        {
+            auto jwtValidator( LHWSUtilNS::GetStandardJwtValidatorFactory()->CreateJwtValidator() );
+            auto jwtIssuerCache( LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::GetInstance() );
+            size_t next = 0;
+
+            while ( !( started.load( std::memory_order_acquire ) ) )
+            {
+                std::this_thread::yield();
+            }
+
+            while ( !( stopped.load( std::memory_order_relaxed ) ) )
+            {
+                size_t issuer = sequence[ next++ & ( sequence.size() - 1 ) ];
+                bool ok = true;
+
+                auto start( std::chrono::steady_clock::now() );
+                switch ( workload )
+                {
+                    case Workload::GetIssuer:
+                        ok = !!( jwtIssuerCache->GetIssuer( issuers[ issuer ] ) );
+                        break;
+                    case Workload::ValidateIntoJwt:
+                        ok = !!( jwtValidator->ValidateIntoJwt( tokens[ issuer ] ) );
+                        break;
+                    case Workload::SingletonLookup:
+                        ok = !!( LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::GetInstance() );
+                        break;
+                }
+                auto elapsed( std::chrono::steady_clock::now() - start );
+
+                result.latencies->Record( std::chrono::duration_cast< std::chrono::nanoseconds >( elapsed ) );
+                ++result.ops;
+                if ( !( ok ) )
+                {
+                    ++result.failures;
+                }
+            }
+        }
+
+        void runScaling( const Options& options,
+                         const TestRsaKey& signingKey,
+                         LHWSUtilImplNS::JwtIssuerCache& jwtIssuerCache )
+        {
+            for ( size_t w = 0; w < options.workloads.size(); ++w )
+            {
+                for ( size_t m = 0; m < sizeof( issuerMixes ) / sizeof( issuerMixes[ 0 ] ); ++m )
+                {
+                    const IssuerMix& mix( issuerMixes[ m ] );
+                    std::vector< std::string > issuers;
+                    std::vector< std::string > tokens;
+
+                    for ( size_t i = 0; i < mix.numIssuers; ++i )
+                    {
+                        TestTokenParams tokenParams;
+                        std::string token;
+
+                        tokenParams.iss = issuerUrl( i );
+                        CreateTestToken( tokenParams, signingKey, token );
+
+                        issuers.push_back( tokenParams.iss );
+                        tokens.push_back( token );
+                    }
+
+                    for ( unsigned numThreads = 1; numThreads <= options.maxThreads; )
+                    {
+                        std::atomic< bool > started( false );
+                        std::atomic< bool > stopped( false );
+                        std::vector< ThreadResult > results( numThreads );
+                        std::vector< std::vector< size_t > > sequences;
+                        std::vector< std::thread > threads;
+
+                        for ( unsigned t = 0; t < numThreads; ++t )
+                        {
+                            sequences.push_back( issuerSequence( mix, t + 1 ) );
+                        }
+
+                        for ( unsigned t = 0; t < numThreads; ++t )
+                        {
+                            threads.push_back( std::thread( runThread,
+                                                            options.workloads[ w ],
+                                                            std::cref( sequences[ t ] ),
+                                                            std::cref( issuers ),
+                                                            std::cref( tokens ),
+                                                            std::cref( started ),
+                                                            std::cref( stopped ),
+                                                            std::ref( results[ t ] ) ) );
+                        }
+
+                        jwtIssuerCache.ResetLockWaitStats();
+                        auto runStart( std::chrono::steady_clock::now() );
+                        started.store( true, std::memory_order_release );
+                        std::this_thread::sleep_for( std::chrono::milliseconds( options.durationMs ) );
+                        stopped.store( true );
+                        for ( unsigned t = 0; t < numThreads; ++t )
+                        {
+                            threads[ t ].join();
+                        }
+                        double seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - runStart ).count();
+
+                        LHWSUtilImplNS::LockWaitStats lockWaitStats;
+                        jwtIssuerCache.GetLockWaitStats( lockWaitStats );
+
+                        NanosHistogram allLatencies;
+                        uint64_t ops = 0;
+                        uint64_t failures = 0;
+                        uint64_t worstThreadP99 = 0;
+                        std::ostringstream perThreadP99;
+                        for ( unsigned t = 0; t < numThreads; ++t )
+                        {
+                            ops += results[ t ].ops;
+                            failures += results[ t ].failures;
+                            uint64_t threadP99 = results[ t ].latencies->GetPercentileNanos( 0.99 );
+                            worstThreadP99 = std::max( worstThreadP99, threadP99 );
+                            perThreadP99 << ( t ? "," : "" ) << threadP99;
+                        }
+
+                        for ( unsigned t = 0; t < numThreads; ++t )
+                        {
+                            allLatencies.Merge( *( results[ t ].latencies ) );
+                        }
+
+                        std::cout << "{\"workload\":\"" << workloadName( options.workloads[ w ] ) << "\""
+                                  << ",\"mix\":\"" << mix.name << "\""
+                                  << ",\"threads\":" << numThreads
+                                  << ",\"ops\":" << ops
+                                  << ",\"failures\":" << failures
+                                  << ",\"throughput_ops_per_s\":" << static_cast< uint64_t >( ops / seconds )
+                                  << ",\"p50_ns\":" << allLatencies.GetPercentileNanos( 0.50 )
+                                  << ",\"p99_ns\":" << allLatencies.GetPercentileNanos( 0.99 )
+                                  << ",\"p999_ns\":" << allLatencies.GetPercentileNanos( 0.999 )
+                                  << ",\"worst_thread_p99_ns\":" << worstThreadP99
+                                  << ",\"per_thread_p99_ns\":[" << perThreadP99.str() << "]"
+                                  << ",\"cache_mutex_contended\":" << lockWaitStats.contendedAcquisitions
+                                  << ",\"cache_mutex_wait_ns\":" << lockWaitStats.waitNanos
+                                  << "}" << std::endl;
+
+                        numThreads = ( numThreads < options.maxThreads && numThreads * 2 > options.maxThreads ) ?
+                            options.maxThreads : numThreads * 2;
+                    }
+                }
+            }
+        }
+    }
+}
+
+int main( int argc, char** argv )
+{
+    using namespace TestLHWSUtilNS;
+
+    const char* usage = "usage: benchlhwsutilscaling [--max-threads N] [--duration-ms N] "
+        "[--workload GetIssuer|ValidateIntoJwt|SingletonLookup]";
+    Options options;
+
+    for ( int i = 1; i < argc; i += 2 )
+    {
+        if ( i + 1 == argc )
+        {
+            std::cerr << "missing value for " << argv[ i ] << std::endl << usage << std::endl;
+            return 1;
+        }
+
+        if ( strcmp( argv[ i ], "--max-threads" ) == 0 )
+        {
+            options.maxThreads = static_cast< unsigned >( strtoul( argv[ i + 1 ], nullptr, 10 ) );
+        }
+        else if ( strcmp( argv[ i ], "--duration-ms" ) == 0 )
+        {
+            options.durationMs = strtol( argv[ i + 1 ], nullptr, 10 );
+        }
+        else if ( strcmp( argv[ i ], "--workload" ) == 0 )
+        {
+            options.workloads.clear();
+            for ( int w = 0; w <= static_cast< int >( Workload::SingletonLookup ); ++w )
+            {
+                if ( strcmp( argv[ i + 1 ], workloadName( static_cast< Workload >( w ) ) ) == 0 )
+                {
+                    options.workloads.push_back( static_cast< Workload >( w ) );
+                }
+            }
+
+            if ( options.workloads.empty() )
+            {
+                std::cerr << "unknown workload " << argv[ i + 1 ] << std::endl << usage << std::endl;
+                return 1;
+            }
+        }
+        else
+        {
+            std::cerr << "unknown option " << argv[ i ] << std::endl << usage << std::endl;
+            return 1;
+        }
+    }
+
+    TestRsaKey signingKey;
+    if ( GenerateTestRsaKey( 2048, signingKey ) != 0 )
+    {
+        std::cerr << "failed to generate key" << std::endl;
+        return 2;
+    }
+
+    // every issuer shares the key, they are loaded with explicit pems so no IdP is involved
+    std::shared_ptr< LHWSUtilImplNS::JwtIssuerCache > jwtIssuerCache( new LHWSUtilImplNS::JwtIssuerCache() );
+    for ( size_t i = 0; i < 64; ++i )
+    {
+        LHWSUtilNS::JwtIssuerCacheParams cacheParams;
+
+        cacheParams.iss = issuerUrl( i );
+        cacheParams.algToKeyPem[ "RS256" ] = signingKey.publicKeyPem;
+        jwtIssuerCache->LoadIssuer( cacheParams );
+    }
+
+    LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::SetInstance( jwtIssuerCache );
+
+    runScaling( options, signingKey, *jwtIssuerCache );
+
+    return 0;
+}
@@ -0,0 +1,622 @@
+#include "mockopenidprovider.h"
+
+#include <jwt.h> // C
+
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace TestLHWSUtilNS
+{
+    namespace
+    {
+        const char b64UrlAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+        std::string encodeB64Url( const std::vector< unsigned char >& bytes )
+        {
+            std::string out;
+            size_t i = 0;
+
+            out.reserve( ( ( bytes.size() + 2 ) / 3 ) * 4 );
+
+            for ( ; i + 2 < bytes.size(); i += 3 )
+            {
+                unsigned int triple = ( bytes[ i ] << 16 ) | ( bytes[ i + 1 ] << 8 ) | bytes[ i + 2 ];
+                out.push_back( b64UrlAlphabet[ ( triple >> 18 ) & 0x3f ] );
+                out.push_back( b64UrlAlphabet[ ( triple >> 12 ) & 0x3f ] );
+                out.push_back( b64UrlAlphabet[ ( triple >> 6 ) & 0x3f ] );
+                out.push_back( b64UrlAlphabet[ triple & 0x3f ] );
+            }
+
+            if ( i + 1 == bytes.size() )
+            {
+                unsigned int triple = bytes[ i ] << 16;
+                out.push_back( b64UrlAlphabet[ ( triple >> 18 ) & 0x3f ] );
+                out.push_back( b64UrlAlphabet[ ( triple >> 12 ) & 0x3f ] );
+            }
+            else if ( i + 2 == bytes.size() )
+            {
+                unsigned int triple = ( bytes[ i ] << 16 ) | ( bytes[ i + 1 ] << 8 );
+                out.push_back( b64UrlAlphabet[ ( triple >> 18 ) & 0x3f ] );
+                out.push_back( b64UrlAlphabet[ ( triple >> 12 ) & 0x3f ] );
+                out.push_back( b64UrlAlphabet[ ( triple >> 6 ) & 0x3f ] );
+            }
+
+            return out;
+        }
+
+        std::string bnToB64Url( const BIGNUM* bn )
+        {
+            std::vector< unsigned char > bytes( BN_num_bytes( bn ) );
+            BN_bn2bin( bn, bytes.data() );
+
+            return encodeB64Url( bytes );
+        }
+
+        int writePemInto( EVP_PKEY* pkey, bool privateKey, std::string& pemOut )
+        {
+            BIO* bioMem = BIO_new( BIO_s_mem() );
+            char* bioMemData = nullptr;
+            int rc = 0;
+
+            if ( !( bioMem ) )
+            {
+                return 1;
+            }
+
+            if ( privateKey )
+            {
+                rc = PEM_write_bio_PrivateKey( bioMem, pkey, nullptr, nullptr, 0, nullptr, nullptr );
+            }
+            else
+            {
+                rc = PEM_write_bio_PUBKEY( bioMem, pkey );
+            }
+
+            long bioMemDataLength = BIO_get_mem_data( bioMem, &bioMemData );
+            if ( ( rc == 1 ) && ( bioMemDataLength > 0 ) && bioMemData )
+            {
+                pemOut.assign( bioMemData, bioMemDataLength );
+                rc = 0;
+            }
+            else
+            {
+                rc = 2;
+            }
+
+            BIO_vfree( bioMem );
+
+            return rc;
+        }
+
+        int fillRsaComponents( EVP_PKEY* pkey, TestRsaKey& keyOut )
+        {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+            BIGNUM* n = nullptr;
+            BIGNUM* e = nullptr;
+            if ( !( EVP_PKEY_get_bn_param( pkey, OSSL_PKEY_PARAM_RSA_N, &n ) ) ||
+                 !( EVP_PKEY_get_bn_param( pkey, OSSL_PKEY_PARAM_RSA_E, &e ) ) )
+            {
+                BN_free( n );
+                BN_free( e );
+                return 1;
+            }
+
+            keyOut.nB64Url = bnToB64Url( n );
+            keyOut.eB64Url = bnToB64Url( e );
+
+            BN_free( n );
+            BN_free( e );
+#else
+            RSA* rsa = EVP_PKEY_get1_RSA( pkey );
+            if ( !( rsa ) )
+            {
+                return 1;
+            }
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+            const BIGNUM* n = nullptr;
+            const BIGNUM* e = nullptr;
+            RSA_get0_key( rsa, &n, &e, nullptr );
+#else
+            const BIGNUM* n = rsa->n;
+            const BIGNUM* e = rsa->e;
+#endif
+            keyOut.nB64Url = bnToB64Url( n );
+            keyOut.eB64Url = bnToB64Url( e );
+
+            RSA_free( rsa );
+#endif
+            return 0;
+        }
+
+        bool shouldHappen( double rate )
+        {
+            static thread_local std::mt19937 generator( std::random_device{}() );
+            std::uniform_real_distribution< double > distribution( 0.0, 1.0 );
+
+            return ( rate > 0 ) && ( distribution( generator ) < rate );
+        }
+
+        const char* reasonForStatus( int status )
+        {
+            switch ( status )
+            {
+                case 200:
+                    return "OK";
+                case 404:
+                    return "Not Found";
+                default:
+                    return "Internal Server Error";
+            }
+        }
+    }
+
+    TestRsaKey::TestRsaKey()
+        : bits( 0 )
+        , privateKeyPem()
+        , publicKeyPem()
+        , nB64Url()
+        , eB64Url()
+    {
+    }
+
+    int GenerateTestRsaKey( int bits, TestRsaKey& keyOut )
+    {
+        EVP_PKEY* pkey = nullptr;
+        int ret = 0;
+
+        EVP_PKEY_CTX* ctx = EVP_PKEY_CTX_new_id( EVP_PKEY_RSA, nullptr );
+        if ( !( ctx ) )
+        {
+            return 1;
+        }
+
+        if ( ( EVP_PKEY_keygen_init( ctx ) != 1 ) ||
+             ( EVP_PKEY_CTX_set_rsa_keygen_bits( ctx, bits ) != 1 ) ||
+             ( EVP_PKEY_keygen( ctx, &pkey ) != 1 ) )
+        {
+            ret = 2;
+        }
+        else if ( writePemInto( pkey, true, keyOut.privateKeyPem ) != 0 )
+        {
+            ret = 3;
+        }
+        else if ( writePemInto( pkey, false, keyOut.publicKeyPem ) != 0 )
+        {
+            ret = 4;
+        }
+        else if ( fillRsaComponents( pkey, keyOut ) != 0 )
+        {
+            ret = 5;
+        }
+        else
+        {
+            keyOut.bits = bits;
+        }
+
+        EVP_PKEY_free( pkey );
+        EVP_PKEY_CTX_free( ctx );
+
+        return ret;
+    }
+
+    TestTokenParams::TestTokenParams()
+        : alg( "RS256" )
+        , kid()
+        , iss()
+        , aud( "lhwsutil-test" )
+        , lifetimeSeconds( 3600 )
+        , minEncodedSize( 0 )
+    {
+    }
+
+    int CreateTestToken( const TestTokenParams& params,
+                         const TestRsaKey& signingKey,
+                         std::string& tokenOut )
+    {
+        jwt_t* jwt = nullptr;
+        char* encoded = nullptr;
+        int ret = 0;
+        long now = static_cast<long>( time( nullptr ) );
+        static std::atomic< uint64_t > jtiCounter( 0 );
+
+        jwt_alg_t alg = jwt_str_alg( params.alg.c_str() );
+        if ( alg == JWT_ALG_INVAL )
+        {
+            return 1;
+        }
+
+        std::ostringstream payload;
+        payload << "{\"iss\":\"" << params.iss << "\","
+                << "\"aud\":\"" << params.aud << "\","
+                << "\"sub\":\"5f1c7d4e-8a52-4d1f-9c3a-2b1e0f6a7d90\","
+                << "\"typ\":\"Bearer\","
+                << "\"azp\":\"lhwsutil-test\","
+                << "\"exp\":" << ( now + params.lifetimeSeconds ) << ","
+                << "\"iat\":" << now << ","
+                << "\"jti\":\"" << now << "-" << jtiCounter.fetch_add( 1 ) << "\","
+                << "\"scope\":\"openid profile email\","
+                << "\"preferred_username\":\"testuser\","
+                << "\"email\":\"testuser@example.com\","
+                << "\"email_verified\":true,"
+                << "\"realm_access\":{\"roles\":[\"offline_access\",\"uma_authorization\"";
+
+        // roughly 4/3 base64 expansion of the payload, plus header and signature
+        size_t overhead = 100 + ( signingKey.bits / 6 );
+        for ( size_t i = 0; ( ( payload.tellp() * 4 ) / 3 ) + overhead < params.minEncodedSize; ++i )
+        {
+            payload << ",\"generated-role-" << i << "\"";
+        }
+
+        payload << "]}}";
+
+        if ( jwt_new( &jwt ) != 0 )
+        {
+            return 2;
+        }
+
+        if ( params.kid.size() && ( jwt_add_header( jwt, "kid", params.kid.c_str() ) != 0 ) )
+        {
+            ret = 3;
+        }
+        else if ( jwt_add_grants_json( jwt, payload.str().c_str() ) != 0 )
+        {
+            ret = 4;
+        }
+        else if ( jwt_set_alg( jwt,
+                               alg,
+                               reinterpret_cast< const unsigned char* >( signingKey.privateKeyPem.c_str() ),
+                               signingKey.privateKeyPem.size() ) != 0 )
+        {
+            ret = 5;
+        }
+        else if ( !( encoded = jwt_encode_str( jwt ) ) )
+        {
+            ret = 6;
+        }
+        else
+        {
+            tokenOut = encoded;
+            jwt_free_str( encoded );
+        }
+
+        jwt_free( jwt );
+
+        return ret;
+    }
+
+    MockOpenIdProviderParams::MockOpenIdProviderParams()
+        : port( 0 )
+        , realm( "mock" )
+        , keyBits( 2048 )
+        , algs( { "RS256", "RS384", "RS512" } )
+        , latency( 0 )
+        , failureRate( 0 )
+        , inactiveRate( 0 )
+    {
+    }
+
+    MockOpenIdProvider::MockOpenIdProvider( const MockOpenIdProviderParams& _params )
+        : params( _params )
+        , algToKey()
+        , issuerUrl()
+        , openIdConfiguration()
+        , jwks()
+        , listenFd( -1 )
+        , stopping( false )
+        , requestCount( 0 )
+        , failureCount( 0 )
+        , acceptThread()
+        , connectionsMutex()
+        , connectionFds()
+        , connectionThreads()
+    {
+    }
+
+    MockOpenIdProvider::~MockOpenIdProvider()
+    {
+        Stop();
+    }
+
+    int MockOpenIdProvider::Start()
+    {
+        std::ostringstream jwksOss;
+
+        jwksOss << "{\"keys\":[";
+        for ( size_t i = 0; i < params.algs.size(); ++i )
+        {
+            TestRsaKey key;
+            if ( GenerateTestRsaKey( params.keyBits, key ) != 0 )
+            {
+                return 1;
+            }
+
+            jwksOss << ( i ? "," : "" )
+                    << "{\"kid\":\"" << params.algs[ i ] << "-kid\",\"kty\":\"RSA\",\"alg\":\""
+                    << params.algs[ i ] << "\",\"use\":\"sig\",\"n\":\"" << key.nB64Url
+                    << "\",\"e\":\"" << key.eB64Url << "\"}";
+
+            algToKey[ params.algs[ i ] ] = key;
+        }
+        jwksOss << "]}";
+        jwks = jwksOss.str();
+
+        listenFd = socket( AF_INET, SOCK_STREAM, 0 );
+        if ( listenFd < 0 )
+        {
+            return 2;
+        }
+
+        int one = 1;
+        setsockopt( listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof( one ) );
+
+        sockaddr_in addr;
+        memset( &addr, 0, sizeof( addr ) );
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons( params.port );
+        addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+        socklen_t addrLen = sizeof( addr );
+
+        if ( ( bind( listenFd, reinterpret_cast< sockaddr* >( &addr ), sizeof( addr ) ) != 0 ) ||
+             ( listen( listenFd, 128 ) != 0 ) ||
+             ( getsockname( listenFd, reinterpret_cast< sockaddr* >( &addr ), &addrLen ) != 0 ) )
+        {
+            close( listenFd );
+            listenFd = -1;
+            return 3;
+        }
+
+        std::ostringstream issuerOss;
+        issuerOss << "http://127.0.0.1:" << ntohs( addr.sin_port ) << "/realms/" << params.realm;
+        issuerUrl = issuerOss.str();
+
+        std::ostringstream configOss;
+        configOss << "{\"issuer\":\"" << issuerUrl << "\","
+                  << "\"jwks_uri\":\"" << issuerUrl << "/protocol/openid-connect/certs\","
+                  << "\"introspection_endpoint\":\"" << issuerUrl << "/protocol/openid-connect/token/introspect\","
+                  << "\"token_endpoint\":\"" << issuerUrl << "/protocol/openid-connect/token\","
+                  << "\"id_token_signing_alg_values_supported\":[";
+        for ( size_t i = 0; i < params.algs.size(); ++i )
+        {
+            configOss << ( i ? "," : "" ) << "\"" << params.algs[ i ] << "\"";
+        }
+        configOss << "]}";
+        openIdConfiguration = configOss.str();
+
+        stopping = false;
+        acceptThread = std::thread( &MockOpenIdProvider::acceptLoop, this );
+
+        return 0;
+    }
+
+    void MockOpenIdProvider::Stop()
+    {
+        if ( listenFd < 0 )
+        {
+            return;
+        }
+
+        stopping = true;
+        shutdown( listenFd, SHUT_RDWR );
+        if ( acceptThread.joinable() )
+        {
+            acceptThread.join();
+        }
+        close( listenFd );
+        listenFd = -1;
+
+        std::vector< std::thread > threads;
+        {
+            std::lock_guard< std::mutex > lock( connectionsMutex );
+            for ( size_t i = 0; i < connectionFds.size(); ++i )
+            {
+                shutdown( connectionFds[ i ], SHUT_RDWR );
+            }
+            threads.swap( connectionThreads );
+        }
+
+        for ( size_t i = 0; i < threads.size(); ++i )
+        {
+            threads[ i ].join();
+        }
+    }
+
+    const std::string& MockOpenIdProvider::GetIssuerUrl() const
+    {
+        return issuerUrl;
+    }
+
+    const TestRsaKey& MockOpenIdProvider::GetKeyForAlg( const std::string& alg ) const
+    {
+        auto it = algToKey.find( alg );
+        if ( it == algToKey.end() )
+        {
+            throw std::runtime_error( "no key for alg=[" + alg + "]" );
+        }
+
+        return it->second;
+    }
+
+    int MockOpenIdProvider::IssueToken( const std::string& alg, size_t minEncodedSize, std::string& tokenOut ) const
+    {
+        TestTokenParams tokenParams;
+
+        tokenParams.alg = alg;
+        tokenParams.kid = alg + "-kid";
+        tokenParams.iss = issuerUrl;
+        tokenParams.minEncodedSize = minEncodedSize;
+
+        return CreateTestToken( tokenParams, GetKeyForAlg( alg ), tokenOut );
+    }
+
+    uint64_t MockOpenIdProvider::GetRequestCount() const
+    {
+        return requestCount.load();
+    }
+
+    uint64_t MockOpenIdProvider::GetFailureCount() const
+    {
+        return failureCount.load();
+    }
+
+    void MockOpenIdProvider::acceptLoop()
+    {
+        while ( !( stopping ) )
+        {
+            int fd = accept( listenFd, nullptr, nullptr );
+            if ( fd < 0 )
+            {
+                continue;
+            }
+
+            int one = 1;
+            setsockopt( fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+
+            std::lock_guard< std::mutex > lock( connectionsMutex );
+            connectionFds.push_back( fd );
+            connectionThreads.push_back( std::thread( &MockOpenIdProvider::serveConnection, this, fd ) );
+        }
+    }
+
+    void MockOpenIdProvider::serveConnection( int fd )
+    {
+        std::string buffer;
+        char chunk[ 16 * 1024 ];
+
+        while ( !( stopping ) )
+        {
+            size_t headerEnd = buffer.find( "\r\n\r\n" );
+            if ( headerEnd == std::string::npos )
+            {
+                ssize_t numRead = read( fd, chunk, sizeof( chunk ) );
+                if ( numRead <= 0 )
+                {
+                    break;
+                }
+                buffer.append( chunk, numRead );
+                continue;
+            }
+
+            std::istringstream requestLine( buffer.substr( 0, buffer.find( "\r\n" ) ) );
+            std::string method;
+            std::string path;
+            requestLine >> method >> path;
+
+            size_t contentLength = 0;
+            size_t contentLengthPos = buffer.find( "Content-Length:" );
+            if ( contentLengthPos != std::string::npos && contentLengthPos < headerEnd )
+            {
+                contentLength = strtoul( buffer.c_str() + contentLengthPos + 15, nullptr, 10 );
+            }
+
+            while ( buffer.size() < headerEnd + 4 + contentLength )
+            {
+                ssize_t numRead = read( fd, chunk, sizeof( chunk ) );
+                if ( numRead <= 0 )
+                {
+                    break;
+                }
+                buffer.append( chunk, numRead );
+            }
+
+            if ( buffer.size() < headerEnd + 4 + contentLength )
+            {
+                break;
+            }
+
+            buffer.erase( 0, headerEnd + 4 + contentLength );
+
+            int status = 200;
+            std::string body;
+            respond( method, path, status, body );
+
+            std::ostringstream response;
+            response << "HTTP/1.1 " << status << " " << reasonForStatus( status ) << "\r\n"
+                     << "Content-Type: application/json\r\n"
+                     << "Content-Length: " << body.size() << "\r\n"
+                     << "Connection: keep-alive\r\n\r\n"
+                     << body;
+
+            std::string responseStr( response.str() );
+            size_t written = 0;
+            while ( written < responseStr.size() )
+            {
+                ssize_t numWritten = write( fd, responseStr.data() + written, responseStr.size() - written );
+                if ( numWritten <= 0 )
+                {
+                    break;
+                }
+                written += numWritten;
+            }
+        }
+
+        std::lock_guard< std::mutex > lock( connectionsMutex );
+        for ( auto it = connectionFds.begin(); it != connectionFds.end(); ++it )
+        {
+            if ( *it == fd )
+            {
+                connectionFds.erase( it );
+                break;
+            }
+        }
+        close( fd );
+    }
+
+    void MockOpenIdProvider::respond( const std::string& method,
+                                      const std::string& path,
+                                      int& statusOut,
+                                      std::string& bodyOut )
+    {
+        std::string prefix( "/realms/" + params.realm );
+
+        requestCount.fetch_add( 1 );
+
+        if ( params.latency.count() > 0 )
+        {
+            std::this_thread::sleep_for( params.latency );
+        }
+
+        if ( shouldHappen( params.failureRate ) )
+        {
+            failureCount.fetch_add( 1 );
+            statusOut = 500;
+            bodyOut = "{\"error\":\"injected failure\"}";
+            return;
+        }
+
+        statusOut = 200;
+        if ( method == "GET" && path == prefix + "/.well-known/openid-configuration" )
+        {
+            bodyOut = openIdConfiguration;
+        }
+        else if ( method == "GET" && path == prefix + "/protocol/openid-connect/certs" )
+        {
+            bodyOut = jwks;
+        }
+        else if ( method == "POST" && path == prefix + "/protocol/openid-connect/token/introspect" )
+        {
+            bodyOut = shouldHappen( params.inactiveRate ) ? "{\"active\":false}" : "{\"active\":true}";
+        }
+        else
+        {
+            statusOut = 404;
+            bodyOut = "{\"error\":\"not found\"}";
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#ifndef __LHWSUTIL_TEST_MOCKOPENIDPROVIDER_H__
+#define __LHWSUTIL_TEST_MOCKOPENIDPROVIDER_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace TestLHWSUtilNS
+{
+    struct TestRsaKey
+    {
+        TestRsaKey();
+
+        int bits;
+        std::string privateKeyPem;
+        std::string publicKeyPem;
+        // base64url encoded big endian modulus and exponent, as found in a jwk
+        std::string nB64Url;
+        std::string eB64Url;
+    };
+
+    int GenerateTestRsaKey( int bits, TestRsaKey& keyOut );
+
+    struct TestTokenParams
+    {
+        TestTokenParams();
+
+        std::string alg;
+        std::string kid;
+        std::string iss;
+        std::string aud;
+        long lifetimeSeconds;
+        // the encoded token is padded with realm roles until it is at least this long
+        size_t minEncodedSize;
+    };
+
+    int CreateTestToken( const TestTokenParams& params,
+                         const TestRsaKey& signingKey,
+                         std::string& tokenOut );
+
+    struct MockOpenIdProviderParams
+    {
+        MockOpenIdProviderParams();
+
+        // 0 => pick an ephemeral port
+        unsigned short port;
+        std::string realm;
+        int keyBits;
+        std::vector< std::string > algs;
+        // added to every response
+        std::chrono::microseconds latency;
+        // fraction of requests answered with a 500
+        double failureRate;
+        // fraction of introspections answered with active=false
+        double inactiveRate;
+    };
+
+    // serves openid-configuration, jwks and introspection for a single realm on localhost,
+    // one thread per connection, connections are kept alive
+    class MockOpenIdProvider
+    {
+        public:
+            MockOpenIdProvider( const MockOpenIdProviderParams& _params );
+            ~MockOpenIdProvider();
+
+            MockOpenIdProvider( const MockOpenIdProvider& other ) = delete;
+            MockOpenIdProvider& operator=( const MockOpenIdProvider& other ) = delete;
+
+            int Start();
+            void Stop();
+
+            // valid after Start
+            const std::string& GetIssuerUrl() const;
+            const TestRsaKey& GetKeyForAlg( const std::string& alg ) const;
+            int IssueToken( const std::string& alg, size_t minEncodedSize, std::string& tokenOut ) const;
+
+            uint64_t GetRequestCount() const;
+            uint64_t GetFailureCount() const;
+
+        private:
+            MockOpenIdProviderParams params;
+            std::map< std::string, TestRsaKey > algToKey;
+            std::string issuerUrl;
+            std::string openIdConfiguration;
+            std::string jwks;
+            int listenFd;
+            std::atomic< bool > stopping;
+            std::atomic< uint64_t > requestCount;
+            std::atomic< uint64_t > failureCount;
+            std::thread acceptThread;
+            std::mutex connectionsMutex;
+            std::vector< int > connectionFds;
+            std::vector< std::thread > connectionThreads;
+
+            void acceptLoop();
+            void serveConnection( int fd );
+            void respond( const std::string& method,
+                          const std::string& path,
+                          int& statusOut,
+                          std::string& bodyOut );
+    };
+}
+
+#endif
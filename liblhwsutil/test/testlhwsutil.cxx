@@ -1,8 +1,58 @@
 #include <gtest/gtest.h>
 
+#include <boost/log/core.hpp>
+#include <boost/log/expressions.hpp>
+#include <boost/log/sinks/sync_frontend.hpp>
+#include <boost/log/sinks/text_ostream_backend.hpp>
+
+#include <jwt.h> // C
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <lhsslutil/base64.h>
+
+#include <lhwsutil/claimpath.h>
+#include <lhwsutil/ijwtreplayguard.h>
+#include <lhwsutil/ijwtrevocationlist.h>
+#include <lhwsutil/jwtpolicy.h>
+#include <lhwsutil/logging.h>
+#include <lhwsutil/metrics.h>
+#include <lhwsutil/scoperegistry.h>
+#include <lhwsutil/staticjwtvalidator.h>
+#include <lhwsutil/tracing.h>
+#include <lhwsutil/validatedjwt.h>
+
+#include <lhwsutil_impl/claimprojection.h>
+#include <lhwsutil_impl/frozenissuertable.h>
+#include <lhwsutil_impl/httpresponsesinks.h>
+#include <lhwsutil_impl/jwsverifier.h>
+#include <lhwsutil_impl/jwtchecks.h>
+#include <lhwsutil_impl/jwtissuercache.h>
+#include <lhwsutil_impl/jwtpolicy.h>
+#include <lhwsutil_impl/jwtreplayguard.h>
 #include <lhwsutil_impl/jwtvalidator.h>
+#include <lhwsutil_impl/latencyhistogram.h>
+#include <lhwsutil_impl/lazyjwtissuercache.h>
+#include <lhwsutil_impl/metricsregistry.h>
+#include <lhwsutil_impl/rsa.h>
+#include <lhwsutil_impl/sharedjwtcache.h>
 #include <lhwsutil_impl/simplehttpclientcurl.h>
 #include <lhwsutil_impl/jwtutils.h>
+#include <lhwsutil_impl/validationarena.h>
 
 namespace TestLHThingAPINS
 {
@@ -13,4 +63,1919 @@ namespace TestLHThingAPINS
         auto validJwt = jwtValidator->ValidateIntoJwt( "abc" );
         ASSERT_TRUE( true );
     }
+
+    TEST( TestLHWSUtil, MetricsSurviveThreadExit )
+    {
+        const std::string iss( "https://idp.example.com/realms/metrics" );
+        const int numThreads = 4;
+        const int numValidations = 1000;
+        LHWSUtilNS::MetricsSnapshot before;
+        LHWSUtilNS::MetricsSnapshot after;
+        std::vector< std::thread > threads;
+        std::string prometheusText;
+
+        LHWSUtilNS::GetMetricsSnapshot( before );
+
+        LHWSUtilImplNS::GetMetricsRegistry().RegisterIssuer( iss );
+        size_t issuerIndex = LHWSUtilImplNS::GetMetricsRegistry().IssuerIndex( iss );
+        ASSERT_NE( LHWSUtilImplNS::otherMetricsIssuer, issuerIndex );
+        ASSERT_EQ( LHWSUtilImplNS::otherMetricsIssuer,
+                   LHWSUtilImplNS::GetMetricsRegistry().IssuerIndex( "https://unregistered.example.com" ) );
+
+        for ( int t = 0; t < numThreads; ++t )
+        {
+            threads.push_back( std::thread( [ issuerIndex ]()
+            {
+                for ( int i = 0; i < numValidations; ++i )
+                {
+                    LHWSUtilImplNS::RecordJwtValidation( LHWSUtilNS::JwtValidationMethod::ValidateIntoJwt,
+                                                         LHWSUtilNS::JwtValidationResult::Valid,
+                                                         LHWSUtilNS::JwtValidationStage::Verify,
+                                                         issuerIndex,
+                                                         LHWSUtilImplNS::MetricsAlgIndex( "RS256" ),
+                                                         10 );
+                }
+            } ) );
+        }
+
+        for ( auto it = threads.begin(); it != threads.end(); ++it )
+        {
+            it->join();
+        }
+
+        LHWSUtilNS::GetMetricsSnapshot( after );
+
+        const size_t valid = static_cast< size_t >( LHWSUtilNS::JwtValidationResult::Valid );
+        const size_t validate = static_cast< size_t >( LHWSUtilNS::JwtValidationMethod::ValidateIntoJwt );
+        EXPECT_EQ( numThreads * numValidations,
+                   after.validationsByMethod[ validate ][ valid ] - before.validationsByMethod[ validate ][ valid ] );
+        EXPECT_EQ( numThreads * numValidations, after.validationsByIssuer[ iss ][ valid ] );
+        EXPECT_EQ( numThreads * numValidations,
+                   after.validationLatency[ validate ].count - before.validationLatency[ validate ].count );
+
+        LHWSUtilNS::FormatMetricsPrometheus( after, prometheusText );
+        EXPECT_NE( std::string::npos,
+                   prometheusText.find( "lhwsutil_jwt_validations_by_issuer_total{issuer=\"" + iss +
+                                        "\",result=\"valid\"} 4000\n" ) );
+        EXPECT_NE( std::string::npos,
+                   prometheusText.find( "lhwsutil_jwt_validation_duration_seconds_bucket{method=\"validate\",le=\"+Inf\"}" ) );
+    }
+
+    TEST( TestLHWSUtil, ScopeRegistryParsesScopeClaims )
+    {
+        LHWSUtilNS::ScopeRegistry registry;
+        LHWSUtilNS::ScopeSet required( registry.RegisterScopes( { "openid", "email", "orders:write" } ) );
+        size_t profileBit = registry.RegisterScope( "profile" );
+        const std::string scopesStr( "  email openid unregistered  orders:write " );
+        LHWSUtilNS::ScopeSet scopes;
+
+        ASSERT_EQ( registry.RegisterScope( "email" ), registry.RegisterScope( "email" ) );
+        ASSERT_EQ( 4U, registry.NumScopes() );
+        ASSERT_EQ( "profile", registry.ScopeName( profileBit ) );
+
+        registry.ParseScopes( scopesStr.data(), scopesStr.size(), scopes );
+        EXPECT_EQ( 3U, scopes.count() );
+        EXPECT_TRUE( LHWSUtilNS::HasAllScopes( scopes, required ) );
+        EXPECT_FALSE( scopes.test( profileBit ) );
+
+        scopes.reset();
+        registry.ParseScopes( "openid", 6, scopes );
+        EXPECT_EQ( 1U, scopes.count() );
+        EXPECT_FALSE( LHWSUtilNS::HasAllScopes( scopes, required ) );
+        EXPECT_TRUE( LHWSUtilNS::HasAnyScope( scopes, required ) );
+    }
+
+    TEST( TestLHWSUtil, JwtPolicyCompilesTopLevelClaimsFirst )
+    {
+        LHWSUtilNS::JwtPolicy policy;
+        std::string errorStr;
+
+        ASSERT_EQ( 0, policy.Compile( "realm_access.roles contains admin AND scope contains orders:write "
+                                      "AND aud == \"my api\" AND email_verified == true", errorStr ) );
+        ASSERT_EQ( 4U, policy.GetConditions().size() );
+        EXPECT_EQ( "scope", policy.GetConditions()[ 0 ].path );
+        EXPECT_EQ( "my api", policy.GetValues()[ policy.GetConditions()[ 1 ].valueIndex ] );
+        EXPECT_TRUE( policy.GetConditions()[ 2 ].valueIsBool );
+        EXPECT_EQ( "realm_access.roles", policy.GetConditions()[ 3 ].path );
+        ASSERT_EQ( 2U, policy.GetConditions()[ 3 ].claimPath.NumTokens() );
+        EXPECT_EQ( LHWSUtilNS::JwtPolicyOp::Contains, policy.GetConditions()[ 3 ].op );
+
+        EXPECT_NE( 0, policy.Compile( "scope contains", errorStr ) );
+        EXPECT_NE( 0, policy.Compile( "scope contains a OR scope contains b", errorStr ) );
+        EXPECT_NE( 0, policy.Compile( "realm_access..roles exists", errorStr ) );
+        EXPECT_EQ( 4U, policy.GetConditions().size() );
+
+        // conditions on one claim or with one value share it
+        ASSERT_EQ( 0, policy.Compile( "scope contains openid AND realm_access.groups contains admin", errorStr ) );
+        ASSERT_EQ( 6U, policy.GetConditions().size() );
+        EXPECT_EQ( 4U, policy.GetClaimNames().size() );
+        EXPECT_EQ( policy.GetConditions()[ 0 ].claimIndex, policy.GetConditions()[ 3 ].claimIndex );
+        EXPECT_EQ( policy.GetConditions()[ 4 ].claimIndex, policy.GetConditions()[ 5 ].claimIndex );
+        EXPECT_EQ( policy.GetConditions()[ 4 ].valueIndex, policy.GetConditions()[ 5 ].valueIndex );
+        EXPECT_EQ( "realm_access", policy.GetClaimNames()[ policy.GetConditions()[ 5 ].claimIndex ] );
+    }
+
+    TEST( TestLHWSUtil, ClaimProjectionMapsClaimsOntoFields )
+    {
+        struct Claims
+        {
+            std::string sub;
+            long exp;
+            std::vector< std::string > roles;
+        };
+        LHWSUtilNS::ClaimProjection< Claims > projection;
+        Claims claims;
+
+        projection.MapString( "sub", &Claims::sub )
+                  .MapInt( "exp", &Claims::exp )
+                  .MapStringList( "roles", &Claims::roles, false );
+        ASSERT_THROW( projection.MapString( "sub", &Claims::sub ), std::runtime_error );
+        ASSERT_EQ( 3U, projection.NumClaims() );
+        ASSERT_EQ( 1, projection.FindClaim( "exp", 3 ) );
+        ASSERT_EQ( -1, projection.FindClaim( "ex", 2 ) );
+        EXPECT_FALSE( projection.ClaimIsRequired( 2 ) );
+
+        projection.SetString( &claims, 0, "user", 4 );
+        projection.SetInt( &claims, 1, 42 );
+        projection.ClearList( &claims, 2 );
+        projection.AppendToList( &claims, 2, "admin", 5 );
+        EXPECT_EQ( "user", claims.sub );
+        EXPECT_EQ( 42, claims.exp );
+        ASSERT_EQ( 1U, claims.roles.size() );
+        EXPECT_EQ( "admin", claims.roles[ 0 ] );
+
+        EXPECT_EQ( 4U, LHWSUtilNS::GetUserIdentifiersProjection().NumClaims() );
+
+        LHWSUtilImplNS::JwtValidatorFactory jwtValidatorFactory;
+        auto jwtValidator = jwtValidatorFactory.CreateJwtValidator();
+        EXPECT_EQ( 1, jwtValidator->ValidateIntoClaims( "abc", projection, claims ) );
+    }
+
+    TEST( TestLHWSUtil, ClaimPathParsesPointersAndDottedPaths )
+    {
+        LHWSUtilNS::ClaimPath dotted( "realm_access.roles" );
+        LHWSUtilNS::ClaimPath pointer( "/resource_access/my.client/roles/0" );
+        LHWSUtilNS::ClaimPath escaped( "/a~1b/c~0d" );
+
+        ASSERT_EQ( 2U, dotted.NumTokens() );
+        EXPECT_EQ( "roles", dotted.GetToken( 1 ) );
+        EXPECT_EQ( -1, dotted.GetIndex( 1 ) );
+
+        ASSERT_EQ( 4U, pointer.NumTokens() );
+        EXPECT_EQ( "my.client", pointer.GetToken( 1 ) );
+        EXPECT_EQ( 0, pointer.GetIndex( 3 ) );
+
+        ASSERT_EQ( 2U, escaped.NumTokens() );
+        EXPECT_EQ( "a/b", escaped.GetToken( 0 ) );
+        EXPECT_EQ( "c~d", escaped.GetToken( 1 ) );
+
+        EXPECT_EQ( 0U, LHWSUtilNS::ClaimPath( "" ).NumTokens() );
+        EXPECT_THROW( LHWSUtilNS::ClaimPath( "/a//b" ), std::runtime_error );
+        EXPECT_THROW( LHWSUtilNS::ClaimPath( "/a~2" ), std::runtime_error );
+        EXPECT_THROW( LHWSUtilNS::ClaimPath( "a." ), std::runtime_error );
+    }
+
+    TEST( TestLHWSUtil, ValidationArenaGrowsToFitAndResetsOnOutermostScope )
+    {
+        std::thread( []()
+        {
+            LHWSUtilImplNS::ValidationArena& arena( LHWSUtilImplNS::GetValidationArena() );
+            size_t initialCapacity = arena.GetCapacity();
+
+            {
+                LHWSUtilImplNS::ValidationArenaScope outerScope;
+                {
+                    LHWSUtilImplNS::ValidationArenaScope innerScope;
+                    ASSERT_NE( nullptr, arena.GetAllocator().Malloc( 16 ) );
+                }
+
+                // the inner scope must not have released the outer scope's allocations
+                EXPECT_LT( 0U, arena.GetAllocator().Size() );
+                ASSERT_NE( nullptr, arena.GetAllocator().Malloc( LHWSUtilImplNS::validationArenaInitialBytes ) );
+            }
+
+            EXPECT_EQ( 0U, arena.GetAllocator().Size() );
+            EXPECT_LT( initialCapacity, arena.GetCapacity() );
+        } ).join();
+    }
+
+    TEST( TestLHWSUtil, ValidatedJwtHoldsCommonClaimsByValue )
+    {
+        const LHWSUtilNS::ClaimProjectionBase& projection( LHWSUtilNS::ValidatedJwt::GetClaimProjection() );
+        LHWSUtilNS::ValidatedJwt validatedJwt;
+        const std::string sub( LHWSUtilNS::validatedJwtInlineBytes, 's' );
+        const char* str = nullptr;
+        size_t strSize = 0;
+        long exp = 0;
+
+        EXPECT_EQ( LHWSUtilNS::JwtValidationResult::Error, validatedJwt.GetResult() );
+
+        int aud = projection.FindClaim( "aud", 3 );
+        ASSERT_LE( 0, aud );
+        projection.SetString( &validatedJwt, projection.FindClaim( "iss", 3 ), "https://idp", 11 );
+        projection.ClearList( &validatedJwt, aud );
+        projection.AppendToList( &validatedJwt, aud, "api", 3 );
+        projection.AppendToList( &validatedJwt, aud, "web", 3 );
+        projection.SetInt( &validatedJwt, projection.FindClaim( "exp", 3 ), 42 );
+        // spills the strings onto the heap
+        projection.SetString( &validatedJwt, projection.FindClaim( "sub", 3 ), sub.data(), sub.size() );
+
+        LHWSUtilNS::ValidatedJwt movedJwt( std::move( validatedJwt ) );
+        EXPECT_FALSE( validatedJwt.IsValid() );
+        EXPECT_EQ( 1, validatedJwt.GetStrClaim( LHWSUtilNS::JwtStrClaim::Iss, str, strSize ) );
+
+        // only a validator sets the result
+        EXPECT_FALSE( movedJwt.IsValid() );
+        ASSERT_EQ( 0, movedJwt.GetStrClaim( LHWSUtilNS::JwtStrClaim::Iss, str, strSize ) );
+        EXPECT_EQ( "https://idp", std::string( str, strSize ) );
+        ASSERT_EQ( 0, movedJwt.GetStrClaim( LHWSUtilNS::JwtStrClaim::Sub, str, strSize ) );
+        EXPECT_EQ( sub, std::string( str, strSize ) );
+        EXPECT_TRUE( movedJwt.StrClaimHasToken( LHWSUtilNS::JwtStrClaim::Aud, "web", 3 ) );
+        EXPECT_FALSE( movedJwt.StrClaimHasToken( LHWSUtilNS::JwtStrClaim::Aud, "we", 2 ) );
+        ASSERT_EQ( 0, movedJwt.GetIntClaim( LHWSUtilNS::JwtIntClaim::Exp, exp ) );
+        EXPECT_EQ( 42, exp );
+        EXPECT_EQ( 1, movedJwt.GetIntClaim( LHWSUtilNS::JwtIntClaim::Iat, exp ) );
+
+        LHWSUtilImplNS::JwtValidatorFactory jwtValidatorFactory;
+        auto jwtValidator = jwtValidatorFactory.CreateJwtValidator();
+        EXPECT_EQ( LHWSUtilNS::JwtValidationResult::Invalid, jwtValidator->ValidateIntoJwt( "", movedJwt ) );
+        EXPECT_EQ( LHWSUtilNS::JwtValidationResult::Invalid, movedJwt.GetResult() );
+        EXPECT_EQ( 1, movedJwt.GetStrClaim( LHWSUtilNS::JwtStrClaim::Iss, str, strSize ) );
+    }
+
+    LHWSUTIL_JWT_ISSUER( TestIdp, "https://idp.test" );
+
+    TEST( TestLHWSUtil, StaticJwtValidatorFoldsItsParameters )
+    {
+        typedef LHWSUtilNS::RequiredClaims< LHWSUtilNS::ClaimSub, LHWSUtilNS::ClaimExp > Required;
+        typedef LHWSUtilNS::AllowedIssuers< TestIdp > Issuers;
+        LHWSUtilNS::StaticJwtValidator< LHWSUtilNS::JwtAlg::RS256, Required, Issuers > jwtValidator;
+        LHWSUtilNS::ValidatedJwt validatedJwt;
+
+        static_assert( Required::strClaimMask == ( 1U << static_cast< size_t >( LHWSUtilNS::JwtStrClaim::Sub ) ),
+                       "sub is the only required string claim" );
+        static_assert( Required::intClaimMask == ( 1U << static_cast< size_t >( LHWSUtilNS::JwtIntClaim::Exp ) ),
+                       "exp is the only required integer claim" );
+        ASSERT_EQ( 1U, Issuers::numIssuers );
+        EXPECT_EQ( 0U, LHWSUtilNS::AnyIssuer::numIssuers );
+        EXPECT_EQ( LHWSUtilNS::ClaimSub::strClaimMask, Required::strClaimMask );
+        EXPECT_EQ( LHWSUtilNS::ClaimExp::intClaimMask, Required::intClaimMask );
+        EXPECT_EQ( 0U, LHWSUtilNS::RequiredClaims<>::strClaimMask );
+        EXPECT_STREQ( "https://idp.test", Issuers::Urls()[ 0 ] );
+        EXPECT_EQ( nullptr, LHWSUtilNS::AnyIssuer::Urls()[ 0 ] );
+        EXPECT_STREQ( "RS256", LHWSUtilNS::JwtAlgName( LHWSUtilNS::JwtAlg::RS256 ) );
+
+        EXPECT_EQ( LHWSUtilNS::JwtValidationResult::Invalid, jwtValidator.ValidateIntoJwt( "", validatedJwt ) );
+        EXPECT_FALSE( validatedJwt.IsValid() );
+    }
+
+    TEST( TestLHWSUtil, JwtRevocationListRevokesUntilExpAndReloadsAtOnce )
+    {
+        // 2100-01-01, revocations which have passed are dropped when the list is rebuilt
+        const long base = 4102444800L;
+        auto revocationList( LHWSUtilNS::GetStandardJwtRevocationList( 4 ) );
+        LHWSUtilNS::JwtRevocation revocation;
+
+        ASSERT_EQ( 0, LHWSUtilNS::ParseJwtRevocation( "jti abc 4102445000", 18, revocation ) );
+        revocationList->Revoke( revocation );
+        ASSERT_EQ( 0, LHWSUtilNS::ParseJwtRevocation( "sid s1 4102444900\r", 18, revocation ) );
+        revocationList->Revoke( revocation );
+        EXPECT_EQ( 1, LHWSUtilNS::ParseJwtRevocation( "# comment", 9, revocation ) );
+        EXPECT_NE( 0, LHWSUtilNS::ParseJwtRevocation( "aud x 100", 9, revocation ) );
+        // grows the filter past its expected revocations
+        for ( int i = 0; i < 100; ++i )
+        {
+            revocationList->Revoke( LHWSUtilNS::JwtRevocation( LHWSUtilNS::JwtRevocationClaim::Jti,
+                "jti" + std::to_string( i ),
+                base + 300 ) );
+        }
+
+        // an already expired revocation is not kept
+        revocationList->Revoke( LHWSUtilNS::JwtRevocation( LHWSUtilNS::JwtRevocationClaim::Jti, "old", 1000 ) );
+        EXPECT_FALSE( revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Jti, "old", 3, 999 ) );
+
+        EXPECT_EQ( 102U, revocationList->NumRevocations() );
+        EXPECT_TRUE( revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Jti, "abc", 3, base + 150 ) );
+        EXPECT_TRUE( revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Jti, "jti99", 5, base + 150 ) );
+        EXPECT_FALSE( revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Sid, "abc", 3, base ) );
+        EXPECT_TRUE( revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Sid, "s1", 2, base ) );
+        EXPECT_FALSE( revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Sid, "s1", 2, base + 100 ) );
+
+        EXPECT_EQ( 1U, revocationList->Expire( base + 100 ) );
+        EXPECT_EQ( 101U, revocationList->NumRevocations() );
+
+        revocationList->Reload( { LHWSUtilNS::JwtRevocation( LHWSUtilNS::JwtRevocationClaim::Jti, "new", base ) } );
+        EXPECT_EQ( 1U, revocationList->NumRevocations() );
+        EXPECT_FALSE( revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Jti, "abc", 3, base - 1 ) );
+        EXPECT_TRUE( revocationList->IsRevoked( LHWSUtilNS::JwtRevocationClaim::Jti, "new", 3, base - 1 ) );
+    }
+
+    TEST( TestLHWSUtil, JwtReplayGuardRejectsASecondUseUntilExp )
+    {
+        const long now = 1767225600L;
+        LHWSUtilImplNS::ReplayTimingWheel wheel( 2, now );
+
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::First, wheel.Insert( 1, now + 10 ) );
+        // expires through level 1
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::First, wheel.Insert( 2, now + 1000 ) );
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::Replayed, wheel.Insert( 1, now + 10 ) );
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::Unrecorded, wheel.Insert( 3, now + 10 ) );
+
+        wheel.Advance( now + 9 );
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::Replayed, wheel.Insert( 1, now + 10 ) );
+        wheel.Advance( now + 10 );
+        EXPECT_EQ( 1U, wheel.NumEntries() );
+        wheel.Advance( now + 999 );
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::Replayed, wheel.Insert( 2, now + 1000 ) );
+        wheel.Advance( now + 1000 );
+        EXPECT_EQ( 0U, wheel.NumEntries() );
+
+        LHWSUtilNS::JwtReplayGuardParams params;
+        params.maxEntries = 64;
+        params.maxLifetimeSeconds = 60;
+        auto replayGuard( LHWSUtilNS::GetStandardJwtReplayGuard( params ) );
+        long guardNow = std::chrono::duration_cast< std::chrono::seconds >(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::First, replayGuard->CheckAndRecord( "iss", 3, "jti", 3, guardNow + 30, guardNow ) );
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::Replayed, replayGuard->CheckAndRecord( "iss", 3, "jti", 3, guardNow + 30, guardNow + 29 ) );
+        // the same jti from another issuer is another token
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::First, replayGuard->CheckAndRecord( "other", 5, "jti", 3, guardNow + 30, guardNow + 29 ) );
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::First, replayGuard->CheckAndRecord( "is", 2, "sjti", 4, guardNow + 30, guardNow + 29 ) );
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::First, replayGuard->CheckAndRecord( "iss", 3, "jti", 3, guardNow + 60, guardNow + 30 ) );
+        EXPECT_EQ( LHWSUtilNS::JwtReplayCheck::Unrecorded, replayGuard->CheckAndRecord( "iss", 3, "long", 4, guardNow + 91, guardNow + 30 ) );
+        EXPECT_EQ( LHWSUtilNS::JwtReplayFailMode::Closed, replayGuard->GetFailMode() );
+
+        LHWSUtilNS::JwtValidatorParams validatorParams;
+        validatorParams.replayGuard = replayGuard;
+        LHWSUtilImplNS::JwtValidatorFactory jwtValidatorFactory;
+        EXPECT_NE( nullptr, jwtValidatorFactory.CreateJwtValidator( validatorParams ) );
+    }
+
+    TEST( TestLHWSUtil, JwtValidationChecksRejectBeforeVerifying )
+    {
+        const long now = 1767225600L;
+        LHWSUtilNS::JwtValidationChecks checks;
+        rapidjson::Document headerJson;
+        rapidjson::Document payloadJson;
+        LHWSUtilImplNS::JwtCheckedFields fields;
+
+        EXPECT_EQ( 0, LHWSUtilImplNS::CheckJwtShape( "eyJh.eyJi.c2ln", checks ) );
+        EXPECT_EQ( 0, LHWSUtilImplNS::CheckJwtShape( "eyJh.eyJi.", checks ) );
+        EXPECT_EQ( 2, LHWSUtilImplNS::CheckJwtShape( "eyJh.eyJi", checks ) );
+        EXPECT_EQ( 2, LHWSUtilImplNS::CheckJwtShape( ".eyJi.c2ln", checks ) );
+        EXPECT_EQ( 2, LHWSUtilImplNS::CheckJwtShape( "eyJh.eyJi.c2ln.x", checks ) );
+        EXPECT_EQ( 3, LHWSUtilImplNS::CheckJwtShape( "eyJh.ey+i.c2ln", checks ) );
+        checks.maxTokenSize = 8;
+        EXPECT_EQ( 1, LHWSUtilImplNS::CheckJwtShape( "eyJh.eyJi.c2ln", checks ) );
+
+        headerJson.Parse( "{\"alg\":\"RS256\"}" );
+        payloadJson.Parse( "{\"iss\":\"https://idp.test\",\"exp\":1767225660,\"nbf\":1767225600,\"aud\":[\"a\",\"b\"]}" );
+        LHWSUtilImplNS::GetJwtCheckedFields( headerJson, payloadJson, fields );
+        EXPECT_EQ( 0, LHWSUtilImplNS::CheckJwtFields( fields, checks, now ) );
+        // within the clock skew either side
+        EXPECT_EQ( 0, LHWSUtilImplNS::CheckJwtFields( fields, checks, now + 119 ) );
+        EXPECT_EQ( 5, LHWSUtilImplNS::CheckJwtFields( fields, checks, now + 120 ) );
+        EXPECT_EQ( 0, LHWSUtilImplNS::CheckJwtFields( fields, checks, now - 60 ) );
+        EXPECT_EQ( 6, LHWSUtilImplNS::CheckJwtFields( fields, checks, now - 61 ) );
+
+        checks.algs = { "ES256" };
+        EXPECT_EQ( 1, LHWSUtilImplNS::CheckJwtFields( fields, checks, now ) );
+        checks.algs = { "ES256", "RS256" };
+        checks.requireKid = true;
+        EXPECT_EQ( 2, LHWSUtilImplNS::CheckJwtFields( fields, checks, now ) );
+        checks.requireKid = false;
+        checks.issuers = { "https://other.test" };
+        EXPECT_EQ( 3, LHWSUtilImplNS::CheckJwtFields( fields, checks, now ) );
+        checks.issuers.clear();
+        checks.audiences = { "c" };
+        EXPECT_EQ( 7, LHWSUtilImplNS::CheckJwtFields( fields, checks, now ) );
+        checks.audiences = { "c", "b" };
+        EXPECT_EQ( 0, LHWSUtilImplNS::CheckJwtFields( fields, checks, now ) );
+
+        payloadJson.Parse( "{\"iss\":\"https://idp.test\",\"aud\":\"b\",\"exp\":\"soon\"}" );
+        LHWSUtilImplNS::GetJwtCheckedFields( headerJson, payloadJson, fields );
+        EXPECT_EQ( 4, LHWSUtilImplNS::CheckJwtFields( fields, checks, now ) );
+        payloadJson.Parse( "{\"iss\":\"https://idp.test\",\"aud\":\"b\"}" );
+        LHWSUtilImplNS::GetJwtCheckedFields( headerJson, payloadJson, fields );
+        EXPECT_EQ( 0, LHWSUtilImplNS::CheckJwtFields( fields, checks, now ) );
+        checks.requireExp = true;
+        EXPECT_EQ( 4, LHWSUtilImplNS::CheckJwtFields( fields, checks, now ) );
+    }
+
+    TEST( TestLHWSUtil, JwtIssuerCacheFreezesIntoAPerfectHashTable )
+    {
+        const std::string issPrefix( "https://idp.example.com/realms/frozen-" );
+        LHWSUtilImplNS::JwtIssuerCache jwtIssuerCache;
+        LHWSUtilNS::JwtIssuerCacheParams cacheParams;
+        cacheParams.algToKeyPem[ "RS256" ] = "pem";
+
+        for ( int i = 0; i < 100; ++i )
+        {
+            cacheParams.iss = issPrefix + std::to_string( i );
+            jwtIssuerCache.LoadIssuer( cacheParams );
+        }
+
+        ASSERT_EQ( 0, jwtIssuerCache.Freeze() );
+        EXPECT_TRUE( jwtIssuerCache.IsFrozen() );
+        for ( int i = 0; i < 100; ++i )
+        {
+            EXPECT_EQ( issPrefix + std::to_string( i ), jwtIssuerCache.GetIssuer( issPrefix + std::to_string( i ) )->GetUrl() );
+        }
+        EXPECT_FALSE( jwtIssuerCache.IssuerIsLoaded( issPrefix + "100" ) );
+        EXPECT_THROW( jwtIssuerCache.GetIssuer( issPrefix + "100" ), std::runtime_error );
+
+        // issuers with the same url cannot be placed, the table throws and Freeze returns !=0 instead
+        std::vector< std::shared_ptr< LHWSUtilNS::IJwtIssuer > > sameUrlIssuers( 2, jwtIssuerCache.GetIssuer( issPrefix + "0" ) );
+        EXPECT_THROW( LHWSUtilImplNS::FrozenIssuerTable frozenTable( sameUrlIssuers ), std::runtime_error );
+
+        sameUrlIssuers.clear();
+
+        cacheParams.iss = issPrefix + "100";
+        EXPECT_THROW( jwtIssuerCache.LoadIssuer( cacheParams ), std::runtime_error );
+
+        // a table is freed once it is unfrozen and no lookup holds it, however often the cache is
+        // frozen and unfrozen under lookups
+        std::atomic< bool > lookingUp( true );
+        std::vector< std::thread > lookupThreads;
+        for ( int t = 0; t < 2; ++t )
+        {
+            lookupThreads.emplace_back( [ &jwtIssuerCache, &lookingUp, &issPrefix ]()
+            {
+                for ( int i = 0; lookingUp.load(); i = ( i + 1 ) % 100 )
+                {
+                    EXPECT_TRUE( jwtIssuerCache.IssuerIsLoaded( issPrefix + std::to_string( i ) ) );
+                }
+            } );
+        }
+        for ( int i = 0; i < 100; ++i )
+        {
+            jwtIssuerCache.Unfreeze();
+            EXPECT_EQ( 0, jwtIssuerCache.Freeze() );
+        }
+        lookingUp.store( false );
+        for ( auto& lookupThread : lookupThreads )
+        {
+            lookupThread.join();
+        }
+
+        std::shared_ptr< LHWSUtilNS::IJwtIssuer > jwtIssuer( jwtIssuerCache.GetIssuer( issPrefix + "0" ) );
+        // held by the cache, the table and jwtIssuer
+        EXPECT_EQ( 3, jwtIssuer.use_count() );
+        jwtIssuerCache.Unfreeze();
+        EXPECT_FALSE( jwtIssuerCache.IsFrozen() );
+        EXPECT_EQ( 2, jwtIssuer.use_count() );
+        jwtIssuerCache.LoadIssuer( cacheParams );
+        EXPECT_TRUE( jwtIssuerCache.IssuerIsLoaded( issPrefix + "100" ) );
+    }
+
+    TEST( TestLHWSUtil, LazyJwtIssuerCacheLoadsOnFirstUseAndEvictsLru )
+    {
+        const std::string issPrefix( "https://idp.example.com/realms/" );
+        EXPECT_TRUE( LHWSUtilImplNS::IssMatchesPattern( issPrefix + "a", issPrefix + "*" ) );
+        EXPECT_FALSE( LHWSUtilImplNS::IssMatchesPattern( issPrefix, issPrefix + "*" ) );
+        EXPECT_FALSE( LHWSUtilImplNS::IssMatchesPattern( issPrefix + "a/b", issPrefix + "*" ) );
+        EXPECT_TRUE( LHWSUtilImplNS::IssMatchesPattern( "https://a.example.com", "https://*.example.com" ) );
+        EXPECT_FALSE( LHWSUtilImplNS::IssMatchesPattern( "https://a/.example.com", "https://*.example.com" ) );
+
+        LHWSUtilNS::LazyJwtIssuerCacheParams lazyParams;
+        lazyParams.allowedIssPatterns.push_back( issPrefix + "*" );
+        lazyParams.issuerParams.algToKeyPem[ "RS256" ] = "pem";
+        lazyParams.resolver = []( const std::string& iss, LHWSUtilNS::JwtIssuerCacheParams& cacheParams ) -> bool
+        {
+            cacheParams.algToKeyPem[ "RS256" ] = "pem";
+            return ( iss == "https://other.example.com" );
+        };
+
+        // the bytes of one issuer, each of a to d takes as many
+        std::vector< LHWSUtilNS::JwtIssuerMemoryUsage > usage;
+        size_t issuerBytes = 0;
+        {
+            LHWSUtilImplNS::LazyJwtIssuerCache unboundedCache( lazyParams );
+            ASSERT_EQ( issPrefix + "a", unboundedCache.GetIssuer( issPrefix + "a" )->GetUrl() );
+            issuerBytes = unboundedCache.GetMemoryUsage( usage );
+            ASSERT_EQ( 1U, usage.size() );
+            EXPECT_EQ( issuerBytes, usage[ 0 ].bytes );
+        }
+
+        lazyParams.maxMemoryBytes = ( 3 * issuerBytes ) + ( issuerBytes / 2 );
+        LHWSUtilImplNS::LazyJwtIssuerCache lazyCache( lazyParams );
+        EXPECT_FALSE( lazyCache.IssuerIsLoaded( issPrefix + "a" ) );
+        lazyCache.GetIssuer( issPrefix + "a" );
+        lazyCache.GetIssuer( issPrefix + "b" );
+        lazyCache.GetIssuer( issPrefix + "c" );
+        lazyCache.GetIssuer( issPrefix + "a" );
+        lazyCache.GetIssuer( issPrefix + "d" );
+        EXPECT_TRUE( lazyCache.IssuerIsLoaded( issPrefix + "a" ) );
+        EXPECT_FALSE( lazyCache.IssuerIsLoaded( issPrefix + "b" ) );
+        EXPECT_TRUE( lazyCache.IssuerIsLoaded( issPrefix + "c" ) );
+        EXPECT_TRUE( lazyCache.IssuerIsLoaded( issPrefix + "d" ) );
+
+        usage.clear();
+        EXPECT_EQ( 3 * issuerBytes, lazyCache.GetMemoryUsage( usage ) );
+        EXPECT_EQ( 3U, usage.size() );
+
+        EXPECT_EQ( "https://other.example.com", lazyCache.GetIssuer( "https://other.example.com" )->GetUrl() );
+        EXPECT_THROW( lazyCache.GetIssuer( issPrefix + "a/b" ), std::runtime_error );
+        EXPECT_THROW( lazyCache.GetIssuer( "https://unknown.example.com" ), std::runtime_error );
+        EXPECT_FALSE( lazyCache.IssuerIsLoaded( "https://unknown.example.com" ) );
+        EXPECT_EQ( 2, lazyCache.Freeze() );
+    }
+
+    // implements only what IJwtIssuer has always required, the rest falls back on its defaults
+    class BaselineJwtIssuer : public LHWSUtilNS::IJwtIssuer
+    {
+        public:
+            BaselineJwtIssuer()
+                : LHWSUtilNS::IJwtIssuer()
+                , url( "https://idp.example.com" )
+                , keyPem( "hs256 secret" )
+                , empty()
+            {
+            }
+
+            const std::string& GetUrl() const
+            {
+                return url;
+            }
+
+            bool AlgIsSupported( const std::string& alg ) const
+            {
+                return ( alg == "HS256" );
+            }
+
+            const std::string& GetKeyPemForAlg( const std::string& alg ) const
+            {
+                if ( !( AlgIsSupported( alg ) ) )
+                {
+                    throw std::runtime_error( "unsupported alg[" + alg + "]" );
+                }
+
+                return keyPem;
+            }
+
+            const std::string& GetClientAuthzBearerToken() const
+            {
+                return empty;
+            }
+
+            const std::string& GetOpenIdConfiguration() const
+            {
+                return empty;
+            }
+
+            std::string url;
+            std::string keyPem;
+            std::string empty;
+    };
+
+    TEST( TestLHWSUtil, JwtIssuerPacksItsFieldsIntoOneRecord )
+    {
+        LHWSUtilImplNS::JwtIssuerFields fields;
+        fields.url = "https://idp.example.com/realms/packed";
+        fields.clientAuthzBearerToken = "token";
+        fields.introspectionEndpoint = fields.url + "/introspect";
+        fields.algKeyPems.emplace_back( LHWSUtilNS::JwtAlg::RS256, "rs256 pem" );
+        fields.algKeyPems.emplace_back( LHWSUtilNS::JwtAlg::ES256, "es256 pem" );
+        fields.algKeyPems.emplace_back( LHWSUtilNS::JwtAlg::RS256, "second rs256 pem" );
+        fields.namedAlgKeyPems.emplace_back( "PS256", "ps256 pem" );
+        fields.namedAlgKeyPems.emplace_back( "EdDSA", "eddsa pem" );
+
+        LHWSUtilImplNS::JwtIssuer jwtIssuer( fields );
+        size_t recordBytes = jwtIssuer.GetMemoryUsage();
+        EXPECT_EQ( fields.url, jwtIssuer.GetUrlView().str() );
+        EXPECT_EQ( "token", jwtIssuer.GetClientAuthzBearerTokenView().str() );
+        EXPECT_EQ( fields.url + "/introspect", jwtIssuer.GetIntrospectionEndpoint().str() );
+        EXPECT_TRUE( jwtIssuer.GetJwksUri().empty() );
+        EXPECT_TRUE( jwtIssuer.GetOpenIdConfigurationView().empty() );
+
+        // the first pem of an alg is kept
+        EXPECT_EQ( "rs256 pem", jwtIssuer.GetKeyPemForAlgView( "RS256" ).str() );
+        EXPECT_EQ( '\0', jwtIssuer.GetKeyPemForAlgView( "RS256" ).data[ 9 ] );
+        EXPECT_EQ( "es256 pem", jwtIssuer.GetKeyPemForAlgView( "ES256" ).str() );
+        // algs which are not a JwtAlg are kept by name
+        EXPECT_EQ( "ps256 pem", jwtIssuer.GetKeyPemForAlgView( "PS256" ).str() );
+        EXPECT_EQ( "eddsa pem", jwtIssuer.GetKeyPemForAlgView( "EdDSA" ).str() );
+        EXPECT_FALSE( jwtIssuer.AlgIsSupported( "PS384" ) );
+        EXPECT_FALSE( jwtIssuer.AlgIsSupported( "HS256" ) );
+        EXPECT_FALSE( jwtIssuer.AlgIsSupported( "rs256" ) );
+        EXPECT_THROW( jwtIssuer.GetKeyPemForAlgView( "HS256" ), std::runtime_error );
+        EXPECT_EQ( recordBytes, jwtIssuer.GetMemoryUsage() );
+
+        // the std::string getters copy the record out once
+        const std::string& url( jwtIssuer.GetUrl() );
+        EXPECT_EQ( fields.url, url );
+        EXPECT_EQ( &url, &( jwtIssuer.GetUrl() ) );
+        EXPECT_EQ( "token", jwtIssuer.GetClientAuthzBearerToken() );
+        EXPECT_TRUE( jwtIssuer.GetOpenIdConfiguration().empty() );
+        EXPECT_EQ( "rs256 pem", jwtIssuer.GetKeyPemForAlg( "RS256" ) );
+        EXPECT_EQ( "es256 pem", jwtIssuer.GetKeyPemForAlg( "ES256" ) );
+        EXPECT_EQ( "eddsa pem", jwtIssuer.GetKeyPemForAlg( "EdDSA" ) );
+        EXPECT_THROW( jwtIssuer.GetKeyPemForAlg( "HS256" ), std::runtime_error );
+        EXPECT_LT( recordBytes, jwtIssuer.GetMemoryUsage() );
+
+        // the keys survive a trip through a SharedJwtCache record
+        std::string record;
+        LHWSUtilImplNS::JwtIssuerFields parsedFields;
+        LHWSUtilImplNS::SerializeJwtIssuer( jwtIssuer, record );
+        ASSERT_EQ( 0, LHWSUtilImplNS::ParseJwtIssuerRecord( record.data(), record.size(), parsedFields ) );
+        LHWSUtilImplNS::JwtIssuer parsedIssuer( parsedFields );
+        EXPECT_EQ( "rs256 pem", parsedIssuer.GetKeyPemForAlgView( "RS256" ).str() );
+        EXPECT_EQ( "ps256 pem", parsedIssuer.GetKeyPemForAlgView( "PS256" ).str() );
+        EXPECT_EQ( "eddsa pem", parsedIssuer.GetKeyPemForAlgView( "EdDSA" ).str() );
+        EXPECT_NE( 0, LHWSUtilImplNS::ParseJwtIssuerRecord( record.data(), record.size() - 1, parsedFields ) );
+
+        LHWSUtilNS::JwtIssuerCacheParams cacheParams;
+        std::shared_ptr< LHWSUtilImplNS::JwtIssuer > loadedIssuer;
+        cacheParams.iss = fields.url;
+        cacheParams.algToKeyPem[ "PS512" ] = "ps512 pem";
+        cacheParams.algToKeyPem[ "RS256" ] = "rs256 pem";
+        ASSERT_EQ( 0, LHWSUtilImplNS::LoadJwtIssuer( cacheParams, loadedIssuer ) );
+        ASSERT_TRUE( loadedIssuer );
+        EXPECT_EQ( "ps512 pem", loadedIssuer->GetKeyPemForAlgView( "PS512" ).str() );
+        EXPECT_EQ( "rs256 pem", loadedIssuer->GetKeyPemForAlgView( "RS256" ).str() );
+
+        // an issuer implementing only what IJwtIssuer always required has no endpoints, and views
+        // of its strings
+        BaselineJwtIssuer baselineIssuer;
+        EXPECT_TRUE( baselineIssuer.GetIntrospectionEndpoint().empty() );
+        EXPECT_STREQ( "", baselineIssuer.GetIntrospectionEndpoint().c_str() );
+        EXPECT_TRUE( baselineIssuer.GetJwksUri().empty() );
+        EXPECT_EQ( baselineIssuer.url.c_str(), baselineIssuer.GetUrlView().data );
+        EXPECT_EQ( baselineIssuer.url.size(), baselineIssuer.GetUrlView().size );
+        EXPECT_EQ( baselineIssuer.keyPem.c_str(), baselineIssuer.GetKeyPemForAlgView( "HS256" ).data );
+        EXPECT_THROW( baselineIssuer.GetKeyPemForAlgView( "RS256" ), std::runtime_error );
+        EXPECT_TRUE( baselineIssuer.GetClientAuthzBearerTokenView().empty() );
+        EXPECT_TRUE( baselineIssuer.GetOpenIdConfigurationView().empty() );
+    }
+
+    TEST( TestLHWSUtil, JwsVerifierVerifiesSignaturesWithPrefetchedContexts )
+    {
+        // RFC 7515 appendix A.1
+        std::vector< unsigned char > secret;
+        ASSERT_EQ( 0, LHSSLUtilNS::DecodeB64UrlStr(
+            "AyM1SysPpbyDfgZld3umj1qzKObwVMkoqQ-EstJQLr_T-1qS0gZH75aKtMN3Yj0iPS4hcgUuTwjAzZr1Z9CAow",
+            secret ) );
+        std::string signingInput(
+            "eyJ0eXAiOiJKV1QiLA0KICJhbGciOiJIUzI1NiJ9"
+            ".eyJpc3MiOiJqb2UiLA0KICJleHAiOjEzMDA4MTkzODAsDQogImh0dHA6Ly9leGFtcGxlLmNvbS9pc19yb290Ijp0cnVlfQ" );
+        std::string jwsStr( signingInput + ".dBjftJeZ4CVP-mB92K27uhbUJU1p1r_wW1gFWFOEjXk" );
+
+        LHWSUtilImplNS::JwsVerifier hsVerifier(
+            LHWSUtilNS::JwtAlg::HS256, reinterpret_cast< const char* >( secret.data() ), secret.size() );
+        EXPECT_EQ( 0, hsVerifier.VerifyCompact( jwsStr ) );
+        EXPECT_EQ( 0, hsVerifier.VerifyCompact( jwsStr ) );
+        EXPECT_EQ( 1, hsVerifier.VerifyCompact( signingInput + ".eBjftJeZ4CVP-mB92K27uhbUJU1p1r_wW1gFWFOEjXk" ) );
+        EXPECT_EQ( 1, hsVerifier.VerifyCompact( signingInput + "." ) );
+        EXPECT_EQ( 2, hsVerifier.VerifyCompact( signingInput ) );
+
+        secret[ 0 ] ^= 1;
+        LHWSUtilImplNS::JwsVerifier otherHsVerifier(
+            LHWSUtilNS::JwtAlg::HS256, reinterpret_cast< const char* >( secret.data() ), secret.size() );
+        EXPECT_EQ( 1, otherHsVerifier.VerifyCompact( jwsStr ) );
+
+        // the key is built from n and e without a pem and is only good for RS algs
+        std::vector< unsigned char > nBytes( 256, 0xc5 );
+        std::vector< unsigned char > eBytes{ 0x01, 0x00, 0x01 };
+        LHWSUtilImplNS::RSAPublicKey rsaPublicKey( nBytes, eBytes );
+        std::string pem;
+        ASSERT_EQ( 0, rsaPublicKey.GetPEMFormatInto( pem ) );
+        EXPECT_EQ( 0U, pem.find( "-----BEGIN PUBLIC KEY-----" ) );
+
+        LHWSUtilImplNS::JwsVerifier rsVerifier( LHWSUtilNS::JwtAlg::RS256, rsaPublicKey.GetKey() );
+        EXPECT_EQ( LHWSUtilNS::JwtAlg::RS256, rsVerifier.GetAlg() );
+        LHWSUtilImplNS::JwsVerifier pemRsVerifier( LHWSUtilNS::JwtAlg::RS512, pem.data(), pem.size() );
+        EXPECT_EQ( 1, pemRsVerifier.VerifyCompact( jwsStr ) );
+        EXPECT_THROW( LHWSUtilImplNS::JwsVerifier( LHWSUtilNS::JwtAlg::ES256, rsaPublicKey.GetKey() ),
+            std::runtime_error );
+        EXPECT_THROW( LHWSUtilImplNS::JwsVerifier( LHWSUtilNS::JwtAlg::RS256, "not a pem", 9 ),
+            std::runtime_error );
+    }
+
+    TEST( TestLHWSUtil, SharedJwtCacheSharesIssuersAndResultsBetweenProcesses )
+    {
+        std::string iss( "https://idp.example.com/realms/shared" );
+        std::string token( "eyJhbGciOiJSUzI1NiJ9.eyJpc3MiOiJzaGFyZWQifQ.c2ln" );
+        long now = std::chrono::duration_cast< std::chrono::seconds >(
+            std::chrono::system_clock::now().time_since_epoch() ).count();
+
+        LHWSUtilNS::SharedJwtCacheParams sharedParams;
+        sharedParams.name = "/lhwsutil.test." + std::to_string( getpid() );
+        sharedParams.maxIssuers = 4;
+        sharedParams.maxResults = 16;
+        sharedParams.role = LHWSUtilNS::SharedJwtCacheRole::Reader;
+        EXPECT_THROW( LHWSUtilNS::GetSharedJwtCache( sharedParams ), std::runtime_error );
+
+        sharedParams.role = LHWSUtilNS::SharedJwtCacheRole::Writer;
+        std::unique_ptr< LHWSUtilImplNS::SharedJwtCache > writer( new LHWSUtilImplNS::SharedJwtCache( sharedParams ) );
+
+        LHWSUtilNS::JwtIssuerCacheParams cacheParams;
+        cacheParams.iss = iss;
+        cacheParams.clientAuthzBearerToken = "token";
+        cacheParams.algToKeyPem[ "RS256" ] = "rs256 pem";
+        writer->LoadIssuer( cacheParams );
+        EXPECT_THROW( writer->LoadIssuer( cacheParams ), std::runtime_error );
+
+        // a worker forked from the writer opens the segment and records a result into it
+        pid_t worker = fork();
+        if ( worker == 0 )
+        {
+            sharedParams.role = LHWSUtilNS::SharedJwtCacheRole::Reader;
+            LHWSUtilImplNS::SharedJwtCache reader( sharedParams );
+            std::shared_ptr< LHWSUtilNS::IJwtIssuer > jwtIssuer( reader.GetIssuer( iss ) );
+            bool ok = ( jwtIssuer->GetKeyPemForAlgView( "RS256" ).str() == "rs256 pem" ) &&
+                ( jwtIssuer->GetClientAuthzBearerToken() == "token" ) &&
+                ( reader.GetIssuer( iss ) == jwtIssuer );
+            reader.RecordResult( token, true, now + 30, now );
+            _exit( ok ? 0 : 1 );
+        }
+        ASSERT_GT( worker, 0 );
+        int status = 0;
+        ASSERT_EQ( worker, waitpid( worker, &status, 0 ) );
+        EXPECT_TRUE( WIFEXITED( status ) && ( WEXITSTATUS( status ) == 0 ) );
+
+        EXPECT_EQ( LHWSUtilNS::SharedJwtResult::Active, writer->FindResult( token, now ) );
+        EXPECT_EQ( LHWSUtilNS::SharedJwtResult::Unknown, writer->FindResult( token, now + 30 ) );
+        EXPECT_EQ( LHWSUtilNS::SharedJwtResult::Unknown, writer->FindResult( token + "x", now ) );
+        writer->RecordResult( token, false, 0, now );
+        EXPECT_EQ( LHWSUtilNS::SharedJwtResult::Inactive, writer->FindResult( token, now ) );
+
+        // a refresh publishes the issuer again and readers build it again
+        sharedParams.role = LHWSUtilNS::SharedJwtCacheRole::Reader;
+        LHWSUtilImplNS::SharedJwtCache reader( sharedParams );
+        std::shared_ptr< LHWSUtilNS::IJwtIssuer > jwtIssuer( reader.GetIssuer( iss ) );
+        EXPECT_EQ( 0U, writer->Refresh() );
+        LHWSUtilNS::JwtIssuerStr heldKeyPem( jwtIssuer->GetKeyPemForAlgView( "RS256" ) );
+        EXPECT_NE( jwtIssuer, reader.GetIssuer( iss ) );
+        EXPECT_EQ( "rs256 pem", reader.GetIssuer( iss )->GetKeyPemForAlg( "RS256" ) );
+        // the replaced issuer, and the key a validation may still be verifying with, live on while held
+        EXPECT_EQ( 1, jwtIssuer.use_count() );
+        EXPECT_EQ( "rs256 pem", heldKeyPem.str() );
+
+        // lookups take no lock, and find the issuer however often it is published and built again
+        std::atomic< bool > lookingUp( true );
+        std::vector< std::thread > lookupThreads;
+        for ( int t = 0; t < 2; ++t )
+        {
+            lookupThreads.emplace_back( [ &reader, &lookingUp, &iss ]()
+            {
+                while ( lookingUp.load() )
+                {
+                    EXPECT_EQ( "rs256 pem", reader.GetIssuer( iss )->GetKeyPemForAlgView( "RS256" ).str() );
+                }
+            } );
+        }
+        for ( int i = 0; i < 100; ++i )
+        {
+            EXPECT_EQ( 0U, writer->Refresh() );
+        }
+        lookingUp.store( false );
+        for ( auto& lookupThread : lookupThreads )
+        {
+            lookupThread.join();
+        }
+        EXPECT_EQ( 2, reader.GetIssuer( iss ).use_count() );
+
+        EXPECT_TRUE( reader.IssuerIsLoaded( iss ) );
+        EXPECT_FALSE( reader.IssuerIsLoaded( iss + "/other" ) );
+        EXPECT_THROW( reader.GetIssuer( iss + "/other" ), std::runtime_error );
+        EXPECT_THROW( reader.LoadIssuer( cacheParams ), std::runtime_error );
+
+        // a worker killed while it may be mid record does not leave the slot unusable
+        pid_t recordingWorker = fork();
+        if ( recordingWorker == 0 )
+        {
+            LHWSUtilImplNS::SharedJwtCache workerReader( sharedParams );
+            for ( ;; )
+            {
+                workerReader.RecordResult( token, true, now + 30, now );
+            }
+        }
+        ASSERT_GT( recordingWorker, 0 );
+        std::this_thread::sleep_for( std::chrono::milliseconds( 50 ) );
+        kill( recordingWorker, SIGKILL );
+        ASSERT_EQ( recordingWorker, waitpid( recordingWorker, &status, 0 ) );
+        reader.RecordResult( token, false, 0, now );
+        EXPECT_EQ( LHWSUtilNS::SharedJwtResult::Inactive, reader.FindResult( token, now ) );
+
+        writer.reset();
+        EXPECT_THROW( LHWSUtilNS::GetSharedJwtCache( sharedParams ), std::runtime_error );
+        EXPECT_EQ( LHWSUtilNS::SharedJwtResult::Inactive, reader.FindResult( token, now ) );
+
+        // a writer which exits retires its segment, a reader maps the one a later writer creates
+        sharedParams.role = LHWSUtilNS::SharedJwtCacheRole::Writer;
+        pid_t dyingWriter = fork();
+        if ( dyingWriter == 0 )
+        {
+            LHWSUtilImplNS::SharedJwtCache childWriter( sharedParams );
+            cacheParams.algToKeyPem[ "RS256" ] = "dying rs256 pem";
+            childWriter.LoadIssuer( cacheParams );
+            // dies without retiring or unlinking its segment
+            _exit( 0 );
+        }
+        ASSERT_GT( dyingWriter, 0 );
+        ASSERT_EQ( dyingWriter, waitpid( dyingWriter, &status, 0 ) );
+        EXPECT_EQ( "dying rs256 pem", reader.GetIssuer( iss )->GetKeyPemForAlg( "RS256" ) );
+        EXPECT_EQ( LHWSUtilNS::SharedJwtResult::Unknown, reader.FindResult( token, now ) );
+
+        // a writer which replaces the segment of one which died retires it
+        writer.reset( new LHWSUtilImplNS::SharedJwtCache( sharedParams ) );
+        cacheParams.algToKeyPem[ "RS256" ] = "next rs256 pem";
+        writer->LoadIssuer( cacheParams );
+        EXPECT_EQ( "next rs256 pem", reader.GetIssuer( iss )->GetKeyPemForAlg( "RS256" ) );
+    }
+
+    // implements only the calls an ISimpleHttpClient had before response sinks
+    class BufferingHttpClient : public LHWSUtilNS::ISimpleHttpClient
+    {
+        public:
+            using LHWSUtilNS::ISimpleHttpClient::Get;
+            using LHWSUtilNS::ISimpleHttpClient::Post;
+
+            BufferingHttpClient( const std::string& _body, int _ret )
+            :   LHWSUtilNS::ISimpleHttpClient()
+            ,   body( _body )
+            ,   ret( _ret )
+            {
+            }
+
+            int Get( const std::string& url, std::string& responseBody )
+            {
+                return Get( url, LHWSUtilNS::HttpRequestParams(), responseBody );
+            }
+
+            int Get( const std::string&, const LHWSUtilNS::HttpRequestParams&, std::string& responseBody )
+            {
+                if ( ret == 0 )
+                {
+                    responseBody = body;
+                }
+                return ret;
+            }
+
+            int Post( const std::string& url,
+                      const std::string& data,
+                      const std::unordered_map< std::string, std::string >& headers,
+                      std::string& responseBody )
+            {
+                return Post( url, data, headers, LHWSUtilNS::HttpRequestParams(), responseBody );
+            }
+
+            int Post( const std::string& url,
+                      const std::string&,
+                      const std::unordered_map< std::string, std::string >&,
+                      const LHWSUtilNS::HttpRequestParams& params,
+                      std::string& responseBody )
+            {
+                return Get( url, params, responseBody );
+            }
+
+            std::string UrlEscape( const std::string& data )
+            {
+                return data;
+            }
+
+        private:
+            std::string body;
+            int ret;
+    };
+
+    class AbortingResponseSink : public LHWSUtilNS::IHttpResponseSink
+    {
+        public:
+            AbortingResponseSink()
+            :   LHWSUtilNS::IHttpResponseSink()
+            ,   finished( false )
+            {
+            }
+
+            void ExpectSize( size_t )
+            {
+            }
+
+            int Consume( const char*, size_t )
+            {
+                return 1;
+            }
+
+            int Finish()
+            {
+                finished = true;
+                return 0;
+            }
+
+            bool finished;
+    };
+
+    TEST( TestLHWSUtil, HttpResponseSinksCollectBodiesAndDefaultToBuffering )
+    {
+        const std::string body( "{\"active\":true,\"scope\":\"openid\"}" );
+        const std::string prefix( "prefix:" );
+        const std::unordered_map< std::string, std::string > headers;
+        LHWSUtilNS::HttpRequestParams params;
+
+        std::string stringOut( prefix );
+        LHWSUtilImplNS::StringResponseSink stringSink( stringOut );
+        stringSink.ExpectSize( body.size() );
+        EXPECT_LE( prefix.size() + body.size(), stringOut.capacity() );
+        EXPECT_EQ( 0, stringSink.Consume( body.data(), 10 ) );
+        EXPECT_EQ( 0, stringSink.Consume( body.data() + 10, body.size() - 10 ) );
+        EXPECT_EQ( 0, stringSink.Finish() );
+        EXPECT_EQ( prefix + body, stringOut );
+
+        // a Content-Length too large to trust is not reserved
+        std::string unreservedOut;
+        LHWSUtilImplNS::StringResponseSink unreservedSink( unreservedOut );
+        unreservedSink.ExpectSize( LHWSUtilImplNS::maxResponseSizeToReserve + 1 );
+        EXPECT_GT( LHWSUtilImplNS::maxResponseSizeToReserve, unreservedOut.capacity() );
+
+        LHWSUtilImplNS::JsonDocumentResponseSink jsonSink;
+        jsonSink.ExpectSize( body.size() );
+        EXPECT_EQ( 0, jsonSink.Consume( body.data(), 10 ) );
+        EXPECT_EQ( 0, jsonSink.Consume( body.data() + 10, body.size() - 10 ) );
+        ASSERT_EQ( 0, jsonSink.Finish() );
+        EXPECT_EQ( body.size(), jsonSink.GetBodySize() );
+        ASSERT_TRUE( jsonSink.GetDocument().IsObject() );
+        EXPECT_TRUE( jsonSink.GetDocument()[ "active" ].GetBool() );
+        EXPECT_EQ( std::string( "openid" ), jsonSink.GetDocument()[ "scope" ].GetString() );
+
+        LHWSUtilImplNS::JsonDocumentResponseSink emptySink;
+        EXPECT_EQ( 1, emptySink.Finish() );
+
+        LHWSUtilImplNS::JsonDocumentResponseSink malformedSink;
+        EXPECT_EQ( 0, malformedSink.Consume( body.data(), 10 ) );
+        EXPECT_EQ( 2, malformedSink.Finish() );
+
+        // a client written before sinks existed still streams into them through the defaults
+        BufferingHttpClient bufferingClient( body, 0 );
+        LHWSUtilNS::ISimpleHttpClient& simpleHttpClient( bufferingClient );
+
+        LHWSUtilImplNS::JsonDocumentResponseSink getSink;
+        ASSERT_EQ( 0, simpleHttpClient.Get( "http://127.0.0.1/", params, getSink ) );
+        EXPECT_TRUE( getSink.GetDocument()[ "active" ].GetBool() );
+
+        std::string postOut;
+        LHWSUtilImplNS::StringResponseSink postSink( postOut );
+        EXPECT_EQ( 0, simpleHttpClient.Post( "http://127.0.0.1/", "token=abc", headers, params, postSink ) );
+        EXPECT_EQ( body, postOut );
+
+        AbortingResponseSink abortingSink;
+        EXPECT_EQ( 1, simpleHttpClient.Post( "http://127.0.0.1/", "token=abc", headers, params, abortingSink ) );
+        EXPECT_FALSE( abortingSink.finished );
+
+        LHWSUtilImplNS::JsonDocumentResponseSink emptyBodySink;
+        BufferingHttpClient emptyClient( "", 0 );
+        EXPECT_EQ( 1, emptyClient.Get( "http://127.0.0.1/", params, emptyBodySink ) );
+
+        std::string failedOut;
+        LHWSUtilImplNS::StringResponseSink failedSink( failedOut );
+        BufferingHttpClient failingClient( body, 7 );
+        EXPECT_EQ( 7, failingClient.Get( "http://127.0.0.1/", params, failedSink ) );
+        EXPECT_TRUE( failedOut.empty() );
+    }
+
+    TEST( TestLHWSUtil, LatencyHistogramBoundsEveryBucketAndFindsPercentiles )
+    {
+        LHWSUtilImplNS::LatencyHistogram latencies;
+        LHWSUtilImplNS::LatencyHistogram merged;
+        std::vector< std::thread > threads;
+
+        for ( uint64_t micros = 0; micros < 10 * 1000 * 1000; micros += 1 + ( micros / 7 ) )
+        {
+            size_t bucket = LHWSUtilImplNS::LatencyBucketForMicros( micros );
+            uint64_t upperBound = LHWSUtilImplNS::LatencyBucketUpperBoundMicros( bucket );
+
+            ASSERT_LT( micros, upperBound );
+            ASSERT_TRUE( ( bucket == 0 ) || ( LHWSUtilImplNS::LatencyBucketUpperBoundMicros( bucket - 1 ) <= micros ) );
+            // no bucket is more than 25% wide
+            ASSERT_LE( upperBound * 4, ( micros * 5 ) + 4 );
+        }
+        EXPECT_EQ( LHWSUtilImplNS::numLatencyBuckets - 1, LHWSUtilImplNS::LatencyBucketForMicros( UINT64_MAX ) );
+
+        EXPECT_EQ( 0U, latencies.GetCount() );
+        EXPECT_EQ( 0U, latencies.GetPercentileMicros( 0.95 ) );
+
+        for ( int i = 0; i < 90; ++i )
+        {
+            latencies.Record( 100 );
+        }
+        for ( int i = 0; i < 10; ++i )
+        {
+            latencies.Record( 10000 );
+        }
+        EXPECT_EQ( 100U, latencies.GetCount() );
+        EXPECT_EQ( LHWSUtilImplNS::LatencyBucketUpperBoundMicros( LHWSUtilImplNS::LatencyBucketForMicros( 100 ) ),
+                   latencies.GetPercentileMicros( 0.5 ) );
+        EXPECT_EQ( LHWSUtilImplNS::LatencyBucketUpperBoundMicros( LHWSUtilImplNS::LatencyBucketForMicros( 10000 ) ),
+                   latencies.GetPercentileMicros( 0.95 ) );
+
+        merged.Merge( latencies );
+        merged.Merge( latencies );
+        EXPECT_EQ( 200U, merged.GetCount() );
+        EXPECT_EQ( latencies.GetPercentileMicros( 0.95 ), merged.GetPercentileMicros( 0.95 ) );
+
+        for ( int t = 0; t < 4; ++t )
+        {
+            threads.push_back( std::thread( [ &merged ]()
+            {
+                for ( int i = 0; i < 10000; ++i )
+                {
+                    merged.Record( i );
+                }
+            } ) );
+        }
+        for ( auto it = threads.begin(); it != threads.end(); ++it )
+        {
+            it->join();
+        }
+        EXPECT_EQ( 40200U, merged.GetCount() );
+    }
+
+    TEST( TestLHWSUtil, IntrospectionRequestParamsFollowTheDeadlineAndHedgePercentile )
+    {
+        LHWSUtilNS::JwtIntrospectionParams params;
+        LHWSUtilNS::HttpRequestParams noDeadline;
+        LHWSUtilNS::HttpRequestParams passed;
+        LHWSUtilNS::HttpRequestParams bounded;
+        LHWSUtilNS::HttpRequestParams unhedged;
+        LHWSUtilNS::HttpRequestParams hedged;
+        LHWSUtilNS::HttpRequestParams tooLateToHedge;
+
+        ASSERT_EQ( 0, LHWSUtilImplNS::FillIntrospectionRequestParams( params, noDeadline ) );
+        EXPECT_EQ( 0, noDeadline.connectTimeoutMs );
+        EXPECT_EQ( 0, noDeadline.timeoutMs );
+        EXPECT_EQ( 0, noDeadline.hedgeAfterMs );
+
+        params.deadline = std::chrono::steady_clock::now() - std::chrono::milliseconds( 1 );
+        EXPECT_NE( 0, LHWSUtilImplNS::FillIntrospectionRequestParams( params, passed ) );
+
+        // the connect timeout never outlasts the deadline
+        params.connectTimeoutMs = 60000;
+        params.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( 5000 );
+        ASSERT_EQ( 0, LHWSUtilImplNS::FillIntrospectionRequestParams( params, bounded ) );
+        EXPECT_LT( 0, bounded.timeoutMs );
+        EXPECT_GE( 5000, bounded.timeoutMs );
+        EXPECT_EQ( bounded.timeoutMs, bounded.connectTimeoutMs );
+
+        // hedging waits for enough samples, then hedges after their percentile
+        params.hedge = true;
+        params.hedgeMinSamples = LHWSUtilImplNS::IntrospectionLatencies().GetCount() + 1000;
+        ASSERT_EQ( 0, LHWSUtilImplNS::FillIntrospectionRequestParams( params, unhedged ) );
+        EXPECT_EQ( 0, unhedged.hedgeAfterMs );
+
+        for ( int i = 0; i < 1000; ++i )
+        {
+            LHWSUtilImplNS::IntrospectionLatencies().Record( 20000 );
+        }
+        ASSERT_EQ( 0, LHWSUtilImplNS::FillIntrospectionRequestParams( params, hedged ) );
+        EXPECT_EQ( static_cast< long >( LHWSUtilImplNS::IntrospectionLatencies().GetPercentileMicros( 0.95 ) / 1000 ),
+                   hedged.hedgeAfterMs );
+        EXPECT_LT( 0, hedged.hedgeAfterMs );
+
+        // a hedge which could not start before the deadline is not sent
+        params.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds( 5 );
+        ASSERT_EQ( 0, LHWSUtilImplNS::FillIntrospectionRequestParams( params, tooLateToHedge ) );
+        EXPECT_EQ( 0, tooLateToHedge.hedgeAfterMs );
+    }
+
+    // answers the n-th connection on localhost after delays[ n ], with body "n"
+    class DelayedHttpServer
+    {
+        public:
+            DelayedHttpServer( const std::vector< std::chrono::milliseconds >& _delays )
+            :   delays( _delays )
+            ,   listenFd( socket( AF_INET, SOCK_STREAM, 0 ) )
+            ,   port( 0 )
+            ,   numAccepted( 0 )
+            ,   stopping( false )
+            {
+                sockaddr_in addr;
+                socklen_t addrSize = sizeof( addr );
+
+                memset( &addr, 0, sizeof( addr ) );
+                addr.sin_family = AF_INET;
+                addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+                bind( listenFd, reinterpret_cast< sockaddr* >( &addr ), sizeof( addr ) );
+                listen( listenFd, 8 );
+                getsockname( listenFd, reinterpret_cast< sockaddr* >( &addr ), &addrSize );
+                port = ntohs( addr.sin_port );
+
+                acceptThread = std::thread( [ this ]()
+                {
+                    int fd;
+                    while ( ( fd = accept( listenFd, nullptr, nullptr ) ) >= 0 )
+                    {
+                        size_t n = numAccepted++;
+                        connectionThreads.push_back( std::thread( [ this, fd, n ]() { serve( fd, n ); } ) );
+                    }
+                } );
+            }
+
+            ~DelayedHttpServer()
+            {
+                {
+                    std::lock_guard< std::mutex > lock( stoppingMutex );
+                    stopping = true;
+                }
+                stoppingChanged.notify_all();
+                shutdown( listenFd, SHUT_RDWR );
+                acceptThread.join();
+                close( listenFd );
+                for ( auto it = connectionThreads.begin(); it != connectionThreads.end(); ++it )
+                {
+                    it->join();
+                }
+            }
+
+            std::string GetUrl() const
+            {
+                return "http://127.0.0.1:" + std::to_string( port ) + "/introspect";
+            }
+
+            size_t GetNumAccepted() const
+            {
+                return numAccepted;
+            }
+
+        private:
+            std::vector< std::chrono::milliseconds > delays;
+            int listenFd;
+            unsigned short port;
+            std::atomic< size_t > numAccepted;
+            std::mutex stoppingMutex;
+            std::condition_variable stoppingChanged;
+            bool stopping;
+            std::thread acceptThread;
+            std::vector< std::thread > connectionThreads;
+
+            void serve( int fd, size_t n )
+            {
+                std::string request;
+                char buffer[ 4096 ];
+                ssize_t numRead;
+
+                while ( ( request.find( "\r\n\r\n" ) == std::string::npos ) &&
+                        ( ( numRead = read( fd, buffer, sizeof( buffer ) ) ) > 0 ) )
+                {
+                    request.append( buffer, numRead );
+                }
+
+                std::unique_lock< std::mutex > lock( stoppingMutex );
+                if ( !( stoppingChanged.wait_for( lock, ( n < delays.size() ) ? delays[ n ] : std::chrono::milliseconds( 0 ),
+                                                  [ this ]() { return stopping; } ) ) )
+                {
+                    std::string body( std::to_string( n ) );
+                    std::string response( "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string( body.size() ) +
+                                          "\r\nConnection: close\r\n\r\n" + body );
+
+                    if ( write( fd, response.data(), response.size() ) < 0 )
+                    {
+                        response.clear();
+                    }
+                }
+                lock.unlock();
+
+                close( fd );
+            }
+    };
+
+    TEST( TestLHWSUtil, SimpleHttpClientHedgesSlowRequestsAndKeepsDeadlines )
+    {
+        const std::unordered_map< std::string, std::string > headers;
+        LHWSUtilImplNS::SimpleHttpClientCurl simpleHttpClient;
+
+        {
+            DelayedHttpServer server( { std::chrono::milliseconds( 5000 ), std::chrono::milliseconds( 0 ) } );
+            LHWSUtilNS::HttpRequestParams params;
+            std::string responseBody;
+
+            params.timeoutMs = 10000;
+            params.hedgeAfterMs = 50;
+            auto start( std::chrono::steady_clock::now() );
+            ASSERT_EQ( 0, simpleHttpClient.Post( server.GetUrl(), "token=abc", headers, params, responseBody ) );
+            EXPECT_GT( std::chrono::milliseconds( 4000 ), std::chrono::steady_clock::now() - start );
+            EXPECT_EQ( "1", responseBody );
+            EXPECT_EQ( 2U, server.GetNumAccepted() );
+        }
+
+        {
+            DelayedHttpServer server( { std::chrono::milliseconds( 0 ) } );
+            LHWSUtilNS::HttpRequestParams params;
+            std::string responseBody;
+
+            // a response quicker than the hedge delay sends no hedge
+            params.hedgeAfterMs = 2000;
+            ASSERT_EQ( 0, simpleHttpClient.Post( server.GetUrl(), "token=abc", headers, params, responseBody ) );
+            EXPECT_EQ( "0", responseBody );
+            EXPECT_EQ( 1U, server.GetNumAccepted() );
+        }
+
+        {
+            DelayedHttpServer server( { std::chrono::milliseconds( 5000 ) } );
+            LHWSUtilNS::HttpRequestParams params;
+            std::string responseBody;
+
+            params.timeoutMs = 100;
+            auto start( std::chrono::steady_clock::now() );
+            EXPECT_NE( 0, simpleHttpClient.Post( server.GetUrl(), "token=abc", headers, params, responseBody ) );
+            EXPECT_GT( std::chrono::milliseconds( 4000 ), std::chrono::steady_clock::now() - start );
+            EXPECT_TRUE( responseBody.empty() );
+        }
+    }
+
+    TEST( TestLHWSUtil, LoggingTruncatesPayloadsAndHonoursTheThreshold )
+    {
+        const std::string payload( "0123456789" );
+        std::ostringstream whole;
+        std::ostringstream truncated;
+        std::ostringstream empty;
+        int numEvaluated = 0;
+        auto evaluated = [ &numEvaluated ]() { return ++numEvaluated; };
+
+        whole << LHWSUtilNS::LogPayload( payload );
+        EXPECT_EQ( payload, whole.str() );
+        truncated << LHWSUtilNS::LogPayload( payload, 4 );
+        EXPECT_EQ( "0123...(10 bytes)", truncated.str() );
+        empty << LHWSUtilNS::LogPayload( nullptr, 10 );
+        EXPECT_EQ( "", empty.str() );
+
+        // records under the threshold are dropped before their message is evaluated, plain
+        // wsUtilLog records are not
+        std::shared_ptr< std::ostringstream > allRecords( new std::ostringstream() );
+        LHWSUtilNS::EnableAsyncLogSink( allRecords, LHWSUtilNS::SeverityLevel::trace );
+        EXPECT_THROW( LHWSUtilNS::EnableAsyncLogSink( allRecords, LHWSUtilNS::SeverityLevel::trace ),
+                      std::runtime_error );
+
+        LHWSUtilNS::SetLogSeverityThreshold( LHWSUtilNS::SeverityLevel::fatal );
+        EXPECT_FALSE( LHWSUtilNS::LogSeverityEnabled( LHWSUtilNS::SeverityLevel::error ) );
+        EXPECT_TRUE( LHWSUtilNS::LogSeverityEnabled( LHWSUtilNS::SeverityLevel::fatal ) );
+        EXPECT_FALSE( wsUtilLogSeverityEnabled( LHWSUtilNS::SeverityLevel::error ) );
+        EXPECT_EQ( LHWSUTIL_MIN_LOG_SEVERITY <= static_cast< int >( LHWSUtilNS::SeverityLevel::fatal ),
+                   wsUtilLogSeverityEnabled( LHWSUtilNS::SeverityLevel::fatal ) );
+        wsUtilLogError( "dropped error " << evaluated() );
+        wsUtilLog( "plain record" );
+        EXPECT_EQ( 0, numEvaluated );
+
+        LHWSUtilNS::SetLogSeverityThreshold( LHWSUtilNS::SeverityLevel::trace );
+        wsUtilLogError( "kept error " << evaluated() );
+        EXPECT_EQ( 1, numEvaluated );
+        LHWSUtilNS::DisableAsyncLogSink();
+
+        EXPECT_NE( std::string::npos, allRecords->str().find( "[trace] plain record" ) );
+        EXPECT_NE( std::string::npos, allRecords->str().find( "[error] kept error 1" ) );
+        EXPECT_EQ( std::string::npos, allRecords->str().find( "dropped error" ) );
+
+        // the sink's own severity filters what reaches its stream
+        std::shared_ptr< std::ostringstream > errorRecords( new std::ostringstream() );
+        LHWSUtilNS::EnableAsyncLogSink( errorRecords, LHWSUtilNS::SeverityLevel::error );
+        wsUtilLogInfo( "info record" );
+        for ( size_t i = 0; i < 100; ++i )
+        {
+            wsUtilLogError( "error record " << i );
+        }
+        LHWSUtilNS::DisableAsyncLogSink();
+
+        EXPECT_EQ( std::string::npos, errorRecords->str().find( "info record" ) );
+        EXPECT_NE( std::string::npos, errorRecords->str().find( "[error] error record 0\n" ) );
+        EXPECT_NE( std::string::npos, errorRecords->str().find( "[error] error record 99\n" ) );
+    }
+
+    size_t countTraceEvents( const std::string& traceJson )
+    {
+        size_t numEvents = 0;
+
+        for ( size_t pos = traceJson.find( "\"ph\":\"X\"" ); pos != std::string::npos;
+              pos = traceJson.find( "\"ph\":\"X\"", pos + 1 ) )
+        {
+            ++numEvents;
+        }
+
+        return numEvents;
+    }
+
+    TEST( TestLHWSUtil, TraceScopesNameLogRecordsAndExportSampledSpans )
+    {
+        typedef boost::log::sinks::synchronous_sink< boost::log::sinks::text_ostream_backend > SinkType;
+        boost::shared_ptr< std::ostringstream > records( new std::ostringstream() );
+        auto backend( boost::make_shared< boost::log::sinks::text_ostream_backend >() );
+        std::string traceJson;
+
+        backend->add_stream( records );
+        auto sink( boost::make_shared< SinkType >( backend ) );
+        sink->set_formatter( boost::log::expressions::stream
+                             << boost::log::expressions::attr< boost::string_view >( LHWSUTIL_LOGGER_RECORD_ATTR_NAME_TRACE_SCOPE )
+                             << ": " << boost::log::expressions::smessage );
+        boost::log::core::get()->add_sink( sink );
+
+        EXPECT_STREQ( "", LHWSUtilNS::CurrentTraceScopeName() );
+        {
+            wsUtilLogSetScope( "outer" );
+            EXPECT_STREQ( "outer", LHWSUtilNS::CurrentTraceScopeName() );
+            {
+                LHWSUtilNS::TraceScope inner( "inner" );
+                wsUtilLogError( "in inner" );
+                inner.End();
+                inner.End();
+            }
+            EXPECT_STREQ( "outer", LHWSUtilNS::CurrentTraceScopeName() );
+            wsUtilLogError( "in outer" );
+        }
+        EXPECT_STREQ( "", LHWSUtilNS::CurrentTraceScopeName() );
+
+        boost::log::core::get()->remove_sink( sink );
+        EXPECT_NE( std::string::npos, records->str().find( "inner: in inner\n" ) );
+        EXPECT_NE( std::string::npos, records->str().find( "outer: in outer\n" ) );
+
+        // nothing is recorded until tracing is enabled
+        LHWSUtilNS::ClearTraceSpans();
+        LHWSUtilNS::GetChromeTraceJson( traceJson );
+        EXPECT_EQ( "{\"traceEvents\":[],\"displayTimeUnit\":\"ms\"}", traceJson );
+
+        // fresh threads so that which outermost scopes are sampled does not depend on earlier tests
+        LHWSUtilNS::TracingParams tracingParams;
+        tracingParams.sampleEvery = 1;
+        tracingParams.maxSpansPerTrace = 2;
+        LHWSUtilNS::EnableTracing( tracingParams );
+        std::thread( []()
+        {
+            LHWSUtilNS::TraceScope outer( "validate" );
+            {
+                wsUtilTraceSpan( "say \"hi\"" );
+            }
+            {
+                wsUtilTraceSpan( "second" );
+            }
+        } ).join();
+        LHWSUtilNS::GetChromeTraceJson( traceJson );
+        EXPECT_EQ( 2U, countTraceEvents( traceJson ) );
+        EXPECT_NE( std::string::npos, traceJson.find( "{\"name\":\"say \\\"hi\\\"\",\"cat\":\"lhwsutil\",\"ph\":\"X\"" ) );
+        EXPECT_NE( std::string::npos, traceJson.find( "\"name\":\"second\"" ) );
+        // spans are kept as they end, the outermost ends last and is beyond maxSpansPerTrace
+        EXPECT_EQ( std::string::npos, traceJson.find( "\"name\":\"validate\"" ) );
+
+        // 1 in sampleEvery outermost scopes is sampled, the oldest spans go beyond maxSpans
+        LHWSUtilNS::ClearTraceSpans();
+        tracingParams.sampleEvery = 2;
+        tracingParams.maxSpans = 3;
+        tracingParams.maxSpansPerTrace = 256;
+        LHWSUtilNS::EnableTracing( tracingParams );
+        std::thread( []()
+        {
+            for ( int i = 0; i < 8; ++i )
+            {
+                wsUtilTraceSpan( "sampled" );
+            }
+        } ).join();
+        LHWSUtilNS::GetChromeTraceJson( traceJson );
+        EXPECT_EQ( 3U, countTraceEvents( traceJson ) );
+
+        LHWSUtilNS::DisableTracing();
+        LHWSUtilNS::ClearTraceSpans();
+        std::thread( []()
+        {
+            wsUtilTraceSpan( "untraced" );
+        } ).join();
+        LHWSUtilNS::GetChromeTraceJson( traceJson );
+        EXPECT_EQ( 0U, countTraceEvents( traceJson ) );
+    }
+
+    TEST( TestLHWSUtil, JwtPolicyAllowsAndDeniesOnEachConditionKind )
+    {
+        rapidjson::Document payloadJson;
+        payloadJson.Parse( "{\"sub\":\"user\",\"scope\":\"openid orders:write\",\"aud\":[\"api\",\"web\"],"
+                           "\"email_verified\":true,\"age\":42,\"nickname\":\"true\","
+                           "\"realm_access\":{\"roles\":[\"admin\",\"user\"]}}" );
+        ASSERT_FALSE( payloadJson.HasParseError() );
+        LHWSUtilImplNS::ValidJwtJson jwt( payloadJson );
+
+        auto evaluate = [ &jwt, &payloadJson ]( const std::string& expression ) -> bool
+        {
+            LHWSUtilNS::JwtPolicy policy;
+            std::string errorStr;
+
+            EXPECT_EQ( 0, policy.Compile( expression, errorStr ) ) << errorStr;
+            LHWSUtilNS::JwtPolicyDecision decision( policy.Evaluate( jwt ) );
+            // ValidateIntoJwt and IntrospectJwt evaluate on the parsed payload, they must agree
+            EXPECT_TRUE( decision == LHWSUtilImplNS::EvaluateJwtPolicy( policy, payloadJson ) ) << expression;
+            return decision == LHWSUtilNS::JwtPolicyDecision::Allow;
+        };
+
+        EXPECT_TRUE( evaluate( "sub exists" ) );
+        EXPECT_TRUE( evaluate( "realm_access.roles exists" ) );
+        EXPECT_FALSE( evaluate( "acr exists" ) );
+        EXPECT_FALSE( evaluate( "realm_access.groups exists" ) );
+
+        EXPECT_TRUE( evaluate( "sub == user" ) );
+        EXPECT_FALSE( evaluate( "sub == admin" ) );
+        EXPECT_TRUE( evaluate( "aud == web" ) );
+        EXPECT_FALSE( evaluate( "aud == cli" ) );
+        EXPECT_TRUE( evaluate( "email_verified == true" ) );
+        EXPECT_FALSE( evaluate( "email_verified == false" ) );
+        EXPECT_TRUE( evaluate( "age == 42" ) );
+        EXPECT_FALSE( evaluate( "age == 43" ) );
+        EXPECT_TRUE( evaluate( "nickname == true" ) );
+        EXPECT_FALSE( evaluate( "acr == 1" ) );
+        // a quoted literal only matches a string, an object matches nothing
+        EXPECT_FALSE( evaluate( "email_verified == \"true\"" ) );
+        EXPECT_FALSE( evaluate( "age == \"42\"" ) );
+        EXPECT_FALSE( evaluate( "realm_access == admin" ) );
+
+        EXPECT_TRUE( evaluate( "scope contains orders:write" ) );
+        EXPECT_FALSE( evaluate( "scope contains orders" ) );
+        EXPECT_TRUE( evaluate( "realm_access.roles contains admin" ) );
+        EXPECT_FALSE( evaluate( "realm_access.roles contains root" ) );
+        EXPECT_FALSE( evaluate( "acr contains gold" ) );
+        EXPECT_FALSE( evaluate( "age contains 42" ) );
+        EXPECT_FALSE( evaluate( "realm_access contains roles" ) );
+
+        EXPECT_TRUE( evaluate( "sub exists AND scope contains openid AND realm_access.roles contains user" ) );
+        EXPECT_FALSE( evaluate( "sub exists AND scope contains openid AND realm_access.roles contains root" ) );
+
+        LHWSUtilNS::JwtPolicy policy;
+        LHWSUtilNS::JwtPolicyDecision decision( LHWSUtilNS::JwtPolicyDecision::Allow );
+        EXPECT_THROW( policy.RequireClaim( "" ), std::runtime_error );
+        EXPECT_THROW( policy.RequireClaimEquals( "realm_access..roles", "admin" ), std::runtime_error );
+        EXPECT_THROW( policy.RequireClaimContains( "/a~2", "admin" ), std::runtime_error );
+        EXPECT_EQ( 0U, policy.GetConditions().size() );
+
+        policy.RequireClaimContains( "scope", "openid" );
+        LHWSUtilImplNS::JwtValidatorFactory jwtValidatorFactory;
+        auto jwtValidator = jwtValidatorFactory.CreateJwtValidator();
+        EXPECT_EQ( nullptr, jwtValidator->ValidateIntoJwt( "abc", policy, decision ) );
+        EXPECT_TRUE( decision == LHWSUtilNS::JwtPolicyDecision::Deny );
+    }
+
+    TEST( TestLHWSUtil, ClaimProjectionProjectsPayloadsInOnePass )
+    {
+        struct Claims
+        {
+            std::string sub;
+            long exp;
+            std::vector< std::string > roles;
+            std::vector< std::string > scopes;
+            bool emailVerified;
+        };
+        LHWSUtilNS::ClaimProjection< Claims > projection;
+        Claims claims = Claims();
+
+        projection.MapString( "sub", &Claims::sub )
+                  .MapInt( "exp", &Claims::exp )
+                  .MapStringList( "roles", &Claims::roles )
+                  .MapStringList( "scope", &Claims::scopes )
+                  .MapBool( "email_verified", &Claims::emailVerified, false );
+
+        // the SAX pass over the payload and the pass over the parsed payload must agree
+        auto project = [ &projection ]( const std::string& payload, Claims& projected ) -> int
+        {
+            Claims parsedProjected = Claims();
+            rapidjson::Document payloadJson;
+
+            payloadJson.Parse( payload.c_str() );
+            int rc = LHWSUtilImplNS::ProjectClaims( payload, projection, &projected );
+            EXPECT_EQ( rc, LHWSUtilImplNS::ProjectClaims( payloadJson, projection, &parsedProjected ) ) << payload;
+            if ( rc == 0 )
+            {
+                EXPECT_EQ( projected.sub, parsedProjected.sub );
+                EXPECT_EQ( projected.exp, parsedProjected.exp );
+                EXPECT_EQ( projected.roles, parsedProjected.roles );
+                EXPECT_EQ( projected.scopes, parsedProjected.scopes );
+            }
+
+            return rc;
+        };
+
+        // nested objects and arrays are skipped, including claims of the same name inside them
+        ASSERT_EQ( 0, project( "{\"iss\":\"https://idp.test\","
+                               "\"realm_access\":{\"roles\":[\"nested\"],\"sub\":\"nested\"},"
+                               "\"groups\":[[\"nested\"],{\"sub\":\"nested\"}],"
+                               "\"sub\":\"user\",\"exp\":1767225660,"
+                               "\"roles\":[\"admin\",[\"nested\"],{\"sub\":\"nested\"},\"user\"],"
+                               "\"scope\":\"openid  email\"}", claims ) );
+        EXPECT_EQ( "user", claims.sub );
+        EXPECT_EQ( 1767225660L, claims.exp );
+        EXPECT_EQ( std::vector< std::string >( { "admin", "user" } ), claims.roles );
+        EXPECT_EQ( std::vector< std::string >( { "openid", "email" } ), claims.scopes );
+        EXPECT_FALSE( claims.emailVerified );
+
+        // a StringList from a single string, replacing what the list held
+        ASSERT_EQ( 0, project( "{\"sub\":\"user\",\"exp\":1,\"roles\":\"admin\",\"scope\":[\"openid\"],"
+                               "\"email_verified\":true}", claims ) );
+        EXPECT_EQ( std::vector< std::string >( { "admin" } ), claims.roles );
+        EXPECT_EQ( std::vector< std::string >( { "openid" } ), claims.scopes );
+        EXPECT_TRUE( claims.emailVerified );
+
+        // required claims missing, or null which counts as missing
+        EXPECT_EQ( 2, project( "{\"exp\":1,\"roles\":[],\"scope\":\"\"}", claims ) );
+        EXPECT_EQ( 2, project( "{\"sub\":null,\"exp\":1,\"roles\":[],\"scope\":\"\"}", claims ) );
+        EXPECT_EQ( 0, project( "{\"sub\":\"user\",\"exp\":1,\"roles\":[],\"scope\":\"\"}", claims ) );
+
+        // claims of the wrong type
+        EXPECT_EQ( 1, project( "{\"sub\":42,\"exp\":1,\"roles\":[],\"scope\":\"\"}", claims ) );
+        EXPECT_EQ( 1, project( "{\"sub\":\"user\",\"exp\":\"soon\",\"roles\":[],\"scope\":\"\"}", claims ) );
+        EXPECT_EQ( 1, project( "{\"sub\":\"user\",\"exp\":1.5,\"roles\":[],\"scope\":\"\"}", claims ) );
+        EXPECT_EQ( 1, project( "{\"sub\":\"user\",\"exp\":1,\"roles\":{\"admin\":true},\"scope\":\"\"}", claims ) );
+        EXPECT_EQ( 1, project( "{\"sub\":\"user\",\"exp\":1,\"roles\":[],\"scope\":\"\","
+                               "\"email_verified\":\"yes\"}", claims ) );
+        EXPECT_EQ( 1, project( "[\"sub\"]", claims ) );
+    }
+
+    // delegates to jwt, counting the calls which serialize a whole top level claim
+    class GrantJsonCountingJwt : public LHWSUtilNS::IValidJwt
+    {
+        public:
+            GrantJsonCountingJwt( const LHWSUtilNS::IValidJwt& _jwt )
+                : LHWSUtilNS::IValidJwt()
+                , numGrantJsonValues( 0 )
+                , jwt( _jwt )
+            {
+            }
+
+            int GetGrantBoolValue( const std::string& grant, bool& valueOut ) const
+            {
+                return jwt.GetGrantBoolValue( grant, valueOut );
+            }
+
+            int GetGrantIntValue( const std::string& grant, long& valueOut ) const
+            {
+                return jwt.GetGrantIntValue( grant, valueOut );
+            }
+
+            int GetGrantJsonValue( const std::string& grant, std::string& valueOut ) const
+            {
+                ++numGrantJsonValues;
+                return jwt.GetGrantJsonValue( grant, valueOut );
+            }
+
+            int GetGrantStrValue( const std::string& grant, std::string& valueOut ) const
+            {
+                return jwt.GetGrantStrValue( grant, valueOut );
+            }
+
+            void ToString( std::string& out, bool prettyPrint ) const
+            {
+                jwt.ToString( out, prettyPrint );
+            }
+
+            int GetClaimStrValue( const LHWSUtilNS::ClaimPath& path, std::string& valueOut ) const
+            {
+                return jwt.GetClaimStrValue( path, valueOut );
+            }
+
+            int GetClaimBoolValue( const LHWSUtilNS::ClaimPath& path, bool& valueOut ) const
+            {
+                return jwt.GetClaimBoolValue( path, valueOut );
+            }
+
+            int GetClaimIntValue( const LHWSUtilNS::ClaimPath& path, long& valueOut ) const
+            {
+                return jwt.GetClaimIntValue( path, valueOut );
+            }
+
+            int ClaimArrayContains( const LHWSUtilNS::ClaimPath& path,
+                                    const std::string& value,
+                                    bool& containsOut ) const
+            {
+                return jwt.ClaimArrayContains( path, value, containsOut );
+            }
+
+            int ForEachClaimStr( const LHWSUtilNS::ClaimPath& path,
+                                 const std::function< bool( const char* str, size_t strSize ) >& visitor ) const
+            {
+                return jwt.ForEachClaimStr( path, visitor );
+            }
+
+            mutable size_t numGrantJsonValues;
+
+        private:
+            const LHWSUtilNS::IValidJwt& jwt;
+    };
+
+    TEST( TestLHWSUtil, JwtPolicyFetchesEachClaimItNamesOnce )
+    {
+        rapidjson::Document payloadJson;
+        payloadJson.Parse( "{\"sub\":\"user\",\"age\":42,"
+                           "\"resource_access\":{\"my.api\":{\"roles\":[\"read\",\"write\"]}},"
+                           "\"org\":{\"name\":\"acme corp\",\"verified\":true,\"level\":3,\"unit\":{},\"ratio\":0.5}}" );
+        ASSERT_FALSE( payloadJson.HasParseError() );
+        LHWSUtilImplNS::ValidJwtJson validJwt( payloadJson );
+        GrantJsonCountingJwt jwt( validJwt );
+
+        auto evaluate = [ &jwt, &payloadJson ]( const std::string& expression ) -> bool
+        {
+            LHWSUtilNS::JwtPolicy policy;
+            std::string errorStr;
+
+            EXPECT_EQ( 0, policy.Compile( expression, errorStr ) ) << errorStr;
+            LHWSUtilNS::JwtPolicyDecision decision( policy.Evaluate( jwt ) );
+            EXPECT_TRUE( decision == LHWSUtilImplNS::EvaluateJwtPolicy( policy, payloadJson ) ) << expression;
+            return decision == LHWSUtilNS::JwtPolicyDecision::Allow;
+        };
+
+        EXPECT_TRUE( evaluate( "/resource_access/my.api/roles contains write" ) );
+        EXPECT_FALSE( evaluate( "/resource_access/my.api/roles contains admin" ) );
+        EXPECT_TRUE( evaluate( "/resource_access/my.api/roles/0 == read" ) );
+        EXPECT_TRUE( evaluate( "/resource_access/my.api/roles == write" ) );
+        EXPECT_TRUE( evaluate( "/resource_access/my.api/roles exists" ) );
+        EXPECT_TRUE( evaluate( "org.name == \"acme corp\"" ) );
+        EXPECT_TRUE( evaluate( "org.name contains acme" ) );
+        EXPECT_FALSE( evaluate( "org.name contains acme.corp" ) );
+        EXPECT_TRUE( evaluate( "org.verified == true" ) );
+        EXPECT_FALSE( evaluate( "org.verified == false" ) );
+        EXPECT_TRUE( evaluate( "org.level == 3" ) );
+        EXPECT_TRUE( evaluate( "org.level exists" ) );
+        EXPECT_FALSE( evaluate( "org.level == \"3\"" ) );
+        EXPECT_FALSE( evaluate( "org.level contains 3" ) );
+        EXPECT_FALSE( evaluate( "org.verified contains true" ) );
+        EXPECT_FALSE( evaluate( "org.unit == acme" ) );
+        EXPECT_FALSE( evaluate( "org.missing == acme" ) );
+        EXPECT_TRUE( evaluate( "org.unit exists" ) );
+        EXPECT_TRUE( evaluate( "org.ratio exists" ) );
+        EXPECT_TRUE( evaluate( "org exists" ) );
+        EXPECT_FALSE( evaluate( "/resource_access/other.api/roles exists" ) );
+        EXPECT_FALSE( evaluate( "org.name.first exists" ) );
+        EXPECT_EQ( 22U, jwt.numGrantJsonValues );
+
+        // however many conditions are on them
+        jwt.numGrantJsonValues = 0;
+        EXPECT_TRUE( evaluate( "org.name contains acme AND org.verified == true AND org.level == 3 AND "
+                               "sub exists AND age == 42" ) );
+        EXPECT_EQ( 3U, jwt.numGrantJsonValues );
+        EXPECT_FALSE( evaluate( "acr exists AND org.level == 3" ) );
+        EXPECT_EQ( 5U, jwt.numGrantJsonValues );
+    }
+
+    // loads a fresh issuer for every GetIssuer and keeps no reference to it, as though the issuer were
+    // evicted the moment it was handed out, and scribbles over its key when it is freed
+    class EvictingJwtIssuerCache : public LHWSUtilNS::IJwtIssuerCache
+    {
+        public:
+            EvictingJwtIssuerCache( const LHWSUtilNS::JwtIssuerCacheParams& _cacheParams )
+                : LHWSUtilNS::IJwtIssuerCache()
+                , numIssuersFreed( 0 )
+                , cacheParams( _cacheParams )
+            {
+            }
+
+            void LoadIssuer( const LHWSUtilNS::JwtIssuerCacheParams& )
+            {
+                throw std::runtime_error( "issuers are loaded on use" );
+            }
+
+            bool IssuerIsLoaded( const std::string& ) const
+            {
+                return false;
+            }
+
+            std::shared_ptr< LHWSUtilNS::IJwtIssuer > GetIssuer( const std::string& iss )
+            {
+                std::shared_ptr< LHWSUtilImplNS::JwtIssuer > jwtIssuer;
+                std::atomic< int >* freed = &numIssuersFreed;
+
+                if ( ( iss != cacheParams.iss ) || ( LHWSUtilImplNS::LoadJwtIssuer( cacheParams, jwtIssuer ) != 0 ) )
+                {
+                    throw std::runtime_error( "failed to load issuer" );
+                }
+
+                return std::shared_ptr< LHWSUtilNS::IJwtIssuer >( jwtIssuer.get(),
+                    [ jwtIssuer, freed ]( LHWSUtilNS::IJwtIssuer* evicted ) mutable
+                    {
+                        LHWSUtilNS::JwtIssuerStr keyPem( evicted->GetKeyPemForAlgView( "HS256" ) );
+                        std::memset( const_cast< char* >( keyPem.data ), 'x', keyPem.size );
+                        jwtIssuer.reset();
+                        ++( *freed );
+                    } );
+            }
+
+            std::atomic< int > numIssuersFreed;
+
+        private:
+            LHWSUtilNS::JwtIssuerCacheParams cacheParams;
+    };
+
+    TEST( TestLHWSUtil, ValidationHoldsItsIssuerUntilTheSignatureIsVerified )
+    {
+        const std::string iss( "https://idp.example.com/realms/evicting" );
+        const std::string secret( "a secret for hs256 which the evicted issuer holds" );
+        LHWSUtilNS::JwtIssuerCacheParams cacheParams;
+        jwt_t* jwt = nullptr;
+        char* encoded = nullptr;
+        std::string token;
+        LHWSUtilNS::ValidatedJwt validatedJwt;
+
+        cacheParams.iss = iss;
+        cacheParams.algToKeyPem[ "HS256" ] = secret;
+        cacheParams.pulldownOpenIdConfiguration = false;
+        auto jwtIssuerCache( std::make_shared< EvictingJwtIssuerCache >( cacheParams ) );
+        LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::SetInstance( jwtIssuerCache );
+        ASSERT_EQ( jwtIssuerCache, LHMiscUtilNS::Singleton< LHWSUtilNS::IJwtIssuerCache >::GetInstance() );
+        // a cache without a frozen table of its own is never frozen
+        std::vector< LHWSUtilNS::JwtIssuerMemoryUsage > usage;
+        EXPECT_EQ( 2, jwtIssuerCache->Freeze() );
+        EXPECT_FALSE( jwtIssuerCache->IsFrozen() );
+        EXPECT_EQ( 0U, jwtIssuerCache->GetMemoryUsage( usage ) );
+        EXPECT_TRUE( usage.empty() );
+
+        ASSERT_EQ( 0, jwt_new( &jwt ) );
+        ASSERT_EQ( 0, jwt_add_grants_json( jwt, ( "{\"iss\":\"" + iss + "\",\"sub\":\"user\","
+                                                  "\"scope\":\"openid profile\",\"roles\":[\"admin\",\"user\"],"
+                                                  "\"email_verified\":true,\"age\":42,\"nickname\":null,"
+                                                  "\"ratio\":0.5}" ).c_str() ) );
+        ASSERT_EQ( 0, jwt_set_alg( jwt,
+                                   JWT_ALG_HS256,
+                                   reinterpret_cast< const unsigned char* >( secret.data() ),
+                                   static_cast< int >( secret.size() ) ) );
+        encoded = jwt_encode_str( jwt );
+        ASSERT_NE( nullptr, encoded );
+        token.assign( encoded );
+        jwt_free_str( encoded );
+        jwt_free( jwt );
+
+        // the issuer is freed, and its key scribbled over, as soon as the validation lets go of it,
+        // which must not be before libjwt has verified the signature with the key
+        LHWSUtilImplNS::JwtValidatorFactory jwtValidatorFactory;
+        auto jwtValidator = jwtValidatorFactory.CreateJwtValidator();
+        EXPECT_NE( nullptr, jwtValidator->ValidateIntoJwt( token ) );
+        EXPECT_EQ( 1, jwtIssuerCache->numIssuersFreed.load() );
+
+        LHWSUtilNS::StaticJwtValidator< LHWSUtilNS::JwtAlg::HS256 > staticJwtValidator;
+        EXPECT_EQ( LHWSUtilNS::JwtValidationResult::Valid, staticJwtValidator.ValidateIntoJwt( token, validatedJwt ) );
+        EXPECT_EQ( 2, jwtIssuerCache->numIssuersFreed.load() );
+
+        // claims are projected from those libjwt decoded while verifying
+        struct Claims
+        {
+            std::string sub;
+            std::vector< std::string > scopes;
+            std::vector< std::string > roles;
+            bool emailVerified;
+            long age;
+            std::string nickname;
+        };
+        Claims claims;
+        LHWSUtilNS::ClaimProjection< Claims > projection;
+        projection.MapString( "sub", &Claims::sub )
+                  .MapStringList( "scope", &Claims::scopes )
+                  .MapStringList( "roles", &Claims::roles )
+                  .MapBool( "email_verified", &Claims::emailVerified )
+                  .MapInt( "age", &Claims::age )
+                  .MapString( "nickname", &Claims::nickname, false );
+        claims.emailVerified = false;
+        claims.age = 0;
+        claims.nickname = "unset";
+        ASSERT_EQ( 0, jwtValidator->ValidateIntoClaims( token, projection, claims ) );
+        EXPECT_EQ( "user", claims.sub );
+        EXPECT_EQ( std::vector< std::string >( { "openid", "profile" } ), claims.scopes );
+        EXPECT_EQ( std::vector< std::string >( { "admin", "user" } ), claims.roles );
+        EXPECT_TRUE( claims.emailVerified );
+        EXPECT_EQ( 42, claims.age );
+        // a null claim counts as absent
+        EXPECT_EQ( "unset", claims.nickname );
+        EXPECT_EQ( 3, jwtIssuerCache->numIssuersFreed.load() );
+
+        LHWSUtilNS::ClaimProjection< Claims > requiredNickname;
+        requiredNickname.MapString( "nickname", &Claims::nickname );
+        EXPECT_EQ( 2, jwtValidator->ValidateIntoClaims( token, requiredNickname, claims ) );
+        LHWSUtilNS::ClaimProjection< Claims > fractionalAge;
+        fractionalAge.MapInt( "ratio", &Claims::age );
+        EXPECT_EQ( 2, jwtValidator->ValidateIntoClaims( token, fractionalAge, claims ) );
+        LHWSUtilNS::ClaimProjection< Claims > listAsBool;
+        listAsBool.MapBool( "roles", &Claims::emailVerified );
+        EXPECT_EQ( 2, jwtValidator->ValidateIntoClaims( token, listAsBool, claims ) );
+
+        // the jwt allowed by a policy resolves its nested claims on the payload the policy was evaluated on
+        LHWSUtilNS::JwtPolicy policy;
+        LHWSUtilNS::JwtPolicyDecision decision( LHWSUtilNS::JwtPolicyDecision::Deny );
+        bool contains = false;
+        policy.RequireClaimContains( "roles", "admin" );
+        auto allowedJwt( jwtValidator->ValidateIntoJwt( token, policy, decision ) );
+        ASSERT_NE( nullptr, allowedJwt );
+        EXPECT_TRUE( decision == LHWSUtilNS::JwtPolicyDecision::Allow );
+        EXPECT_EQ( 0, allowedJwt->ClaimArrayContains( LHWSUtilNS::ClaimPath( "roles" ), "user", contains ) );
+        EXPECT_TRUE( contains );
+        EXPECT_EQ( 0, allowedJwt->GetClaimBoolValue( LHWSUtilNS::ClaimPath( "email_verified" ), claims.emailVerified ) );
+    }
+
+    // implements only the calls an IJwtValidator has always had to, the rest fall back on the
+    // interface's defaults, "valid" is a token with payloadJson's claims and any other is invalid
+    class BaselineJwtValidator : public LHWSUtilNS::IJwtValidator
+    {
+        public:
+            BaselineJwtValidator( const rapidjson::Value& _payloadJson )
+                : LHWSUtilNS::IJwtValidator()
+                , payloadJson( _payloadJson )
+            {
+            }
+
+            using LHWSUtilNS::IJwtValidator::ValidateIntoJwt;
+            using LHWSUtilNS::IJwtValidator::IntrospectJwt;
+
+            std::unique_ptr< LHWSUtilNS::IValidJwt > ValidateIntoJwt( const std::string& b64UrlEncodedJwt ) const
+            {
+                if ( b64UrlEncodedJwt != "valid" )
+                {
+                    return nullptr;
+                }
+
+                return std::unique_ptr< LHWSUtilNS::IValidJwt >( new LHWSUtilImplNS::ValidJwtJson( payloadJson ) );
+            }
+
+            std::unique_ptr< LHWSUtilNS::IValidJwt > IntrospectJwt( const std::string& b64UrlEncodedJwt ) const
+            {
+                return ValidateIntoJwt( b64UrlEncodedJwt );
+            }
+
+        private:
+            const rapidjson::Value& payloadJson;
+    };
+
+    class BaselineJwtValidatorFactory : public LHWSUtilNS::IJwtValidatorFactory
+    {
+        public:
+            BaselineJwtValidatorFactory( const rapidjson::Value& _payloadJson )
+                : LHWSUtilNS::IJwtValidatorFactory()
+                , payloadJson( _payloadJson )
+            {
+            }
+
+            using LHWSUtilNS::IJwtValidatorFactory::CreateJwtValidator;
+
+            std::unique_ptr< LHWSUtilNS::IJwtValidator > CreateJwtValidator() const
+            {
+                return std::unique_ptr< LHWSUtilNS::IJwtValidator >( new BaselineJwtValidator( payloadJson ) );
+            }
+
+        private:
+            const rapidjson::Value& payloadJson;
+    };
+
+    TEST( TestLHWSUtil, JwtValidatorDefaultsServeValidatorsWrittenBeforeThem )
+    {
+        rapidjson::Document payloadJson;
+        payloadJson.Parse( "{\"iss\":\"https://idp.test\",\"sub\":\"user\",\"exp\":1767225660,"
+                           "\"aud\":[\"web\",\"cli\"],\"scope\":\"openid email\"}" );
+        ASSERT_FALSE( payloadJson.HasParseError() );
+        BaselineJwtValidatorFactory jwtValidatorFactory( payloadJson );
+        LHWSUtilNS::JwtValidatorParams validatorParams;
+
+        // a factory which cannot honour params creates nothing rather than ignore them
+        validatorParams.replayGuard = LHWSUtilNS::GetStandardJwtReplayGuard( LHWSUtilNS::JwtReplayGuardParams() );
+        EXPECT_EQ( nullptr, jwtValidatorFactory.CreateJwtValidator( validatorParams ) );
+        auto jwtValidator = jwtValidatorFactory.CreateJwtValidator();
+        ASSERT_NE( nullptr, jwtValidator );
+
+        LHWSUtilNS::JwtIntrospectionParams introspectionParams;
+        EXPECT_NE( nullptr, jwtValidator->IntrospectJwt( "valid", introspectionParams ) );
+        EXPECT_EQ( nullptr, jwtValidator->IntrospectJwt( "invalid", introspectionParams ) );
+
+        // a policy is never evaluated by a validator which does not know them
+        LHWSUtilNS::JwtPolicy policy;
+        LHWSUtilNS::JwtPolicyDecision decision( LHWSUtilNS::JwtPolicyDecision::Allow );
+        policy.RequireClaim( "sub" );
+        EXPECT_EQ( nullptr, jwtValidator->ValidateIntoJwt( "valid", policy, decision ) );
+        EXPECT_TRUE( decision == LHWSUtilNS::JwtPolicyDecision::Deny );
+        decision = LHWSUtilNS::JwtPolicyDecision::Allow;
+        EXPECT_EQ( nullptr, jwtValidator->IntrospectJwt( "valid", introspectionParams, policy, decision ) );
+        EXPECT_TRUE( decision == LHWSUtilNS::JwtPolicyDecision::Deny );
+
+        LHWSUtilNS::ValidatedJwt validatedJwt;
+        const char* str = nullptr;
+        size_t strSize = 0;
+        long exp = 0;
+        EXPECT_EQ( LHWSUtilNS::JwtValidationResult::Valid, jwtValidator->ValidateIntoJwt( "valid", validatedJwt ) );
+        ASSERT_EQ( 0, validatedJwt.GetStrClaim( LHWSUtilNS::JwtStrClaim::Sub, str, strSize ) );
+        EXPECT_EQ( "user", std::string( str, strSize ) );
+        EXPECT_EQ( 0, validatedJwt.GetIntClaim( LHWSUtilNS::JwtIntClaim::Exp, exp ) );
+        EXPECT_EQ( 1767225660L, exp );
+        EXPECT_TRUE( validatedJwt.StrClaimHasToken( LHWSUtilNS::JwtStrClaim::Aud, "cli", 3 ) );
+        EXPECT_TRUE( validatedJwt.StrClaimHasToken( LHWSUtilNS::JwtStrClaim::Scope, "email", 5 ) );
+        EXPECT_EQ( LHWSUtilNS::JwtValidationResult::Invalid, jwtValidator->ValidateIntoJwt( "invalid", validatedJwt ) );
+        EXPECT_FALSE( validatedJwt.IsValid() );
+        EXPECT_EQ( 1, validatedJwt.GetStrClaim( LHWSUtilNS::JwtStrClaim::Sub, str, strSize ) );
+        EXPECT_EQ( LHWSUtilNS::JwtValidationResult::Valid,
+                   jwtValidator->IntrospectJwt( "valid", introspectionParams, validatedJwt ) );
+        EXPECT_EQ( 0, validatedJwt.GetStrClaim( LHWSUtilNS::JwtStrClaim::Iss, str, strSize ) );
+        EXPECT_EQ( "https://idp.test", std::string( str, strSize ) );
+        EXPECT_EQ( LHWSUtilNS::JwtValidationResult::Invalid,
+                   jwtValidator->IntrospectJwt( "invalid", introspectionParams, validatedJwt ) );
+
+        struct Claims
+        {
+            std::string sub;
+            std::vector< std::string > audiences;
+            std::string acr;
+        };
+        LHWSUtilNS::ClaimProjection< Claims > projection;
+        LHWSUtilNS::ClaimProjection< Claims > acrProjection;
+        Claims claims = Claims();
+        projection.MapString( "sub", &Claims::sub )
+                  .MapStringList( "aud", &Claims::audiences )
+                  .MapString( "acr", &Claims::acr, false );
+        acrProjection.MapString( "acr", &Claims::acr );
+
+        EXPECT_EQ( 0, jwtValidator->ValidateIntoClaims( "valid", projection, claims ) );
+        EXPECT_EQ( "user", claims.sub );
+        EXPECT_EQ( std::vector< std::string >( { "web", "cli" } ), claims.audiences );
+        EXPECT_EQ( 1, jwtValidator->ValidateIntoClaims( "invalid", projection, claims ) );
+        EXPECT_EQ( 2, jwtValidator->ValidateIntoClaims( "valid", acrProjection, claims ) );
+    }
 }